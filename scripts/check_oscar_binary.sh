@@ -0,0 +1,54 @@
+# round-trip check of the SMASH binary OSCAR writer (particle_list_format = 2)
+# against the OSCAR text writer (particle_list_format = 0)
+#
+# samples one event twice with the same seed, once per format, and compares
+# every particle with scripts/oscar_binary.py --check
+#
+# usage (from the iS3D directory, after building iS3D.e): sh scripts/check_oscar_binary.sh
+# (set IS3D to run another executable, e.g. IS3D=build/iS3D sh scripts/check_oscar_binary.sh)
+
+IS3D=${IS3D:-./iS3D.e}
+SCRIPTS=$(dirname "$0")
+
+echo "***** Checking the binary OSCAR particle list *****"
+
+cp iS3D_parameters.dat iS3D_parameters.dat.check_backup
+text_results=$(mktemp -d)
+
+restore()
+{
+    mv iS3D_parameters.dat.check_backup iS3D_parameters.dat
+    rm -r "$text_results"
+}
+trap restore EXIT
+
+set_parameter()
+{
+    sed -i -E "s/^(${1}[[:space:]]*=[[:space:]]*)[^[:space:]]+/\1${2}/" iS3D_parameters.dat
+}
+
+set_parameter operation 2
+set_parameter test_sampler 0
+set_parameter oversample 0
+set_parameter sampler_seed 1
+set_parameter max_events_in_memory 0
+set_parameter event_observables 0
+
+for format in 0 2
+do
+    set_parameter particle_list_format $format
+
+    sh clear_results.sh > /dev/null 2>&1
+    if ! $IS3D > /dev/null
+    then
+        echo "iS3D failed (particle_list_format = $format)"
+        exit 1
+    fi
+
+    if [ $format = 0 ]
+    then
+        mv results/particle_list_osc_*.dat "$text_results"
+    fi
+done
+
+python3 "$SCRIPTS/oscar_binary.py" results/particles_binary.bin --check "$text_results"
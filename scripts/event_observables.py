@@ -0,0 +1,47 @@
+#reader for the event-by-event observables written by iS3D (event_observables = 1, 2)
+#records use the same cuts as compute_observables.py
+#particles counted: the sampled hadrons, or their stable decay products if decay_sampled_hadrons = 1
+#
+#usage: python event_observables.py results/event_observables.dat
+
+import numpy as np
+import sys
+
+float_t = '<f8'
+int_t = '<i8'
+complex_t = '<c16'
+
+species = ['pion', 'kaon', 'proton', 'Lambda', 'Sigma0', 'Xi', 'Omega']
+
+#one record per event (Event_Observables_Record in src/cpp/EventObservables.h)
+observables_dtype = np.dtype([
+('event', int_t),
+('dNch_deta', float_t),
+('dET_deta', float_t),
+('dN_dy', [(s, float_t) for s in species]),
+('mean_pT', [(s, float_t) for s in species]),
+('pT_fluct', [('N', int_t), ('sum_pT', float_t), ('sum_pTsq', float_t)]),
+('flow', [('N', int_t), ('Qn', complex_t, 7)]),
+])
+
+
+def read_event_observables(filename):
+    return np.fromfile(filename, dtype=observables_dtype)
+
+
+if __name__ == '__main__':
+    events = read_event_observables(sys.argv[1])
+
+    print('events      = ' + str(len(events)))
+    print('<dNch/deta> = ' + str(events['dNch_deta'].mean()))
+
+    for s in species:
+        print('<dN/dy> ' + s + ' = ' + str(events['dN_dy'][s].mean()))
+
+    #two-particle cumulant vn{2}
+    N = events['flow']['N'].astype(float)
+    Qn = events['flow']['Qn']
+    pairs = N * (N - 1)
+    for n in range(1, 8):
+        vn2 = ((np.abs(Qn[:, n - 1])**2 - N).sum() / pairs.sum())
+        print('v' + str(n) + '{2}       = ' + str(np.sqrt(vn2) if vn2 > 0 else 0.0))
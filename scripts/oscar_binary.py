@@ -0,0 +1,121 @@
+#reader for the SMASH binary OSCAR2013 particle list written by iS3D (particle_list_format = 2)
+#and round-trip check against the OSCAR text files written by write_particle_list_OSC (particle_list_format = 0)
+#
+#usage: python oscar_binary.py results/particles_binary.bin
+#       python oscar_binary.py results/particles_binary.bin --check text_results_directory
+#
+#the check needs two sampler runs with the same sampler_seed (>= 0), one per particle_list_format,
+#and compares the header, the event blocks and every particle record (pdg, id, p^mu, x^mu, m)
+#(scripts/check_oscar_binary.sh runs both samplings on one event and the check)
+
+import os
+import struct
+import sys
+
+oscar_magic = b'SMSH'
+format_version = 7
+format_variant = 0
+
+record_format = '<9d3i'             #t x y z m p0 px py pz, pdg id charge
+record_size = struct.calcsize(record_format)
+event_end_format = '<Id?'           #event number, impact parameter, empty event
+event_end_size = struct.calcsize(event_end_format)
+
+text_columns = ('px', 'py', 'pz', 'E', 'm', 'x', 'y', 'z', 't')
+
+
+class OscarBinary:
+    def __init__(self, filename):
+        self.file = open(filename, 'rb')
+
+        header = self.file.read(12)
+        if header[:4] != oscar_magic:
+            raise IOError(filename + ' is not a SMASH binary OSCAR file')
+
+        self.version, self.variant, length = struct.unpack('<HHI', header[4:])
+        if self.version != format_version or self.variant != format_variant:
+            raise IOError(filename + ' has format version %d variant %d (expected %d, %d)' % (self.version, self.variant, format_version, format_variant))
+
+        self.smash_version = self.file.read(length).decode()
+
+    def events(self):
+        #yields (event number, impact parameter, empty event, list of particle dicts) for each event
+        particles = []
+
+        while True:
+            block = self.file.read(1)
+            if block == b'':
+                if particles:
+                    raise IOError('particle block without event end block (file incomplete?)')
+                return
+
+            if block == b'p':
+                count = struct.unpack('<I', self.file.read(4))[0]
+                data = self.file.read(count * record_size)
+                if len(data) != count * record_size:
+                    raise IOError('particle block truncated (file incomplete?)')
+
+                for values in struct.iter_unpack(record_format, data):
+                    particles.append(dict(zip(('t', 'x', 'y', 'z', 'm', 'E', 'px', 'py', 'pz', 'pdg', 'id', 'charge'), values)))
+
+            elif block == b'f':
+                event, impact_parameter, empty = struct.unpack(event_end_format, self.file.read(event_end_size))
+                yield event, impact_parameter, empty, particles
+                particles = []
+
+            else:
+                raise IOError('unknown block type ' + repr(block))
+
+
+def read_oscar_text(filename):
+    particles = []
+
+    with open(filename) as oscar:
+        if oscar.readline().split() != ['n', 'pid'] + list(text_columns):
+            raise IOError(filename + ' has an unexpected OSCAR header')
+
+        for line in oscar:
+            fields = line.split()
+            particle = dict(zip(text_columns, [float(value) for value in fields[2:]]))
+            particle['id'], particle['pdg'] = int(fields[0]), int(fields[1])
+            particles.append(particle)
+
+    return particles
+
+
+def check_against_text(binary_filename, text_directory, rtol = 1.e-8):
+    #compare each binary event with results/particle_list_osc_<event + 1>.dat
+    store = OscarBinary(binary_filename)
+    mismatches = 0
+    nevents = 0
+
+    for event, impact_parameter, empty, particles in store.events():
+        text = read_oscar_text(os.path.join(text_directory, 'particle_list_osc_%d.dat' % (event + 1)))
+
+        if len(text) != len(particles) or empty != (len(particles) == 0):
+            print('event %d: %d binary vs %d text particles' % (event, len(particles), len(text)))
+            mismatches += 1
+            continue
+
+        for a, b in zip(particles, text):
+            same = a['pdg'] == b['pdg'] and a['id'] == b['id']
+            same = same and all(abs(a[name] - b[name]) <= rtol * abs(b[name]) for name in text_columns)
+            if not same:
+                print('event %d particle %d differs:\n  binary %s\n  text   %s' % (event, a['id'], a, b))
+                mismatches += 1
+                break
+
+        nevents += 1
+
+    print('Checked %d events (format version %d, %s): %d mismatches' % (nevents, store.version, store.smash_version, mismatches))
+    return mismatches == 0
+
+
+if __name__ == '__main__':
+    binary_filename = sys.argv[1]
+
+    if len(sys.argv) > 3 and sys.argv[2] == '--check':
+        sys.exit(0 if check_against_text(binary_filename, sys.argv[3]) else 1)
+
+    for event, impact_parameter, empty, particles in OscarBinary(binary_filename).events():
+        print('event %d: %d particles' % (event, len(particles)))
@@ -0,0 +1,91 @@
+#reader for the binary particle store written by iS3D (particle_list_format = 1)
+#and converter to the OSCAR text files written by write_particle_list_OSC
+#
+#usage: python particle_store.py results/particle_list.bin [output_directory]
+
+import numpy as np
+import os
+import sys
+
+store_magic = b'iS3Dpart'
+index_magic = b'iS3Dindx'
+header_size = 16
+store_version = 1
+
+
+def record_dtype(precision):
+    float_t = '<f4' if precision == 4 else '<f8'
+    return np.dtype([('pdg', '<i4')] + [(name, float_t) for name in ('t', 'x', 'y', 'z', 'E', 'px', 'py', 'pz', 'm')])
+
+
+class ParticleStore:
+    def __init__(self, filename):
+        self.file = open(filename, 'rb')
+
+        header = self.file.read(header_size)
+        if header[:8] != store_magic:
+            raise IOError(filename + ' is not an iS3D particle store')
+
+        self.version, self.precision = np.frombuffer(header[8:], dtype='<i4')
+        if self.version != store_version:
+            raise IOError(filename + ' has version %d (expected %d)' % (self.version, store_version))
+        if self.precision not in (4, 8):
+            raise IOError(filename + ' has precision %d (must be 4 or 8)' % self.precision)
+        self.dtype = record_dtype(self.precision)
+
+        #event index at the end of the file
+        file_size = self.file.seek(0, os.SEEK_END)
+        if file_size < header_size + 24:
+            raise IOError(filename + ' has no event index (file incomplete?)')
+
+        self.file.seek(-16, os.SEEK_END)
+        trailer = self.file.read(16)
+        if trailer[8:] != index_magic:
+            raise IOError(filename + ' has no event index (file incomplete?)')
+
+        nevents = int(np.frombuffer(trailer[:8], dtype='<u8')[0])
+        if nevents > (file_size - header_size - 16) // 8 - 1:
+            raise IOError(filename + ' claims %d events, more than the file can index' % nevents)
+
+        records_end = file_size - 16 - 8 * (nevents + 1)
+        self.file.seek(records_end)
+        self.event_offset = np.frombuffer(self.file.read(8 * (nevents + 1)), dtype='<u8')
+
+        #events are back to back whole records from the end of the header to the start of the index
+        sizes = np.diff(self.event_offset.astype('<i8'))
+        if self.event_offset[0] != header_size or self.event_offset[-1] != records_end or (sizes < 0).any() or (sizes % self.dtype.itemsize).any():
+            raise IOError(filename + ' has an inconsistent event index')
+
+    def __len__(self):
+        return len(self.event_offset) - 1
+
+    def event(self, ievent):
+        #structured array of the particles in event ievent (random access)
+        start, end = self.event_offset[ievent], self.event_offset[ievent + 1]
+        self.file.seek(int(start))
+        return np.frombuffer(self.file.read(int(end - start)), dtype=self.dtype)
+
+    def events(self):
+        for ievent in range(len(self)):
+            yield self.event(ievent)
+
+
+def convert_to_oscar(store_filename, output_directory):
+    store = ParticleStore(store_filename)
+
+    for ievent, particles in enumerate(store.events()):
+        filename = os.path.join(output_directory, 'particle_list_osc_%d.dat' % (ievent + 1))
+
+        with open(filename, 'w') as oscar:
+            oscar.write('n pid px py pz E m x y z t\n')
+            for n, p in enumerate(particles):
+                values = ' '.join('%.8e' % p[name] for name in ('px', 'py', 'pz', 'E', 'm', 'x', 'y', 'z', 't'))
+                oscar.write('%d %d %s\n' % (n, p['pdg'], values))
+
+    print('Converted ' + str(len(store)) + ' events to ' + output_directory)
+
+
+if __name__ == '__main__':
+    store_filename = sys.argv[1]
+    output_directory = sys.argv[2] if len(sys.argv) > 2 else os.path.dirname(store_filename)
+    convert_to_oscar(store_filename, output_directory)
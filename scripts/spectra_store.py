@@ -0,0 +1,138 @@
+#reader for the binary continuous spectra written by iS3D (spectra_output_format = 1)
+#and converter to the per-species text files of the continuous spectra writers
+#
+#usage: python spectra_store.py results/continuous/spectra.bin [output_directory]
+#
+#in python: store = SpectraStore('spectra.bin'); store.mcid, store.arrays (name -> (units, axes, shape)),
+#store.get('vn') (numpy array of the given shape if numpy is available, otherwise a flat array of doubles)
+
+from array import array
+import os
+import struct
+import sys
+
+spectra_magic = b'iS3Dspec'
+spectra_version = 2
+header_size = 24
+entry_format = '<32s16s32s2i4qQ'      #name, units, axes, rank, unused, shape[4], byte offset
+entry_size = struct.calcsize(entry_format)
+
+
+def unpack_string(value):
+    return value.split(b'\0', 1)[0].decode()
+
+
+class SpectraStore:
+    def __init__(self, filename):
+        self.file = open(filename, 'rb')
+
+        header = self.file.read(header_size)
+        if header[:8] != spectra_magic:
+            raise IOError(filename + ' is not an iS3D spectra file')
+
+        self.version, self.dimension, species, narrays = struct.unpack('<4i', header[8:])
+        if self.version != spectra_version:
+            raise IOError(filename + ' has version %d (this reader supports version %d)' % (self.version, spectra_version))
+
+        file_size = os.fstat(self.file.fileno()).st_size
+        data_start = header_size + 4 * species + entry_size * narrays
+        if species < 0 or narrays < 0 or data_start > file_size:
+            raise IOError(filename + ' has a truncated directory')
+        self.mcid = list(struct.unpack('<%di' % species, self.file.read(4 * species)))
+
+        self.arrays = {}
+        self.offsets = {}
+        for i in range(narrays):
+            entry = struct.unpack(entry_format, self.file.read(entry_size))
+            name, units, axes = [unpack_string(value) for value in entry[:3]]
+            rank, shape, offset = entry[3], entry[5:9], entry[9]
+
+            size = 1
+            for extent in shape:
+                size *= extent
+
+            valid = 1 <= rank <= 4 and rank == len(axes.split(',')) and all(extent >= 1 for extent in shape)
+            valid = valid and all(extent == 1 for extent in shape[rank:])
+            valid = valid and data_start <= offset and offset + 8 * size <= file_size
+            if not valid:
+                raise IOError('invalid directory entry %s (axes %s) in %s' % (name, axes, filename))
+
+            self.arrays[name] = (units, axes, tuple(shape[:rank]))
+            self.offsets[name] = offset
+
+    def flat(self, name):
+        #flat array of doubles (last axis fastest)
+        units, axes, shape = self.arrays[name]
+        size = 1
+        for extent in shape:
+            size *= extent
+
+        values = array('d')
+        self.file.seek(self.offsets[name])
+        values.frombytes(self.file.read(8 * size))
+        if sys.byteorder != 'little':
+            values.byteswap()
+        return values
+
+    def get(self, name):
+        values = self.flat(name)
+        try:
+            import numpy as np
+        except ImportError:
+            return values
+        return np.array(values).reshape(self.arrays[name][2])
+
+
+def convert_to_text(store_filename, output_directory):
+    store = SpectraStore(store_filename)
+
+    pT, phip, y = store.flat('pT'), store.flat('phip'), store.flat('y')
+    npT, nphip, ny = len(pT), len(phip), len(y)
+
+    #phip resolved arrays are missing for spectra_harmonics = 1
+    dN_pTdpTdphidy = store.flat('dN_pTdpTdphidy') if 'dN_pTdpTdphidy' in store.arrays else None
+    dN_dphidy = store.flat('dN_dphidy') if 'dN_dphidy' in store.arrays else None
+    dN_2pipTdpTdy, dN_dy, vn = store.flat('dN_2pipTdpTdy'), store.flat('dN_dy'), store.flat('vn')
+    harmonics = store.arrays['vn'][2][-1]
+
+    for ipart, mcid in enumerate(store.mcid):
+        def output(observable):
+            return open(os.path.join(output_directory, '%s_%d.dat' % (observable, mcid)), 'w')
+
+        if dN_pTdpTdphidy is not None:
+            with output('dN_pTdpTdphidy') as spectra:
+                spectra.write('y\tphip\tpT\tdN_pTdpTdphidy\n')
+                for iy in range(ny):
+                    for iphip in range(nphip):
+                        for ipT in range(npT):
+                            value = dN_pTdpTdphidy[iy + ny * (iphip + nphip * (ipT + npT * ipart))]
+                            spectra.write('%.8e\t%.8e\t%.8e\t%.8e\n' % (y[iy], phip[iphip], pT[ipT], value))
+                        spectra.write('\n')
+
+        if dN_dphidy is not None:
+            with output('dN_dphidy') as spectra:
+                for iy in range(ny):
+                    for iphip in range(nphip):
+                        spectra.write('%.8e\t%.8e\t%.8e\n' % (y[iy], phip[iphip], dN_dphidy[iphip + nphip * (iy + ny * ipart)]))
+                    if iy < ny - 1:
+                        spectra.write('\n')
+
+        with output('dN_2pipTdpTdy') as pT_spectra, output('dN_dy') as y_spectra, output('vn') as vn_file:
+            for iy in range(ny):
+                for ipT in range(npT):
+                    i = ipT + npT * (iy + ny * ipart)
+                    pT_spectra.write('%.8e\t%.8e\t%.8e\n' % (y[iy], pT[ipT], dN_2pipTdpTdy[i]))
+                    vn_file.write('%.8e\t%.8e' % (y[iy], pT[ipT]))
+                    vn_file.write(''.join('\t%.8e' % vn[k + harmonics * i] for k in range(harmonics)) + '\n')
+                if iy < ny - 1:
+                    pT_spectra.write('\n')
+                vn_file.write('\n')
+                y_spectra.write('%5.8g\t%.8g\n' % (y[iy], dN_dy[iy + ny * ipart]))
+
+    print('Converted the spectra of ' + str(len(store.mcid)) + ' species to ' + output_directory)
+
+
+if __name__ == '__main__':
+    store_filename = sys.argv[1]
+    output_directory = sys.argv[2] if len(sys.argv) > 2 else os.path.dirname(store_filename)
+    convert_to_text(store_filename, output_directory)
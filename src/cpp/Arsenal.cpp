@@ -9,6 +9,8 @@
 #include <iomanip>
 #include <cstdarg>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "Macros.h"
 #include "Arsenal.h"
 
@@ -231,4 +233,79 @@ void free_3D(double *** M, int n, int m)
 }
 
 
+uint64_t fnv1a_hash(const void * data, size_t bytes, uint64_t hash)
+{
+  // 64-bit FNV-1a hash (chained through hash)
+  const unsigned char * byte = (const unsigned char *)data;
+
+  for(size_t i = 0; i < bytes; i++)
+  {
+    hash ^= (uint64_t)byte[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+
+bool hash_file(string file_name, uint64_t & hash)
+{
+  // chain the content of a file into hash (false if the file doesn't exist)
+  FILE * file = fopen(file_name.c_str(), "rb");
+
+  if(file == NULL) return false;
 
+  char buffer[65536];
+  size_t bytes;
+
+  while((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    hash = fnv1a_hash(buffer, bytes, hash);
+  }
+
+  fclose(file);
+
+  return true;
+}
+
+
+FILE * open_temporary_file(string file_name, string & tmp_file)
+{
+  // create file_name.XXXXXX (unique, readable by other runs once renamed)
+  vector<char> name(file_name.begin(), file_name.end());
+  const char suffix[] = ".XXXXXX";
+  name.insert(name.end(), suffix, suffix + sizeof(suffix));
+
+  int fd = mkstemp(name.data());
+
+  if(fd < 0) return NULL;
+
+  fchmod(fd, 0644);
+
+  tmp_file = name.data();
+
+  FILE * file = fdopen(fd, "wb");
+
+  if(file == NULL)
+  {
+    close(fd);
+    remove(tmp_file.c_str());
+  }
+
+  return file;
+}
+
+
+bool install_temporary_file(FILE * file, string tmp_file, string file_name, bool written)
+{
+  // written = every fwrite count was checked by the caller
+  written = (fclose(file) == 0) && written;
+
+  if(!written || rename(tmp_file.c_str(), file_name.c_str()) != 0)
+  {
+    remove(tmp_file.c_str());
+    return false;
+  }
+
+  return true;
+}
@@ -5,6 +5,8 @@
 #include "stdlib.h"
 #include <vector>
 #include <string>
+#include <stdint.h>
+#include <stdio.h>
 
 using namespace std;
 
@@ -31,4 +33,14 @@ void vector_subtraction(const double a[], const double b[], double c[], int n);
 void free_2D(double ** M, int n);
 void free_3D(double *** M, int n, int m);
 
+// 64-bit FNV-1a hash of cached table inputs (chained through hash)
+const uint64_t fnv1a_offset = 14695981039346656037ULL;
+uint64_t fnv1a_hash(const void * data, size_t bytes, uint64_t hash);
+bool hash_file(string file_name, uint64_t & hash);    // chain the content of a file (false if it doesn't exist)
+
+// cache files are written to a uniquely named temporary file in the same directory and renamed into place,
+// so concurrent runs never see (or install) a partially written file
+FILE * open_temporary_file(string file_name, string & tmp_file);                             // NULL if it can't be created
+bool install_temporary_file(FILE * file, string tmp_file, string file_name, bool written);  // checked fclose + rename (removes tmp_file on failure)
+
 #endif
@@ -6,31 +6,41 @@
 
 using namespace std;
 
+void EmissionFunctionArray::define_sampled_histograms()
+{
+  // bins of the sampled distributions (same order as the observable enum in EmissionFunction.h)
+
+  Histogram_Axis y_axis(Y_BINS, -Y_CUT, Y_CUT);
+  Histogram_Axis pT_axis(PT_BINS, PT_MIN, PT_MAX);
+  Histogram_Axis phi_axis(PHIP_BINS, 0.0, two_pi);
+  Histogram_Axis eta_axis(ETA_BINS, -ETA_CUT, ETA_CUT);
+  Histogram_Axis tau_axis(TAU_BINS, TAU_MIN, TAU_MAX);
+  Histogram_Axis r_axis(R_BINS, R_MIN, R_MAX);
+
+  sampled_histogram = new Sampled_Histogram(number_of_chosen_particles);
+
+  sampled_histogram->add_observable(y_axis);                  // dN_dy_hist
+  sampled_histogram->add_observable(pT_axis);                 // dN_2pipTdpTdy_hist
+  sampled_histogram->add_observable(phi_axis);                // dN_dphipdy_hist
+  sampled_histogram->add_observable(pT_axis, 1 + 2 * K_MAX);  // vn_hist
+  sampled_histogram->add_observable(eta_axis);                // dN_deta_hist
+  sampled_histogram->add_observable(tau_axis);                // dN_taudtaudy_hist
+  sampled_histogram->add_observable(r_axis);                  // dN_twopirdrdy_hist
+  sampled_histogram->add_observable(phi_axis);                // dN_dphisdy_hist
+
+  sampled_histogram->allocate();
+}
+
 void EmissionFunctionArray::sample_dN_dy(int chosen_index, double y)
 {
   // bin sampled dN/dy
-
-  // bin index
-  int iy = (int)floor((y + Y_CUT) / Y_WIDTH);
-
-  // add counts
-  if(iy >= 0 && iy < Y_BINS)
-  {
-    dN_dy_count[chosen_index][iy] += 1.0;
-  }
+  sampled_histogram->fill(dN_dy_hist, chosen_index, y);
 }
 
 void EmissionFunctionArray::sample_dN_deta(int chosen_index, double eta)
 {
   // bin sampled dN/deta
-
-  // bin index
-  int ieta = (int)floor((eta + ETA_CUT) / ETA_WIDTH);
-
-  if(ieta >= 0 && ieta < ETA_BINS)
-  {
-    dN_deta_count[chosen_index][ieta] += 1.0;
-  }
+  sampled_histogram->fill(dN_deta_hist, chosen_index, eta);
 }
 
 void EmissionFunctionArray::sample_dN_dphipdy(int chosen_index, double px, double py)
@@ -44,14 +54,7 @@ void EmissionFunctionArray::sample_dN_dphipdy(int chosen_index, double px, doubl
     phip += two_pi;
   }
 
-  // bin index
-  int iphip = (int)floor(phip / PHIP_WIDTH);
-
-  // add counts
-  if(iphip >= 0 && iphip < PHIP_BINS)
-  {
-    dN_dphipdy_count[chosen_index][iphip] += 1.0;
-  }
+  sampled_histogram->fill(dN_dphipdy_hist, chosen_index, phip);
 }
 
 void EmissionFunctionArray::sample_dN_2pipTdpTdy(int chosen_index, double px, double py)
@@ -60,13 +63,7 @@ void EmissionFunctionArray::sample_dN_2pipTdpTdy(int chosen_index, double px, do
 
   double pT = sqrt(px*px + py*py);
 
-  // bin index
-  int ipT = (int)floor((pT - PT_MIN) / PT_WIDTH);
-
-  if(ipT >= 0 && ipT < PT_BINS)
-  {
-    dN_2pipTdpTdy_count[chosen_index][ipT] += 1.0;
-  }
+  sampled_histogram->fill(dN_2pipTdpTdy_hist, chosen_index, pT);
 }
 
 void EmissionFunctionArray::sample_vn(int chosen_index, double px, double py)
@@ -74,26 +71,21 @@ void EmissionFunctionArray::sample_vn(int chosen_index, double px, double py)
   // bin vn(pT)
 
   double pT = sqrt(px*px + py*py);
-  double phi = atan2(py, px);
-
-  if(phi < 0.0)
-  {
-    phi += two_pi;
-  }
 
-  // pT bin index
-  int ipT = (int)floor((pT - PT_MIN) / PT_WIDTH);
+  double * vn_count = sampled_histogram->bin_accumulators(vn_hist, chosen_index, pT);
 
-  if(ipT >= 0 && ipT < PT_BINS)
+  if(vn_count != NULL)
   {
+    double phi = atan2(py, px);
+
     // pT count
-    pT_count[chosen_index][ipT] += 1.0;
+    vn_count[0] += 1.0;
 
     for(int k = 0; k < K_MAX; k++)
     {
       // Vn count
-      vn_real_count[k][chosen_index][ipT] += cos(((double)k + 1.0) * phi);
-      vn_imag_count[k][chosen_index][ipT] += sin(((double)k + 1.0) * phi);
+      vn_count[1 + 2 * k] += cos(((double)k + 1.0) * phi);
+      vn_count[2 + 2 * k] += sin(((double)k + 1.0) * phi);
     }
   }
 }
@@ -111,23 +103,7 @@ void EmissionFunctionArray::sample_dN_dX(int chosen_index, double tau, double x,
     phi += two_pi;
   }
 
-  // bin indices
-  int itau = (int)floor((tau - TAU_MIN) / TAU_WIDTH);
-  int ir = (int)floor((r - R_MIN) / R_WIDTH);
-  int iphi = (int)floor(phi / PHIP_WIDTH);
-
-  if(itau >= 0 && itau < TAU_BINS)
-  {
-    dN_taudtaudy_count[chosen_index][itau] += 1.0;
-  }
-
-  if(ir >= 0 && ir < R_BINS)
-  {
-    dN_twopirdrdy_count[chosen_index][ir] += 1.0;
-  }
-
-  if(iphi >= 0 && iphi < PHIP_BINS)
-  {
-    dN_dphisdy_count[chosen_index][iphi] += 1.0;
-  }
+  sampled_histogram->fill(dN_taudtaudy_hist, chosen_index, tau);
+  sampled_histogram->fill(dN_twopirdrdy_hist, chosen_index, r);
+  sampled_histogram->fill(dN_dphisdy_hist, chosen_index, phi);
 }
@@ -0,0 +1,412 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef OPENMP
+  #include <omp.h>
+#endif
+
+#include "CooperFrye.h"
+
+using namespace std;
+
+
+Cooper_Frye_Evaluator::Cooper_Frye_Evaluator(ParameterReader * paraRdr, const FO_surf * surf_ptr, long FO_length, Deltaf_Data * df_data, const Particle_Table * particles_in, Table * eta_tab)
+{
+  dimension = paraRdr->getVal("dimension");
+  df_mode = paraRdr->getVal("df_mode");
+  regulate_deltaf = paraRdr->getVal("regulate_deltaf");
+  outflow = paraRdr->getVal("outflow");
+
+  int include_baryon = paraRdr->getVal("include_baryon");
+  int include_bulk_deltaf = paraRdr->getVal("include_bulk_deltaf");
+  int include_shear_deltaf = paraRdr->getVal("include_shear_deltaf");
+  int include_baryondiff_deltaf = paraRdr->getVal("include_baryondiff_deltaf");
+
+  bool baryon_diffusion = (include_baryon && include_baryondiff_deltaf);
+
+  if(df_mode != 1 && df_mode != 2)
+  {
+    printf("Cooper_Frye_Evaluator error: on-demand Cooper-Frye spectra need df_mode = (1,2)\n");
+    exit(-1);
+  }
+
+  if(dimension != 2 && dimension != 3)
+  {
+    printf("Cooper_Frye_Evaluator error: need to set dimension = (2,3)\n");
+    exit(-1);
+  }
+
+  cores = 1;
+
+#ifdef OPENMP
+  cores = omp_get_max_threads();
+#endif
+
+  // spacetime rapidity points (3+1d cells have their own eta)
+  if(dimension == 2)
+  {
+    for(long ieta = 0; ieta < eta_tab->getNumberOfRows(); ieta++)
+    {
+      eta_values.push_back(eta_tab->get(1, ieta + 1));
+      eta_weights.push_back(eta_tab->get(2, ieta + 1));
+    }
+  }
+  else
+  {
+    eta_values.push_back(0.0);
+    eta_weights.push_back(1.0);
+  }
+
+  mc_id = particles_in->mc_id;
+  mass = particles_in->mass;
+  sign = particles_in->sign;
+  degeneracy = particles_in->degeneracy;
+  baryon = particles_in->baryon;
+
+  // df coefficients of all cells (batch interpolation)
+  // (only the cells with u.dsigma > 0, the others are skipped below)
+  vector<double> T_fo(FO_length), E_fo(FO_length), P_fo(FO_length), muB_fo(FO_length), bulkPi_fo(FO_length);
+  vector<char> emitting(FO_length);
+
+  for(long icell = 0; icell < FO_length; icell++)
+  {
+    const FO_surf * surf = &surf_ptr[icell];
+
+    double tau2 = surf->tau * surf->tau;
+    double utperp = sqrt(1.0  +  surf->ux * surf->ux  +  surf->uy * surf->uy);
+    double ut = sqrt(utperp * utperp  +  tau2 * surf->un * surf->un);
+
+    emitting[icell] = (ut * surf->dat  +  surf->ux * surf->dax  +  surf->uy * surf->day  +  surf->un * surf->dan > 0.0);
+
+    T_fo[icell] = surf->T;
+    E_fo[icell] = surf->E;
+    P_fo[icell] = surf->P;
+    muB_fo[icell] = surf->muB;
+    bulkPi_fo[icell] = surf->bulkPi;
+  }
+
+  Deltaf_Coefficient_Columns df_columns;
+
+  df_data->evaluate_df_coefficients(FO_length, T_fo.data(), baryon_diffusion ? muB_fo.data() : NULL, E_fo.data(), P_fo.data(), include_bulk_deltaf ? bulkPi_fo.data() : NULL, emitting.data(), df_columns);
+
+  // momentum independent parts of the integrand (cells with u.dsigma > 0)
+  cells = 0;
+
+  for(long icell = 0; icell < FO_length; icell++)
+  {
+    const FO_surf * surf = &surf_ptr[icell];
+
+    double tau_c = surf->tau;
+    double tau2 = tau_c * tau_c;
+
+    double ux_c = surf->ux;                 // contravariant fluid velocity
+    double uy_c = surf->uy;                 // enforce normalization
+    double un_c = surf->un;
+    double ux2 = ux_c * ux_c;
+    double uy2 = uy_c * uy_c;
+    double utperp = sqrt(1.0  +  ux2  +  uy2);
+    double tau2_un_c = tau2 * un_c;
+    double ut_c = sqrt(utperp * utperp  +  tau2_un_c * un_c);
+    double ut2 = ut_c * ut_c;
+
+    if(ut_c * surf->dat  +  ux_c * surf->dax  +  uy_c * surf->day  +  un_c * surf->dan <= 0.0) continue;
+
+    double T = surf->T;
+    double E = surf->E;
+    double P = surf->P;
+
+    double pitt_c = 0.0;                    // contravariant shear stress tensor pi^munu (GeV/fm^3)
+    double pitx_c = 0.0;                    // enforce orthogonality pi.u = 0
+    double pity_c = 0.0;                    // and tracelessness Tr(pi) = 0
+    double pitn_c = 0.0;
+    double pixx_c = 0.0;
+    double pixy_c = 0.0;
+    double pixn_c = 0.0;
+    double piyy_c = 0.0;
+    double piyn_c = 0.0;
+    double pinn_c = 0.0;
+
+    if(include_shear_deltaf)
+    {
+      pixx_c = surf->pixx;
+      pixy_c = surf->pixy;
+      pixn_c = surf->pixn;
+      piyy_c = surf->piyy;
+      piyn_c = surf->piyn;
+      pinn_c = (pixx_c * (ux2 - ut2)  +  piyy_c * (uy2 - ut2)  +  2.0 * (pixy_c * ux_c * uy_c  +  tau2_un_c * (pixn_c * ux_c  +  piyn_c * uy_c))) / (tau2 * utperp * utperp);
+      pitn_c = (pixn_c * ux_c  +  piyn_c * uy_c  +  tau2_un_c * pinn_c) / ut_c;
+      pity_c = (pixy_c * ux_c  +  piyy_c * uy_c  +  tau2_un_c * piyn_c) / ut_c;
+      pitx_c = (pixx_c * ux_c  +  pixy_c * uy_c  +  tau2_un_c * pixn_c) / ut_c;
+      pitt_c = (pitx_c * ux_c  +  pity_c * uy_c  +  tau2_un_c * pitn_c) / ut_c;
+    }
+
+    double bulkPi = include_bulk_deltaf ? surf->bulkPi : 0.0;
+
+    double alphaB_c = 0.0;                  // muB / T
+    double Vt_c = 0.0;                      // contravariant net baryon diffusion V^mu (fm^-3)
+    double Vx_c = 0.0;
+    double Vy_c = 0.0;
+    double Vn_c = 0.0;
+    double baryon_enthalpy_ratio = 0.0;     // nB / (E + P)
+
+    if(baryon_diffusion)
+    {
+      Vx_c = surf->Vx;
+      Vy_c = surf->Vy;
+      Vn_c = surf->Vn;
+      Vt_c = (Vx_c * ux_c  +  Vy_c * uy_c  +  Vn_c * tau2_un_c) / ut_c;
+
+      alphaB_c = surf->muB / T;
+      baryon_enthalpy_ratio = surf->nB / (E + P);
+    }
+
+    deltaf_coefficients df = df_columns.get(icell);
+
+    double shear = 0.0;
+    double bulk0 = 0.0;
+    double bulk1 = 0.0;
+    double bulk2 = 0.0;
+    double diff0 = 0.0;
+    double diff1 = 0.0;
+
+    if(df_mode == 1)                        // 14 moment
+    {
+      shear = 1.0 / df.shear14_coeff;
+      bulk0 = (df.c0 - df.c2) * bulkPi;
+      bulk1 = df.c1 * bulkPi;
+      bulk2 = (4.0 * df.c2  -  df.c0) * bulkPi;
+
+      if(baryon_diffusion)
+      {
+        diff0 = df.c3;
+        diff1 = df.c4;
+      }
+    }
+    else                                    // Chapman enskog
+    {
+      shear = 0.5 / (df.betapi * T);
+      bulk0 = df.F / (T * T * df.betabulk) * bulkPi;
+      bulk1 = df.G / df.betabulk * bulkPi;
+      bulk2 = bulkPi / (3.0 * T * df.betabulk);
+
+      if(baryon_diffusion)
+      {
+        diff0 = baryon_enthalpy_ratio / df.betaV;
+        diff1 = 1.0 / df.betaV;
+      }
+    }
+
+    if(!include_shear_deltaf) shear = 0.0;
+
+    tau.push_back(tau_c);
+    tau_inv.push_back(1.0 / tau_c);
+    eta.push_back(surf->eta);
+
+    dat.push_back(surf->dat);
+    dax.push_back(surf->dax);
+    day.push_back(surf->day);
+    dan.push_back(surf->dan);
+
+    ut.push_back(ut_c);
+    ux.push_back(ux_c);
+    uy.push_back(uy_c);
+    tau2_un.push_back(tau2_un_c);
+
+    T_inv.push_back(1.0 / T);
+    alphaB.push_back(alphaB_c);
+
+    pitt.push_back(pitt_c);
+    pitx.push_back(pitx_c);
+    pity.push_back(pity_c);
+    tau2_pitn.push_back(tau2 * pitn_c);
+    pixx.push_back(pixx_c);
+    pixy.push_back(pixy_c);
+    tau2_pixn.push_back(tau2 * pixn_c);
+    piyy.push_back(piyy_c);
+    tau2_piyn.push_back(tau2 * piyn_c);
+    tau4_pinn.push_back(tau2 * tau2 * pinn_c);
+
+    Vt.push_back(Vt_c);
+    Vx.push_back(Vx_c);
+    Vy.push_back(Vy_c);
+    tau2_Vn.push_back(tau2 * Vn_c);
+
+    shear_coeff.push_back(shear);
+    bulk0_coeff.push_back(bulk0);
+    bulk1_coeff.push_back(bulk1);
+    bulk2_coeff.push_back(bulk2);
+    diff0_coeff.push_back(diff0);
+    diff1_coeff.push_back(diff1);
+
+    cells++;
+  }
+
+  printf("Cooper_Frye_Evaluator: %ld / %ld freezeout cells with u.dsigma > 0\n", cells, FO_length);
+}
+
+
+long Cooper_Frye_Evaluator::surface_cells() const
+{
+  return cells;
+}
+
+
+int Cooper_Frye_Evaluator::species_index(long mcid) const
+{
+  for(int ipart = 0; ipart < (int)mc_id.size(); ipart++)
+  {
+    if(mc_id[ipart] == mcid) return ipart;
+  }
+
+  printf("Cooper_Frye_Evaluator error: particle %ld is not in the PDG table\n", mcid);
+  exit(-1);
+}
+
+
+void Cooper_Frye_Evaluator::evaluate(const vector<Cooper_Frye_Point> & points, vector<double> & E_dN_d3p) const
+{
+  const long npoints = points.size();
+  const long eta_points = eta_values.size();
+
+  E_dN_d3p.assign(npoints, 0.0);
+
+  if(npoints == 0) return;
+
+  // point properties (structure of arrays for the vectorized point loop)
+  vector<double> px(npoints), py(npoints), mT_coshy(npoints), mT_sinhy(npoints);
+  vector<double> mass2(npoints), sign_p(npoints), baryon_p(npoints), degeneracy_p(npoints);
+
+  unordered_map<long, int> species;
+
+  for(long ipoint = 0; ipoint < npoints; ipoint++)
+  {
+    const Cooper_Frye_Point & point = points[ipoint];
+
+    if(species.find(point.mcid) == species.end()) species[point.mcid] = species_index(point.mcid);
+
+    int ipart = species[point.mcid];
+
+    double m = mass[ipart];
+    double mT = sqrt(m * m  +  point.px * point.px  +  point.py * point.py);
+    double y = (dimension == 3) ? asinh(point.pz / mT) : 0.0;   // 2+1d: boost invariant
+
+    px[ipoint] = point.px;
+    py[ipoint] = point.py;
+    mT_coshy[ipoint] = mT * cosh(y);
+    mT_sinhy[ipoint] = mT * sinh(y);
+
+    mass2[ipoint] = m * m;
+    sign_p[ipoint] = sign[ipart];
+    baryon_p[ipoint] = baryon[ipart];
+    degeneracy_p[ipoint] = degeneracy[ipart];
+  }
+
+  const double * px_p = px.data();
+  const double * py_p = py.data();
+  const double * mT_coshy_p = mT_coshy.data();
+  const double * mT_sinhy_p = mT_sinhy.data();
+  const double * mass2_p = mass2.data();
+  const double * sign_pt = sign_p.data();
+  const double * baryon_pt = baryon_p.data();
+
+  // subdivide the cells into chunks (per-core accumulators of all points)
+  long FO_chunk = cells / cores;
+  long remainder = cells  -  cores * FO_chunk;
+
+  if(remainder != 0) FO_chunk++;
+
+  double * E_dN_d3p_all = (double*)calloc(cores * npoints, sizeof(double));
+
+  #pragma omp parallel for
+  for(long n = 0; n < cores; n++)
+  {
+    double * E_dN_d3p_core = E_dN_d3p_all  +  npoints * n;
+
+    for(long icell = 0; icell < FO_chunk; icell++)
+    {
+      if((icell == FO_chunk - 1) && (remainder != 0) && (n > remainder - 1)) continue;
+
+      long c = n  +  icell * cores;
+
+      const double tau_inv_c = tau_inv[c];
+      const double dat_c = dat[c], dax_c = dax[c], day_c = day[c], dan_c = dan[c];
+      const double ut_c = ut[c], ux_c = ux[c], uy_c = uy[c], tau2_un_c = tau2_un[c];
+      const double T_inv_c = T_inv[c], alphaB_c = alphaB[c];
+      const double pitt_c = pitt[c], pitx_c = pitx[c], pity_c = pity[c], tau2_pitn_c = tau2_pitn[c];
+      const double pixx_c = pixx[c], pixy_c = pixy[c], tau2_pixn_c = tau2_pixn[c];
+      const double piyy_c = piyy[c], tau2_piyn_c = tau2_piyn[c], tau4_pinn_c = tau4_pinn[c];
+      const double Vt_c = Vt[c], Vx_c = Vx[c], Vy_c = Vy[c], tau2_Vn_c = tau2_Vn[c];
+      const double shear_c = shear_coeff[c];
+      const double bulk0_c = bulk0_coeff[c], bulk1_c = bulk1_coeff[c], bulk2_c = bulk2_coeff[c];
+      const double diff0_c = diff0_coeff[c], diff1_c = diff1_coeff[c];
+      const bool grad = (df_mode == 1);
+
+      for(long ieta = 0; ieta < eta_points; ieta++)
+      {
+        double eta_c = (dimension == 3) ? eta[c] : eta_values[ieta];
+        double eta_weight = eta_weights[ieta];
+        double cosh_eta = cosh(eta_c);
+        double sinh_eta = sinh(eta_c);
+
+        #pragma omp simd
+        for(long ipoint = 0; ipoint < npoints; ipoint++)
+        {
+          double pt = mT_coshy_p[ipoint] * cosh_eta  -  mT_sinhy_p[ipoint] * sinh_eta;                // mT.cosh(y - eta)
+          double pn = (mT_sinhy_p[ipoint] * cosh_eta  -  mT_coshy_p[ipoint] * sinh_eta) * tau_inv_c;  // mT.sinh(y - eta) / tau
+          double px_i = px_p[ipoint];
+          double py_i = py_p[ipoint];
+          double m2 = mass2_p[ipoint];
+          double b = baryon_pt[ipoint];
+
+          double pdotdsigma = pt * dat_c  +  px_i * dax_c  +  py_i * day_c  +  pn * dan_c;
+
+          if(outflow && pdotdsigma <= 0.0) pdotdsigma = 0.0;   // enforce outflow
+
+          double E = pt * ut_c  -  px_i * ux_c  -  py_i * uy_c  -  pn * tau2_un_c;   // u.p
+          double feq = 1.0 / (exp(E * T_inv_c  -  b * alphaB_c) + sign_pt[ipoint]);
+          double feqbar = 1.0  -  sign_pt[ipoint] * feq;
+
+          // pi^munu.p_mu.p_nu
+          double pimunu_pmu_pnu = pitt_c * pt * pt  +  pixx_c * px_i * px_i  +  piyy_c * py_i * py_i  +  tau4_pinn_c * pn * pn
+              + 2.0 * (-(pitx_c * px_i  +  pity_c * py_i) * pt  +  pixy_c * px_i * py_i  +  pn * (tau2_pixn_c * px_i  +  tau2_piyn_c * py_i  -  tau2_pitn_c * pt));
+
+          // V^mu.p_mu
+          double Vmu_pmu = Vt_c * pt  -  Vx_c * px_i  -  Vy_c * py_i  -  tau2_Vn_c * pn;
+
+          double df;
+
+          if(grad)    // 14 moment
+          {
+            df = feqbar * (shear_c * pimunu_pmu_pnu  +  bulk0_c * m2  +  (bulk1_c * b  +  bulk2_c * E) * E  +  (diff0_c * b  +  diff1_c * E) * Vmu_pmu);
+          }
+          else        // Chapman enskog
+          {
+            df = feqbar * ((shear_c * pimunu_pmu_pnu  +  (diff0_c * E  -  diff1_c * b) * Vmu_pmu) / E  +  bulk0_c * E  +  bulk1_c * b  +  bulk2_c * (E  -  m2 / E));
+          }
+
+          if(regulate_deltaf) df = max(-1.0, min(df, 1.0));
+
+          E_dN_d3p_core[ipoint] += eta_weight * pdotdsigma * feq * (1.0 + df);
+        }
+      }
+    }
+  }
+
+  // sum over the cores
+  double prefactor = pow(2.0 * M_PI * hbarC, -3);
+
+  for(long ipoint = 0; ipoint < npoints; ipoint++)
+  {
+    double E_dN_d3p_tmp = 0.0;
+
+    for(long n = 0; n < cores; n++) E_dN_d3p_tmp += E_dN_d3p_all[ipoint  +  npoints * n];
+
+    E_dN_d3p[ipoint] = prefactor * degeneracy_p[ipoint] * E_dN_d3p_tmp;
+  }
+
+  free(E_dN_d3p_all);
+}
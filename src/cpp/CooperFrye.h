@@ -0,0 +1,62 @@
+
+#ifndef COOPERFRYE_H
+#define COOPERFRYE_H
+
+#include <vector>
+#include "iS3D.h"
+#include "readindata.h"
+#include "ParameterReader.h"
+#include "ParticleTable.h"
+#include "DeltafData.h"
+#include "Table.h"
+
+using namespace std;
+
+
+// on-demand Cooper-Frye spectra E.dN/d^3p = dN/(pT.dpT.dphip.dy) at arbitrary momenta (df_mode = 1, 2)
+//
+// the constructor preprocesses the freezeout surface once: cells with u.dsigma <= 0 are dropped and the
+// momentum independent parts of the integrand (flow, pi^munu, V^mu with their tau factors, temperature,
+// baryon chemical potential and the bulk / shear / diffusion df coefficients) are stored per cell
+// (structure of arrays). the evaluator keeps its own copies, so the surface and df data can be freed
+//
+// evaluate() is threaded across cells (chunks with per-core accumulators) and vectorized across the
+// points of the batch. 2+1d surfaces are boost invariant (the points are evaluated at y = 0)
+
+class Cooper_Frye_Evaluator
+{
+  private:
+    int dimension;
+    int df_mode;
+    int regulate_deltaf;
+    int outflow;
+    long cores;
+
+    vector<double> eta_values;              // spacetime rapidity table (2+1d)
+    vector<double> eta_weights;
+
+    vector<long> mc_id;                     // species properties of the PDG table
+    vector<double> mass, sign, degeneracy, baryon;
+
+    int species_index(long mcid) const;
+
+    long cells;                             // cells with u.dsigma > 0
+
+    vector<double> tau, tau_inv, eta;
+    vector<double> dat, dax, day, dan;
+    vector<double> ut, ux, uy, tau2_un;
+    vector<double> T_inv, alphaB;
+    vector<double> pitt, pitx, pity, tau2_pitn, pixx, pixy, tau2_pixn, piyy, tau2_piyn, tau4_pinn;
+    vector<double> Vt, Vx, Vy, tau2_Vn;
+    vector<double> shear_coeff, bulk0_coeff, bulk1_coeff, bulk2_coeff, diff0_coeff, diff1_coeff;
+
+  public:
+    Cooper_Frye_Evaluator(ParameterReader * paraRdr, const FO_surf * surf_ptr, long FO_length, Deltaf_Data * df_data, const Particle_Table * particles_in, Table * eta_tab);
+
+    long surface_cells() const;
+
+    // E.dN/d^3p (GeV^-2) of each (mcid, p^x, p^y, p^z) point
+    void evaluate(const vector<Cooper_Frye_Point> & points, vector<double> & E_dN_d3p) const;
+};
+
+#endif
@@ -0,0 +1,237 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "DecayResponse.h"
+#include "Arsenal.h"
+
+using namespace std;
+
+
+Decay_Response_Row::Decay_Response_Row(int points)
+{
+  value.assign(points, 0.0);
+  used.assign(points, 0);
+}
+
+
+void Decay_Response_Row::add(int ipoint, double weight)
+{
+  if(!used[ipoint])
+  {
+    used[ipoint] = 1;
+    touched.push_back(ipoint);
+  }
+
+  value[ipoint] += weight;
+}
+
+
+void Decay_Response_Row::extract(vector<int> & columns, vector<double> & values)
+{
+  sort(touched.begin(), touched.end());
+
+  columns = touched;
+  values.resize(touched.size());
+
+  for(int k = 0; k < (int)touched.size(); k++)
+  {
+    int ipoint = touched[k];
+
+    values[k] = value[ipoint];
+
+    value[ipoint] = 0.0;
+    used[ipoint] = 0;
+  }
+
+  touched.clear();
+}
+
+
+Decay_Response::Decay_Response(uint64_t key_in, int points_in)
+{
+  key = key_in;
+  points = points_in;
+  row_start.assign(1, 0);
+}
+
+
+void Decay_Response::add_pair(int parent, int daughter)
+{
+  pair_parent.push_back(parent);
+  pair_daughter.push_back(daughter);
+}
+
+
+void Decay_Response::add_row(const vector<int> & columns, const vector<double> & values)
+{
+  column.insert(column.end(), columns.begin(), columns.end());
+  value.insert(value.end(), values.begin(), values.end());
+
+  row_start.push_back(column.size());
+}
+
+
+int Decay_Response::pairs() const
+{
+  return pair_parent.size();
+}
+
+
+long Decay_Response::nonzeros() const
+{
+  return value.size();
+}
+
+
+uint64_t Decay_Response::content_hash() const
+{
+  // FNV-1a hash of the pair lists and CSR arrays (stored in the file and checked by read_from_file)
+  uint64_t hash = fnv1a_offset;
+
+  hash = fnv1a_hash(pair_parent.data(), sizeof(int) * pair_parent.size(), hash);
+  hash = fnv1a_hash(pair_daughter.data(), sizeof(int) * pair_daughter.size(), hash);
+  hash = fnv1a_hash(row_start.data(), sizeof(long) * row_start.size(), hash);
+  hash = fnv1a_hash(column.data(), sizeof(int) * column.size(), hash);
+  hash = fnv1a_hash(value.data(), sizeof(double) * value.size(), hash);
+
+  return hash;
+}
+
+
+bool Decay_Response::read_from_file(string filename)
+{
+  FILE * response_file = fopen(filename.c_str(), "rb");
+
+  if(response_file == NULL) return false;
+
+  uint64_t file_key;
+  uint64_t file_hash;
+  int header[2];
+  long nnz;
+
+  bool match = (fread(&file_key, sizeof(uint64_t), 1, response_file) == 1) && (fread(header, sizeof(int), 2, response_file) == 2) && (fread(&nnz, sizeof(long), 1, response_file) == 1) && (fread(&file_hash, sizeof(uint64_t), 1, response_file) == 1);
+
+  match = match && (file_key == key) && (header[0] == points) && (header[1] >= 0) && (nnz >= 0);
+
+  if(match)
+  {
+    // the file size must match the header before anything is allocated
+    long data_start = ftell(response_file);
+
+    fseek(response_file, 0, SEEK_END);
+
+    long file_size = ftell(response_file);
+    long expected_size = data_start  +  2 * sizeof(int) * (long)header[1]  +  sizeof(long) * ((long)points * header[1] + 1)  +  (sizeof(int) + sizeof(double)) * nnz;
+
+    fseek(response_file, data_start, SEEK_SET);
+
+    match = (file_size == expected_size);
+  }
+
+  if(match)
+  {
+    int npairs = header[1];
+    long rows = (long)points * npairs;
+
+    pair_parent.resize(npairs);
+    pair_daughter.resize(npairs);
+    row_start.resize(rows + 1);
+    column.resize(nnz);
+    value.resize(nnz);
+
+    match = ((int)fread(pair_parent.data(), sizeof(int), npairs, response_file) == npairs);
+    match = match && ((int)fread(pair_daughter.data(), sizeof(int), npairs, response_file) == npairs);
+    match = match && ((long)fread(row_start.data(), sizeof(long), rows + 1, response_file) == rows + 1);
+    match = match && ((long)fread(column.data(), sizeof(int), nnz, response_file) == nnz);
+    match = match && ((long)fread(value.data(), sizeof(double), nnz, response_file) == nnz);
+    match = match && (row_start[rows] == nnz);
+
+    if(match && content_hash() != file_hash)
+    {
+      printf("Decay_Response warning: %s is corrupted (content hash mismatch)\n", filename.c_str());
+      match = false;
+    }
+  }
+
+  fclose(response_file);
+
+  if(match)
+  {
+    printf("Read decay response matrices from %s\n", filename.c_str());
+  }
+  else
+  {
+    printf("Decay response matrices in %s are out of date\n", filename.c_str());
+
+    pair_parent.clear();
+    pair_daughter.clear();
+    row_start.assign(1, 0);
+    column.clear();
+    value.clear();
+  }
+
+  return match;
+}
+
+
+void Decay_Response::write_to_file(string filename)
+{
+  // write to a unique temporary file first (an interrupted or concurrent run doesn't leave a truncated cache)
+  string tmp_filename;
+
+  FILE * response_file = open_temporary_file(filename, tmp_filename);
+
+  if(response_file == NULL)
+  {
+    printf("Decay_Response warning: could not write %s\n", filename.c_str());
+    return;
+  }
+
+  int npairs = pairs();
+  int header[2] = {points, npairs};
+  long nnz = nonzeros();
+  uint64_t hash = content_hash();
+
+  bool written = (fwrite(&key, sizeof(uint64_t), 1, response_file) == 1);
+  written = written && (fwrite(header, sizeof(int), 2, response_file) == 2);
+  written = written && (fwrite(&nnz, sizeof(long), 1, response_file) == 1);
+  written = written && (fwrite(&hash, sizeof(uint64_t), 1, response_file) == 1);
+
+  written = written && ((int)fwrite(pair_parent.data(), sizeof(int), npairs, response_file) == npairs);
+  written = written && ((int)fwrite(pair_daughter.data(), sizeof(int), npairs, response_file) == npairs);
+  written = written && (fwrite(row_start.data(), sizeof(long), row_start.size(), response_file) == row_start.size());
+  written = written && ((long)fwrite(column.data(), sizeof(int), nnz, response_file) == nnz);
+  written = written && ((long)fwrite(value.data(), sizeof(double), nnz, response_file) == nnz);
+
+  if(!install_temporary_file(response_file, tmp_filename, filename, written))
+  {
+    printf("Decay_Response warning: could not write %s\n", filename.c_str());
+  }
+}
+
+
+void Decay_Response::apply(double * dN_pTdpTdphidy) const
+{
+  // sparse matrix-vector products, heaviest parent first (its spectrum is final before it decays)
+  for(int ipair = 0; ipair < pairs(); ipair++)
+  {
+    const double * dN_parent = dN_pTdpTdphidy  +  (long)points * pair_parent[ipair];
+    double * dN_daughter = dN_pTdpTdphidy  +  (long)points * pair_daughter[ipair];
+    const long * rows = row_start.data()  +  (long)points * ipair;
+
+    #pragma omp parallel for
+    for(int ipoint = 0; ipoint < points; ipoint++)
+    {
+      double feed_down = 0.0;
+
+      for(long k = rows[ipoint]; k < rows[ipoint + 1]; k++)
+      {
+        feed_down += value[k] * dN_parent[column[k]];
+      }
+
+      dN_daughter[ipoint] += feed_down;
+    }
+  }
+}
@@ -0,0 +1,66 @@
+
+#ifndef DECAYRESPONSE_H
+#define DECAYRESPONSE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+
+// sparse accumulator of one row of a decay response matrix (weights of the parent momentum points)
+class Decay_Response_Row
+{
+  public:
+    vector<double> value;           // [points]
+    vector<char> used;
+    vector<int> touched;            // parent points with a weight
+
+    Decay_Response_Row(int points);
+
+    void add(int ipoint, double weight);
+    void extract(vector<int> & columns, vector<double> & values);     // sorted weights of the row (clears the row)
+};
+
+
+// precomputed resonance decay feed-down on the momentum grid of the continuous spectra
+//
+// the smooth decay integrals are linear in the parent spectrum (linearly interpolated on the grid), so the
+// feed-down of each (parent, daughter) pair is a fixed sparse matrix (all channels summed):
+//
+//   dN_daughter[i] += value[k] * dN_parent[column[k]],   row_start[i + points * ipair] <= k < row_start[i + 1 + points * ipair]
+//
+// pairs are stored from heaviest to lightest parent (cascades are applied in order)
+
+class Decay_Response
+{
+  private:
+    uint64_t key;                   // hash of the PDG decay table, chosen particles and momentum grid
+    int points;                     // momentum points per species (pT x phi x y)
+
+    vector<int> pair_parent;        // chosen index of the parent and daughter of each pair
+    vector<int> pair_daughter;
+
+    vector<long> row_start;         // CSR storage of the pair matrices [points * pairs + 1]
+    vector<int> column;
+    vector<double> value;
+
+    uint64_t content_hash() const;  // hash of the pair lists and CSR arrays (checked when the file is read)
+
+  public:
+    Decay_Response(uint64_t key_in, int points_in);
+
+    void add_pair(int parent, int daughter);                // start a new pair matrix
+    void add_row(const vector<int> & columns, const vector<double> & values);    // append the next row of the current pair
+
+    bool read_from_file(string filename);                   // load cached matrices (false if missing or stale)
+    void write_to_file(string filename);
+
+    int pairs() const;
+    long nonzeros() const;
+
+    void apply(double * dN_pTdpTdphidy) const;              // add the feed-down to the chosen particles' spectra
+};
+
+#endif
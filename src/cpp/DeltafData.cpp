@@ -6,18 +6,157 @@
 #include<cmath>
 #include<iomanip>
 #include<stdlib.h>
-#include <gsl/gsl_errno.h>
-#include <gsl/gsl_spline.h>
-#include <gsl/gsl_interp.h>
+#include<string.h>
+#include<stdio.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
 
 #include "iS3D.h"
 #include "DeltafData.h"
 #include "ParameterReader.h"
 #include "readindata.h"
+#include "Arsenal.h"
 
 using namespace std;
 
 
+Cubic_Spline::Cubic_Spline()
+{
+  points = 0;
+  x_min = 0.0;
+  x_max = 0.0;
+  dx_bucket = 1.0;
+}
+
+
+void Cubic_Spline::construct(const double * x_knots, const double * y_knots, int points_in)
+{
+  // natural cubic spline (same tridiagonal system and solver as gsl_interp_cspline)
+  points = points_in;
+
+  if(points < 3)
+  {
+    printf("Cubic_Spline error: need at least 3 knots (points = %d)\n", points);
+    exit(-1);
+  }
+
+  x.assign(x_knots, x_knots + points);
+
+  int sys_size = points - 2;
+
+  vector<double> c(points, 0.0);          // c = y'' / 2 (c[0] = c[points - 1] = 0)
+  vector<double> diag(sys_size), offdiag(sys_size), g(sys_size);
+
+  for(int i = 0; i < sys_size; i++)
+  {
+    double h_i = x[i + 1] - x[i];
+    double h_ip1 = x[i + 2] - x[i + 1];
+    double ydiff_i = y_knots[i + 1] - y_knots[i];
+    double ydiff_ip1 = y_knots[i + 2] - y_knots[i + 1];
+    double g_i = (h_i != 0.0) ? 1.0 / h_i : 0.0;
+    double g_ip1 = (h_ip1 != 0.0) ? 1.0 / h_ip1 : 0.0;
+
+    offdiag[i] = h_ip1;
+    diag[i] = 2.0 * (h_ip1 + h_i);
+    g[i] = 3.0 * (ydiff_ip1 * g_ip1  -  ydiff_i * g_i);
+  }
+
+  if(sys_size == 1)
+  {
+    c[1] = g[0] / diag[0];
+  }
+  else
+  {
+    // symmetric tridiagonal solve
+    vector<double> gamma(sys_size), alpha(sys_size), zeta(sys_size);
+
+    alpha[0] = diag[0];
+    gamma[0] = offdiag[0] / alpha[0];
+
+    for(int i = 1; i < sys_size - 1; i++)
+    {
+      alpha[i] = diag[i]  -  offdiag[i - 1] * gamma[i - 1];
+      gamma[i] = offdiag[i] / alpha[i];
+    }
+
+    alpha[sys_size - 1] = diag[sys_size - 1]  -  offdiag[sys_size - 2] * gamma[sys_size - 2];
+
+    zeta[0] = g[0];
+    for(int i = 1; i < sys_size; i++) zeta[i] = g[i]  -  gamma[i - 1] * zeta[i - 1];
+    for(int i = 0; i < sys_size; i++) zeta[i] = zeta[i] / alpha[i];
+
+    c[sys_size] = zeta[sys_size - 1];
+    for(int i = sys_size - 2; i >= 0; i--) c[i + 1] = zeta[i]  -  gamma[i] * c[i + 2];
+  }
+
+  coefficients.assign(4 * (points - 1), 0.0);
+
+  for(int i = 0; i < points - 1; i++)
+  {
+    double dx = x[i + 1] - x[i];
+    double dy = y_knots[i + 1] - y_knots[i];
+
+    coefficients[4 * i] = y_knots[i];
+    coefficients[4 * i + 1] = (dy / dx)  -  dx * (c[i + 1]  +  2.0 * c[i]) / 3.0;
+    coefficients[4 * i + 2] = c[i];
+    coefficients[4 * i + 3] = (c[i + 1] - c[i]) / (3.0 * dx);
+  }
+
+  // uniform lookup buckets (one per interval)
+  x_min = x[0];
+  x_max = x[points - 1];
+  dx_bucket = (x_max - x_min) / (double)(points - 1);
+
+  bucket_interval.assign(points - 1, 0);
+
+  int i = 0;
+
+  for(int ibucket = 0; ibucket < points - 1; ibucket++)
+  {
+    double x_bucket = x_min  +  ibucket * dx_bucket;
+
+    while(i < points - 2 && x[i + 1] <= x_bucket) i++;
+
+    bucket_interval[ibucket] = i;
+  }
+}
+
+
+deltaf_coefficients Deltaf_Coefficient_Columns::get(long i) const
+{
+  deltaf_coefficients df = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  if(!c0.empty())
+  {
+    df.c0 = c0[i];
+    df.c1 = c1[i];
+    df.c2 = c2[i];
+    df.c3 = c3[i];
+    df.c4 = c4[i];
+    df.shear14_coeff = shear14_coeff[i];
+  }
+  if(!F.empty())
+  {
+    df.F = F[i];
+    df.G = G[i];
+    df.betabulk = betabulk[i];
+    df.betaV = betaV[i];
+  }
+  if(!betapi.empty()) df.betapi = betapi[i];
+  if(!z.empty())
+  {
+    df.lambda = lambda[i];
+    df.z = z[i];
+    df.delta_lambda = delta_lambda[i];
+    df.delta_z = delta_z[i];
+  }
+
+  return df;
+}
+
+
 Deltaf_Data::Deltaf_Data(ParameterReader * paraRdr_in)
 {
   paraRdr = paraRdr_in;
@@ -26,6 +165,36 @@ Deltaf_Data::Deltaf_Data(ParameterReader * paraRdr_in)
   mode = paraRdr->getVal("mode");
   df_mode = paraRdr->getVal("df_mode");
   include_baryon = paraRdr->getVal("include_baryon");
+  out_of_range_mode = paraRdr->getVal("df_out_of_range");
+  cache_df_coefficients = paraRdr->getVal("cache_df_coefficients");
+
+  generate_df_coefficients = paraRdr->getVal("generate_df_coefficients");
+  generate_points_T = paraRdr->getVal("df_table_T_points");
+  generate_points_muB = paraRdr->getVal("df_table_muB_points");
+  generate_T_min = paraRdr->getVal("df_table_T_min");
+  generate_T_max = paraRdr->getVal("df_table_T_max");
+  generate_muB_min = paraRdr->getVal("df_table_muB_min");
+  generate_muB_max = paraRdr->getVal("df_table_muB_max");
+
+  if(generate_df_coefficients)
+  {
+    if(generate_points_T < 3 || generate_points_muB < 1 || generate_T_max <= generate_T_min || (generate_points_muB > 1 && generate_muB_max <= generate_muB_min))
+    {
+      printf("Error: please choose df_table_T_points >= 3, df_table_muB_points >= 1 and increasing (T, muB) ranges\n");
+      exit(-1);
+    }
+    if(generate_muB_min != 0.0)
+    {
+      printf("Error: df_table_muB_min must be 0 (the muB = 0 row is used for include_baryon = 0)\n");
+      exit(-1);
+    }
+  }
+
+  T_array = NULL;
+  muB_array = NULL;
+  lambda_squared_array = NULL;
+  z_array = NULL;
+  bulkPi_over_Peq_array = NULL;
 
   if(hrg_eos == 1)
   {
@@ -44,25 +213,377 @@ Deltaf_Data::Deltaf_Data(ParameterReader * paraRdr_in)
     printf("Error: please choose hrg_eos = (1,2,3)\n");
     exit(-1);
   }
+
+  bundle_file = hrg_eos_path + "df_coefficients.bin";
 }
 
 Deltaf_Data::~Deltaf_Data()
 {
-  // is there any harm in deallocating memory, while it's being used?
-  gsl_spline_free(c0_spline);
-  gsl_spline_free(c2_spline);
-  gsl_spline_free(c3_spline);
-
-  gsl_spline_free(F_spline);
-  gsl_spline_free(betabulk_spline);
-  gsl_spline_free(betaV_spline);
-  gsl_spline_free(betapi_spline);
-
-  gsl_spline_free(lambda_squared_spline);
-  gsl_spline_free(z_spline);
+  if(out_of_range_mode == flag_out_of_range && out_of_range_cells > 0)
+  {
+    printf("Warning: df coefficients were evaluated outside the coefficient tables %ld times (clamped to the table edges)\n", out_of_range_cells);
+  }
+
+  if(bundle_map != NULL) munmap(bundle_map, bundle_size);
+
+  if(T_array != NULL && !tables_mapped)
+  {
+    free(T_array);
+    free(muB_array);
+
+    free(c0_data);
+    free(c1_data);
+    free(c2_data);
+    free(c3_data);
+    free(c4_data);
+
+    free(F_data);
+    free(G_data);
+    free(betabulk_data);
+    free(betaV_data);
+    free(betapi_data);
+  }
+
+  if(lambda_squared_array != NULL && !jonah_mapped)
+  {
+    free(lambda_squared_array);
+    free(z_array);
+    free(bulkPi_over_Peq_array);
+  }
+}
+
+uint64_t Deltaf_Data::hash_coefficient_tables()
+{
+  // content hash of the coefficient tables (0 if they don't exist)
+  const char * tables[10] = {"c0.dat", "c1.dat", "c2.dat", "c3.dat", "c4.dat", "F.dat", "G.dat", "betabulk.dat", "betaV.dat", "betapi.dat"};
+
+  uint64_t hash = fnv1a_offset;
+
+  for(int i = 0; i < 10; i++)
+  {
+    if(!hash_file(hrg_eos_path + tables[i], hash)) return 0;
+  }
+
+  return hash;
+}
+
+
+uint64_t Deltaf_Data::stat_coefficient_tables()
+{
+  // hash of the size and modification time of the coefficient tables (0 if they don't exist)
+  // (if it matches the bundle, the tables are not read at all)
+  const char * tables[10] = {"c0.dat", "c1.dat", "c2.dat", "c3.dat", "c4.dat", "F.dat", "G.dat", "betabulk.dat", "betaV.dat", "betapi.dat"};
+
+  uint64_t hash = fnv1a_offset;
+
+  for(int i = 0; i < 10; i++)
+  {
+    struct stat table_stat;
+
+    if(stat((hrg_eos_path + tables[i]).c_str(), &table_stat) != 0) return 0;
+
+    int64_t signature[3] = {(int64_t)table_stat.st_size, (int64_t)table_stat.st_mtim.tv_sec, (int64_t)table_stat.st_mtim.tv_nsec};
+
+    hash = fnv1a_hash(signature, sizeof(signature), hash);
+  }
+
+  return hash;
+}
+
+
+uint64_t Deltaf_Data::hash_generator_inputs(Particle_Table & particles)
+{
+  // the generated coefficients depend on the hadron list (mass, degeneracy, baryon number, statistics), grid and Gauss-Laguerre roots
+  uint64_t hash = fnv1a_hash("generated", 9, fnv1a_offset);
+
+  hash = fnv1a_hash(particles.mass.data(), particles.size * sizeof(double), hash);
+  hash = fnv1a_hash(particles.degeneracy.data(), particles.size * sizeof(double), hash);
+  hash = fnv1a_hash(particles.baryon.data(), particles.size * sizeof(double), hash);
+  hash = fnv1a_hash(particles.sign.data(), particles.size * sizeof(double), hash);
+
+  double grid[6] = {(double)generate_points_T, (double)generate_points_muB, generate_T_min, generate_T_max, generate_muB_min, generate_muB_max};
+
+  hash = fnv1a_hash(grid, sizeof(grid), hash);
+
+  if(!hash_file(generate_laguerre_file, hash))
+  {
+    printf("Error: couldn't open %s\n", generate_laguerre_file.c_str());
+    exit(-1);
+  }
+
+  return hash;
 }
 
-void Deltaf_Data::load_df_coefficient_data()
+
+void Deltaf_Data::generate_df_coefficient_tables(Particle_Table & particles)
+{
+  // Grad 14-moment and RTA Chapman-Enskog coefficients of the hadron resonance gas on a uniform (T, muB) grid
+  // (same formulas and scaling as the tables in deltaf_coefficients/vh)
+  points_T = generate_points_T;
+  points_muB = generate_points_muB;
+
+  printf("\n\n\nGenerating Grad 14-moment and RTA Chapman-Enskog coefficients for %d hadrons on a %d x %d (T, muB) grid...\n", particles.size, points_T, points_muB);
+
+  Gauss_Laguerre laguerre;
+  laguerre.load_roots_and_weights(generate_laguerre_file);
+
+  T_array = (double *)calloc(points_T, sizeof(double));
+  muB_array = (double *)calloc(points_muB, sizeof(double));
+
+  double dT_grid = (generate_T_max - generate_T_min) / (double)(points_T - 1);
+  double dmuB_grid = (points_muB > 1) ? (generate_muB_max - generate_muB_min) / (double)(points_muB - 1) : 0.0;
+
+  for(int iT = 0; iT < points_T; iT++) T_array[iT] = generate_T_min  +  (double)iT * dT_grid;
+  for(int iB = 0; iB < points_muB; iB++) muB_array[iB] = generate_muB_min  +  (double)iB * dmuB_grid;
+
+  long grid = (long)points_T * points_muB;
+
+  c0_data = (double *)calloc(grid, sizeof(double));
+  c1_data = (double *)calloc(grid, sizeof(double));
+  c2_data = (double *)calloc(grid, sizeof(double));
+  c3_data = (double *)calloc(grid, sizeof(double));
+  c4_data = (double *)calloc(grid, sizeof(double));
+
+  F_data = (double *)calloc(grid, sizeof(double));
+  G_data = (double *)calloc(grid, sizeof(double));
+  betabulk_data = (double *)calloc(grid, sizeof(double));
+  betaV_data = (double *)calloc(grid, sizeof(double));
+  betapi_data = (double *)calloc(grid, sizeof(double));
+
+  long singular_points = 0;
+
+  #pragma omp parallel for schedule(dynamic) reduction(+:singular_points)
+  for(int iT = 0; iT < points_T; iT++)
+  {
+    double T = T_array[iT];
+
+    vector<double> alphaB(points_muB);
+    vector<Deltaf_Integrals> sums(points_muB);
+
+    for(int iB = 0; iB < points_muB; iB++) alphaB[iB] = muB_array[iB] / T;
+
+    // thermodynamic integrals of all muB at this temperature
+    GaussThermal_df_integrals(laguerre.root, laguerre.weight, laguerre.points, particles.size, particles.mass.data(), particles.degeneracy.data(), T, points_muB, alphaB.data(), particles.baryon.data(), particles.sign.data(), sums.data());
+
+    double T2 = T * T;
+    double T3 = T2 * T;
+    double T4 = T3 * T;
+    double T5 = T4 * T;
+    double T6 = T5 * T;
+
+    for(int iB = 0; iB < points_muB; iB++)
+    {
+      const Deltaf_Integrals & sum = sums[iB];
+
+      long i = iT  +  (long)points_T * iB;
+
+      // restore the prefactors
+      double J40 = sum.J40 * T6 / two_pi2_hbarC3;
+      double J41 = sum.J41 * T6 / (3.0 * two_pi2_hbarC3);
+      double N30 = sum.N30 * T5 / two_pi2_hbarC3;
+      double N31 = sum.N31 * T5 / (3.0 * two_pi2_hbarC3);
+      double M20 = sum.M20 * T4 / two_pi2_hbarC3;
+      double M21 = sum.M21 * T4 / (3.0 * two_pi2_hbarC3);
+      double A20 = sum.A20 * T4 / two_pi2_hbarC3;
+      double A21 = sum.A21 * T4 / (3.0 * two_pi2_hbarC3);
+      double B10 = sum.B10 * T3 / two_pi2_hbarC3;
+
+      double nB = sum.nB * T3 / two_pi2_hbarC3;
+      double e = sum.e * T4 / two_pi2_hbarC3;
+      double p = sum.p * T4 / (3.0 * two_pi2_hbarC3);
+      double J30 = sum.J30 * T5 / two_pi2_hbarC3;
+      double J32 = sum.J32 * T5 / (15.0 * two_pi2_hbarC3);
+      double N20 = sum.N20 * T4 / two_pi2_hbarC3;
+      double M10 = sum.M10 * T3 / two_pi2_hbarC3;
+      double M11 = sum.M11 * T3 / (3.0 * two_pi2_hbarC3);
+
+      // 14-moment approximation
+      double bulk0 = (4.0*N30 - B10)*N30 - M20*(4.0*J40 - A20);
+      double bulk1 = (B10 - N30)*(4.0*J40 - A20) - (4.0*N30 - B10)*(A20 - J40);
+      double bulk2 = M20*(A20 - J40) - (B10 - N30)*N30;
+      double denom = (A21 - J41)*bulk0 + N31*bulk1 + (4.0*J41 - A21)*bulk2;
+      double diffusion_denom = N31*N31 - M21*J41;
+
+      // Chapman-Enskog expansion (alphaB form)
+      double CE_denom = J30*M10 - N20*N20;
+
+      double G = ((e + p)*N20 - J30*nB) / CE_denom;
+      double F = T2 * (N20*nB - (e + p)*M10) / CE_denom;
+      double betabulk = G*nB*T + F*(e + p)/T + 5.0*J32/(3.0*T);
+      double betaV = M11 - nB*nB*T/(e + p);
+      double betapi = J32 / T;
+
+      if(denom == 0.0 || diffusion_denom == 0.0 || CE_denom == 0.0 || betabulk == 0.0 || betaV == 0.0 || betapi == 0.0) singular_points++;
+
+      // store the coefficients with the temperature power scaling of the tables
+      c0_data[i] = bulk0 / denom * T4;
+      c1_data[i] = bulk1 / denom * T3;
+      c2_data[i] = bulk2 / denom * T4;
+      c3_data[i] = J41 / diffusion_denom * T4;
+      c4_data[i] = - N31 / diffusion_denom * T5;
+
+      F_data[i] = F / T;
+      G_data[i] = G;
+      betabulk_data[i] = betabulk / T4;
+      betaV_data[i] = betaV / T3;
+      betapi_data[i] = betapi / T4;
+    }
+  }
+
+  if(singular_points > 0)
+  {
+    printf("Error: the df coefficients are singular at %ld (T, muB) grid points (does the PDG list have baryons?)\n", singular_points);
+    exit(-1);
+  }
+}
+
+
+uint64_t Deltaf_Data::hash_jonah_inputs(Particle_Table & particles, double T)
+{
+  // the PTB arrays depend on the hadron list (mass, degeneracy, statistics), temperature, lambda grid and Gauss-Laguerre roots
+  uint64_t hash = fnv1a_offset;
+
+  hash = fnv1a_hash(particles.mass.data(), particles.size * sizeof(double), hash);
+  hash = fnv1a_hash(particles.degeneracy.data(), particles.size * sizeof(double), hash);
+  hash = fnv1a_hash(particles.sign.data(), particles.size * sizeof(double), hash);
+
+  double lambda_grid[3] = {(double)jonah_points, lambda_min, lambda_max};
+
+  hash = fnv1a_hash(&T, sizeof(double), hash);
+  hash = fnv1a_hash(lambda_grid, sizeof(lambda_grid), hash);
+
+  hash_file("tables/gauss/gla_roots_weights.txt", hash);
+
+  return hash;
+}
+
+
+bool Deltaf_Data::map_df_coefficient_bundle()
+{
+  // memory map the bundle if it matches the coefficient tables (or if there are no tables to compare to)
+  int fd = open(bundle_file.c_str(), O_RDONLY);
+
+  if(fd < 0) return false;
+
+  struct stat file_stat;
+
+  if(fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(Deltaf_Bundle_Header))
+  {
+    close(fd);
+    return false;
+  }
+
+  size_t size = file_stat.st_size;
+  void * map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if(map == MAP_FAILED) return false;
+
+  const Deltaf_Bundle_Header * header = (const Deltaf_Bundle_Header *)map;
+
+  size_t grid = (size_t)header->points_T * header->points_muB;
+  size_t expected_size = sizeof(Deltaf_Bundle_Header)  +  sizeof(double) * (header->points_T  +  header->points_muB  +  10 * grid  +  3 * (size_t)header->jonah_points);
+
+  bool valid = (memcmp(header->magic, deltaf_bundle_magic, 8) == 0 && header->version == deltaf_bundle_version && header->points_T >= 3 && header->points_muB >= 1 && size == expected_size);
+
+  bool refresh_stat = false;
+
+  if(valid && !generate_df_coefficients && tables_stat != 0 && header->tables_stat == tables_stat)
+  {
+    tables_hash = header->tables_hash;                                              // tables untouched since the bundle was written
+  }
+  else if(valid && !generate_df_coefficients && tables_stat != 0)
+  {
+    if(tables_hash == 0) tables_hash = hash_coefficient_tables();                   // tables touched: compare their content
+    if(header->tables_hash != tables_hash) valid = false;                           // stale
+    refresh_stat = true;
+  }
+  else if(valid && tables_hash != 0 && header->tables_hash != tables_hash) valid = false;    // stale
+
+  if(valid && fnv1a_hash((const char *)map + sizeof(Deltaf_Bundle_Header), size - sizeof(Deltaf_Bundle_Header), fnv1a_offset) != header->data_hash)
+  {
+    printf("Warning: %s is corrupted (content hash mismatch), ignoring it\n", bundle_file.c_str());
+    valid = false;
+  }
+
+  if(!valid)
+  {
+    munmap(map, size);
+    return false;
+  }
+
+  bundle_map = map;
+  bundle_size = size;
+
+  if(refresh_stat) bundle_stale = true;     // same content, store the new modification times
+
+  points_T = header->points_T;
+  points_muB = header->points_muB;
+
+  double * data = (double *)((char *)map + sizeof(Deltaf_Bundle_Header));
+
+  T_array = data;                 data += points_T;
+  muB_array = data;               data += points_muB;
+
+  c0_data = data;                 data += grid;
+  c1_data = data;                 data += grid;
+  c2_data = data;                 data += grid;
+  c3_data = data;                 data += grid;
+  c4_data = data;                 data += grid;
+
+  F_data = data;                  data += grid;
+  G_data = data;                  data += grid;
+  betabulk_data = data;           data += grid;
+  betaV_data = data;              data += grid;
+  betapi_data = data;
+
+  tables_mapped = true;
+
+  return true;
+}
+
+
+void Deltaf_Data::load_df_coefficient_data(Particle_Table & particles)
+{
+  // the content of the tables is only hashed if their size / modification time differ from the bundle's
+  if(generate_df_coefficients) tables_hash = hash_generator_inputs(particles);
+  else tables_stat = stat_coefficient_tables();
+
+  if(cache_df_coefficients && map_df_coefficient_bundle())
+  {
+    printf("\n\n\nLoaded Grad 14-moment and RTA Chapman-Enskog coefficient tables from %s\n", bundle_file.c_str());
+  }
+  else if(generate_df_coefficients)
+  {
+    generate_df_coefficient_tables(particles);
+
+    bundle_stale = true;
+  }
+  else
+  {
+    if(tables_stat == 0)
+    {
+      printf("Error: couldn't find the df coefficient tables in %s or a valid %s\n", hrg_eos_path.c_str(), bundle_file.c_str());
+      exit(-1);
+    }
+
+    if(cache_df_coefficients && tables_hash == 0) tables_hash = hash_coefficient_tables();
+
+    read_df_coefficient_tables();
+
+    bundle_stale = true;
+  }
+
+  T_min = T_array[0];
+  muB_min = muB_array[0];
+
+  // uniform grid
+  dT = fabs(T_array[1] - T_array[0]);
+  dmuB = (points_muB > 1) ? fabs(muB_array[1] - muB_array[0]) : 1.0;
+}
+
+
+void Deltaf_Data::read_df_coefficient_tables()
 {
   printf("\n\n\nReading in Grad 14-moment and RTA Chapman-Enskog coefficient tables from deltaf_coefficients/...\n");
 
@@ -131,8 +652,6 @@ void Deltaf_Data::load_df_coefficient_data()
   fscanf(betaV_file, "%d\n%d\n", &points_T, &points_muB);
   fscanf(betapi_file, "%d\n%d\n", &points_T, &points_muB);
 
-  if(!include_baryon) points_muB = 1;
-
   // skip the header
   char header[300];
   fgets(header, 100, c0_file);
@@ -151,58 +670,41 @@ void Deltaf_Data::load_df_coefficient_data()
   T_array = (double *)calloc(points_T, sizeof(double));
   muB_array = (double *)calloc(points_muB, sizeof(double));
 
-  // coefficient data
-  c0_data = (double **)calloc(points_muB, sizeof(double));
-  c1_data = (double **)calloc(points_muB, sizeof(double));
-  c2_data = (double **)calloc(points_muB, sizeof(double));
-  c3_data = (double **)calloc(points_muB, sizeof(double));
-  c4_data = (double **)calloc(points_muB, sizeof(double));
+  // coefficient data (flat grids [iT + points_T * iB])
+  c0_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  c1_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  c2_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  c3_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  c4_data = (double *)calloc(points_T * points_muB, sizeof(double));
 
-  F_data = (double **)calloc(points_muB, sizeof(double));
-  G_data = (double **)calloc(points_muB, sizeof(double));
-  betabulk_data = (double **)calloc(points_muB, sizeof(double));
-  betaV_data = (double **)calloc(points_muB, sizeof(double));
-  betapi_data = (double **)calloc(points_muB, sizeof(double));
+  F_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  G_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  betabulk_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  betaV_data = (double *)calloc(points_T * points_muB, sizeof(double));
+  betapi_data = (double *)calloc(points_T * points_muB, sizeof(double));
 
   // scan coefficient files
   for(int iB = 0; iB < points_muB; iB++)  // muB
   {
-    c0_data[iB] = (double *)calloc(points_T, sizeof(double));
-    c1_data[iB] = (double *)calloc(points_T, sizeof(double));
-    c2_data[iB] = (double *)calloc(points_T, sizeof(double));
-    c3_data[iB] = (double *)calloc(points_T, sizeof(double));
-    c4_data[iB] = (double *)calloc(points_T, sizeof(double));
-
-    F_data[iB] = (double *)calloc(points_T, sizeof(double));
-    G_data[iB] = (double *)calloc(points_T, sizeof(double));
-    betabulk_data[iB] = (double *)calloc(points_T, sizeof(double));
-    betaV_data[iB] = (double *)calloc(points_T, sizeof(double));
-    betapi_data[iB] = (double *)calloc(points_T, sizeof(double));
-
     for(int iT = 0; iT < points_T; iT++)  // T
     {
+      int i = iT  +  points_T * iB;
+
       // set T and muB (fm^-1) arrays from file
-      fscanf(c0_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c0_data[iB][iT]);
-      fscanf(c1_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c1_data[iB][iT]);
-      fscanf(c2_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c2_data[iB][iT]);
-      fscanf(c3_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c3_data[iB][iT]);
-      fscanf(c4_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c4_data[iB][iT]);
-
-      fscanf(F_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &F_data[iB][iT]);
-      fscanf(G_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &G_data[iB][iT]);
-      fscanf(betabulk_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &betabulk_data[iB][iT]);
-      fscanf(betaV_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &betaV_data[iB][iT]);
-      fscanf(betapi_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &betapi_data[iB][iT]);
+      fscanf(c0_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c0_data[i]);
+      fscanf(c1_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c1_data[i]);
+      fscanf(c2_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c2_data[i]);
+      fscanf(c3_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c3_data[i]);
+      fscanf(c4_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &c4_data[i]);
+
+      fscanf(F_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &F_data[i]);
+      fscanf(G_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &G_data[i]);
+      fscanf(betabulk_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &betabulk_data[i]);
+      fscanf(betaV_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &betaV_data[i]);
+      fscanf(betapi_file, "%lf\t\t%lf\t\t%lf\n", &T_array[iT], &muB_array[iB], &betapi_data[i]);
     } // iT
   } // iB
 
-  T_min = T_array[0];
-  muB_min = muB_array[0];
-
-  // uniform grid
-  dT = fabs(T_array[1] - T_array[0]);
-  dmuB = fabs(muB_array[1] - muB_array[0]);
-
   fclose(c0_file);
   fclose(c1_file);
   fclose(c2_file);
@@ -217,8 +719,50 @@ void Deltaf_Data::load_df_coefficient_data()
 }
 
 
-void Deltaf_Data::compute_jonah_coefficients(particle_info * particle_data, int Nparticle)
+void Deltaf_Data::compute_jonah_coefficients(Particle_Table & particles)
 {
+  // get the average temperature, energy density, pressure
+  Plasma QGP;
+  QGP.load_thermodynamic_averages();
+
+  // GeV (assumes freezeout surface of constant temperature)
+  // the coefficients are computed at the nearest node of a fixed temperature grid (jonah_T_bin), so the
+  // cached PTB arrays are reused by every event whose average temperature falls in the same bin
+  const double T = jonah_T_bin * round(QGP.temperature / jonah_T_bin);
+
+  jonah_hash = hash_jonah_inputs(particles, T);
+
+  // reuse the PTB arrays of the mapped bundle if they were computed with the same inputs
+  // (a PTB section for another temperature bin is recomputed in memory without rewriting the bundle,
+  // so concurrent runs don't fight over it; only a bundle without PTB arrays is updated)
+  bool jonah_section = false;
+
+  if(tables_mapped)
+  {
+    const Deltaf_Bundle_Header * header = (const Deltaf_Bundle_Header *)bundle_map;
+
+    jonah_section = (header->jonah_points > 0);
+
+    if(header->jonah_points == jonah_points && header->jonah_hash == jonah_hash)
+    {
+      double * data = (double *)((char *)bundle_map + sizeof(Deltaf_Bundle_Header))  +  points_T  +  points_muB  +  10 * (long)points_T * points_muB;
+
+      lambda_squared_array = data;
+      z_array = data  +  jonah_points;
+      bulkPi_over_Peq_array = data  +  2 * jonah_points;
+      bulkPi_over_Peq_max = header->bulkPi_over_Peq_max;
+
+      jonah_mapped = true;
+
+      lambda_squared_spline.construct(bulkPi_over_Peq_array, lambda_squared_array, jonah_points);
+      z_spline.construct(bulkPi_over_Peq_array, z_array, jonah_points);
+
+      return;
+    }
+  }
+
+  if(!jonah_section) bundle_stale = true;
+
   // allocate memory for the arrays
   lambda_squared_array = (double *)calloc(jonah_points, sizeof(double));
   z_array = (double *)calloc(jonah_points, sizeof(double));
@@ -226,22 +770,13 @@ void Deltaf_Data::compute_jonah_coefficients(particle_info * particle_data, int
 
   bulkPi_over_Peq_max = -1.0;      // default to lowest value
 
-  // get the average temperature, energy density, pressure
-  Plasma QGP;
-  QGP.load_thermodynamic_averages();
-
-  const double T = QGP.temperature;    // GeV (assumes freezeout surface of constant temperature)
-
   // gauss laguerre roots and weights
   Gauss_Laguerre gla;
   gla.load_roots_and_weights("tables/gauss/gla_roots_weights.txt");
 
   const int pbar_pts = gla.points;
 
-  double * pbar_root1 = gla.root[1];
   double * pbar_root2 = gla.root[2];
-
-  double * pbar_weight1 = gla.weight[1];
   double * pbar_weight2 = gla.weight[2];
 
   // calculate the interpolation points of z(bulkPi/P), lambda(bulkPi/P)
@@ -255,11 +790,11 @@ void Deltaf_Data::compute_jonah_coefficients(particle_info * particle_data, int
     double P_mod = 0.0;                   // modified pressure
 
     // calculate modified energy density (sum over hadron resonance contributions)
-    for(int n = 0; n < Nparticle; n++)
+    for(int n = 0; n < particles.size; n++)
     {
-      double degeneracy = (double)particle_data[n].gspin;
-      double mass = particle_data[n].mass;
-      double sign = (double)particle_data[n].sign;
+      double degeneracy = particles.degeneracy[n];
+      double mass = particles.mass[n];
+      double sign = particles.sign[n];
 
       double mbar = mass / T;
 
@@ -287,11 +822,99 @@ void Deltaf_Data::compute_jonah_coefficients(particle_info * particle_data, int
   }
 
   // now construct cubic splines for lambda(bulkPi/Peq) and z(bulkPi/Peq)
-  lambda_squared_spline = gsl_spline_alloc(gsl_interp_cspline, jonah_points);
-  z_spline = gsl_spline_alloc(gsl_interp_cspline, jonah_points);
+  lambda_squared_spline.construct(bulkPi_over_Peq_array, lambda_squared_array, jonah_points);
+  z_spline.construct(bulkPi_over_Peq_array, z_array, jonah_points);
+}
+
+
+void Deltaf_Data::write_df_coefficient_bundle()
+{
+  if(!cache_df_coefficients || !bundle_stale) return;
+
+  Deltaf_Bundle_Header header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, deltaf_bundle_magic, 8);
+  header.version = deltaf_bundle_version;
+  header.points_T = points_T;
+  header.points_muB = points_muB;
+  header.tables_hash = tables_hash;
+  header.tables_stat = tables_stat;
+
+  // keep the hash of the original tables if they aren't in hrg_eos_path
+  if(tables_hash == 0 && tables_mapped)
+  {
+    header.tables_hash = ((const Deltaf_Bundle_Header *)bundle_map)->tables_hash;
+    header.tables_stat = ((const Deltaf_Bundle_Header *)bundle_map)->tables_stat;
+  }
+
+  bool jonah = (lambda_squared_array != NULL);
+
+  if(jonah)
+  {
+    header.jonah_points = jonah_points;
+    header.jonah_hash = jonah_hash;
+    header.bulkPi_over_Peq_max = bulkPi_over_Peq_max;
+  }
+
+  long grid = (long)points_T * points_muB;
 
-  gsl_spline_init(lambda_squared_spline, bulkPi_over_Peq_array, lambda_squared_array, jonah_points);
-  gsl_spline_init(z_spline, bulkPi_over_Peq_array, z_array, jonah_points);
+  const double * grids[10] = {c0_data, c1_data, c2_data, c3_data, c4_data, F_data, G_data, betabulk_data, betaV_data, betapi_data};
+
+  // content hash of the data (same order as written)
+  uint64_t data_hash = fnv1a_offset;
+
+  data_hash = fnv1a_hash(T_array, sizeof(double) * points_T, data_hash);
+  data_hash = fnv1a_hash(muB_array, sizeof(double) * points_muB, data_hash);
+
+  for(int i = 0; i < 10; i++) data_hash = fnv1a_hash(grids[i], sizeof(double) * grid, data_hash);
+
+  if(jonah)
+  {
+    data_hash = fnv1a_hash(lambda_squared_array, sizeof(double) * jonah_points, data_hash);
+    data_hash = fnv1a_hash(z_array, sizeof(double) * jonah_points, data_hash);
+    data_hash = fnv1a_hash(bulkPi_over_Peq_array, sizeof(double) * jonah_points, data_hash);
+  }
+
+  header.data_hash = data_hash;
+
+  // write to a unique temporary file and rename it (the current bundle may be mapped by this or another run)
+  string tmp_file;
+
+  FILE * bundle = open_temporary_file(bundle_file, tmp_file);
+
+  if(bundle == NULL)
+  {
+    printf("Warning: couldn't write the df coefficient bundle %s\n", bundle_file.c_str());
+    return;
+  }
+
+  bool written = (fwrite(&header, sizeof(header), 1, bundle) == 1);
+
+  written = written && ((long)fwrite(T_array, sizeof(double), points_T, bundle) == points_T);
+  written = written && ((long)fwrite(muB_array, sizeof(double), points_muB, bundle) == points_muB);
+
+  for(int i = 0; i < 10; i++)
+  {
+    written = written && ((long)fwrite(grids[i], sizeof(double), grid, bundle) == grid);
+  }
+
+  if(jonah)
+  {
+    written = written && ((long)fwrite(lambda_squared_array, sizeof(double), jonah_points, bundle) == jonah_points);
+    written = written && ((long)fwrite(z_array, sizeof(double), jonah_points, bundle) == jonah_points);
+    written = written && ((long)fwrite(bulkPi_over_Peq_array, sizeof(double), jonah_points, bundle) == jonah_points);
+  }
+
+  if(!install_temporary_file(bundle, tmp_file, bundle_file, written))
+  {
+    printf("Warning: couldn't write the df coefficient bundle %s\n", bundle_file.c_str());
+    return;
+  }
+
+  printf("Saved df coefficients to %s\n", bundle_file.c_str());
+
+  bundle_stale = false;
 }
 
 
@@ -299,25 +922,25 @@ void Deltaf_Data::construct_cubic_splines()
 {
   printf("\nConstructing cubic splines for df coefficients (muB = 0)...\n");
 
-  // Allocate memory for cubic splines
-  c0_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-  c2_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-  c3_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-
-  F_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-  betabulk_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-  betapi_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-  betaV_spline = gsl_spline_alloc(gsl_interp_cspline, points_T);
-
-  // Initialize the cubic splines
-  gsl_spline_init(c0_spline, T_array, c0_data[0], points_T);
-  gsl_spline_init(c2_spline, T_array, c2_data[0], points_T);
-  gsl_spline_init(c3_spline, T_array, c3_data[0], points_T);
-
-  gsl_spline_init(F_spline, T_array, F_data[0], points_T);
-  gsl_spline_init(betabulk_spline, T_array, betabulk_data[0], points_T);
-  gsl_spline_init(betaV_spline, T_array, betaV_data[0], points_T);
-  gsl_spline_init(betapi_spline, T_array, betapi_data[0], points_T);
+  // splines of the muB = 0 row
+  c0_spline.construct(T_array, c0_data, points_T);
+  c2_spline.construct(T_array, c2_data, points_T);
+  c3_spline.construct(T_array, c3_data, points_T);
+
+  F_spline.construct(T_array, F_data, points_T);
+  betabulk_spline.construct(T_array, betabulk_data, points_T);
+  betaV_spline.construct(T_array, betaV_data, points_T);
+  betapi_spline.construct(T_array, betapi_data, points_T);
+}
+
+
+void Deltaf_Data::count_out_of_range(bool out_of_range)
+{
+  if(out_of_range)
+  {
+    #pragma omp atomic
+    out_of_range_cells++;
+  }
 }
 
 
@@ -325,8 +948,7 @@ deltaf_coefficients Deltaf_Data::cubic_spline(double T, double E, double P, doub
 {
   deltaf_coefficients df;
 
-  gsl_interp_accel * accel_T = gsl_interp_accel_alloc();    // for temperature dependent functions
-  gsl_interp_accel * accel_bulk = gsl_interp_accel_alloc(); // for bulkPi/Peq dependent functions
+  bool out_of_range = false;
 
   switch(df_mode)
   {
@@ -335,9 +957,9 @@ deltaf_coefficients Deltaf_Data::cubic_spline(double T, double E, double P, doub
       // undo the temperature power scaling of coefficients
       double T4 = T * T * T * T;
 
-      df.c0 = gsl_spline_eval(c0_spline, T, accel_T) / T4;
+      df.c0 = c0_spline.evaluate(T, out_of_range_mode, out_of_range) / T4;
       df.c1 = 0.0;
-      df.c2 = gsl_spline_eval(c2_spline, T, accel_T) / T4;
+      df.c2 = c2_spline.evaluate(T, out_of_range_mode, out_of_range) / T4;
       df.c3 = 0.0;
       df.c4 = 0.0;
       df.shear14_coeff = 2.0 * T * T * (E + P);
@@ -352,11 +974,11 @@ deltaf_coefficients Deltaf_Data::cubic_spline(double T, double E, double P, doub
       // undo the temperature power scaling of coefficients
       double T4 = T * T * T * T;
 
-      df.F = gsl_spline_eval(F_spline, T, accel_T) * T;
+      df.F = F_spline.evaluate(T, out_of_range_mode, out_of_range) * T;
       df.G = 0.0;
-      df.betabulk = gsl_spline_eval(betabulk_spline, T, accel_T) * T4;
+      df.betabulk = betabulk_spline.evaluate(T, out_of_range_mode, out_of_range) * T4;
       df.betaV = 1.0;
-      df.betapi = gsl_spline_eval(betapi_spline, T, accel_T) * T4;
+      df.betapi = betapi_spline.evaluate(T, out_of_range_mode, out_of_range) * T4;
 
       break;
     }
@@ -365,7 +987,7 @@ deltaf_coefficients Deltaf_Data::cubic_spline(double T, double E, double P, doub
       // undo the temperature power scaling of betapi
       double T4 = T * T * T * T;
 
-      double lambda_squared = gsl_spline_eval(lambda_squared_spline, (bulkPi / P), accel_bulk);
+      double lambda_squared = lambda_squared_spline.evaluate(bulkPi / P, out_of_range_mode, out_of_range);
       if(bulkPi < 0.0)
       {
         df.lambda = - sqrt(lambda_squared);
@@ -374,8 +996,12 @@ deltaf_coefficients Deltaf_Data::cubic_spline(double T, double E, double P, doub
       {
         df.lambda = sqrt(lambda_squared);
       }
-      df.z = gsl_spline_eval(z_spline, (bulkPi / P), accel_bulk);
-      df.betapi = gsl_spline_eval(betapi_spline, T, accel_T) * T4;
+      else
+      {
+        df.lambda = 0.0;
+      }
+      df.z = z_spline.evaluate(bulkPi / P, out_of_range_mode, out_of_range);
+      df.betapi = betapi_spline.evaluate(T, out_of_range_mode, out_of_range) * T4;
       // linearized correction to lambda, z
       df.delta_lambda = bulkPi / (5.0 * df.betapi -  3.0 * P * (E + P) / E);
       df.delta_z = - 3.0 * df.delta_lambda * P / E;
@@ -395,51 +1021,60 @@ deltaf_coefficients Deltaf_Data::cubic_spline(double T, double E, double P, doub
     }
   }
 
-  gsl_interp_accel_free(accel_T);
-  gsl_interp_accel_free(accel_bulk);
+  count_out_of_range(out_of_range);
 
   return df;
 }
 
-double Deltaf_Data::calculate_bilinear(double ** f_data, double T, double muB, double TL, double TR, double muBL, double muBR, int iTL, int iTR, int imuBL, int imuBR)
+double Deltaf_Data::calculate_bilinear(const double * f_data, double T, double muB, int iTL, int imuBL)
 {
   // bilinear formula f(T,muB)
   //  f_LR    f_RR
   //
   //  f_LL    f_RL
 
-  double f_LL = f_data[imuBL][iTL];
-  double f_LR = f_data[imuBR][iTL];
-  double f_RL = f_data[imuBL][iTR];
-  double f_RR = f_data[imuBR][iTR];
+  int iTR = iTL + 1;
+  int imuBR = imuBL + 1;
+
+  double TL = T_array[iTL];
+  double TR = T_array[iTR];
+  double muBL = muB_array[imuBL];
+  double muBR = muB_array[imuBR];
+
+  double f_LL = f_data[iTL  +  points_T * imuBL];
+  double f_LR = f_data[iTL  +  points_T * imuBR];
+  double f_RL = f_data[iTR  +  points_T * imuBL];
+  double f_RR = f_data[iTR  +  points_T * imuBR];
 
   return ((f_LL*(TR - T) + f_RL*(T - TL)) * (muBR - muB)  +  (f_LR*(TR - T) + f_RR*(T - TL)) * (muB - muBL)) / (dT * dmuB);
 }
 
-deltaf_coefficients Deltaf_Data::bilinear_interpolation(double T, double muB, double E, double P, double bulkPi)
+deltaf_coefficients Deltaf_Data::bilinear_interpolation(double T, double muB, double E, double P)
 {
-  // left and right T, muB indices
-  int iTL = (int)floor((T - T_min) / dT);
-  int iTR = iTL + 1;
-
-  int imuBL = (int)floor((muB - muB_min) / dmuB);
-  int imuBR = imuBL + 1;
-
-  double TL, TR, muBL, muBR;
-
-  if(!(iTL >= 0 && iTR < points_T) || !(imuBL >= 0 && imuBR < points_muB))
+  if(points_muB < 2)
   {
-    printf("Error: (T,muB) outside df coefficient table. Exiting...\n");
+    printf("Bilinear interpolation error: the df coefficient tables have a single muB value. Exiting..\n");
     exit(-1);
   }
-  else
+
+  // (T, muB) outside the table: clamp (or extrapolate with the edge cell)
+  double T_max = T_min  +  (points_T - 1) * dT;
+  double muB_max = muB_min  +  (points_muB - 1) * dmuB;
+
+  bool out_of_range = (T < T_min || T > T_max || muB < muB_min || muB > muB_max);
+
+  if(out_of_range && out_of_range_mode != extrapolate_out_of_range)
   {
-    TL = T_array[iTL];
-    TR = T_array[iTR];
-    muBL = muB_array[imuBL];
-    muBR = muB_array[imuBR];
+    T = min(max(T, T_min), T_max);
+    muB = min(max(muB, muB_min), muB_max);
   }
 
+  count_out_of_range(out_of_range);
+
+  // left T, muB indices
+  int iTL = min(max((int)floor((T - T_min) / dT), 0), points_T - 2);
+  int imuBL = min(max((int)floor((muB - muB_min) / dmuB), 0), points_muB - 2);
+
   deltaf_coefficients df;
 
   switch(df_mode)
@@ -451,11 +1086,11 @@ deltaf_coefficients Deltaf_Data::bilinear_interpolation(double T, double muB, do
       double T5 = T4 * T;
 
       // bilinear interpolated values & undo temperature power scaling
-      df.c0 = calculate_bilinear(c0_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) / T4;
-      df.c1 = calculate_bilinear(c1_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) / T3;
-      df.c2 = calculate_bilinear(c2_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) / T4;
-      df.c3 = calculate_bilinear(c3_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) / T4;
-      df.c4 = calculate_bilinear(c4_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) / T5;
+      df.c0 = calculate_bilinear(c0_data, T, muB, iTL, imuBL) / T4;
+      df.c1 = calculate_bilinear(c1_data, T, muB, iTL, imuBL) / T3;
+      df.c2 = calculate_bilinear(c2_data, T, muB, iTL, imuBL) / T4;
+      df.c3 = calculate_bilinear(c3_data, T, muB, iTL, imuBL) / T4;
+      df.c4 = calculate_bilinear(c4_data, T, muB, iTL, imuBL) / T5;
       df.shear14_coeff = 2.0 * T * T * (E + P);
 
       break;
@@ -469,11 +1104,11 @@ deltaf_coefficients Deltaf_Data::bilinear_interpolation(double T, double muB, do
       double T4 = T3 * T;
 
       // bilinear interpolated values & undo temperature power scaling
-      df.F = calculate_bilinear(F_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) * T;
-      df.G = calculate_bilinear(G_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR);
-      df.betabulk = calculate_bilinear(betabulk_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) * T4;
-      df.betaV = calculate_bilinear(betaV_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) * T3;
-      df.betapi = calculate_bilinear(betapi_data, T, muB, TL, TR, muBL, muBR, iTL, iTR, imuBL, imuBR) * T4;
+      df.F = calculate_bilinear(F_data, T, muB, iTL, imuBL) * T;
+      df.G = calculate_bilinear(G_data, T, muB, iTL, imuBL);
+      df.betabulk = calculate_bilinear(betabulk_data, T, muB, iTL, imuBL) * T4;
+      df.betaV = calculate_bilinear(betaV_data, T, muB, iTL, imuBL) * T3;
+      df.betapi = calculate_bilinear(betapi_data, T, muB, iTL, imuBL) * T4;
 
       break;
     }
@@ -512,13 +1147,101 @@ deltaf_coefficients Deltaf_Data::evaluate_df_coefficients(double T, double muB,
   {
     // muB on freezeout surface should be nonzero in general
     // otherwise should set include_baryon = 0
-    df = bilinear_interpolation(T, muB, E, P, bulkPi);  // bilinear wrt (T, muB)
+    df = bilinear_interpolation(T, muB, E, P);  // bilinear wrt (T, muB)
   }
 
   return df;
 }
 
 
+void Deltaf_Data::evaluate_df_coefficients(long length, const double * T_fo, const double * muB_fo, const double * E_fo, const double * P_fo, const double * bulkPi_fo, const char * emitting, Deltaf_Coefficient_Columns & columns)
+{
+  // df coefficients of all cells in SoA columns (e.g. before a cell loop)
+  columns.length = length;
+
+  switch(df_mode)
+  {
+    case 1:
+    {
+      columns.c0.assign(length, 0.0);
+      columns.c1.assign(length, 0.0);
+      columns.c2.assign(length, 0.0);
+      columns.c3.assign(length, 0.0);
+      columns.c4.assign(length, 0.0);
+      columns.shear14_coeff.assign(length, 0.0);
+      break;
+    }
+    case 2:
+    case 3:
+    case 5:
+    {
+      columns.F.assign(length, 0.0);
+      columns.G.assign(length, 0.0);
+      columns.betabulk.assign(length, 0.0);
+      columns.betaV.assign(length, 0.0);
+      columns.betapi.assign(length, 0.0);
+      break;
+    }
+    case 4:
+    {
+      columns.betapi.assign(length, 0.0);
+      columns.lambda.assign(length, 0.0);
+      columns.z.assign(length, 0.0);
+      columns.delta_lambda.assign(length, 0.0);
+      columns.delta_z.assign(length, 0.0);
+      break;
+    }
+    default:
+    {
+      printf("Error: choose df_mode = (1,2,3,4,5)\n");
+      exit(-1);
+    }
+  }
+
+  #pragma omp parallel for
+  for(long i = 0; i < length; i++)
+  {
+    if(emitting != NULL && !emitting[i]) continue;
+
+    double muB = (muB_fo == NULL) ? 0.0 : muB_fo[i];
+    double bulkPi = (bulkPi_fo == NULL) ? 0.0 : bulkPi_fo[i];
+
+    deltaf_coefficients df = evaluate_df_coefficients(T_fo[i], muB, E_fo[i], P_fo[i], bulkPi);
+
+    switch(df_mode)
+    {
+      case 1:
+      {
+        columns.c0[i] = df.c0;
+        columns.c1[i] = df.c1;
+        columns.c2[i] = df.c2;
+        columns.c3[i] = df.c3;
+        columns.c4[i] = df.c4;
+        columns.shear14_coeff[i] = df.shear14_coeff;
+        break;
+      }
+      case 4:
+      {
+        columns.betapi[i] = df.betapi;
+        columns.lambda[i] = df.lambda;
+        columns.z[i] = df.z;
+        columns.delta_lambda[i] = df.delta_lambda;
+        columns.delta_z[i] = df.delta_z;
+        break;
+      }
+      default:
+      {
+        columns.F[i] = df.F;
+        columns.G[i] = df.G;
+        columns.betabulk[i] = df.betabulk;
+        columns.betaV[i] = df.betaV;
+        columns.betapi[i] = df.betapi;
+      }
+    }
+  }
+}
+
+
 void Deltaf_Data::test_df_coefficients(double bulkPi_over_P)
 {
   // test print the output of the df coefficients at average temperature, etc (and a fixed value of bulkPi)
@@ -552,7 +1275,7 @@ void Deltaf_Data::test_df_coefficients(double bulkPi_over_P)
   }
 }
 
-void Deltaf_Data::compute_particle_densities(particle_info * particle_data, int Nparticle)
+void Deltaf_Data::compute_particle_densities(Particle_Table & particles)
 {
   // get the average temperature, energy density, pressure, etc.
   Plasma QGP;
@@ -582,28 +1305,30 @@ void Deltaf_Data::compute_particle_densities(particle_info * particle_data, int
 
   const int pbar_pts = gla.points;
 
-  double * pbar_root1 = gla.root[1];
-  double * pbar_root2 = gla.root[2];
-  double * pbar_root3 = gla.root[3];
+  // thermal moments needed by df_mode (one fused pass per Laguerre order)
+  int moments = neq_moment;
+
+  if(df_mode == 1) moments |= (J10_moment | J20_moment | J30_moment | J31_moment);
+  else if(df_mode == 2 || df_mode == 3 || df_mode == 5) moments |= (J10_moment | J11_moment | J20_moment);
 
-  double * pbar_weight1 = gla.weight[1];
-  double * pbar_weight2 = gla.weight[2];
-  double * pbar_weight3 = gla.weight[3];
 
+  vector<Thermal_Moments> thermal_list(particles.size);
+
+  GaussThermal_moments_batch(moments, gla.root, gla.weight, pbar_pts, particles.size, particles.mass.data(), T, alphaB, particles.baryon.data(), particles.sign.data(), thermal_list.data());
 
   // calculate the equilibrium densities and the
   // bulk / diffusion corrections of each particle
-  for(int i = 0; i < Nparticle; i++)
+  for(int i = 0; i < particles.size; i++)
   {
-    double mass = particle_data[i].mass;
-    double degeneracy = (double)particle_data[i].gspin;
-    double baryon = (double)particle_data[i].baryon;
-    double sign = (double)particle_data[i].sign;
-    double mbar = mass / T;
+    double mass = particles.mass[i];
+    double degeneracy = particles.degeneracy[i];
+    double baryon = particles.baryon[i];
 
     // equilibrium density
     double neq_fact = degeneracy * pow(T,3) / two_pi2_hbarC3;
-    double neq = neq_fact * GaussThermal(neq_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
+    const Thermal_Moments & thermal = thermal_list[i];
+
+    double neq = neq_fact * thermal.neq;
 
     // bulk and diffusion density corrections
     double dn_bulk = 0.0;
@@ -624,10 +1349,10 @@ void Deltaf_Data::compute_particle_densities(particle_info * particle_data, int
         double J30_fact = degeneracy * pow(T,5) / two_pi2_hbarC3;
         double J31_fact = degeneracy * pow(T,5) / two_pi2_hbarC3 / 3.0;
 
-        double J10 =  J10_fact * GaussThermal(J10_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
-        double J20 = J20_fact * GaussThermal(J20_int, pbar_root2, pbar_weight2, pbar_pts, mbar, alphaB, baryon, sign);
-        double J30 = J30_fact * GaussThermal(J30_int, pbar_root3, pbar_weight3, pbar_pts, mbar, alphaB, baryon, sign);
-        double J31 = J31_fact * GaussThermal(J31_int, pbar_root3, pbar_weight3, pbar_pts, mbar, alphaB, baryon, sign);
+        double J10 = J10_fact * thermal.J10;
+        double J20 = J20_fact * thermal.J20;
+        double J30 = J30_fact * thermal.J30;
+        double J31 = J31_fact * thermal.J31;
 
         dn_bulk = ((c0 - c2) * mass * mass * J10 +  c1 * baryon * J20  +  (4.0 * c2 - c0) * J30);
         // these coefficients need to be loaded.
@@ -650,9 +1375,9 @@ void Deltaf_Data::compute_particle_densities(particle_info * particle_data, int
         double J11_fact = degeneracy * pow(T,3) / two_pi2_hbarC3 / 3.0;
         double J20_fact = degeneracy * pow(T,4) / two_pi2_hbarC3;
 
-        double J10 = J10_fact * GaussThermal(J10_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
-        double J11 = J11_fact * GaussThermal(J11_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
-        double J20 = J20_fact * GaussThermal(J20_int, pbar_root2, pbar_weight2, pbar_pts, mbar, alphaB, baryon, sign);
+        double J10 = J10_fact * thermal.J10;
+        double J11 = J11_fact * thermal.J11;
+        double J20 = J20_fact * thermal.J20;
 
         dn_bulk = (neq + (baryon * J10 * G) + (J20 * F / pow(T,2))) / betabulk;
         dn_diff = (neq * T * baryon_enthalpy_ratio  -  baryon * J11) / betaV;
@@ -683,9 +1408,9 @@ void Deltaf_Data::compute_particle_densities(particle_info * particle_data, int
     //   printf("dn_diff = %lf\n", dn_diff);
     // }
 
-    particle_data[i].equilibrium_density = neq;
-    particle_data[i].bulk_density = dn_bulk;
-    particle_data[i].diff_density = dn_diff;
+    particles.equilibrium_density[i] = neq;
+    particles.bulk_density[i] = dn_bulk;
+    particles.diff_density[i] = dn_diff;
   }
 }
 
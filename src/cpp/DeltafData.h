@@ -6,13 +6,96 @@
 #include "readindata.h"
 #include "GaussThermal.h"
 #include <fstream>
-#include <gsl/gsl_errno.h>
-#include <gsl/gsl_spline.h>
-#include <gsl/gsl_interp.h>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
 
 using namespace std;
 
 
+// handling of (T, muB, bulkPi / Peq) outside the df coefficient tables (df_out_of_range)
+enum {clamp_out_of_range = 0, extrapolate_out_of_range = 1, flag_out_of_range = 2};
+
+
+// natural cubic spline (same as gsl_interp_cspline) with flat (y, b, c, d) coefficients per interval
+// intervals are found by direct index computation (uniform knots) or a uniform bucket table (non-uniform knots)
+// evaluation does not allocate and is thread safe
+class Cubic_Spline
+{
+    private:
+        int points;                         // number of knots
+        vector<double> x;                   // knots (increasing)
+        vector<double> coefficients;        // [4 * i + k] : y = y_i + dx.(b_i + dx.(c_i + dx.d_i)) in interval i
+
+        double x_min;
+        double x_max;
+        double dx_bucket;                   // width of the lookup buckets
+        vector<int> bucket_interval;        // first interval overlapping each bucket
+
+    public:
+        Cubic_Spline();
+
+        void construct(const double * x_knots, const double * y_knots, int points_in);
+
+        // out_of_range is set if x is outside [x_min, x_max] (value is clamped or extrapolated according to mode)
+        inline double evaluate(double x_eval, int mode, bool & out_of_range) const
+        {
+            if(x_eval < x_min || x_eval > x_max)
+            {
+                out_of_range = true;
+                if(mode != extrapolate_out_of_range) x_eval = min(max(x_eval, x_min), x_max);
+            }
+
+            int ibucket = min(max((int)((x_eval - x_min) / dx_bucket), 0), points - 2);
+            int i = bucket_interval[ibucket];
+
+            while(i < points - 2 && x_eval > x[i + 1]) i++;
+
+            const double * a = coefficients.data()  +  4 * i;
+            double dx = x_eval - x[i];
+
+            return a[0]  +  dx * (a[1]  +  dx * (a[2]  +  dx * a[3]));
+        }
+};
+
+
+// binary df coefficient bundle (deltaf_coefficients/vh/<hrg_eos>/df_coefficients.bin, little endian)
+// the header is followed by T_array, muB_array, the coefficient grids (c0, c1, c2, c3, c4, F, G, betabulk, betaV, betapi)
+// [iT + points_T * imuB] and (if jonah_points > 0) the PTB arrays lambda^2, z and bulkPi / Peq
+// (data_hash = FNV-1a hash of everything after the header, checked when the bundle is mapped)
+const char deltaf_bundle_magic[8] = "iS3D_df";
+const int deltaf_bundle_version = 3;
+
+typedef struct
+{
+  char magic[8];
+  int32_t version;
+  int32_t points_T;
+  int32_t points_muB;
+  int32_t jonah_points;                 // 0 if the bundle has no PTB arrays
+  uint64_t tables_hash;                 // content hash of the coefficient tables (c0.dat, ..., betapi.dat) or of the generator inputs
+  uint64_t tables_stat;                 // hash of the size and modification time of the coefficient tables (0 if generated)
+  uint64_t jonah_hash;                  // hash of the hadron list, temperature and roots of the PTB arrays
+  uint64_t data_hash;                   // content hash of the data following the header
+  double bulkPi_over_Peq_max;
+} Deltaf_Bundle_Header;
+
+
+// df coefficients of many cells in SoA columns (batch evaluate_df_coefficients)
+// only the columns used by df_mode are filled
+class Deltaf_Coefficient_Columns
+{
+    public:
+        long length = 0;
+
+        vector<double> c0, c1, c2, c3, c4, shear14_coeff;       // df_mode = 1
+        vector<double> F, G, betabulk, betaV, betapi;           // df_mode = 2, 3, 5 (betapi also for 4)
+        vector<double> lambda, z, delta_lambda, delta_z;        // df_mode = 4
+
+        deltaf_coefficients get(long i) const;                 // coefficients of cell i (unfilled columns = 0, skipped cells = 0)
+};
+
+
 class Deltaf_Data
 {
     private:
@@ -27,6 +110,35 @@ class Deltaf_Data
         string urqmd = "deltaf_coefficients/vh/urqmd/"; // directories of df coefficient tables
         string smash = "deltaf_coefficients/vh/smash/";
         string smash_box = "deltaf_coefficients/vh/smash_box/";
+
+        int generate_df_coefficients;       // switch to compute the coefficient grids from the PDG list (instead of reading the tables)
+        int generate_points_T;              // grid of the generated coefficients
+        int generate_points_muB;
+        double generate_T_min;
+        double generate_T_max;
+        double generate_muB_min;
+        double generate_muB_max;
+        string generate_laguerre_file = "tables/gauss/gla_roots_weights_64_points.txt";
+
+        int cache_df_coefficients;          // switch to load / save the coefficients from / to a binary bundle
+        string bundle_file;
+        uint64_t tables_hash = 0;           // content hash of the coefficient tables (0 if there are none or not hashed yet)
+        uint64_t tables_stat = 0;           // size and modification time signature of the tables (0 if there are none)
+        uint64_t jonah_hash = 0;            // hash of the PTB inputs (hash_jonah_inputs)
+        bool bundle_stale = false;          // rewrite the bundle (write_df_coefficient_bundle)
+
+        void * bundle_map = NULL;           // memory mapped bundle
+        size_t bundle_size = 0;
+        bool tables_mapped = false;         // coefficient grids / PTB arrays point into the bundle
+        bool jonah_mapped = false;
+
+        uint64_t hash_coefficient_tables();
+        uint64_t stat_coefficient_tables();
+        uint64_t hash_generator_inputs(Particle_Table & particles);
+        uint64_t hash_jonah_inputs(Particle_Table & particles, double T);
+        bool map_df_coefficient_bundle();
+        void read_df_coefficient_tables();
+        void generate_df_coefficient_tables(Particle_Table & particles);
     public:
         int points_T;
         int points_muB;
@@ -39,70 +151,85 @@ class Deltaf_Data
 
         double * T_array;
         double * muB_array;
+
+        int out_of_range_mode;              // clamp, extrapolate or flag (df_out_of_range)
+        long out_of_range_cells = 0;        // number of evaluations outside the tables (flag)
+
         //  Coefficients of 14 moment approximation (vhydro)
         // df ~ ((c0-c2)m^2 + b.c1(u.p) + (4c2-c0)(u.p)^2).Pi + (b.c3 + c4(u.p))p_u.V^u + c5.p_u.p_v.pi^uv
-        double ** c0_data;
-        double ** c1_data;
-        double ** c2_data;
-        double ** c3_data;
-        double ** c4_data;
+        // flat (T, muB) grids [iT + points_T * imuB]
+        double * c0_data;
+        double * c1_data;
+        double * c2_data;
+        double * c3_data;
+        double * c4_data;
 
         //  Coefficients of Chapman Enskog expansion (vhydro)
         // df ~ ((c0-c2)m^2 + b.c1(u.p) + (4c2-c0)(u.p)^2).Pi + (b.c3 + c4(u.p))p_u.V^u + c5.p_u.p_v.pi^uv
-        double ** F_data;
-        double ** G_data;
-        double ** betabulk_data;
-        double ** betaV_data;
-        double ** betapi_data;
+        double * F_data;
+        double * G_data;
+        double * betabulk_data;
+        double * betaV_data;
+        double * betapi_data;
 
         // cubic splines of the coefficients as function of temperature only (neglect muB, nB, Vmu)
         // (c1, G = 0) for muB = 0 and (c3, c4, betaV) aren't needed since they couple to baryon diffusion
         // so in the cubic spline evaluation: just set (G, c1, c3, c4) = 0 and betaV = 1 (betaV is in denominator)
 
-        gsl_spline * c0_spline;
-        gsl_spline * c2_spline;
-        gsl_spline * c3_spline;
+        Cubic_Spline c0_spline;
+        Cubic_Spline c2_spline;
+        Cubic_Spline c3_spline;
 
-        gsl_spline * F_spline;
-        gsl_spline * betabulk_spline;
-        gsl_spline * betaV_spline;
-        gsl_spline * betapi_spline;
+        Cubic_Spline F_spline;
+        Cubic_Spline betabulk_spline;
+        Cubic_Spline betaV_spline;
+        Cubic_Spline betapi_spline;
 
         // Jonah coefficients
         const int jonah_points = 301;       // # lambda interpolation points
         const double lambda_min = -1.0;     // lambda min / max values
         const double lambda_max = 2.0;
         const double delta_lambda = (lambda_max - lambda_min) / ((double)jonah_points - 1.0);
+        const double jonah_T_bin = 1.e-4;   // temperature grid (GeV) of the cached coefficients
 
         double * lambda_squared_array;      // squared isotropic momentum scale
         double * z_array;                   // renormalization factor (apart from detLambda)
         double * bulkPi_over_Peq_array;     // bulk pressure output
         double bulkPi_over_Peq_max;         // the maximum bulk pressure in the array
 
-        gsl_spline * lambda_squared_spline; // cubic splines for lambda^2(bulkPi/Peq) and z(bulkPi/Peq)
-        gsl_spline * z_spline;
+        Cubic_Spline lambda_squared_spline; // cubic splines for lambda^2(bulkPi/Peq) and z(bulkPi/Peq)
+        Cubic_Spline z_spline;
 
         Deltaf_Data(ParameterReader * paraRdr_in);
         ~Deltaf_Data();
 
-        void load_df_coefficient_data();    // read the data files in /deltaf_coefficients/vh
+        // map the binary bundle, read the data files in /deltaf_coefficients/vh or generate the coefficients of the PDG list (generate_df_coefficients = 1)
+        void load_df_coefficient_data(Particle_Table & particles);
+
+        void write_df_coefficient_bundle(); // save the coefficients to the binary bundle (if it is missing or stale)
 
         void construct_cubic_splines();
 
         // I skip the photon because I think it breaks down for lambda = -1
-        void compute_jonah_coefficients(particle_info * particle_data, int Nparticle);
+        void compute_jonah_coefficients(Particle_Table & particles);
 
         deltaf_coefficients evaluate_df_coefficients(double T, double muB, double E, double P, double bulkPi);
 
+        // batch over cells (muB_fo, bulkPi_fo = NULL are treated as zero)
+        // cells with emitting[i] = 0 (e.g. u.dsigma <= 0) are neither evaluated nor counted by df_out_of_range (NULL = all cells)
+        void evaluate_df_coefficients(long length, const double * T_fo, const double * muB_fo, const double * E_fo, const double * P_fo, const double * bulkPi_fo, const char * emitting, Deltaf_Coefficient_Columns & columns);
+
         deltaf_coefficients cubic_spline(double T, double E, double P, double bulkPi);
 
-        double calculate_bilinear(double ** f_data, double T, double muB, double TL, double TR, double muBL, double muBR, int iTL, int iTR, int imuBL, int imuBR);
+        double calculate_bilinear(const double * f_data, double T, double muB, int iTL, int imuBL);
+
+        deltaf_coefficients bilinear_interpolation(double T, double muB, double E, double P);
 
-        deltaf_coefficients bilinear_interpolation(double T, double muB, double E, double P, double bulkPi);
+        void count_out_of_range(bool out_of_range);
 
         void test_df_coefficients(double bulkPi_over_P);
 
-        void compute_particle_densities(particle_info * particle_data, int Nparticle);
+        void compute_particle_densities(Particle_Table & particles);
 };
 
 #endif
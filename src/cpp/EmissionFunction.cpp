@@ -11,6 +11,8 @@
 #include <complex>
 #include <array>
 #include <ctime>
+#include <string.h>
+#include <stdint.h>
 
 #ifdef OPENMP
   #include <omp.h>
@@ -62,7 +64,7 @@ bool is_linear_pion0_density_negative(double T, double neq_pion0, double J20_pio
   return false;
 }
 
-bool does_feqmod_breakdown(double mass_pion0, double T, double F, double bulkPi, double betabulk, double detA, double detA_min, double z, Gauss_Laguerre * laguerre, int df_mode, int fast, double Tavg, double F_avg, double betabulk_avg)
+bool does_feqmod_breakdown(double mass_pion0, double T, double F, double bulkPi, double betabulk, double detA, double detA_min, double z, Gauss_Laguerre * laguerre, int df_mode, int fast, double Tavg, double F_avg, double betabulk_avg, Thermal_Density_Table * density_table)
 {
   if(df_mode == 3)
   {
@@ -73,20 +75,28 @@ bool does_feqmod_breakdown(double mass_pion0, double T, double F, double bulkPi,
       F = F_avg;
       betabulk = betabulk_avg;
     }
-    const int laguerre_pts = laguerre->points;
-    double * pbar_root1 = laguerre->root[1];
-    double * pbar_root2 = laguerre->root[2];
-    double * pbar_weight1 = laguerre->weight[1];
-    double * pbar_weight2 = laguerre->weight[2];
-
     // calculate linearized pion density
-    double mbar_pion0 = mass_pion0 / T;
-
     double neq_fact = T * T * T / two_pi2_hbarC3;
     double J20_fact = T * neq_fact;
 
-    double neq_pion0 = neq_fact * GaussThermal(neq_int, pbar_root1, pbar_weight1, laguerre_pts, mbar_pion0, 0., 0., -1.);
-    double J20_pion0 = J20_fact * GaussThermal(J20_int, pbar_root2, pbar_weight2, laguerre_pts, mbar_pion0, 0., 0., -1.);
+    double neq_pion0, J20_pion0;
+
+    if(density_table != NULL && density_table->in_range(T, 0.0))
+    {
+      density_table->pion0_integrals(T, &neq_pion0, &J20_pion0);
+    }
+    else
+    {
+      double mbar_pion0 = mass_pion0 / T;
+
+      Thermal_Moments pion0 = GaussThermal_moments(neq_moment | J20_moment, laguerre->root, laguerre->weight, laguerre->points, mbar_pion0, 0., 0., -1.);
+
+      neq_pion0 = pion0.neq;
+      J20_pion0 = pion0.J20;
+    }
+
+    neq_pion0 *= neq_fact;
+    J20_pion0 *= J20_fact;
 
     bool pion_density_negative = is_linear_pion0_density_negative(T, neq_pion0, J20_pion0, bulkPi, F, betabulk);
 
@@ -112,8 +122,8 @@ bool does_feqmod_breakdown(double mass_pion0, double T, double F, double bulkPi,
 
 // Class EmissionFunctionArray ------------------------------------------
 EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table* chosen_particles_in, Table* pT_tab_in,
-  Table* phi_tab_in, Table* y_tab_in, Table* eta_tab_in, particle_info* particles_in,
-  int Nparticles_in, FO_surf* surf_ptr_in, long FO_length_in, Deltaf_Data * df_data_in)
+  Table* phi_tab_in, Table* y_tab_in, Table* eta_tab_in, Particle_Table* particles_in,
+  FO_surf* surf_ptr_in, long FO_length_in, Deltaf_Data * df_data_in)
   {
     // momentum and spacetime rapdity tables
     pT_tab = pT_tab_in;
@@ -139,6 +149,10 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
     paraRdr = paraRdr_in;
     OPERATION = paraRdr->getVal("operation");
     MODE = paraRdr->getVal("mode");
+    FUSE_POLARIZATION = paraRdr->getVal("fuse_polarization");
+    FEMTOSCOPY_MOMENTS = paraRdr->getVal("femtoscopy_moments");
+    SPECTRA_HARMONICS = paraRdr->getVal("spectra_harmonics");
+    SPECTRA_OUTPUT_FORMAT = paraRdr->getVal("spectra_output_format");
 
 
     DIMENSION = paraRdr->getVal("dimension");
@@ -203,13 +217,25 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
     LIGHTEST_PARTICLE = paraRdr->getVal("lightest_particle");
     DO_RESONANCE_DECAYS = paraRdr->getVal("do_resonance_decays");
+    DECAY_RESPONSE_TAIL_T = paraRdr->getVal("decay_response_tail_T");
 
     OVERSAMPLE = paraRdr->getVal("oversample");
+    MAX_EVENTS_IN_MEMORY = paraRdr->getVal("max_events_in_memory");
+    SPECIES_WEIGHT_CACHE = paraRdr->getVal("species_weight_cache");
     FAST = paraRdr->getVal("fast");
     MIN_NUM_HADRONS = paraRdr->getVal("min_num_hadrons");
     MAX_NUM_SAMPLES = paraRdr->getVal("max_num_samples");
     SAMPLER_SEED = paraRdr->getVal("sampler_seed");
 
+    TABULATE_MOMENTUM = paraRdr->getVal("tabulate_momentum");
+    MOMENTUM_TABLE_T_BINS = paraRdr->getVal("momentum_table_T_bins");
+    MOMENTUM_TABLE_POINTS = paraRdr->getVal("momentum_table_points");
+    CACHE_MOMENTUM_TABLE = paraRdr->getVal("cache_momentum_table");
+
+    TABULATE_DENSITIES = paraRdr->getVal("tabulate_densities");
+    DENSITY_TABLE_T_BINS = paraRdr->getVal("density_table_T_bins");
+    DENSITY_TABLE_ALPHAB_BINS = paraRdr->getVal("density_table_alphaB_bins");
+
     if(OPERATION == 2)
     {
       printf("Sampler seed set to %ld \n", SAMPLER_SEED);
@@ -220,6 +246,11 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
     //::::::::::::::::::::::::::::::::::::::::::::::::::::
     TEST_SAMPLER = paraRdr->getVal("test_sampler");
 
+    PARTICLE_LIST_FORMAT = paraRdr->getVal("particle_list_format");
+    PARTICLE_STORE_PRECISION = paraRdr->getVal("particle_store_precision");
+    EVENT_OBSERVABLES = paraRdr->getVal("event_observables");
+    DECAY_SAMPLED_HADRONS = paraRdr->getVal("decay_sampled_hadrons");
+
     PT_MIN = paraRdr->getVal("pT_min");
     PT_MAX = paraRdr->getVal("pT_max");
     PT_BINS = paraRdr->getVal("pT_bins");
@@ -245,66 +276,50 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
     R_MAX = paraRdr->getVal("r_max");
     R_BINS = paraRdr->getVal("r_bins");
     R_WIDTH = (R_MAX - R_MIN) / (double)R_BINS;
+
+    EMISSION_HISTOGRAMS = paraRdr->getVal("emission_histograms");
     //::::::::::::::::::::::::::::::::::::::::::::::::::::
 
     particles = particles_in;
-    Nparticles = Nparticles_in;
+    Nparticles = particles_in->size;
     surf_ptr = surf_ptr_in;
     FO_length = FO_length_in;
     df_data = df_data_in;
     number_of_chosen_particles = chosen_particles_in->getNumberOfRows();
 
-    // allocate memory for sampled distributions / spectra (for sampler testing)
-    dN_dy_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
-    dN_deta_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
-    dN_dphipdy_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
-    dN_2pipTdpTdy_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
+    // histograms of sampled distributions (for sampler testing)
+    if(TEST_SAMPLER) define_sampled_histograms();
 
-    pT_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
-    vn_real_count = (double***)calloc(K_MAX, sizeof(double));
-    vn_imag_count = (double***)calloc(K_MAX, sizeof(double));
 
-    dN_taudtaudy_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
-    dN_twopirdrdy_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
-    dN_dphisdy_count = (double**)calloc(number_of_chosen_particles, sizeof(double));
+    chosen_particles_01_table = new int[Nparticles];
 
-    for(int ipart = 0; ipart < number_of_chosen_particles; ipart++)
-    {
-      dN_dy_count[ipart] = (double*)calloc(Y_BINS, sizeof(double));
-      dN_deta_count[ipart] = (double*)calloc(ETA_BINS, sizeof(double));
-      dN_dphipdy_count[ipart] = (double*)calloc(PHIP_BINS, sizeof(double));
-      dN_2pipTdpTdy_count[ipart] = (double*)calloc(PT_BINS, sizeof(double));
-      pT_count[ipart] = (double*)calloc(PT_BINS, sizeof(double));
-
-      dN_taudtaudy_count[ipart] = (double*)calloc(TAU_BINS, sizeof(double));
-      dN_twopirdrdy_count[ipart] = (double*)calloc(R_BINS, sizeof(double));
-      dN_dphisdy_count[ipart] = (double*)calloc(PHIP_BINS, sizeof(double));
-    }
+    // phip Fourier harmonics of the continuous spectra replace the phip resolved spectra (operation = 1)
+    if(OPERATION != 1) SPECTRA_HARMONICS = 0;
 
-    for(int k = 0; k < K_MAX; k++)
+    if(SPECTRA_HARMONICS && (DF_MODE == 5 || DO_RESONANCE_DECAYS || FEMTOSCOPY_MOMENTS))
     {
-      vn_real_count[k] = (double**)calloc(number_of_chosen_particles, sizeof(double));
-      vn_imag_count[k] = (double**)calloc(number_of_chosen_particles, sizeof(double));
-
-      for(int ipart = 0; ipart < number_of_chosen_particles; ipart++)
-      {
-        vn_real_count[k][ipart] = (double*)calloc(PT_BINS, sizeof(double));
-        vn_imag_count[k][ipart] = (double*)calloc(PT_BINS, sizeof(double));
-      }
+      printf("EmissionFunctionArray error: spectra_harmonics = 1 needs df_mode = (1,2,3,4), do_resonance_decays = 0 and femtoscopy_moments = 0\n");
+      exit(-1);
     }
 
-
-    chosen_particles_01_table = new int[Nparticles];
-
     //a class member to hold 3D smooth CF spectra for all chosen particles
-    dN_pTdpTdphidy = new double [number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length];
+    dN_pTdpTdphidy = NULL;
     // holds smooth CF spectra of a given parent resonance
     logdN_PTdPTdPhidY = new double [pT_tab_length * phi_tab_length * y_tab_length];
 
-    //zero the array
-    for (int iSpectra = 0; iSpectra < number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length; iSpectra++)
+    if(SPECTRA_HARMONICS)
     {
-      dN_pTdpTdphidy[iSpectra] = 0.0;
+      dN_harmonics = new double [(2 * K_MAX + 1) * number_of_chosen_particles * pT_tab_length * y_tab_length]();
+    }
+    else
+    {
+      dN_pTdpTdphidy = new double [number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length];
+
+      //zero the array
+      for (int iSpectra = 0; iSpectra < number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length; iSpectra++)
+      {
+        dN_pTdpTdphidy[iSpectra] = 0.0;
+      }
     }
     for(int iS_parent = 0; iS_parent < pT_tab_length * phi_tab_length * y_tab_length; iS_parent++)
     {
@@ -345,7 +360,7 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       for (int n = 0; n < Nparticles; n++)
       {
-        if (particles[n].mc_id == mc_id)
+        if (particles->mc_id[n] == mc_id)
         {
           chosen_particles_01_table[n] = 1;
           break;
@@ -362,7 +377,7 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       int mc_id = chosen_particles_in->get(1, m + 1);
       for (int n = 0; n < Nparticles; n++)
       {
-        if (particles[n].mc_id == mc_id)
+        if (particles->mc_id[n] == mc_id)
         {
           chosen_particles_sampling_table[current_idx] = n;
           current_idx ++;
@@ -378,7 +393,7 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       {
         for (int n = 0; n < number_of_chosen_particles - m - 1; n++)
         {
-          if (particles[chosen_particles_sampling_table[n]].mass > particles[chosen_particles_sampling_table[n + 1]].mass)
+          if (particles->mass[chosen_particles_sampling_table[n]] > particles->mass[chosen_particles_sampling_table[n + 1]])
           {
             // swap them
             int particle_idx = chosen_particles_sampling_table[n + 1];
@@ -388,6 +403,24 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
         } // for (int n = 0; n < number_of_chosen_particles - m - 1; n++)
       } // for (int m = 0; m < number_of_chosen_particles; m++)
     } // if (GROUP_PARTICLES == 1)
+
+    // chosen particle mass and mcid (sampled particles only store the chosen index)
+    if(number_of_chosen_particles > 65535)
+    {
+      printf("EmissionFunctionArray error: compact sampled particles support at most 65535 chosen particles\n");
+      exit(-1);
+    }
+
+    chosen_mass.resize(number_of_chosen_particles);
+    chosen_mcid.resize(number_of_chosen_particles);
+    chosen_charge.resize(number_of_chosen_particles);
+
+    for(int ipart = 0; ipart < number_of_chosen_particles; ipart++)
+    {
+      chosen_mass[ipart] = particles->mass[chosen_particles_sampling_table[ipart]];
+      chosen_mcid[ipart] = particles->mc_id[chosen_particles_sampling_table[ipart]];
+      chosen_charge[ipart] = particles->charge[chosen_particles_sampling_table[ipart]];
+    }
   } // EmissionFunctionArray::EmissionFunctionArray
 
   EmissionFunctionArray::~EmissionFunctionArray()
@@ -395,7 +428,23 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
     delete[] chosen_particles_01_table;
     delete[] chosen_particles_sampling_table;
     delete[] dN_pTdpTdphidy; //for holding 3d spectra of all chosen particles
+    delete[] dN_harmonics;
     delete[] logdN_PTdPTdPhidY;
+
+    if(momentum_table != NULL) delete momentum_table;
+    if(density_table != NULL) delete density_table;
+    if(sampled_histogram != NULL) delete sampled_histogram;
+    if(decay_response != NULL) delete decay_response;
+    if(hadron_decayer != NULL) delete hadron_decayer;
+    if(polzn_sweep != NULL) delete polzn_sweep;
+    if(femto_sweep != NULL) delete femto_sweep;
+    if(emission_histograms != NULL) delete emission_histograms;
+  }
+
+
+  void EmissionFunctionArray::set_particle_event_callback(Particle_Event_Callback callback)
+  {
+    particle_event_callback = callback;
   }
 
 
@@ -407,10 +456,12 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
   {
     printf("Writing thermal spectra to file...\n");
 
-    char filename[255] = "";
+    set_momentum_grid();
 
+    #pragma omp parallel for schedule(dynamic)
     for(long ipart  = 0; ipart < number_of_chosen_particles; ipart++)
     {
+      char filename[255] = "";
       sprintf(filename, "results/continuous/dN_pTdpTdphidy_%d.dat", MCID[ipart]);
       ofstream spectra(filename, ios_base::out);
 
@@ -418,16 +469,15 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       for(long iy = 0; iy < y_tab_length; iy++)
       {
-        double y = 0.0;
-        if(DIMENSION == 3) y = y_tab->get(1,iy + 1);
+        double y = y_values[iy];
 
         for(long iphip = 0; iphip < phi_tab_length; iphip++)
         {
-          double phip = phi_tab->get(1,iphip + 1);
+          double phip = phip_values[iphip];
 
           for(long ipT = 0; ipT < pT_tab_length; ipT++)
           {
-            double pT = pT_tab->get(1,ipT + 1);
+            double pT = pT_values[ipT];
             long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
 
             spectra << scientific <<  setw(5) << setprecision(8) << y << "\t" << phip << "\t" << pT << "\t" << dN_pTdpTdphidy[iS3D] << "\n";
@@ -444,33 +494,24 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
   void EmissionFunctionArray::write_dN_dphidy_toFile(int *MCID)
   {
     printf("Writing thermal dN_dphidy to file...\n");
-    char filename[255] = "";
 
     // write a separate file for each species
+    #pragma omp parallel for schedule(dynamic)
     for(long ipart  = 0; ipart < number_of_chosen_particles; ipart++)
     {
+      const Continuous_Observables & observables = continuous_observables[ipart];
+
+      char filename[255] = "";
       sprintf(filename, "results/continuous/dN_dphidy_%d.dat", MCID[ipart]);
       ofstream spectra(filename, ios_base::out);
 
       for(long iy = 0; iy < y_tab_length; iy++)
       {
-        double y = 0.0;
-        if(DIMENSION == 3) y = y_tab->get(1,iy + 1);
+        double y = y_values[iy];
 
         for(long iphip = 0; iphip < phi_tab_length; iphip++)
         {
-          double phip = phi_tab->get(1,iphip + 1);
-          double dN_dphidy = 0.0;
-
-          for(int ipT = 0; ipT < pT_tab_length; ipT++)
-          {
-            double pT_weight = pT_tab->get(2, ipT + 1);
-
-            long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
-
-            dN_dphidy += pT_weight * dN_pTdpTdphidy[iS3D];
-          }
-          spectra << scientific <<  setw(5) << setprecision(8) << y << "\t" << phip << "\t" << dN_dphidy << "\n";
+          spectra << scientific <<  setw(5) << setprecision(8) << y << "\t" << phip_values[iphip] << "\t" << observables.dN_dphidy[iphip  +  phi_tab_length * iy] << "\n";
         }
         if(iy < y_tab_length - 1) spectra << "\n";
       }
@@ -482,35 +523,22 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
   {
     printf("Writing thermal dN_twopipTdpTdy to file...\n");
 
-    char filename[255] = "";
-
+    #pragma omp parallel for schedule(dynamic)
     for(long ipart  = 0; ipart < number_of_chosen_particles; ipart++)
     {
+      const Continuous_Observables & observables = continuous_observables[ipart];
+
+      char filename[255] = "";
       sprintf(filename, "results/continuous/dN_2pipTdpTdy_%d.dat", MCID[ipart]);
       ofstream spectra(filename, ios_base::out);
 
       for(long iy = 0; iy < y_tab_length; iy++)
       {
-        double y = 0.0;
-
-        if(DIMENSION == 3) y = y_tab->get(1, iy + 1);
+        double y = y_values[iy];
 
         for(long ipT = 0; ipT < pT_tab_length; ipT++)
         {
-          double pT = pT_tab->get(1, ipT + 1);
-
-          double dN_twopipTdpTdy = 0.0;
-
-          for(long iphip = 0; iphip < phi_tab_length; iphip++)
-          {
-            double phip_weight = phi_tab->get(2, iphip + 1);
-
-            long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
-
-            dN_twopipTdpTdy += phip_weight * dN_pTdpTdphidy[iS3D] / two_pi;
-          }
-
-          spectra << scientific <<  setw(5) << setprecision(8) << y << "\t" << pT << "\t" << dN_twopipTdpTdy << "\n";
+          spectra << scientific <<  setw(5) << setprecision(8) << y << "\t" << pT_values[ipT] << "\t" << observables.dN_2pipTdpTdy[ipT  +  pT_tab_length * iy] << "\n";
         }
 
         if(iy < y_tab_length - 1) spectra << "\n";
@@ -524,34 +552,20 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
   void EmissionFunctionArray::write_dN_dy_toFile(int *MCID)
   {
     printf("Writing thermal dN_dy to file...\n");
-    char filename[255] = "";
 
     //write a separate file for each species
+    #pragma omp parallel for schedule(dynamic)
     for(long ipart = 0; ipart < number_of_chosen_particles; ipart++)
     {
+      const Continuous_Observables & observables = continuous_observables[ipart];
+
+      char filename[255] = "";
       sprintf(filename, "results/continuous/dN_dy_%d.dat", MCID[ipart]);
       ofstream spectra(filename, ios_base::out);
 
       for(long iy = 0; iy < y_tab_length; iy++)
       {
-        double y = 0.0;
-        if(DIMENSION == 3) y = y_tab->get(1, iy + 1);
-
-        double dN_dy = 0.0;
-
-        for(long iphip = 0; iphip < phi_tab_length; iphip++)
-        {
-          double phip_weight = phi_tab->get(2, iphip + 1);
-
-          for(long ipT = 0; ipT < pT_tab_length; ipT++)
-          {
-            double pT_weight = pT_tab->get(2, ipT + 1);
-            long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
-
-            dN_dy += phip_weight * pT_weight * dN_pTdpTdphidy[iS3D];
-          }
-        }
-        spectra << setw(5) << setprecision(8) << y << "\t" << dN_dy << endl;
+        spectra << setw(5) << setprecision(8) << y_values[iy] << "\t" << observables.dN_dy[iy] << endl;
       }
       spectra.close();
     }
@@ -612,10 +626,10 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
   {
     printf("Writing sampled particles list to file...\n");
 
-    for(int ievent = 0; ievent < Nevents; ievent++)
+    for(long ievent = 0; ievent < (long)particle_event_list.size(); ievent++)
     {
       char filename[255] = "";
-      sprintf(filename, "results/particle_list_%d.dat", ievent + 1);
+      sprintf(filename, "results/particle_list_%ld.dat", event_offset + ievent + 1);
 
       //ofstream spectraFile(filename, ios_base::app);
       ofstream spectraFile(filename, ios_base::out);
@@ -626,15 +640,17 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       spectraFile << "mcid" << "," << "tau" << "," << "x" << "," << "y" << "," << "eta" << "," << "E" << "," << "px" << "," << "py" << "," << "pz" << "\n";
       for (int ipart = 0; ipart < num_particles; ipart++)
       {
-        int mcid = particle_event_list[ievent][ipart].mcID;
-        double tau = particle_event_list[ievent][ipart].tau;
-        double x = particle_event_list[ievent][ipart].x;
-        double y = particle_event_list[ievent][ipart].y;
-        double eta = particle_event_list[ievent][ipart].eta;
-        double E = particle_event_list[ievent][ipart].E;
-        double px = particle_event_list[ievent][ipart].px;
-        double py = particle_event_list[ievent][ipart].py;
-        double pz = particle_event_list[ievent][ipart].pz;
+        Compact_Particle & particle = particle_event_list[ievent][ipart];
+
+        int mcid = chosen_mcid[particle.chosen_index];
+        double tau = particle.tau;
+        double x = particle.x;
+        double y = particle.y;
+        double eta = particle.eta;
+        double E = particle.E(chosen_mass[particle.chosen_index]);
+        double px = particle.px;
+        double py = particle.py;
+        double pz = particle.pz;
         spectraFile << scientific <<  setw(5) << setprecision(8) << mcid << "," << tau << "," << x << "," << y << "," << eta << "," << E << "," << px << "," << py << "," << pz << "\n";
       }//ipart
       spectraFile.close();
@@ -646,10 +662,10 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
   {
     printf("Writing sampled particles list to OSCAR File...\n");
 
-    for(int ievent = 0; ievent < Nevents; ievent++)
+    for(long ievent = 0; ievent < (long)particle_event_list.size(); ievent++)
     {
       char filename[255] = "";
-      sprintf(filename, "results/particle_list_osc_%d.dat", ievent + 1);
+      sprintf(filename, "results/particle_list_osc_%ld.dat", event_offset + ievent + 1);
 
       ofstream spectraFile(filename, ios_base::out);
 
@@ -660,23 +676,163 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       spectraFile << "n pid px py pz E m x y z t" << "\n";
       for (int ipart = 0; ipart < num_particles; ipart++)
       {
-        int mcid = particle_event_list[ievent][ipart].mcID;
-        double x = particle_event_list[ievent][ipart].x;
-        double y = particle_event_list[ievent][ipart].y;
-        double t = particle_event_list[ievent][ipart].t;
-        double z = particle_event_list[ievent][ipart].z;
-
-        double m  = particle_event_list[ievent][ipart].mass;
-        double E  = particle_event_list[ievent][ipart].E;
-        double px = particle_event_list[ievent][ipart].px;
-        double py = particle_event_list[ievent][ipart].py;
-        double pz = particle_event_list[ievent][ipart].pz;
-        spectraFile << ipart << " " << mcid << " " << scientific <<  setw(5) << setprecision(16) << px << " " << py << " " << pz << " " << E << " " << m << " " << x << " " << y << " " << z << " " << t << "\n";
+        Compact_Particle & particle = particle_event_list[ievent][ipart];
+
+        int mcid = chosen_mcid[particle.chosen_index];
+        double x = particle.x;
+        double y = particle.y;
+        double t = particle.t();
+        double z = particle.z();
+
+        double m  = chosen_mass[particle.chosen_index];
+        double E  = particle.E(m);
+        double px = particle.px;
+        double py = particle.py;
+        double pz = particle.pz;
+        spectraFile << ipart << " " << mcid << " " << scientific <<  setw(5) << setprecision(8) << px << " " << py << " " << pz << " " << E << " " << m << " " << x << " " << y << " " << z << " " << t << "\n";
       }//ipart
       spectraFile.close();
     } // ievent
   }
 
+  //write particle list in SMASH's binary OSCAR2013 format (format version 7, default variant)
+  //one file per run: header, then a particle block 'p' and an event end block 'f' per event
+  void EmissionFunctionArray::write_particle_list_binary_OSC()
+  {
+    printf("Writing sampled particles list to binary OSCAR file...\n");
+
+    if(binary_OSC_file == NULL)
+    {
+      // write to a unique temporary file, installed when the run is complete (close_particle_list_binary_OSC)
+      binary_OSC_file = open_temporary_file("results/particles_binary.bin", binary_OSC_tmp_file);
+
+      if(binary_OSC_file == NULL)
+      {
+        printf("write_particle_list_binary_OSC error: could not open a temporary file for results/particles_binary.bin\n");
+        exit(-1);
+      }
+
+      setvbuf(binary_OSC_file, NULL, _IOFBF, 1 << 22);    // 4 MB buffer for sequential writes
+
+      const char magic[4] = {'S', 'M', 'S', 'H'};
+      const uint16_t format_version = 7;
+      const uint16_t format_variant = 0;
+      const char smash_version[] = "iS3D";
+      const uint32_t length = sizeof(smash_version) - 1;
+
+      binary_OSC_written = (fwrite(magic, 1, 4, binary_OSC_file) == 4);
+      binary_OSC_written = binary_OSC_written && (fwrite(&format_version, sizeof(uint16_t), 1, binary_OSC_file) == 1);
+      binary_OSC_written = binary_OSC_written && (fwrite(&format_variant, sizeof(uint16_t), 1, binary_OSC_file) == 1);
+      binary_OSC_written = binary_OSC_written && (fwrite(&length, sizeof(uint32_t), 1, binary_OSC_file) == 1);
+      binary_OSC_written = binary_OSC_written && (fwrite(smash_version, 1, length, binary_OSC_file) == length);
+    }
+
+    const long record_size = 9 * sizeof(double)  +  3 * sizeof(int32_t);   // t x y z m p0 px py pz pdg id charge
+
+    std::vector<char> buffer;
+
+    for(long ievent = 0; ievent < (long)particle_event_list.size(); ievent++)
+    {
+      uint32_t num_particles = particle_event_list[ievent].size();
+
+      buffer.resize(5  +  num_particles * record_size  +  14);
+
+      char * block = buffer.data();
+
+      block[0] = 'p';                                     // particle block header
+      memcpy(block + 1, &num_particles, 4);
+      block += 5;
+
+      for(uint32_t ipart = 0; ipart < num_particles; ipart++)
+      {
+        Compact_Particle & particle = particle_event_list[ievent][ipart];
+
+        double m = chosen_mass[particle.chosen_index];
+
+        double values[9] = {particle.t(), particle.x, particle.y, particle.z(), m, particle.E(m), particle.px, particle.py, particle.pz};
+        int32_t ints[3] = {chosen_mcid[particle.chosen_index], (int32_t)ipart, chosen_charge[particle.chosen_index]};
+
+        memcpy(block, values, sizeof(values));
+        memcpy(block + sizeof(values), ints, sizeof(ints));
+        block += record_size;
+      }
+
+      uint32_t event_number = event_offset + ievent;
+      double impact_parameter = 0.0;
+      char empty_event = (num_particles == 0);
+
+      block[0] = 'f';                                     // event end block
+      memcpy(block + 1, &event_number, 4);
+      memcpy(block + 5, &impact_parameter, 8);
+      block[13] = empty_event;
+
+      binary_OSC_written = binary_OSC_written && (fwrite(buffer.data(), 1, buffer.size(), binary_OSC_file) == buffer.size());
+    }
+  }
+
+  void EmissionFunctionArray::close_particle_list_binary_OSC()
+  {
+    // checked close and rename of the binary OSCAR file (exit if any write failed)
+    bool installed = install_temporary_file(binary_OSC_file, binary_OSC_tmp_file, "results/particles_binary.bin", binary_OSC_written);
+    binary_OSC_file = NULL;
+
+    if(!installed)
+    {
+      printf("write_particle_list_binary_OSC error: could not write results/particles_binary.bin\n");
+      exit(-1);
+    }
+  }
+
+  void EmissionFunctionArray::flush_particle_events(Compact_Event_List &final_events)
+  {
+    if(particle_store != NULL)
+    {
+      for(long ievent = 0; ievent < (long)particle_event_list.size(); ievent++)
+      {
+        particle_store->write_event(particle_event_list[ievent], chosen_mass.data(), chosen_mcid.data());  // append events to binary particle store
+      }
+    }
+    else if(PARTICLE_LIST_FORMAT == 2)
+    {
+      write_particle_list_binary_OSC();                   // append events to SMASH binary OSCAR file
+    }
+    else
+    {
+      write_particle_list_OSC();                          // write OSCAR particle list to file (if not using JETSCAPE)
+    }
+
+    if(particle_event_callback)
+    {
+      // expand the compact events of this batch one at a time for the callback, releasing each compact event
+      for(long ievent = 0; ievent < (long)particle_event_list.size(); ievent++)
+      {
+        std::vector<Sampled_Particle> event;
+        event.reserve(particle_event_list[ievent].size());
+
+        for(const Compact_Particle & particle : particle_event_list[ievent])
+        {
+          event.push_back(particle.expand(chosen_mass[particle.chosen_index], chosen_mcid[particle.chosen_index]));
+        }
+
+        std::vector<Compact_Particle>().swap(particle_event_list[ievent]);
+
+        particle_event_callback(event_offset + ievent, std::move(event));
+      }
+    }
+    else if(Nevents_batch == Nevents)
+    {
+      // store the events compactly (not streaming), with a copy of the chosen species table to expand them on access
+      Chosen_Species_Table * species = new Chosen_Species_Table;
+      species->mass = chosen_mass;
+      species->mcID = chosen_mcid;
+
+      final_events.species.reset(species);
+      final_events.events.swap(particle_event_list);
+    }
+
+    particle_event_list.clear();
+  }
+
 
 
 
@@ -705,9 +861,9 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       for(int iy = 0; iy < Y_BINS; iy++)
       {
-        average += dN_dy_count[ipart][iy];
+        average += sampled_histogram->get(dN_dy_hist, ipart, iy);
 
-        dN_dy << setprecision(6) << y_mid[iy] << "\t" << dN_dy_count[ipart][iy] / (Y_WIDTH * (double)Nevents) << endl;
+        dN_dy << setprecision(6) << y_mid[iy] << "\t" << sampled_histogram->get(dN_dy_hist, ipart, iy) / (Y_WIDTH * (double)Nevents) << endl;
 
       } // iy
 
@@ -717,8 +873,6 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       dN_dy_avg.close();
 
     } // ipart
-
-    free_2D(dN_dy_count, number_of_chosen_particles);
   }
 
 
@@ -738,13 +892,11 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       for(int ieta = 0; ieta < ETA_BINS; ieta++)
       {
-        dN_deta << setprecision(6) << eta_mid[ieta] << "\t" << dN_deta_count[ipart][ieta] / (ETA_WIDTH * (double)Nevents) << endl;
+        dN_deta << setprecision(6) << eta_mid[ieta] << "\t" << sampled_histogram->get(dN_deta_hist, ipart, ieta) / (ETA_WIDTH * (double)Nevents) << endl;
       }
       dN_deta.close();
 
     } // ipart
-
-    free_2D(dN_deta_count, number_of_chosen_particles);
   }
 
 
@@ -765,13 +917,11 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       for(int ipT = 0; ipT < PT_BINS; ipT++)
       {
-        dN_2pipTdpTdy << setprecision(6) << scientific << pT_mid[ipT] << "\t" << dN_2pipTdpTdy_count[ipart][ipT] / (two_pi * 2.0 * Y_CUT * PT_WIDTH * pT_mid[ipT] * (double)Nevents) << "\n";
+        dN_2pipTdpTdy << setprecision(6) << scientific << pT_mid[ipT] << "\t" << sampled_histogram->get(dN_2pipTdpTdy_hist, ipart, ipT) / (two_pi * 2.0 * Y_CUT * PT_WIDTH * pT_mid[ipT] * (double)Nevents) << "\n";
       }
       dN_2pipTdpTdy.close();
 
     } // ipart
-
-    free_2D(dN_2pipTdpTdy_count, number_of_chosen_particles);
   }
 
 
@@ -791,90 +941,92 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       for(int iphip = 0; iphip < PHIP_BINS; iphip++)
       {
-        dN_dphipdy << setprecision(6) << scientific << phip_mid[iphip] << "\t" << dN_dphipdy_count[ipart][iphip] / (2.0 * Y_CUT * PHIP_WIDTH * (double)Nevents) << "\n";
+        dN_dphipdy << setprecision(6) << scientific << phip_mid[iphip] << "\t" << sampled_histogram->get(dN_dphipdy_hist, ipart, iphip) / (2.0 * Y_CUT * PHIP_WIDTH * (double)Nevents) << "\n";
       }
       dN_dphipdy.close();
 
     } // ipart
-
-    free_2D(dN_dphipdy_count, number_of_chosen_particles);
   }
 
 
   void EmissionFunctionArray::write_continuous_vn_toFile(int *MCID)
   {
     printf("Writing continuous vn(pT,y) to file (for testing vn's)...\n");
-    char filename[255] = "";
-
-    const complex<double> I(0.0,1.0);   // imaginary i
-
-    const int k_max = 7;                // v_n = {v_1, ..., v_7}
 
     // write a separate file for each species
+    #pragma omp parallel for schedule(dynamic)
     for(long ipart = 0; ipart < number_of_chosen_particles; ipart++)
     {
+      const Continuous_Observables & observables = continuous_observables[ipart];
+
+      char filename[255] = "";
       sprintf(filename, "results/continuous/vn_%d.dat", MCID[ipart]);
       ofstream vn_File(filename, ios_base::out);
 
       for(long iy = 0; iy < y_tab_length; iy++)
       {
-        double y = 0.0;
-        if(DIMENSION == 3) y = y_tab->get(1, iy + 1);
+        double y = y_values[iy];
 
         for(long ipT = 0; ipT < pT_tab_length; ipT++)
         {
-          double pT = pT_tab->get(1, ipT + 1);
+          vn_File << scientific <<  setw(5) << setprecision(8) << y << "\t" << pT_values[ipT];
 
-          double Vn_real_numerator[k_max];
-          double Vn_imag_numerator[k_max];
-
-          for(int k = 0; k < k_max; k++)
+          for(int k = 0; k < K_MAX; k++)
           {
-            Vn_real_numerator[k] = 0.0;
-            Vn_imag_numerator[k] = 0.0;
+            vn_File << "\t" << observables.vn[k  +  K_MAX * (ipT  +  pT_tab_length * iy)];
           }
 
-          double vn_denominator = 0.0;
+          vn_File << "\n";
 
-          for(long iphip = 0; iphip < phi_tab_length; iphip++)
-          {
-            double phip = phi_tab->get(1, iphip + 1);
-            double phip_weight = phi_tab->get(2, iphip + 1);
+        } //ipT
 
-            long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
+        vn_File << "\n";
 
-            for(int k = 0; k < k_max; k++)
-            {
-              Vn_real_numerator[k] += cos(((double)k + 1.0) * phip) * phip_weight * dN_pTdpTdphidy[iS3D];
-              Vn_imag_numerator[k] += sin(((double)k + 1.0) * phip) * phip_weight * dN_pTdpTdphidy[iS3D];
-            }
-            vn_denominator += phip_weight * dN_pTdpTdphidy[iS3D];
+      } //iy
 
-          } //iphip
+      vn_File.close();
 
-          vn_File << scientific <<  setw(5) << setprecision(8) << y << "\t" << pT;
+    }
 
-          for(int k = 0; k < k_max; k++)
-          {
-            double vn = abs(Vn_real_numerator[k]  +  I * Vn_imag_numerator[k]) / vn_denominator;
+  }
 
-            if(vn_denominator < 1.e-15) vn = 0.0;
+  void EmissionFunctionArray::write_continuous_spectra_store(int *MCID)
+  {
+    // the momentum grid, dN_pTdpTdphidy and the continuous_observables of all species in one binary file
+    printf("Writing continuous spectra to results/continuous/spectra.bin...\n");
 
-            vn_File << "\t" << vn;
-          }
+    long npart = number_of_chosen_particles;
 
-          vn_File << "\n";
+    vector<double> dN_2pipTdpTdy, dN_dphidy, dN_dy, vn;    // contiguous over species
 
-        } //ipT
+    for(long ipart = 0; ipart < npart; ipart++)
+    {
+      const Continuous_Observables & observables = continuous_observables[ipart];
 
-        vn_File << "\n";
+      dN_2pipTdpTdy.insert(dN_2pipTdpTdy.end(), observables.dN_2pipTdpTdy.begin(), observables.dN_2pipTdpTdy.end());
+      dN_dphidy.insert(dN_dphidy.end(), observables.dN_dphidy.begin(), observables.dN_dphidy.end());
+      dN_dy.insert(dN_dy.end(), observables.dN_dy.begin(), observables.dN_dy.end());
+      vn.insert(vn.end(), observables.vn.begin(), observables.vn.end());
+    }
 
-      } //iy
+    Spectra_Store_Writer store("results/continuous/spectra.bin", DIMENSION, MCID, npart);
 
-      vn_File.close();
+    store.add("pT", "GeV", "pT", {pT_tab_length}, pT_values.data());
+    store.add("pT_weight", "GeV", "pT", {pT_tab_length}, pT_weights.data());
+    store.add("phip", "rad", "phip", {phi_tab_length}, phip_values.data());
+    store.add("phip_weight", "rad", "phip", {phi_tab_length}, phip_weights.data());
+    store.add("y", "1", "y", {y_tab_length}, y_values.data());
 
+    if(!SPECTRA_HARMONICS)
+    {
+      store.add("dN_pTdpTdphidy", "GeV^-2", "species,pT,phip,y", {npart, pT_tab_length, phi_tab_length, y_tab_length}, dN_pTdpTdphidy);
+      store.add("dN_dphidy", "GeV^-1", "species,y,phip", {npart, y_tab_length, phi_tab_length}, dN_dphidy.data());   // pT_weight sums (as in dN_dphidy_<mcid>.dat)
     }
+    store.add("dN_2pipTdpTdy", "GeV^-2", "species,y,pT", {npart, y_tab_length, pT_tab_length}, dN_2pipTdpTdy.data());
+    store.add("dN_dy", "GeV^-1", "species,y", {npart, y_tab_length}, dN_dy.data());                                       // (as in dN_dy_<mcid>.dat)
+    store.add("vn", "1", "species,y,pT,n", {npart, y_tab_length, pT_tab_length, K_MAX}, vn.data());
 
+    store.write();
   }
 
   void EmissionFunctionArray::write_sampled_vn_to_file_test(int * MCID)
@@ -899,7 +1051,7 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
         for(int k = 0; k < K_MAX; k++)
         {
-          double vn_abs = abs(vn_real_count[k][ipart][ipT]  +  I * vn_imag_count[k][ipart][ipT]) / pT_count[ipart][ipT];
+          double vn_abs = abs(sampled_histogram->get(vn_hist, ipart, ipT, 1 + 2 * k)  +  I * sampled_histogram->get(vn_hist, ipart, ipT, 2 + 2 * k)) / sampled_histogram->get(vn_hist, ipart, ipT);
           if(std::isnan(vn_abs) || std::isinf(vn_abs)) vn_abs = 0.0;
 
           vn << "\t" << vn_abs;
@@ -910,10 +1062,6 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
       vn.close();
     } // ipart
-
-    free_2D(pT_count, number_of_chosen_particles);
-    free_3D(vn_real_count, K_MAX, number_of_chosen_particles);
-    free_3D(vn_imag_count, K_MAX, number_of_chosen_particles);
   }
 
 
@@ -950,17 +1098,17 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       // normalize spacetime distributions by the binwidth, jacobian factor, events and rapidity cut range
       for(int ir = 0; ir < R_BINS; ir++)
       {
-        dN_twopirdrdy << setprecision(6) << scientific << r_mid[ir] << "\t" << dN_twopirdrdy_count[ipart][ir] / (two_pi * r_mid[ir] * R_WIDTH * (double)Nevents * 2.0 * Y_CUT) << "\n";
+        dN_twopirdrdy << setprecision(6) << scientific << r_mid[ir] << "\t" << sampled_histogram->get(dN_twopirdrdy_hist, ipart, ir) / (two_pi * r_mid[ir] * R_WIDTH * (double)Nevents * 2.0 * Y_CUT) << "\n";
       }
 
       for(int itau = 0; itau < TAU_BINS; itau++)
       {
-        dN_taudtaudy << setprecision(6) << scientific << tau_mid[itau] << "\t" << dN_taudtaudy_count[ipart][itau] / (tau_mid[itau] * TAU_WIDTH * (double)Nevents * 2.0 * Y_CUT) << "\n";
+        dN_taudtaudy << setprecision(6) << scientific << tau_mid[itau] << "\t" << sampled_histogram->get(dN_taudtaudy_hist, ipart, itau) / (tau_mid[itau] * TAU_WIDTH * (double)Nevents * 2.0 * Y_CUT) << "\n";
       }
 
       for(int iphi = 0; iphi < PHIP_BINS; iphi++)
       {
-        dN_dphisdy << setprecision(6) << scientific << phi_mid[iphi] << "\t" << dN_dphisdy_count[ipart][iphi] / (PHIP_WIDTH * (double)Nevents * 2.0 * Y_CUT) << "\n";
+        dN_dphisdy << setprecision(6) << scientific << phi_mid[iphi] << "\t" << sampled_histogram->get(dN_dphisdy_hist, ipart, iphi) / (PHIP_WIDTH * (double)Nevents * 2.0 * Y_CUT) << "\n";
       }
 
 
@@ -968,17 +1116,13 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       dN_twopirdrdy.close();
       dN_dphisdy.close();
     } // ipart
-
-    free_2D(dN_taudtaudy_count, number_of_chosen_particles);
-    free_2D(dN_twopirdrdy_count, number_of_chosen_particles);
-    free_2D(dN_dphisdy_count, number_of_chosen_particles);
   }
 
 
 
 
   //*********************************************************************************************
-  void EmissionFunctionArray::calculate_spectra(std::vector<std::vector<Sampled_Particle>> &particle_event_list_in)
+  void EmissionFunctionArray::calculate_spectra(Compact_Event_List &final_events)
   {
     printf("\n\nRunning particlization with %s\n\n", df_correction.c_str());
 
@@ -1009,31 +1153,23 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
     {
       int chosen_index = chosen_particles_sampling_table[ipart];  // chosen particle's PDG index
 
-      Mass[ipart] = particles[chosen_index].mass;                 // mass of chosen particles
-      Sign[ipart] = particles[chosen_index].sign;                 // quantum statistics sign
-      Degeneracy[ipart] = particles[chosen_index].gspin;          // spin degeneracy factor
-      Baryon[ipart] = particles[chosen_index].baryon;             // baryon number
-      MCID[ipart] = particles[chosen_index].mc_id;                // Monte-Carlo ID
+      Mass[ipart] = particles->mass[chosen_index];                // mass of chosen particles
+      Sign[ipart] = particles->sign[chosen_index];                // quantum statistics sign
+      Degeneracy[ipart] = particles->degeneracy[chosen_index];    // spin degeneracy factor
+      Baryon[ipart] = particles->baryon[chosen_index];            // baryon number
+      MCID[ipart] = particles->mc_id[chosen_index];               // Monte-Carlo ID
 
-      Equilibrium_Density[ipart] = particles[chosen_index].equilibrium_density; // neq
-      Bulk_Density[ipart] = particles[chosen_index].bulk_density;               // dn_bulk (omitted Pi * u.d\sigma)
-      Diffusion_Density[ipart] = particles[chosen_index].diff_density;          // dn_diff (omitted V.d\sigma)
+      Equilibrium_Density[ipart] = particles->equilibrium_density[chosen_index];  // neq
+      Bulk_Density[ipart] = particles->bulk_density[chosen_index];                // dn_bulk (omitted Pi * u.d\sigma)
+      Diffusion_Density[ipart] = particles->diff_density[chosen_index];           // dn_diff (omitted V.d\sigma)
     }
 
 
     // particle info of entire PDG table (remember to skip photons in calculation)
-    double *Mass_PDG = (double*)calloc(Nparticles, sizeof(double));
-    double *Sign_PDG = (double*)calloc(Nparticles, sizeof(double));
-    double *Degeneracy_PDG = (double*)calloc(Nparticles, sizeof(double));
-    double *Baryon_PDG = (double*)calloc(Nparticles, sizeof(double));
-
-    for(int ipart = 0; ipart < Nparticles; ipart++)
-    {
-      Mass_PDG[ipart] = particles[ipart].mass;
-      Sign_PDG[ipart] = particles[ipart].sign;
-      Degeneracy_PDG[ipart] = particles[ipart].gspin;
-      Baryon_PDG[ipart] = particles[ipart].baryon;
-    }
+    double *Mass_PDG = particles->mass.data();
+    double *Sign_PDG = particles->sign.data();
+    double *Degeneracy_PDG = particles->degeneracy.data();
+    double *Baryon_PDG = particles->baryon.data();
 
 
     Gauss_Laguerre * gla = new Gauss_Laguerre;  // load gauss laguerre/legendre roots and weights
@@ -1160,6 +1296,15 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       }
     }
 
+    // spin polarization in the surface sweep of the continuous spectra (df_mode = 1-4)
+    bool fused_polarization = (MODE == 5 && FUSE_POLARIZATION && OPERATION == 1 && DF_MODE >= 1 && DF_MODE <= 4);
+
+    if(fused_polarization)
+    {
+      printf("\nComputing spin polarization with the continuous spectra...\n");
+      start_spin_polzn(wtx, wty, wtn, wxy, wxn, wyn, QGP, CORES);   // one accumulator per core of the spectra kernels
+    }
+
 
     switch(OPERATION)
     {
@@ -1167,6 +1312,20 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
       {
         printf("\nComputing particle spacetime distributions...\n\n");
 
+        if(EMISSION_HISTOGRAMS)
+        {
+          vector<double> pT_nodes(pT_tab_length);
+          vector<double> eta_nodes(eta_tab_length, 0.0);   // 3+1d: etas is binned at the cell
+
+          for(long ipT = 0; ipT < pT_tab_length; ipT++) pT_nodes[ipT] = pT_tab->get(1, ipT + 1);
+          if(DIMENSION == 2)
+          {
+            for(long ieta = 0; ieta < eta_tab_length; ieta++) eta_nodes[ieta] = eta_tab->get(1, ieta + 1);
+          }
+
+          emission_histograms = new Emission_Histograms("tables/emission_histograms.dat", number_of_chosen_particles, CORES, DIMENSION, pT_nodes, eta_nodes);
+        }
+
         switch(DF_MODE)
         {
           case 1:
@@ -1193,12 +1352,25 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
             exit(-1);
           }
         }
+
+        if(emission_histograms != NULL)
+        {
+          emission_histograms->write(MCID);
+
+          delete emission_histograms;
+          emission_histograms = NULL;
+        }
         break;
       }
       case 1:
       {
         printf("\nComputing continuous momentum spectra...\n\n");
 
+        // spacetime moments of the emission function in the same surface sweep (df_mode = 1-4)
+        bool femtoscopy = (FEMTOSCOPY_MOMENTS && DF_MODE >= 1 && DF_MODE <= 4);
+
+        if(femtoscopy) start_femtoscopy_moments(x, y);
+
         switch(DF_MODE)
         {
           case 1:
@@ -1224,21 +1396,43 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
             exit(-1);
           }
         }
-        write_dN_pTdpTdphidy_toFile(MCID);   // write continuous particle momentum spectra to file
+        if(femtoscopy) finish_femtoscopy_moments(MCID);  // HBT radii of the thermal spectra
+
+        if(DO_RESONANCE_DECAYS) do_resonance_decays();   // add the smooth resonance decay feed-down
+
+        reduce_continuous_spectra();                      // vn and the projections of all species in one pass
+
+        if(SPECTRA_OUTPUT_FORMAT == 1)
+        {
+          write_continuous_spectra_store(MCID);            // one binary file (convert_spectra_store_to_text for the text files)
+          break;
+        }
+
+        if(!SPECTRA_HARMONICS)                            // (spectra_harmonics = 1: no phip resolved spectra)
+        {
+          write_dN_pTdpTdphidy_toFile(MCID);   // write continuous particle momentum spectra to file
+          write_dN_dphidy_toFile(MCID);
+        }
         write_continuous_vn_toFile(MCID);
         write_dN_twopipTdpTdy_toFile(MCID);
-        write_dN_dphidy_toFile(MCID);
         write_dN_dy_toFile(MCID);
 
         break;
       }
       case 2:
       {
-        if(OVERSAMPLE)
+        // estimate average particle yield (also stores the sampler's per-cell quantities)
+        double Ntotal = 0.0;
+
+        if(TABULATE_DENSITIES && !FAST && DF_MODE != 5) build_density_table(Mass, Sign, Baryon, T, muB, gla);
+
+        if(OVERSAMPLE || DF_MODE != 5)
         {
-          // estimate average particle yield
-          double Ntotal = calculate_total_yield(Equilibrium_Density, Bulk_Density, Diffusion_Density, T, P, E, tau, ux, uy, un, dat, dax, day, dan, pixx, pixy, pixn, piyy, piyn, bulkPi, muB, nB, Vx, Vy, Vn, df_data, gla);
+          Ntotal = calculate_total_yield(Mass, Sign, Degeneracy, Baryon, Equilibrium_Density, Bulk_Density, Diffusion_Density, T, P, E, tau, ux, uy, un, dat, dax, day, dan, pixx, pixy, pixn, piyy, piyn, bulkPi, muB, nB, Vx, Vy, Vn, df_data, gla);
+        }
 
+        if(OVERSAMPLE)
+        {
           Nevents = (long)min(ceil(MIN_NUM_HADRONS / Ntotal), MAX_NUM_SAMPLES);   // number of events to sample
 
           printf("\nSampling %ld particlization events...\n\n", Nevents);
@@ -1250,30 +1444,104 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
 
 
-        particle_event_list.resize(Nevents);
-
+        // sample the events in batches of at most max_events_in_memory (streaming mode)
+        // each batch is written / passed on before the next one is sampled
+        long events_per_batch = Nevents;
 
-        switch(DF_MODE)
+        if(MAX_EVENTS_IN_MEMORY > 0 && MAX_EVENTS_IN_MEMORY < Nevents)
         {
-          case 1:
-          case 2:
-          case 3:
-          case 4:
+          events_per_batch = MAX_EVENTS_IN_MEMORY;
+          long batches = (Nevents + events_per_batch - 1) / events_per_batch;
+
+          // each batch re-sweeps the freezeout surface, so the per-cell setup of the sampler
+          // (df coefficients, Milne basis, pimunu boost) is repeated for every batch
+          printf("Streaming %ld events in batches of %ld events (%ld sweeps of the freezeout surface)\n", Nevents, events_per_batch, batches);
+
+          if(!TEST_SAMPLER && !particle_event_callback)
           {
-            sample_dN_pTdpTdphidy(Mass, Sign, Degeneracy, Baryon, MCID, Equilibrium_Density, Bulk_Density, Diffusion_Density, T, P, E, tau, x, y, eta, ux, uy, un, dat, dax, day, dan, pixx, pixy, pixn, piyy, piyn, bulkPi, muB, nB, Vx, Vy, Vn, df_data, gla, legendre);
-            break;
+            printf("Warning: no particle event callback is set, so the streamed events are only written to file (final_particles_ stays empty)\n");
           }
-          case 5:
+        }
+
+        set_sampler_seed();
+
+        if(TABULATE_MOMENTUM && DF_MODE != 5) build_momentum_table(Mass, Sign, T);
+
+        if(!TEST_SAMPLER && DECAY_SAMPLED_HADRONS && hadron_decayer == NULL)
+        {
+          hadron_decayer = new Hadron_Decayer(particles, chosen_particles_sampling_table, number_of_chosen_particles, chosen_mass, chosen_mcid, chosen_charge, sampler_seed_value);
+
+          printf("Decaying sampled hadrons: %d unstable species, %d stable decay products added to the chosen particles (%d closed decay channels)\n", hadron_decayer->unstable_species, hadron_decayer->added_species, hadron_decayer->closed_channels);
+        }
+
+        if(!TEST_SAMPLER && PARTICLE_LIST_FORMAT == 1)
+        {
+          particle_store = new Particle_Store_Writer("results/particle_list.bin", PARTICLE_STORE_PRECISION);
+        }
+        if(!TEST_SAMPLER && EVENT_OBSERVABLES)
+        {
+          event_observables = new Event_Observables("results/event_observables.dat", chosen_mcid.size(), chosen_mcid.data(), chosen_charge.data());   // chosen tables include the decay products
+        }
+
+        for(event_offset = 0; event_offset < Nevents; event_offset += events_per_batch)
+        {
+          Nevents_batch = min(events_per_batch, Nevents - event_offset);
+
+          particle_event_list.clear();
+          particle_event_list.resize(Nevents_batch);
+
+          if(event_observables != NULL) event_observables->start_batch(Nevents_batch);
+
+          switch(DF_MODE)
           {
-            sample_dN_pTdpTdphidy_famod(Mass, Sign, Degeneracy, Baryon, MCID, T, P, E, tau, x, y, eta, ux, uy, un, dat, dax, day, dan, pixx, pixy, pixn, piyy, piyn, bulkPi, muB, nB, Vx, Vy, Vn, Nparticles, Mass_PDG, Sign_PDG, Degeneracy_PDG, Baryon_PDG);
+            case 1:
+            case 2:
+            case 3:
+            case 4:
+            {
+              sample_dN_pTdpTdphidy(Mass, Sign, Degeneracy, Baryon, MCID, Equilibrium_Density, Bulk_Density, Diffusion_Density, T, P, E, tau, x, y, eta, ux, uy, un, dat, dax, day, dan, pixx, pixy, pixn, piyy, piyn, bulkPi, muB, nB, Vx, Vy, Vn, df_data, gla, legendre);
+              break;
+            }
+            case 5:
+            {
+              sample_dN_pTdpTdphidy_famod(Mass, Sign, Degeneracy, Baryon, MCID, T, P, E, tau, x, y, eta, ux, uy, un, dat, dax, day, dan, pixx, pixy, pixn, piyy, piyn, bulkPi, muB, nB, Vx, Vy, Vn, Nparticles, Mass_PDG, Sign_PDG, Degeneracy_PDG, Baryon_PDG);
 
-            break;
+              break;
+            }
+            default:
+            {
+              printf("calculate_spectra error: need to set df_mode = (1, 2, 3, 4, 5)\n");
+              exit(-1);
+            }
           }
-          default:
+
+          if(hadron_decayer != NULL)
           {
-            printf("calculate_spectra error: need to set df_mode = (1, 2, 3, 4, 5)\n");
-            exit(-1);
+            decay_sampled_hadrons();                        // replace unstable hadrons by their stable decay products
+          }
+          if(event_observables != NULL)
+          {
+            event_observables->write_batch(event_offset);   // append the observables of this batch
+          }
+          if(!TEST_SAMPLER && EVENT_OBSERVABLES != 2)
+          {
+            flush_particle_events(final_events);            // write / store the events of this batch
           }
+        } // event batches
+
+        if(particle_store != NULL)
+        {
+          delete particle_store;                          // writes the event index and closes the file
+          particle_store = NULL;
+        }
+        if(binary_OSC_file != NULL)
+        {
+          close_particle_list_binary_OSC();
+        }
+        if(event_observables != NULL)
+        {
+          delete event_observables;
+          event_observables = NULL;
         }
 
         if(TEST_SAMPLER)
@@ -1285,12 +1553,6 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
           write_sampled_vn_to_file_test(MCID);
           write_sampled_dN_dX_to_file_test(MCID);
         }
-        else
-        {
-          write_particle_list_OSC();                      // write OSCAR particle list to file (if not using JETSCAPE)
-        }
-
-        particle_event_list_in = particle_event_list;     // store particlization events
 
         break;
       }
@@ -1304,8 +1566,15 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
 
     if(MODE == 5)
     {
-      printf("\nComputing spin polarization...\n");
-      calculate_spin_polzn(Mass, Sign, Degeneracy, tau, eta, ux, uy, un, dat, dax, day, dan, wtx, wty, wtn, wxy, wxn, wyn, QGP);
+      if(fused_polarization)
+      {
+        finish_spin_polzn();
+      }
+      else
+      {
+        printf("\nComputing spin polarization...\n");
+        calculate_spin_polzn(Mass, Sign, tau, eta, ux, uy, un, dat, dax, day, dan, wtx, wty, wtn, wxy, wxn, wyn, QGP);
+      }
       write_polzn_vector_toFile();
     }
 
@@ -1322,10 +1591,6 @@ EmissionFunctionArray::EmissionFunctionArray(ParameterReader* paraRdr_in, Table*
     free(Bulk_Density);
     free(Diffusion_Density);
 
-    free(Mass_PDG);
-    free(Sign_PDG);
-    free(Degeneracy_PDG);
-    free(Baryon_PDG);
 
     free(tau);
     free(x);
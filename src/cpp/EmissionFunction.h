@@ -10,6 +10,15 @@
 #include "DeltafData.h"
 #include "SampledParticle.h"
 #include "LocalRestFrame.h"
+#include "MomentumTable.h"
+#include "ThermalDensityTable.h"
+#include "ParticleStore.h"
+#include "SpectraStore.h"
+#include "SampledHistogram.h"
+#include "EventObservables.h"
+#include "DecayResponse.h"
+#include "HadronDecays.h"
+#include "EmissionHistogram.h"
 
 using namespace std;
 
@@ -21,7 +30,67 @@ double compute_detA(Shear_Stress pimunu, double betapi, double bulk_mod);
 
 bool is_linear_pion0_density_negative(double T, double neq_pion0, double J20_pion0, double bulkPi, double F, double betabulk);
 
-bool does_feqmod_breakdown(double mass_pion0, double T, double F, double bulkPi, double betabulk, double detA, double detA_min, double z, Gauss_Laguerre * laguerre, int df_mode, int fast, double Tavg, double F_avg, double betabulk_avg);
+bool does_feqmod_breakdown(double mass_pion0, double T, double F, double bulkPi, double betabulk, double detA, double detA_min, double z, Gauss_Laguerre * laguerre, int df_mode, int fast, double Tavg, double F_avg, double betabulk_avg, Thermal_Density_Table * density_table = NULL);
+
+
+// smooth resonance decays (ResonanceDecays.cpp)
+typedef struct
+{
+  double constant;        // large MT tail of a (phip, y) column of the parent spectrum: log(dN/dYMTdMTdPhi) = constant + slope * MT
+  double slope;
+  int points;             // linear interpolation in MT up to the last positive point of the column (tail beyond)
+} MT_fit_parameters;
+
+typedef struct
+{
+  int daughter;           // chosen index of the daughter
+  int bodies;             // 2 or 3-body decay
+  double multiplicity;    // number of daughters in the channel
+  double branch_ratio;
+  double mass_parent;     // masses of the decay kinematics (2-body masses adjusted if below threshold)
+  double mass;            // daughter
+  double mass_2;          // other decay products
+  double mass_3;
+  double Q;               // 3-body phase space normalization
+} Decay_Group;
+
+// observables derived from the continuous spectra of one species (reduce_continuous_spectra)
+typedef struct
+{
+  std::vector<double> dN_2pipTdpTdy;      // [ipT + pT_tab_length * iy]
+  std::vector<double> dN_dphidy;          // [iphip + phi_tab_length * iy] (empty if spectra_harmonics = 1)
+  std::vector<double> dN_dy;              // [iy]
+  std::vector<double> vn;                 // {v1, ..., v7} [k - 1 + K_MAX * (ipT + pT_tab_length * iy)]
+} Continuous_Observables;
+
+
+// streaming spin polarization reduction (Polarization.cpp)
+typedef struct
+{
+  double T;                                             // temperature of the thermal distribution
+  double *wtx, *wty, *wtn, *wxy, *wxn, *wyn;            // thermal vorticity of the freezeout cells
+  std::vector<double> cosphi, sinphi, pT, y;            // momentum grid
+  std::vector<double> eta, eta_weight;                  // eta points x delta_eta weights (2+1d)
+  long threads;                                         // number of accumulators
+  std::vector<double> S_all;                            // per-thread accumulators of (St, Sx, Sy, Sn, Snorm) [icomp + 5 * (iS3D + momentum points * n)]
+} Spin_Polzn_Sweep;
+
+
+// spacetime moments of the emission function accumulated in the continuous spectra sweep (Femtoscopy.cpp)
+// the coordinates of each momentum point are taken in its longitudinally comoving frame, rotated to (out, side, long)
+enum
+{
+  femto_t, femto_out, femto_side, femto_long,           // first moments
+  femto_tt, femto_oo, femto_ss, femto_ll,               // second moments
+  femto_to, femto_ts, femto_tl, femto_os, femto_ol, femto_sl,
+  femto_moments
+};
+
+typedef struct
+{
+  double *x, *y;                                        // transverse position of the freezeout cells
+  std::vector<double> moments_all;                      // per-core Cooper-Frye weighted sums [imoment + femto_moments * (iS3D + momentum points * n)]
+} Femtoscopy_Sweep;
 
 
 class EmissionFunctionArray
@@ -33,6 +102,10 @@ private:
 
   int OPERATION; // calculate smooth spectra or sample distributions
   int MODE; //vh or vah , ...
+  int FUSE_POLARIZATION; // compute the spin polarization (mode = 5) in the surface sweep of the continuous spectra
+  int FEMTOSCOPY_MOMENTS; // accumulate the spacetime moments of the emission function in the surface sweep of the continuous spectra
+  int SPECTRA_HARMONICS;  // accumulate the phip Fourier harmonics of the continuous spectra instead of dN_pTdpTdphidy
+  int SPECTRA_OUTPUT_FORMAT; // continuous spectra output (0 = text files per species, 1 = one binary file)
 
   int DF_MODE;  // delta-f type
   string df_correction;
@@ -52,18 +125,65 @@ private:
 
   double MASS_PION0;
 
-  int LIGHTEST_PARTICLE; //mcid of lightest resonance to calculate in decay feed-down
-  int DO_RESONANCE_DECAYS; // smooth resonance decays option
+  int LIGHTEST_PARTICLE; //mcid of lightest particle fed by the resonance decays
+  int DO_RESONANCE_DECAYS; // smooth resonance decay feed-down of the continuous spectra (1 = direct, 2 = cached response matrices)
+  double DECAY_RESPONSE_TAIL_T; // inverse slope (GeV) of the parent MT tail beyond the pT grid (do_resonance_decays = 2)
 
   int OVERSAMPLE; // whether or not to iteratively oversample surface
+  long MAX_EVENTS_IN_MEMORY;  // max number of sampled events held in memory before flushing (0 = all events)
+  double SPECIES_WEIGHT_CACHE;  // max memory (MB) for the species weights stored by the yield pass (0 = recompute while sampling)
   int FAST;                 // switch to compute mean hadron number quickly using an averaged (T,muB)
   double MIN_NUM_HADRONS; //min number of particles summed over all samples
   double MAX_NUM_SAMPLES; // max number of events sampled
   long int SAMPLER_SEED; //the seed for the particle sampler. If chosen < 0, seed set with clocktime
 
+  int TABULATE_MOMENTUM;        // switch to sample LRF momentum from tabulated inverse cdfs (no rejection)
+  int MOMENTUM_TABLE_T_BINS;    // number of temperature nodes in the momentum tables
+  int MOMENTUM_TABLE_POINTS;    // number of quantile nodes per (species, temperature)
+  int CACHE_MOMENTUM_TABLE;     // switch to read / write the momentum tables from / to disk
+
+  int TABULATE_DENSITIES;           // switch to interpolate the thermal densities of the sampler from tables (fast = 0)
+  int DENSITY_TABLE_T_BINS;         // number of temperature nodes in the density tables
+  int DENSITY_TABLE_ALPHAB_BINS;    // number of alphaB nodes in the density tables (if include_baryon = 1)
+
   int TEST_SAMPLER;
 
+  int PARTICLE_LIST_FORMAT;       // sampled particle list output: 0 = OSCAR text files, 1 = binary particle store, 2 = SMASH binary OSCAR
+  int PARTICLE_STORE_PRECISION;   // bytes per x^mu / p^mu value in the binary store (4 or 8)
+  int EVENT_OBSERVABLES;          // event-by-event observables: 0 = off, 1 = with particle list, 2 = without particle list
+  int DECAY_SAMPLED_HADRONS;      // switch to decay the unstable sampled hadrons before the particle lists are written
+
   long Nevents = 1;                  // default number of sampled events
+  long Nevents_batch = 1;            // number of events sampled in the current batch (streaming mode)
+  long event_offset = 0;             // event index of the first event in the current batch
+
+  default_random_engine generator_poisson;    // sampler random number engines (seeded once for all batches)
+  default_random_engine generator_type;
+  default_random_engine generator_momentum;
+  default_random_engine generator_rapidity;
+
+  unsigned sampler_seed_value = 0;            // seed of the sampler's random number engines (set_sampler_seed)
+
+  Momentum_Table * momentum_table = NULL;     // tabulated LRF momentum distributions (tabulate_momentum = 1)
+  Thermal_Density_Table * density_table = NULL;   // tabulated thermal densities (tabulate_densities = 1)
+
+  Particle_Event_Callback particle_event_callback;  // receives completed events (optional)
+
+  Hadron_Decayer * hadron_decayer = NULL;     // Monte Carlo decays of the sampled hadrons (decay_sampled_hadrons = 1)
+
+  // sampler quantities of each freezeout cell stored by the yield pass (calculate_total_yield)
+  bool sampler_cells_cached = false;
+  bool sampler_species_cached = false;            // cell_dn_list is filled (if it fits in species_weight_cache MB)
+  std::vector<double> cell_dn_tot;                // mean number of hadrons emitted from the max volume 2.y_max.ds_max (0 = skip cell)
+  std::vector<double> cell_ds_max;                // magnitude of dsigma (max volume)
+  std::vector<char> cell_feqmod_breaks_down;
+  std::vector<double> cell_dn_list;               // species weights dn_list[ipart + npart * icell]
+
+  Particle_Store_Writer * particle_store = NULL;    // binary particle list (particle_list_format = 1)
+  FILE * binary_OSC_file = NULL;                    // SMASH binary OSCAR particle list (particle_list_format = 2)
+  std::string binary_OSC_tmp_file;                  // temporary file renamed to results/particles_binary.bin at the end of the run
+  bool binary_OSC_written = false;                  // every fwrite to binary_OSC_file succeeded
+  Event_Observables * event_observables = NULL;     // event-by-event observables (event_observables = 1, 2)
 
   // for binning sampled particles (for sampler tests)
   double PT_MIN;
@@ -92,39 +212,58 @@ private:
   int R_BINS;
   double R_WIDTH;
 
-  // for sampler test (2+1d)
-  double **dN_dy_count;          // event-averaged momentum distributions
-  double **dN_2pipTdpTdy_count;
-  double **dN_dphipdy_count;
-
-  double ***vn_real_count;      // event-averaged Vn's
-  double ***vn_imag_count;
-  const int K_MAX = 7;          // {v1, ..., v7}
-  double **pT_count;            // count in each pT bin
+  int EMISSION_HISTOGRAMS;                        // switch to fill the emission histograms of tables/emission_histograms.dat (operation = 0)
+  Emission_Histograms * emission_histograms = NULL;
 
-  double **dN_deta_count;       // event-averaged spacetime distribution
-  double **dN_taudtaudy_count;
-  double **dN_twopirdrdy_count;
-  double **dN_dphisdy_count;
+  // for sampler test (2+1d)
+  Sampled_Histogram * sampled_histogram = NULL;   // event-averaged distributions of all sampled observables
+  const int K_MAX = 7;                            // {v1, ..., v7}
+
+  // sampled_histogram observables (added in this order by define_sampled_histograms)
+  enum
+  {
+    dN_dy_hist,                   // momentum distributions
+    dN_2pipTdpTdy_hist,
+    dN_dphipdy_hist,
+    vn_hist,                      // components: pT count, (cos, sin)(k.phip) for k = 1, ..., K_MAX
+    dN_deta_hist,                 // spacetime distributions
+    dN_taudtaudy_hist,
+    dN_twopirdrdy_hist,
+    dN_dphisdy_hist
+  };
 
 
   Table *pT_tab, *phi_tab, *y_tab, *eta_tab;
   long pT_tab_length, phi_tab_length, y_tab_length, eta_tab_length;
   long FO_length;
   double *dN_pTdpTdphidy; //to hold smooth CF 3D spectra of all species
+  std::vector<Continuous_Observables> continuous_observables;   // derived observables of all chosen species
+  double *dN_harmonics = NULL; // phip Fourier harmonics (1, cos, sin)(k.phip) of the spectra (spectra_harmonics = 1) [ih + (2.K_MAX + 1) * (iy + y_tab_length * (ipT + pT_tab_length * ipart))]
   double *logdN_PTdPTdPhidY; // hold log of smooth CF 3D spectra of parent (set in res decay for linear interpolation)
 
+  std::vector<double> pT_values, phip_values, y_values;   // momentum grid of the continuous spectra (set_momentum_grid)
+  std::vector<double> pT_weights, phip_weights;           // quadrature weights of the momentum grid
+  std::vector<double> MT_parent;                          // MT grid of the current parent
+  std::vector<MT_fit_parameters> MT_fit_parent;           // large MT tail of each (phip, y) column of logdN_PTdPTdPhidY
+  double parent_mass;
+  Decay_Response * decay_response = NULL;                 // precomputed feed-down (do_resonance_decays = 2)
+
   double *St, *Sx, *Sy, *Sn; //to hold the polarization vector of all species
   double *Snorm; //the normalization of the polarization vector of all species
+  Spin_Polzn_Sweep * polzn_sweep = NULL;    // accumulators of the polarization sweep in progress
+  Femtoscopy_Sweep * femto_sweep = NULL;    // accumulators of the emission function moments in progress
 
   std::vector<Sampled_Particle> particle_list;                        // to hold sampled particle list (inactive)
-  std::vector< std::vector<Sampled_Particle> > particle_event_list;   // holds sampled particle list of all events
+  std::vector< std::vector<Compact_Particle> > particle_event_list;   // holds sampled particle list of all events (current batch)
 
   int *chosen_particles_01_table;       // has length Nparticle, 0 means miss, 1 means include
   int *chosen_particles_sampling_table; // store particle index; the sampling process follows the order specified by this table
+  std::vector<double> chosen_mass;      // mass and mcid of chosen particles (to expand compact sampled particles)
+  std::vector<int> chosen_mcid;
+  std::vector<int> chosen_charge;       // (tables extended by the stable decay products if decay_sampled_hadrons = 1)
   int Nparticles;
   int number_of_chosen_particles;
-  particle_info* particles;       // contains all the particle info from pdg.dat
+  Particle_Table* particles;      // contains all the particle info from pdg.dat
   FO_surf* surf_ptr;
   Deltaf_Data * df_data;
   bool particles_are_the_same(int, int);
@@ -132,12 +271,15 @@ private:
 public:
 
   // constructor
-  EmissionFunctionArray(ParameterReader* paraRdr_in, Table* chosen_particle, Table* pT_tab_in, Table* phi_tab_in, Table* y_tab_in, Table* eta_tab_in, particle_info* particles_in, int Nparticles, FO_surf* FOsurf_ptr_in, long FO_length_in, Deltaf_Data * df_data_in);
+  EmissionFunctionArray(ParameterReader* paraRdr_in, Table* chosen_particle, Table* pT_tab_in, Table* phi_tab_in, Table* y_tab_in, Table* eta_tab_in, Particle_Table* particles_in, FO_surf* FOsurf_ptr_in, long FO_length_in, Deltaf_Data * df_data_in);
 
   ~EmissionFunctionArray();
 
+  // hand each sampled event to the callback as soon as it is complete
+  void set_particle_event_callback(Particle_Event_Callback callback);
+
   // main function
-  void calculate_spectra(std::vector<std::vector<Sampled_Particle>> &particle_event_list_in);
+  void calculate_spectra(Compact_Event_List &final_events);
 
 
   // continuous spectra routines:
@@ -149,6 +291,13 @@ public:
   // continuous spectra with feqmod
   void calculate_dN_pTdpTdphidy_feqmod(double *Mass, double *Sign, double *Degeneracy, double *Baryon, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *eta_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gauss_Laguerre * laguerre, Deltaf_Data * df_data);
 
+  // phip Fourier harmonics of the continuous spectra (spectra_harmonics = 1)
+  void set_phip_harmonic_weights(std::vector<double> & phip_harmonics);   // phip_weight * (1, cos, sin)(k.phip) [ih + (2.K_MAX + 1) * iphip]
+  void reduce_spectra_harmonics(const double * harmonics_all);            // sum the per-core harmonics into dN_harmonics
+
+  void set_momentum_grid();           // cache the pT, phip and y tables of the continuous spectra
+  void reduce_continuous_spectra();   // all derived observables in one pass over dN_pTdpTdphidy (or dN_harmonics)
+
   void calculate_dN_pTdpTdphidy_famod(double *Mass, double *Sign, double *Degeneracy, double *Baryon, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *eta_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, int Nparticles, double *Mass_PDG, double *Sign_PDG, double *Degeneracy_PDG, double *Baryon_PDG);
 
 
@@ -164,12 +313,39 @@ public:
 
   //:::::::::::::::::::::::::::::::::::::::::::::::::
 
+  // smooth resonance decay feed-down (post-processing of dN_pTdpTdphidy, heaviest to lightest parent)
+  void do_resonance_decays();
+  void setup_resonance_decays(std::vector<int> & chosen_index, std::vector<int> & parents);
+  std::vector<Decay_Group> resonance_decay_groups(int parent_chosen_index, const std::vector<int> & chosen_index, long & decay_channels, long & skipped_channels);
+  void set_parent_MT_grid(double mass_parent);
+  void set_parent_log_spectrum(int parent_chosen_index, double mass_parent);
+  double log_dN_column(long icolumn, double MT, int iMTR);
+  bool decay_y_bracket(double Y, int & iYL, int & iYR, double & wYL, double & wYR);
+  void decay_phip_bracket(double Phip, int & iPhipL, int & iPhipR, double & wPhipL, double & wPhipR);
+  double dN_dYMTdMTdPhi_parent(double MT, double Phip1, double Phip2, double Y);
+  void add_parent_response(Decay_Response_Row * row, double MT, double Phip1, double Phip2, double Y, double weight);
+  double two_body_integral(double mass_parent, double mass, double Estar, double pstar, double pT, double phip, double y, double weight = 1.0, Decay_Response_Row * row = NULL);
+  double decay_feed_down(const Decay_Group & group, double pT, double phip, double y, Decay_Response_Row * row = NULL);
+  uint64_t decay_response_key();
+  void build_decay_response(const std::vector<int> & chosen_index, const std::vector<int> & parents, long & decay_channels, long & skipped_channels);
+
 
   // sampling spectra routines:
   //:::::::::::::::::::::::::::::::::::::::::::::::::
 
+  void set_sampler_seed();
+  void build_momentum_table(double *Mass, double *Sign, double *T_fo);
+  void build_density_table(double *Mass, double *Sign, double *Baryon, double *T_fo, double *muB_fo, Gauss_Laguerre * laguerre);
+
+  // replace the unstable hadrons of the current batch by their stable decay products
+  void decay_sampled_hadrons();
+
+  // pass the events of the current batch to the writer and callback / final_events
+  void flush_particle_events(Compact_Event_List &final_events);
+
   // calculate average total particle yield from freezeout surface to determine number of events to sample
-  double calculate_total_yield(double * Equilibrium_Density, double * Bulk_Density, double * Diffusion_Density, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB, double *nB, double *Vx_fo, double *Vy_fo, double *Vn_fo, Deltaf_Data * df_data, Gauss_Laguerre * laguerre);
+  double max_particle_numbers(double * dn_list, double *Mass, double *Sign, double *Degeneracy, double *Baryon, double *Equilibrium_Density, double *Bulk_Density, double T, double alphaB, double bulkPi, deltaf_coefficients df, bool feqmod_breaks_down, Gauss_Laguerre * laguerre);
+  double calculate_total_yield(double *Mass, double *Sign, double *Degeneracy, double *Baryon, double * Equilibrium_Density, double * Bulk_Density, double * Diffusion_Density, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB, double *nB, double *Vx_fo, double *Vy_fo, double *Vn_fo, Deltaf_Data * df_data, Gauss_Laguerre * laguerre);
 
   // sample particles with feq + df14, feq + dfCE, PTM feqmod or PTB feqmod
   void sample_dN_pTdpTdphidy(double *Mass, double *Sign, double *Degeneracy, double *Baryon, int *MCID, double *Equilibrium_Density, double *Bulk_Density, double *Diffusion_Density, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *x_fo, double *y_fo, double *eta_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Deltaf_Data *df_data, Gauss_Laguerre * laguerre, Gauss_Legendre * legendre);
@@ -180,6 +356,7 @@ public:
 
 
   // add counts for sampled distributions
+  void define_sampled_histograms();
   void sample_dN_dy(int chosen_index, double y);
   void sample_dN_deta(int chosen_index, double eta);
   void sample_dN_dphipdy(int chosen_index, double px, double py);
@@ -191,24 +368,39 @@ public:
   //:::::::::::::::::::::::::::::::::::::::::::::::::
 
   // spin polarization:
-  void calculate_spin_polzn(double *Mass, double *Sign, double *Degeneracy,
+  void calculate_spin_polzn(double *Mass, double *Sign,
   double *tau_fo, double *eta_fo, double *ux_fo, double *uy_fo, double *un_fo,
   double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo,
   double *wtx_fo, double *wty_fo, double *wtn_fo, double *wxy_fo, double *wxn_fo, double *wyn_fo, Plasma * QGP);
 
+  // streaming polarization sweep (standalone or called from the spectra kernels' cell loops)
+  void start_spin_polzn(double *wtx_fo, double *wty_fo, double *wtn_fo, double *wxy_fo, double *wxn_fo, double *wyn_fo, Plasma * QGP, long threads);
+  void add_spin_polzn_cell(long n, long icell, double *Mass, double *Sign, double *tau_fo, double *eta_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo);
+  void finish_spin_polzn();
+
+  // femtoscopy: spacetime moments of the emission function (called from the spectra kernels' cell loops)
+  void start_femtoscopy_moments(double *x_fo, double *y_fo);
+  // eta_moments = eta integrals of weight * (t, z, t^2, z^2, t.z) of the momentum point
+  void add_femtoscopy_moments(long n, long iS3D, double factor, double weight, double x_out, double x_side, const double * eta_moments);
+  void finish_femtoscopy_moments(int *MCID);   // reduce the moments and write the HBT radii
+
 
   // write to file functions:
   //:::::::::::::::::::::::::::::::::::::::::::::::::
 
   void write_dN_pTdpTdphidy_toFile(int *MCID); // write invariant 3D spectra to file
-  void write_dN_dphidy_toFile(int *MCID);
+  void write_dN_dphidy_toFile(int *MCID);      // write the continuous_observables (after reduce_continuous_spectra)
   void write_dN_twopipTdpTdy_toFile(int *MCID);
   void write_dN_dy_toFile(int *MCID);
   void write_continuous_vn_toFile(int *MCID);
+  void write_continuous_spectra_store(int *MCID);   // all continuous spectra in results/continuous/spectra.bin
+  void write_dN_dX_toFile(int *MCID, const double * dN_dX_all);   // reduce and write the per-core (tau,r,phi) histograms
   void write_polzn_vector_toFile(); //write components of spin polarization vector to file
 
-  void write_particle_list_toFile();              // write sampled particle list
-  void write_particle_list_OSC();                 // write sampled particle list in OSCAR format for UrQMD/SMASH
+  void write_particle_list_toFile();              // write sampled particle list (current batch of events)
+  void write_particle_list_OSC();                 // write sampled particle list in OSCAR format for UrQMD/SMASH (current batch of events)
+  void write_particle_list_binary_OSC();          // append current batch of events to SMASH binary OSCAR2013 file
+  void close_particle_list_binary_OSC();          // install the SMASH binary OSCAR file (checked close + rename)
 
   // for sampler test
   void write_sampled_dN_dy_to_file_test(int * MCID);
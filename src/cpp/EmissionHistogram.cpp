@@ -0,0 +1,419 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#include "EmissionHistogram.h"
+
+using namespace std;
+
+
+static const char * variable_names[] = {"tau", "r", "phis", "etas", "pT"};
+static const int variables = 5;
+
+
+Emission_Axis::Emission_Axis(int variable_in, const vector<double> & edges_in, bool uniform_in)
+{
+  variable = variable_in;
+  edges = edges_in;
+  uniform = uniform_in;
+
+  min = edges[0];
+  width = (edges.back() - edges[0]) / (double)bins();
+}
+
+
+int Emission_Axis::bins() const
+{
+  return edges.size() - 1;
+}
+
+
+int Emission_Axis::bin(double x) const
+{
+  if(!(x >= edges[0]) || x >= edges.back()) return -1;
+
+  if(uniform)
+  {
+    int ibin = (int)((x - min) / width);
+    return (ibin < bins()) ? ibin : bins() - 1;
+  }
+
+  return (upper_bound(edges.begin(), edges.end(), x) - edges.begin()) - 1;
+}
+
+
+static Emission_Axis read_emission_axis(string token, string name)
+{
+  // variable:bins:min:max (uniform) or variable=edge_0,edge_1,...,edge_bins (custom)
+  size_t split = token.find_first_of(":=");
+
+  if(split == string::npos)
+  {
+    printf("Emission_Histograms error: axis %s of histogram %s is not variable:bins:min:max or variable=edges\n", token.c_str(), name.c_str());
+    exit(-1);
+  }
+
+  string variable_name = token.substr(0, split);
+  int variable = -1;
+
+  for(int i = 0; i < variables; i++)
+  {
+    if(variable_name == variable_names[i]) variable = i;
+  }
+
+  if(variable < 0)
+  {
+    printf("Emission_Histograms error: unknown variable %s in histogram %s (tau, r, phis, etas, pT)\n", variable_name.c_str(), name.c_str());
+    exit(-1);
+  }
+
+  string values = token.substr(split + 1);
+  replace(values.begin(), values.end(), ':', ' ');
+  replace(values.begin(), values.end(), ',', ' ');
+
+  istringstream value_stream(values);
+  vector<double> numbers;
+  double number;
+
+  while(value_stream >> number) numbers.push_back(number);
+
+  if(!value_stream.eof())
+  {
+    printf("Emission_Histograms error: could not read the bins of %s in histogram %s\n", token.c_str(), name.c_str());
+    exit(-1);
+  }
+
+  vector<double> edges;
+  bool uniform = (token[split] == ':');
+
+  if(uniform)
+  {
+    if(numbers.size() != 3 || numbers[0] < 1.0 || numbers[2] <= numbers[1])
+    {
+      printf("Emission_Histograms error: need %s:bins:min:max with bins >= 1 and max > min in histogram %s\n", variable_name.c_str(), name.c_str());
+      exit(-1);
+    }
+
+    int bins = (int)numbers[0];
+    double width = (numbers[2] - numbers[1]) / (double)bins;
+
+    for(int ibin = 0; ibin <= bins; ibin++) edges.push_back(numbers[1]  +  width * (double)ibin);
+  }
+  else
+  {
+    edges = numbers;
+
+    bool increasing = (edges.size() >= 2);
+
+    for(int i = 1; i < (int)edges.size(); i++)
+    {
+      if(edges[i] <= edges[i - 1]) increasing = false;
+    }
+
+    if(!increasing)
+    {
+      printf("Emission_Histograms error: the bin edges of %s in histogram %s must be at least 2 increasing values\n", variable_name.c_str(), name.c_str());
+      exit(-1);
+    }
+  }
+
+  return Emission_Axis(variable, edges, uniform);
+}
+
+
+Emission_Histograms::Emission_Histograms(string filename, int npart_in, int cores_in, int dimension_in, const vector<double> & pT_nodes_in, const vector<double> & eta_nodes_in)
+{
+  npart = npart_in;
+  cores = (cores_in < 1) ? 1 : cores_in;
+  dimension = dimension_in;
+  pT_nodes = pT_nodes_in;
+  eta_nodes = eta_nodes_in;
+
+  ifstream histogram_file(filename.c_str());
+
+  if(!histogram_file.is_open())
+  {
+    printf("Emission_Histograms error: could not open %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  string line;
+
+  while(getline(histogram_file, line))
+  {
+    istringstream line_stream(line);
+    string name;
+    string storage;
+
+    if(!(line_stream >> name) || name[0] == '#') continue;     // skip blank and comment lines
+
+    if(!(line_stream >> storage) || (storage != "dense" && storage != "sparse"))
+    {
+      printf("Emission_Histograms error: histogram %s needs a storage type (dense or sparse)\n", name.c_str());
+      exit(-1);
+    }
+
+    Emission_Histogram histogram;
+    histogram.name = name;
+    histogram.sparse = (storage == "sparse");
+    histogram.pT_axis = -1;
+    histogram.eta_axis = -1;
+
+    bool used[variables] = {false, false, false, false, false};
+    string token;
+
+    while(line_stream >> token)
+    {
+      if(token[0] == '#') break;
+
+      Emission_Axis axis = read_emission_axis(token, name);
+
+      if(used[axis.variable])
+      {
+        printf("Emission_Histograms error: variable %s appears twice in histogram %s\n", variable_names[axis.variable], name.c_str());
+        exit(-1);
+      }
+      used[axis.variable] = true;
+
+      if(axis.variable == pT_variable) histogram.pT_axis = histogram.axes.size();
+      if(axis.variable == etas_variable && dimension == 2) histogram.eta_axis = histogram.axes.size();
+
+      histogram.axes.push_back(axis);
+    }
+
+    if(histogram.axes.empty())
+    {
+      printf("Emission_Histograms error: histogram %s has no axes\n", name.c_str());
+      exit(-1);
+    }
+
+    // row-major flat bin index (last axis fastest)
+    int naxes = histogram.axes.size();
+    histogram.stride.resize(naxes);
+    histogram.bins = 1;
+
+    for(int i = naxes - 1; i >= 0; i--)
+    {
+      histogram.stride[i] = histogram.bins;
+      histogram.bins *= histogram.axes[i].bins();
+    }
+
+    if(histogram.sparse) histogram.sparse_bins.resize(cores);
+    else histogram.dense_bins.assign(histogram.bins * npart * cores, 0.0);
+
+    histograms.push_back(histogram);
+  }
+
+  histogram_file.close();
+
+  cell_offset.assign(histograms.size() * cores, -1);
+  cell_etas.assign(cores, 0.0);
+
+  printf("Filling %d emission histograms from %s\n", size(), filename.c_str());
+}
+
+
+int Emission_Histograms::size() const
+{
+  return histograms.size();
+}
+
+
+bool Emission_Histograms::uses_nodes() const
+{
+  for(int ihist = 0; ihist < size(); ihist++)
+  {
+    if(histograms[ihist].pT_axis >= 0 || histograms[ihist].eta_axis >= 0) return true;
+  }
+
+  return false;
+}
+
+
+bool Emission_Histograms::set_cell(int n, double tau, double r, double phis, double etas)
+{
+  double cell_values[variables] = {tau, r, phis, etas, 0.0};
+  bool inside = false;
+
+  cell_etas[n] = etas;
+
+  for(int ihist = 0; ihist < size(); ihist++)
+  {
+    const Emission_Histogram & histogram = histograms[ihist];
+    long offset = 0;
+
+    for(int i = 0; i < (int)histogram.axes.size(); i++)
+    {
+      if(i == histogram.pT_axis || i == histogram.eta_axis) continue;
+
+      int ibin = histogram.axes[i].bin(cell_values[histogram.axes[i].variable]);
+
+      if(ibin < 0)
+      {
+        offset = -1;
+        break;
+      }
+
+      offset += histogram.stride[i] * ibin;
+    }
+
+    cell_offset[ihist  +  size() * n] = offset;
+
+    if(offset >= 0) inside = true;
+  }
+
+  return inside;
+}
+
+
+void Emission_Histograms::add(Emission_Histogram & histogram, int n, long ipart, long ibin, double weight)
+{
+  if(histogram.sparse)
+  {
+    histogram.sparse_bins[n][ibin  +  histogram.bins * ipart] += weight;
+  }
+  else
+  {
+    histogram.dense_bins[ibin  +  histogram.bins * (ipart  +  npart * n)] += weight;
+  }
+}
+
+
+void Emission_Histograms::fill_cell(int n, long ipart, double dN_dy_cell, const double * node_weights)
+{
+  const int pT_points = pT_nodes.size();
+  const int eta_points = eta_nodes.size();
+
+  for(int ihist = 0; ihist < size(); ihist++)
+  {
+    long offset = cell_offset[ihist  +  size() * n];
+
+    if(offset < 0) continue;
+
+    Emission_Histogram & histogram = histograms[ihist];
+
+    if(histogram.pT_axis < 0 && histogram.eta_axis < 0)
+    {
+      add(histogram, n, ipart, offset, dN_dy_cell);
+      continue;
+    }
+
+    for(int ipT = 0; ipT < pT_points; ipT++)
+    {
+      long pT_offset = offset;
+
+      if(histogram.pT_axis >= 0)
+      {
+        int ibin = histogram.axes[histogram.pT_axis].bin(pT_nodes[ipT]);
+        if(ibin < 0) continue;
+        pT_offset += histogram.stride[histogram.pT_axis] * ibin;
+      }
+
+      for(int ieta = 0; ieta < eta_points; ieta++)
+      {
+        double weight = node_weights[ieta  +  eta_points * ipT];
+
+        if(weight == 0.0) continue;
+
+        long ibin_all = pT_offset;
+
+        if(histogram.eta_axis >= 0)
+        {
+          int ibin = histogram.axes[histogram.eta_axis].bin(eta_nodes[ieta]);
+          if(ibin < 0) continue;
+          ibin_all += histogram.stride[histogram.eta_axis] * ibin;
+        }
+
+        add(histogram, n, ipart, ibin_all, weight);
+      }
+    }
+  }
+}
+
+
+void Emission_Histograms::write(const int * MCID)
+{
+  for(int ihist = 0; ihist < size(); ihist++)
+  {
+    Emission_Histogram & histogram = histograms[ihist];
+    int naxes = histogram.axes.size();
+
+    // sum the core copies (sparse: merge into core 0 and sort the non-empty bins)
+    vector<long> keys;
+
+    if(histogram.sparse)
+    {
+      unordered_map<long, double> & merged = histogram.sparse_bins[0];
+
+      for(int n = 1; n < cores; n++)
+      {
+        for(auto & entry : histogram.sparse_bins[n]) merged[entry.first] += entry.second;
+
+        histogram.sparse_bins[n].clear();
+      }
+
+      for(auto & entry : merged) keys.push_back(entry.first);
+
+      sort(keys.begin(), keys.end());
+    }
+    else
+    {
+      long length = histogram.bins * npart;
+
+      for(int n = 1; n < cores; n++)
+      {
+        for(long i = 0; i < length; i++) histogram.dense_bins[i] += histogram.dense_bins[i  +  length * n];
+      }
+    }
+
+    long ikey = 0;
+
+    for(long ipart = 0; ipart < npart; ipart++)
+    {
+      char filename[255] = "";
+      sprintf(filename, "results/continuous/emission_%s_%d.dat", histogram.name.c_str(), MCID[ipart]);
+
+      ofstream histogram_output(filename, ios_base::out);
+
+      histogram_output << "#";
+      for(int i = 0; i < naxes; i++)
+      {
+        histogram_output << " " << variable_names[histogram.axes[i].variable] << "_low " << variable_names[histogram.axes[i].variable] << "_high";
+      }
+      histogram_output << " dN/dy (bin content)" << (histogram.sparse ? " (non-empty bins)" : "") << "\n";
+
+      long first = 0;
+      long last = histogram.bins;
+
+      if(histogram.sparse)
+      {
+        first = ikey;
+        while(ikey < (long)keys.size() && keys[ikey] < histogram.bins * (ipart + 1)) ikey++;
+        last = ikey;
+      }
+
+      for(long k = first; k < last; k++)
+      {
+        long ibin = histogram.sparse ? keys[k]  -  histogram.bins * ipart : k;
+        double value = histogram.sparse ? histogram.sparse_bins[0][keys[k]] : histogram.dense_bins[ibin  +  histogram.bins * ipart];
+
+        for(int i = 0; i < naxes; i++)
+        {
+          int iaxis_bin = (ibin / histogram.stride[i]) % histogram.axes[i].bins();
+
+          histogram_output << setprecision(6) << scientific << histogram.axes[i].edges[iaxis_bin] << "\t" << histogram.axes[i].edges[iaxis_bin + 1] << "\t";
+        }
+
+        histogram_output << setprecision(6) << scientific << value << "\n";
+      }
+
+      histogram_output.close();
+    }
+  }
+}
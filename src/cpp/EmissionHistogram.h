@@ -0,0 +1,90 @@
+
+#ifndef EMISSIONHISTOGRAM_H
+#define EMISSIONHISTOGRAM_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+
+// Cooper-Frye weighted emission histograms of the spacetime distributions (operation = 0, emission_histograms = 1)
+//
+// each histogram bins the mean number dN/dy of every chosen species jointly in up to five of the variables
+// (tau, r, phis, etas, pT), defined one histogram per line in tables/emission_histograms.dat:
+//
+//   name   dense|sparse   variable:bins:min:max   variable=edge_0,edge_1,...,edge_bins   ...
+//
+// all histograms are filled in the single surface sweep of calculate_dN_dX(_feqmod), each core fills its own
+// copy (dense arrays or hash maps of the non-empty bins) and write() sums the copies. pT (and etas for 2+1d
+// surfaces) are binned at the momentum / spacetime rapidity quadrature points of the cell's dN/dy
+
+typedef enum {tau_variable, r_variable, phis_variable, etas_variable, pT_variable} emission_variable;
+
+
+class Emission_Axis
+{
+  public:
+    int variable;                           // emission_variable
+    vector<double> edges;                   // bin edges [bins + 1] (increasing)
+    bool uniform;
+    double min;
+    double width;
+
+    Emission_Axis(int variable_in, const vector<double> & edges_in, bool uniform_in);
+
+    int bins() const;
+    int bin(double x) const;                // bin index (-1 if x is outside [edge_0, edge_bins))
+};
+
+
+class Emission_Histogram
+{
+  public:
+    string name;
+    bool sparse;                            // hash maps of the non-empty bins instead of dense arrays
+    vector<Emission_Axis> axes;
+    vector<long> stride;                    // flat bin index = sum(stride[i] * bin_i) (last axis fastest)
+    long bins;                              // product of the axis bins
+
+    int pT_axis;                            // axes binned at the (pT, eta) quadrature points (-1 = none)
+    int eta_axis;                           // (the other axes are cell variables)
+
+    vector<double> dense_bins;              // [ibin  +  bins * (ipart  +  npart * n)]
+    vector< unordered_map<long, double> > sparse_bins;   // key = ibin  +  bins * ipart  [n]
+};
+
+
+class Emission_Histograms
+{
+  private:
+    int npart;                              // number of chosen particles
+    int cores;                              // number of per-core copies
+    int dimension;                          // surface dimension (etas is a cell variable for 3+1d)
+
+    vector<double> pT_nodes;                // pT quadrature points of the momentum table
+    vector<double> eta_nodes;               // spacetime rapidity points of the eta table (2+1d)
+
+    vector<Emission_Histogram> histograms;
+
+    vector<long> cell_offset;               // flat cell bin of each histogram [histogram + size * n] (-1 = outside)
+    vector<double> cell_etas;               // spacetime rapidity of the current cell [n] (3+1d)
+
+    void add(Emission_Histogram & histogram, int n, long ipart, long ibin, double weight);
+
+  public:
+    Emission_Histograms(string filename, int npart_in, int cores_in, int dimension_in, const vector<double> & pT_nodes_in, const vector<double> & eta_nodes_in);
+
+    int size() const;
+    bool uses_nodes() const;                // whether any histogram needs the (pT, eta) node weights of the cells
+
+    bool set_cell(int n, double tau, double r, double phis, double etas);   // false if the cell lies outside every histogram
+
+    // node_weights[ieta + eta_points * ipT] = dN/dy of the cell at each quadrature point (NULL if !uses_nodes())
+    void fill_cell(int n, long ipart, double dN_dy_cell, const double * node_weights);
+
+    void write(const int * MCID);          // sum the core copies and write results/continuous/emission_<name>_<mcid>.dat
+};
+
+#endif
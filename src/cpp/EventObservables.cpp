@@ -0,0 +1,156 @@
+
+#include <cmath>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "EventObservables.h"
+
+using namespace std;
+
+
+Event_Observables::Event_Observables(string filename, int npart_in, const int * mcid, const int * charge_in)
+{
+  npart = npart_in;
+
+  // one copy per OpenMP thread (the decays add particles from a parallel loop over events)
+  threads = 1;
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  Nevents = 0;
+
+  charge.resize(npart);
+  species.resize(npart);
+
+  for(int ipart = 0; ipart < npart; ipart++)
+  {
+    charge[ipart] = charge_in[ipart];
+    species[ipart] = -1;
+
+    for(int s = 0; s < identified_species; s++)
+    {
+      if(labs((long)mcid[ipart]) == identified_mcid[s]) species[ipart] = s;
+    }
+  }
+
+  observables_file = fopen(filename.c_str(), "wb");
+
+  if(observables_file == NULL)
+  {
+    printf("Event_Observables error: could not open %s\n", filename.c_str());
+    exit(-1);
+  }
+}
+
+
+Event_Observables::~Event_Observables()
+{
+  fclose(observables_file);
+}
+
+
+void Event_Observables::start_batch(long Nevents_batch)
+{
+  Nevents = Nevents_batch;
+
+  records.assign(Nevents * threads, Event_Observables_Record());
+
+  memset(records.data(), 0, records.size() * sizeof(Event_Observables_Record));
+}
+
+
+void Event_Observables::add_particle(long ievent, int chosen_index, double E, double px, double py, double pz, double rapidity)
+{
+  Event_Observables_Record & record = records[ievent  +  Nevents * thread_index()];
+
+  double pT = sqrt(px * px  +  py * py);
+  double p = sqrt(pT * pT  +  pz * pz);
+  double eta_p = 0.5 * log((p + pz) / (p - pz));      // pseudorapidity
+
+  int s = species[chosen_index];
+
+  if(s >= 0 && fabs(rapidity) < 0.5)
+  {
+    record.dN_dy[s] += 1.0;
+    record.mean_pT[s] += pT;
+  }
+
+  if(fabs(eta_p) < 0.6)
+  {
+    record.dET_deta += E * pT / p / 1.2;
+  }
+
+  if(charge[chosen_index] == 0 || fabs(eta_p) >= 0.8) return;
+
+  if(fabs(eta_p) < 0.5)
+  {
+    record.dNch_deta += 1.0;
+  }
+
+  if(pT > 0.15 && pT < 2.0)
+  {
+    record.pT_fluct_N++;
+    record.pT_fluct_sum_pT += pT;
+    record.pT_fluct_sum_pTsq += pT * pT;
+  }
+
+  if(pT > 0.2 && pT < 5.0)
+  {
+    double phi = atan2(py, px);
+
+    record.flow_N++;
+
+    for(int n = 1; n <= flow_harmonics; n++)
+    {
+      record.Qn[n - 1][0] += cos(n * phi);
+      record.Qn[n - 1][1] += sin(n * phi);
+    }
+  }
+}
+
+
+void Event_Observables::write_batch(long event_offset)
+{
+  for(long ievent = 0; ievent < Nevents; ievent++)
+  {
+    Event_Observables_Record & record = records[ievent];
+
+    // merge the thread copies (all sums)
+    for(int thread = 1; thread < threads; thread++)
+    {
+      const Event_Observables_Record & record_thread = records[ievent  +  Nevents * thread];
+
+      record.dNch_deta += record_thread.dNch_deta;
+      record.dET_deta += record_thread.dET_deta;
+
+      for(int s = 0; s < identified_species; s++)
+      {
+        record.dN_dy[s] += record_thread.dN_dy[s];
+        record.mean_pT[s] += record_thread.mean_pT[s];
+      }
+
+      record.pT_fluct_N += record_thread.pT_fluct_N;
+      record.pT_fluct_sum_pT += record_thread.pT_fluct_sum_pT;
+      record.pT_fluct_sum_pTsq += record_thread.pT_fluct_sum_pTsq;
+
+      record.flow_N += record_thread.flow_N;
+
+      for(int n = 0; n < flow_harmonics; n++)
+      {
+        record.Qn[n][0] += record_thread.Qn[n][0];
+        record.Qn[n][1] += record_thread.Qn[n][1];
+      }
+    }
+
+    record.event = event_offset + ievent + 1;
+
+    for(int s = 0; s < identified_species; s++)
+    {
+      if(record.dN_dy[s] > 0.0) record.mean_pT[s] /= record.dN_dy[s];
+    }
+  }
+
+  fwrite(records.data(), sizeof(Event_Observables_Record), Nevents, observables_file);
+  fflush(observables_file);
+}
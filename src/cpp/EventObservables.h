@@ -0,0 +1,89 @@
+
+#ifndef EVENTOBSERVABLES_H
+#define EVENTOBSERVABLES_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+using namespace std;
+
+
+// event-by-event observables updated while particles are sampled or decayed (event_observables = 1, 2)
+// same cuts as scripts/compute_observables.py:
+//
+//   dNch_deta     charged particles with |eta_p| < 0.5
+//   dET_deta      transverse energy with |eta_p| < 0.6 (divided by 1.2)
+//   dN_dy         identified particles + antiparticles with |y| < 0.5
+//   mean_pT       of the identified particles with |y| < 0.5
+//   pT_fluct      (N, sum pT, sum pT^2) of charged particles with |eta_p| < 0.8, 0.15 < pT < 2 GeV
+//   flow          (N, Q_n = sum exp(i.n.phi) for n = 1, ..., 7) of charged particles with |eta_p| < 0.8, 0.2 < pT < 5 GeV
+//
+// written as one 280 byte record per event (little endian) to results/event_observables.dat
+// (with decay_sampled_hadrons = 1 the particles are the stable decay products of the final state, otherwise the sampled hadrons)
+
+const int identified_species = 7;
+const long identified_mcid[identified_species] = {211, 321, 2212, 3122, 3212, 3312, 3334};   // pi, K, p, Lambda, Sigma0, Xi, Omega
+
+const int flow_harmonics = 7;
+
+typedef struct
+{
+  int64_t event;                                // event number (starts at 1)
+
+  double dNch_deta;
+  double dET_deta;
+
+  double dN_dy[identified_species];
+  double mean_pT[identified_species];           // sum of pT until the event is finished
+
+  int64_t pT_fluct_N;
+  double pT_fluct_sum_pT;
+  double pT_fluct_sum_pTsq;
+
+  int64_t flow_N;
+  double Qn[flow_harmonics][2];                 // (real, imaginary) part of Q_n
+
+} Event_Observables_Record;
+
+
+class Event_Observables
+{
+  private:
+    FILE * observables_file;
+
+    int npart;                                  // number of chosen particles
+    int threads;                                // per-thread copies of the batch records (OpenMP threads)
+
+    vector<int> charge;                         // charge of each chosen particle
+    vector<int> species;                        // identified species index of each chosen particle (-1 if none)
+
+    long Nevents;                               // events in current batch
+    vector<Event_Observables_Record> records;   // [ievent  +  Nevents * thread]
+
+    inline int thread_index()                   // copies are sized by omp_get_max_threads()
+    {
+    #ifdef _OPENMP
+      return omp_get_thread_num();
+    #else
+      return 0;
+    #endif
+    }
+
+  public:
+    Event_Observables(string filename, int npart_in, const int * mcid, const int * charge_in);
+    ~Event_Observables();
+
+    void start_batch(long Nevents_batch);       // zero the records of the next batch of events
+
+    void add_particle(long ievent, int chosen_index, double E, double px, double py, double pz, double rapidity);
+
+    void write_batch(long event_offset);        // merge threads, finish the records and append them to file
+};
+
+#endif
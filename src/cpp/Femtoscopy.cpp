@@ -0,0 +1,175 @@
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+#include <stdio.h>
+#ifdef _OMP
+#include <omp.h>
+#endif
+#include "iS3D.h"
+#include "readindata.h"
+#include "EmissionFunction.h"
+
+using namespace std;
+
+
+// HBT radii from the spacetime moments of the emission function S(x, K) (smoothness approximation, K = p)
+//
+// the spectra kernels accumulate the Cooper-Frye weighted moments <x^mu> and <x^mu x^nu> of each momentum point in
+// its longitudinally comoving frame (LCMS): t = tau.cosh(eta - y), z = tau.sinh(eta - y), with the transverse position
+// rotated to out = (x, y).phip_hat, side = (x, y).(z_hat cross phip_hat). the radii are the variances (x~ = x - <x>)
+//
+//    R_out^2  = <(x~_out - beta_T.t~)^2>       R_os^2 = <(x~_out - beta_T.t~).x~_side>
+//    R_side^2 = <x~_side^2>                    R_ol^2 = <(x~_out - beta_T.t~).x~_long>
+//    R_long^2 = <x~_long^2>                    R_sl^2 = <x~_side.x~_long>
+//
+// with beta_T = pT / mT (beta_L = 0 in the LCMS)
+
+void EmissionFunctionArray::start_femtoscopy_moments(double *x_fo, double *y_fo)
+{
+  // set up the per-core accumulators (CORES * npart * momentum points * femto_moments)
+  if(femto_sweep != NULL) delete femto_sweep;
+
+  femto_sweep = new Femtoscopy_Sweep;
+
+  femto_sweep->x = x_fo;
+  femto_sweep->y = y_fo;
+
+  long momentum_points = number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length;
+
+  femto_sweep->moments_all.assign(femto_moments * momentum_points * CORES, 0.0);
+}
+
+
+void EmissionFunctionArray::add_femtoscopy_moments(long n, long iS3D, double factor, double weight, double x_out, double x_side, const double * eta_moments)
+{
+  // add a cell's contribution to the moments of the momentum point iS3D (core n)
+  // weight = eta integral of the Cooper-Frye integrand, eta_moments = eta integrals of weight * (t, z, t^2, z^2, t.z)
+  long momentum_points = number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length;
+
+  double * moments = femto_sweep->moments_all.data()  +  femto_moments * (iS3D  +  momentum_points * n);
+
+  double w = factor * weight;
+  double wt = factor * eta_moments[0];
+  double wz = factor * eta_moments[1];
+
+  moments[femto_t] += wt;
+  moments[femto_out] += w * x_out;
+  moments[femto_side] += w * x_side;
+  moments[femto_long] += wz;
+
+  moments[femto_tt] += factor * eta_moments[2];
+  moments[femto_oo] += w * x_out * x_out;
+  moments[femto_ss] += w * x_side * x_side;
+  moments[femto_ll] += factor * eta_moments[3];
+  moments[femto_to] += wt * x_out;
+  moments[femto_ts] += wt * x_side;
+  moments[femto_tl] += factor * eta_moments[4];
+  moments[femto_os] += w * x_out * x_side;
+  moments[femto_ol] += wz * x_out;
+  moments[femto_sl] += wz * x_side;
+}
+
+
+void EmissionFunctionArray::finish_femtoscopy_moments(int *MCID)
+{
+  // reduce the moments over the cores and write the HBT radii of the thermal spectra (call before the resonance decays)
+  printf("Writing femtoscopy radii to file...\n");
+
+  long momentum_points = number_of_chosen_particles * pT_tab_length * phi_tab_length * y_tab_length;
+
+  const double * moments_all = femto_sweep->moments_all.data();
+  vector<double> moments(femto_moments * momentum_points, 0.0);
+
+  #pragma omp parallel for
+  for(long iS3D = 0; iS3D < momentum_points; iS3D++)
+  {
+    for(long n = 0; n < CORES; n++)
+    {
+      for(int imoment = 0; imoment < femto_moments; imoment++)
+      {
+        moments[imoment  +  femto_moments * iS3D] += moments_all[imoment  +  femto_moments * (iS3D  +  momentum_points * n)];
+      }
+    }
+  }
+
+  delete femto_sweep;
+  femto_sweep = NULL;
+
+  set_momentum_grid();
+
+  char filename[255] = "";
+
+  for(long ipart = 0; ipart < number_of_chosen_particles; ipart++)
+  {
+    double mass = chosen_mass[ipart];
+
+    sprintf(filename, "results/continuous/femtoscopy_radii_%d.dat", MCID[ipart]);
+    ofstream radii(filename, ios_base::out);
+
+    radii << "y" << "\t" << "phip" << "\t" << "pT" << "\t" << "dN_pTdpTdphidy" << "\t" << "<t>" << "\t" << "<x_out>" << "\t"
+          << "R_out^2" << "\t" << "R_side^2" << "\t" << "R_long^2" << "\t" << "R_os^2" << "\t" << "R_ol^2" << "\t" << "R_sl^2" << "\n";
+
+    for(long iy = 0; iy < y_tab_length; iy++)
+    {
+      double y = y_values[iy];
+
+      for(long iphip = 0; iphip < phi_tab_length; iphip++)
+      {
+        double phip = phip_values[iphip];
+
+        for(long ipT = 0; ipT < pT_tab_length; ipT++)
+        {
+          double pT = pT_values[ipT];
+          double beta_T = pT / sqrt(mass * mass  +  pT * pT);
+
+          long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
+
+          const double * S = moments.data()  +  femto_moments * iS3D;
+          double S0 = dN_pTdpTdphidy[iS3D];
+
+          double radii_values[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+          double t_mean = 0.0;
+          double out_mean = 0.0;
+
+          if(S0 > 0.0)
+          {
+            t_mean = S[femto_t] / S0;
+            out_mean = S[femto_out] / S0;
+            double side_mean = S[femto_side] / S0;
+            double long_mean = S[femto_long] / S0;
+
+            // covariances <x~_mu x~_nu>
+            double tt = S[femto_tt] / S0  -  t_mean * t_mean;
+            double oo = S[femto_oo] / S0  -  out_mean * out_mean;
+            double ss = S[femto_ss] / S0  -  side_mean * side_mean;
+            double ll = S[femto_ll] / S0  -  long_mean * long_mean;
+            double to = S[femto_to] / S0  -  t_mean * out_mean;
+            double ts = S[femto_ts] / S0  -  t_mean * side_mean;
+            double tl = S[femto_tl] / S0  -  t_mean * long_mean;
+            double os = S[femto_os] / S0  -  out_mean * side_mean;
+            double ol = S[femto_ol] / S0  -  out_mean * long_mean;
+            double sl = S[femto_sl] / S0  -  side_mean * long_mean;
+
+            radii_values[0] = oo  -  2.0 * beta_T * to  +  beta_T * beta_T * tt;   // R_out^2
+            radii_values[1] = ss;                                                 // R_side^2
+            radii_values[2] = ll;                                                 // R_long^2
+            radii_values[3] = os  -  beta_T * ts;                                 // R_os^2
+            radii_values[4] = ol  -  beta_T * tl;                                 // R_ol^2
+            radii_values[5] = sl;                                                 // R_sl^2
+          }
+
+          radii << scientific << setw(5) << setprecision(8) << y << "\t" << phip << "\t" << pT << "\t" << S0 << "\t" << t_mean << "\t" << out_mean;
+
+          for(int i = 0; i < 6; i++) radii << "\t" << radii_values[i];
+
+          radii << "\n";
+        } //ipT
+        radii << "\n";
+      } //iphip
+    } //iy
+    radii.close();
+  }
+}
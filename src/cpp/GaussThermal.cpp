@@ -1,8 +1,12 @@
 
 #include <stdlib.h>
+#include <string.h>
 #include <cmath>
+#include <vector>
 #include "GaussThermal.h"
 
+using namespace std;
+
 // gauss integration routine
 double GaussThermal(double thermal_integrand(double pbar, double mbar, double alphaB, double baryon, double sign), double * pbar_root, double * pbar_weight, int pbar_pts, double mbar, double alphaB, double baryon, double sign)
 {
@@ -87,6 +91,356 @@ double J31_int(double pbar, double mbar, double alphaB, double baryon, double si
 
 
 
+// fused thermal moments (the inlined passes vectorize across the roots)
+// feq = 1 / (exp(Ebar - baryon.alphaB) + sign) and feq.(1 - sign.feq) = exp(Ebar - baryon.alphaB).feq^2
+// pbar_weight_exp = pbar_weight.exp(pbar) (precomputed once per batch)
+static inline void thermal_moments_order1(const double * pbar_root, const double * pbar_weight_exp, int pbar_pts, double mbar, double chem, double sign, Thermal_Moments & result)
+{
+	double neq = 0.0, J10 = 0.0, J11 = 0.0;
+	double mbar2 = mbar * mbar;
+
+	#pragma omp simd reduction(+:neq, J10, J11)
+	for(int k = 0; k < pbar_pts; k++)
+	{
+		double pbar = pbar_root[k];
+		double Ebar = sqrt(pbar * pbar + mbar2);
+		double qexp = exp(Ebar - chem);
+		double feq = 1.0 / (qexp + sign);
+
+		double w_feq = pbar_weight_exp[k] * feq;		// gauss laguerre (a = 1)
+		double w_df = w_feq * qexp * feq;
+
+		neq += pbar * w_feq;
+		J10 += pbar * w_df;
+		J11 += pbar * pbar * pbar / (Ebar * Ebar) * w_df;
+	}
+
+	result.neq = neq;
+	result.J10 = J10;
+	result.J11 = J11;
+}
+
+static inline void thermal_moments_order2(const double * pbar_root, const double * pbar_weight_exp, int pbar_pts, double mbar, double chem, double sign, Thermal_Moments & result)
+{
+	double J20 = 0.0;
+	double mbar2 = mbar * mbar;
+
+	#pragma omp simd reduction(+:J20)
+	for(int k = 0; k < pbar_pts; k++)
+	{
+		double pbar = pbar_root[k];
+		double Ebar = sqrt(pbar * pbar + mbar2);
+		double qexp = exp(Ebar - chem);
+		double feq = 1.0 / (qexp + sign);
+
+		J20 += Ebar * pbar_weight_exp[k] * qexp * feq * feq;		// gauss laguerre (a = 2)
+	}
+
+	result.J20 = J20;
+}
+
+static inline void thermal_moments_order3(const double * pbar_root, const double * pbar_weight_exp, int pbar_pts, double mbar, double chem, double sign, Thermal_Moments & result)
+{
+	double J30 = 0.0, J31 = 0.0;
+	double mbar2 = mbar * mbar;
+
+	#pragma omp simd reduction(+:J30, J31)
+	for(int k = 0; k < pbar_pts; k++)
+	{
+		double pbar = pbar_root[k];
+		double Ebar = sqrt(pbar * pbar + mbar2);
+		double qexp = exp(Ebar - chem);
+		double feq = 1.0 / (qexp + sign);
+
+		double w_df = pbar_weight_exp[k] * qexp * feq * feq;		// gauss laguerre (a = 3)
+
+		J30 += Ebar * Ebar / pbar * w_df;
+		J31 += pbar * w_df;
+	}
+
+	result.J30 = J30;
+	result.J31 = J31;
+}
+
+void GaussThermal_weight_exp(int moments, double ** pbar_root, double ** pbar_weight, int pbar_pts, double * pbar_weight_exp)
+{
+	// pbar_weight_exp[k + pbar_pts * (a - 1)] = pbar_weight[a][k] * exp(pbar_root[a][k]) for the needed orders a = 1, 2, 3
+	bool order[3] = {(moments & (neq_moment | J10_moment | J11_moment)) != 0, (moments & J20_moment) != 0, (moments & (J30_moment | J31_moment)) != 0};
+
+	for(int a = 1; a <= 3; a++)
+	{
+		for(int k = 0; k < pbar_pts; k++)
+		{
+			pbar_weight_exp[k + pbar_pts * (a - 1)] = order[a - 1] ? pbar_weight[a][k] * exp(pbar_root[a][k]) : 0.0;
+		}
+	}
+}
+
+static Thermal_Moments fused_thermal_moments(int moments, double ** pbar_root, const double * pbar_weight_exp, int pbar_pts, double mbar, double alphaB, double baryon, double sign)
+{
+	Thermal_Moments result = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+	double chem = baryon * alphaB;
+
+	if(moments & (neq_moment | J10_moment | J11_moment))
+	{
+		thermal_moments_order1(pbar_root[1], pbar_weight_exp, pbar_pts, mbar, chem, sign, result);
+	}
+	if(moments & J20_moment)
+	{
+		thermal_moments_order2(pbar_root[2], pbar_weight_exp + pbar_pts, pbar_pts, mbar, chem, sign, result);
+	}
+	if(moments & (J30_moment | J31_moment))
+	{
+		thermal_moments_order3(pbar_root[3], pbar_weight_exp + 2 * pbar_pts, pbar_pts, mbar, chem, sign, result);
+	}
+
+	return result;
+}
+
+Thermal_Moments GaussThermal_moments(int moments, double ** pbar_root, double ** pbar_weight, int pbar_pts, double mbar, double alphaB, double baryon, double sign)
+{
+	vector<double> pbar_weight_exp(3 * pbar_pts);
+
+	GaussThermal_weight_exp(moments, pbar_root, pbar_weight, pbar_pts, pbar_weight_exp.data());
+
+	return fused_thermal_moments(moments, pbar_root, pbar_weight_exp.data(), pbar_pts, mbar, alphaB, baryon, sign);
+}
+
+Thermal_Moments GaussThermal_moments_weighted(int moments, double ** pbar_root, const double * pbar_weight_exp, int pbar_pts, double mbar, double alphaB, double baryon, double sign)
+{
+	return fused_thermal_moments(moments, pbar_root, pbar_weight_exp, pbar_pts, mbar, alphaB, baryon, sign);
+}
+
+void GaussThermal_moments_batch(int moments, double ** pbar_root, double ** pbar_weight, int pbar_pts, int nspecies, const double * mass, double T, double alphaB, const double * baryon, const double * sign, Thermal_Moments * moments_list)
+{
+	vector<double> pbar_weight_exp(3 * pbar_pts);
+
+	GaussThermal_weight_exp(moments, pbar_root, pbar_weight, pbar_pts, pbar_weight_exp.data());
+
+	for(int ispecies = 0; ispecies < nspecies; ispecies++)
+	{
+		moments_list[ispecies] = fused_thermal_moments(moments, pbar_root, pbar_weight_exp.data(), pbar_pts, mass[ispecies] / T, alphaB, baryon[ispecies], sign[ispecies]);
+	}
+}
+
+
+// fused integrals of the df coefficient tables
+// exp(Ebar - baryon.alphaB) = exp(Ebar).fugacity: the exponentials of a species are evaluated once per temperature
+// and reused for every alphaB (the meson integrals don't depend on alphaB)
+enum {e_index, p_index, J20_index, J21_index, J30_index, J32_index, J40_index, J41_index, nB_index, N10_index, M11_index, N20_index, M21_index, N30_index, N31_index, df_integrals};
+
+static void df_integrals_species(double ** pbar_root, const double * pbar_weight_exp, const double * Ebar, const double * expE, int pbar_pts, double fugacity, double sign, bool baryon_integrals, double * I)
+{
+	// arrays are [k + pbar_pts * (a - 1)] for the gauss laguerre order a = 1, ..., 4
+	double e = 0.0, p = 0.0, J20 = 0.0, J21 = 0.0;
+	double nB = 0.0, N10 = 0.0, M11 = 0.0, N20 = 0.0, M21 = 0.0, N30 = 0.0, N31 = 0.0;
+
+	const double * root2 = pbar_root[2];
+	const double * weight2 = pbar_weight_exp + pbar_pts;
+	const double * Ebar2 = Ebar + pbar_pts;
+	const double * expE2 = expE + pbar_pts;
+
+	#pragma omp simd reduction(+:e, p, J20, J21)
+	for(int k = 0; k < pbar_pts; k++)
+	{
+		double pbar = root2[k];
+		double qexp = expE2[k] * fugacity;
+		double feq = 1.0 / (qexp + sign);
+
+		double w_feq = weight2[k] * feq;
+		double w_df = w_feq * qexp * feq;
+
+		e += Ebar2[k] * w_feq;
+		p += pbar * pbar / Ebar2[k] * w_feq;
+		J20 += Ebar2[k] * w_df;
+		J21 += pbar * pbar / Ebar2[k] * w_df;
+	}
+
+	double J30 = 0.0, J32 = 0.0;
+
+	const double * root3 = pbar_root[3];
+	const double * weight3 = pbar_weight_exp + 2 * pbar_pts;
+	const double * Ebar3 = Ebar + 2 * pbar_pts;
+	const double * expE3 = expE + 2 * pbar_pts;
+
+	#pragma omp simd reduction(+:J30, J32)
+	for(int k = 0; k < pbar_pts; k++)
+	{
+		double pbar = root3[k];
+		double qexp = expE3[k] * fugacity;
+		double feq = 1.0 / (qexp + sign);
+
+		double w_df = weight3[k] * qexp * feq * feq;
+
+		J30 += Ebar3[k] * Ebar3[k] / pbar * w_df;
+		J32 += pbar * pbar * pbar / (Ebar3[k] * Ebar3[k]) * w_df;
+	}
+
+	double J40 = 0.0, J41 = 0.0;
+
+	const double * root4 = pbar_root[4];
+	const double * weight4 = pbar_weight_exp + 3 * pbar_pts;
+	const double * Ebar4 = Ebar + 3 * pbar_pts;
+	const double * expE4 = expE + 3 * pbar_pts;
+
+	#pragma omp simd reduction(+:J40, J41)
+	for(int k = 0; k < pbar_pts; k++)
+	{
+		double pbar = root4[k];
+		double qexp = expE4[k] * fugacity;
+		double feq = 1.0 / (qexp + sign);
+
+		double w_df = weight4[k] * qexp * feq * feq;
+
+		J40 += Ebar4[k] * Ebar4[k] * Ebar4[k] / (pbar * pbar) * w_df;
+		J41 += Ebar4[k] * w_df;
+	}
+
+	if(baryon_integrals)
+	{
+		const double * root1 = pbar_root[1];
+
+		#pragma omp simd reduction(+:nB, N10, M11)
+		for(int k = 0; k < pbar_pts; k++)
+		{
+			double pbar = root1[k];
+			double qexp = expE[k] * fugacity;
+			double feq = 1.0 / (qexp + sign);
+
+			double w_feq = pbar_weight_exp[k] * feq;
+			double w_df = w_feq * qexp * feq;
+
+			nB += pbar * w_feq;
+			N10 += pbar * w_df;
+			M11 += pbar * pbar * pbar / (Ebar[k] * Ebar[k]) * w_df;
+		}
+
+		#pragma omp simd reduction(+:N20, M21)
+		for(int k = 0; k < pbar_pts; k++)
+		{
+			double pbar = root2[k];
+			double qexp = expE2[k] * fugacity;
+			double feq = 1.0 / (qexp + sign);
+
+			double w_df = weight2[k] * qexp * feq * feq;
+
+			N20 += Ebar2[k] * w_df;
+			M21 += pbar * pbar / Ebar2[k] * w_df;
+		}
+
+		#pragma omp simd reduction(+:N30, N31)
+		for(int k = 0; k < pbar_pts; k++)
+		{
+			double pbar = root3[k];
+			double qexp = expE3[k] * fugacity;
+			double feq = 1.0 / (qexp + sign);
+
+			double w_df = weight3[k] * qexp * feq * feq;
+
+			N30 += Ebar3[k] * Ebar3[k] / pbar * w_df;
+			N31 += pbar * w_df;
+		}
+	}
+
+	I[e_index] = e;       I[p_index] = p;       I[J20_index] = J20;   I[J21_index] = J21;
+	I[J30_index] = J30;   I[J32_index] = J32;   I[J40_index] = J40;   I[J41_index] = J41;
+	I[nB_index] = nB;     I[N10_index] = N10;   I[M11_index] = M11;   I[N20_index] = N20;
+	I[M21_index] = M21;   I[N30_index] = N30;   I[N31_index] = N31;
+}
+
+static void add_df_integrals(const double * I, double mass, double degeneracy, double baryon, Deltaf_Integrals & sums)
+{
+	double mass2 = mass * mass;
+
+	sums.e += degeneracy * I[e_index];
+	sums.p += degeneracy * I[p_index];
+	sums.J20 += degeneracy * I[J20_index];
+	sums.J21 += degeneracy * I[J21_index];
+	sums.A20 += mass2 * degeneracy * I[J20_index];
+	sums.A21 += mass2 * degeneracy * I[J21_index];
+	sums.J30 += degeneracy * I[J30_index];
+	sums.J32 += degeneracy * I[J32_index];
+	sums.J40 += degeneracy * I[J40_index];
+	sums.J41 += degeneracy * I[J41_index];
+
+	if(baryon == 0.0) return;
+
+	// the other integrals are proportional to baryon (N) or baryon^2 (M); M10, M20 have the same integrands as N10, N20
+	double b2 = baryon * baryon;
+
+	sums.nB += degeneracy * baryon * I[nB_index];
+	sums.N10 += degeneracy * baryon * I[N10_index];
+	sums.B10 += mass2 * degeneracy * baryon * I[N10_index];
+	sums.M10 += degeneracy * b2 * I[N10_index];
+	sums.M11 += degeneracy * b2 * I[M11_index];
+	sums.N20 += degeneracy * baryon * I[N20_index];
+	sums.M20 += degeneracy * b2 * I[N20_index];
+	sums.M21 += degeneracy * b2 * I[M21_index];
+	sums.N30 += degeneracy * baryon * I[N30_index];
+	sums.N31 += degeneracy * baryon * I[N31_index];
+}
+
+void GaussThermal_df_integrals(double ** pbar_root, double ** pbar_weight, int pbar_pts, int nspecies, const double * mass, const double * degeneracy, double T, int nalphaB, const double * alphaB, const double * baryon, const double * sign, Deltaf_Integrals * sums_list)
+{
+	memset(sums_list, 0, nalphaB * sizeof(Deltaf_Integrals));
+
+	// [k + pbar_pts * (a - 1)] for a = 1, ..., 4
+	vector<double> pbar_weight_exp(4 * pbar_pts);
+	vector<double> Ebar(4 * pbar_pts);
+	vector<double> expE(4 * pbar_pts);
+
+	for(int a = 1; a <= 4; a++)
+	{
+		for(int k = 0; k < pbar_pts; k++)
+		{
+			pbar_weight_exp[k + pbar_pts * (a - 1)] = pbar_weight[a][k] * exp(pbar_root[a][k]);
+		}
+	}
+
+	double I[df_integrals];
+
+	for(int ispecies = 0; ispecies < nspecies; ispecies++)
+	{
+		if(mass[ispecies] == 0.0) continue;		// skip the photon
+
+		double mbar = mass[ispecies] / T;
+
+		for(int a = 1; a <= 4; a++)
+		{
+			for(int k = 0; k < pbar_pts; k++)
+			{
+				double pbar = pbar_root[a][k];
+				double E = sqrt(pbar * pbar  +  mbar * mbar);
+
+				Ebar[k + pbar_pts * (a - 1)] = E;
+				expE[k + pbar_pts * (a - 1)] = exp(E);
+			}
+		}
+
+		if(baryon[ispecies] == 0.0)
+		{
+			df_integrals_species(pbar_root, pbar_weight_exp.data(), Ebar.data(), expE.data(), pbar_pts, 1.0, sign[ispecies], false, I);
+
+			for(int ialphaB = 0; ialphaB < nalphaB; ialphaB++)
+			{
+				add_df_integrals(I, mass[ispecies], degeneracy[ispecies], 0.0, sums_list[ialphaB]);
+			}
+		}
+		else
+		{
+			for(int ialphaB = 0; ialphaB < nalphaB; ialphaB++)
+			{
+				double fugacity = exp(- baryon[ispecies] * alphaB[ialphaB]);
+
+				df_integrals_species(pbar_root, pbar_weight_exp.data(), Ebar.data(), expE.data(), pbar_pts, fugacity, sign[ispecies], true, I);
+
+				add_df_integrals(I, mass[ispecies], degeneracy[ispecies], baryon[ispecies], sums_list[ialphaB]);
+			}
+		}
+	}
+}
+
 
 // for Jonah's coefficient calculation
 
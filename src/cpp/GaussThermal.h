@@ -16,6 +16,51 @@ double J30_int(double pbar, double mbar, double alphaB, double baryon, double si
 double J31_int(double pbar, double mbar, double alphaB, double baryon, double sign);
 
 
+// fused thermal moments: one pass over the roots of each generalized Laguerre order (a = 1: neq, J10, J11; a = 2: J20; a = 3: J30, J31)
+// shares Ebar, exp(Ebar - baryon.alphaB) and the quantum statistics factor between the moments of the same order
+// (same values as GaussThermal with the corresponding integrand and pbar_root[a], pbar_weight[a])
+
+enum {neq_moment = 1, J10_moment = 2, J11_moment = 4, J20_moment = 8, J30_moment = 16, J31_moment = 32};
+
+typedef struct
+{
+  double neq;
+  double J10;
+  double J11;
+  double J20;
+  double J30;
+  double J31;
+} Thermal_Moments;
+
+// moments = requested moments (e.g. neq_moment | J20_moment); the other moments of the same order are filled too, the rest are zero
+Thermal_Moments GaussThermal_moments(int moments, double ** pbar_root, double ** pbar_weight, int pbar_pts, double mbar, double alphaB, double baryon, double sign);
+
+// pbar_weight_exp[k + pbar_pts * (a - 1)] = pbar_weight[a][k] * exp(pbar_root[a][k]) of the requested moments (3 * pbar_pts doubles)
+// compute them once per kernel and pass them to GaussThermal_moments_weighted inside the cell / species loops
+void GaussThermal_weight_exp(int moments, double ** pbar_root, double ** pbar_weight, int pbar_pts, double * pbar_weight_exp);
+Thermal_Moments GaussThermal_moments_weighted(int moments, double ** pbar_root, const double * pbar_weight_exp, int pbar_pts, double mbar, double alphaB, double baryon, double sign);
+
+// batch over species with a common (T, alphaB): moments_list[ispecies] with mbar = mass[ispecies] / T
+void GaussThermal_moments_batch(int moments, double ** pbar_root, double ** pbar_weight, int pbar_pts, int nspecies, const double * mass, double T, double alphaB, const double * baryon, const double * sign, Thermal_Moments * moments_list);
+
+
+// hadron resonance gas sums of the thermodynamic integrals in the df coefficients (Grad 14-moment and Chapman-Enskog)
+// sum over species of degeneracy * integral (A20, A21, B10 also weighted by mass^2), without the powers of T / two_pi2_hbarC3
+// feq integrals: nB, e, p    df integrals (feq.(1 - sign.feq)): the rest  (same integrands as generate_delta_f_coefficients)
+
+typedef struct
+{
+  double nB, e, p;                                      // gauss laguerre (a = 1, 2, 2)
+  double N10, M10, M11, B10;                            // (a = 1)
+  double J20, J21, M20, M21, N20, A20, A21;             // (a = 2)
+  double J30, J32, N30, N31;                            // (a = 3)
+  double J40, J41;                                      // (a = 4)
+} Deltaf_Integrals;
+
+// batch over alphaB at fixed T: sums_list[ialphaB] (photons with mass = 0 are skipped)
+void GaussThermal_df_integrals(double ** pbar_root, double ** pbar_weight, int pbar_pts, int nspecies, const double * mass, const double * degeneracy, double T, int nalphaB, const double * alphaB, const double * baryon, const double * sign, Deltaf_Integrals * sums_list);
+
+
 // for jonah coefficient calculation
 double Gauss1D_mod(double modified_1D_integrand(double pbar, double mbar, double lambda, double sign), double * pbar_root, double * pbar_weight, int pbar_pts, double mbar, double lambda, double sign);
 
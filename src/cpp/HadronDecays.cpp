@@ -0,0 +1,332 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "iS3D.h"
+#include "HadronDecays.h"
+
+using namespace std;
+
+
+inline double decay_canonical(default_random_engine & generator)
+{
+  return generate_canonical<double, numeric_limits<double>::digits>(generator);
+}
+
+
+double two_body_momentum(double M, double m1, double m2)
+{
+  // momentum of the products of a 2-body decay M -> m1 + m2 in the rest frame of M
+  double a = M * M  -  (m1 + m2) * (m1 + m2);
+  double b = M * M  -  (m1 - m2) * (m1 - m2);
+
+  return sqrt(max(0.0, a * b)) / (2.0 * M);
+}
+
+
+void isotropic_momentum(double p, double mass, default_random_engine & generator, double * pmu)
+{
+  // on-shell 4-momentum with magnitude p in a random direction
+  double costheta = 2.0 * decay_canonical(generator)  -  1.0;
+  double sintheta = sqrt(fabs(1.0  -  costheta * costheta));
+  double phi = two_pi * decay_canonical(generator);
+
+  pmu[0] = sqrt(p * p  +  mass * mass);
+  pmu[1] = p * sintheta * cos(phi);
+  pmu[2] = p * sintheta * sin(phi);
+  pmu[3] = p * costheta;
+}
+
+
+void boost_from_rest_frame(double * pmu, const double * Pmu, double M)
+{
+  // boost pmu from the rest frame of Pmu (mass M) to the frame where it has momentum Pmu
+  double P_dot_p = Pmu[1] * pmu[1]  +  Pmu[2] * pmu[2]  +  Pmu[3] * pmu[3];
+  double factor = P_dot_p / (M * (Pmu[0] + M))  +  pmu[0] / M;
+
+  pmu[0] = (Pmu[0] * pmu[0]  +  P_dot_p) / M;
+
+  for(int i = 1; i < 4; i++) pmu[i] += factor * Pmu[i];
+}
+
+
+Hadron_Decayer::Hadron_Decayer(const Particle_Table * particles_in, const int * chosen_particles_sampling_table, int number_of_chosen_particles, vector<double> & chosen_mass, vector<int> & chosen_mcid, vector<int> & chosen_charge, uint64_t seed_in)
+{
+  particles = particles_in;
+  seed = seed_in;
+
+  int npart = particles->size;
+
+  unstable_species = 0;
+  added_species = 0;
+  closed_channels = 0;
+
+  // open decay channels of each particle
+  channel_start.assign(npart + 1, 0);
+  product_start.assign(1, 0);
+
+  for(int ipart = 0; ipart < npart; ipart++)
+  {
+    int first_channel = channel_probability.size();
+    double total = 0.0;
+
+    if(!particles->stable[ipart])
+    {
+      for(int ichannel = particles->decay_channel_start[ipart]; ichannel < particles->decay_channel_start[ipart + 1]; ichannel++)
+      {
+        int first_product = particles->decay_product_start[ichannel];
+        int decay_products = particles->decay_product_start[ichannel + 1] - first_product;
+        double branch_ratio = particles->decay_branchratio[ichannel];
+
+        if(decay_products < 2 || branch_ratio <= 0.0) continue;
+
+        vector<int> products;
+        double mass_sum = 0.0;
+
+        for(int k = 0; k < decay_products && decay_products <= 3; k++)
+        {
+          int index = particles->find(particles->decay_product[first_product + k]);
+
+          if(index == -1) break;
+
+          products.push_back(index);
+          mass_sum += particles->mass[index];
+        }
+
+        if((int)products.size() != decay_products || mass_sum >= particles->mass[ipart])
+        {
+          closed_channels++;
+          continue;
+        }
+
+        total += branch_ratio;
+
+        channel_probability.push_back(total);
+        product.insert(product.end(), products.begin(), products.end());
+        product_start.push_back(product.size());
+      }
+    }
+
+    for(int ichannel = first_channel; ichannel < (int)channel_probability.size(); ichannel++)
+    {
+      channel_probability[ichannel] /= total;
+    }
+
+    channel_start[ipart + 1] = channel_probability.size();
+
+    if(channel_start[ipart + 1] > channel_start[ipart]) unstable_species++;
+  }
+
+  // compact chosen index of the stable particles in the decayed lists
+  output_index.assign(npart, -1);
+  species_particle.assign(chosen_particles_sampling_table, chosen_particles_sampling_table + number_of_chosen_particles);
+
+  vector<char> visited(npart, 0);
+  vector<int> unstable;
+
+  for(int ichosen = 0; ichosen < number_of_chosen_particles; ichosen++)
+  {
+    int ipart = chosen_particles_sampling_table[ichosen];
+
+    visited[ipart] = 1;
+
+    if(channel_start[ipart + 1] > channel_start[ipart]) unstable.push_back(ipart);
+    else output_index[ipart] = ichosen;
+  }
+
+  // stable descendants that aren't chosen particles
+  while(!unstable.empty())
+  {
+    int ipart = unstable.back();
+    unstable.pop_back();
+
+    for(int k = product_start[channel_start[ipart]]; k < product_start[channel_start[ipart + 1]]; k++)
+    {
+      int index = product[k];
+
+      if(visited[index]) continue;
+
+      visited[index] = 1;
+
+      if(channel_start[index + 1] > channel_start[index])
+      {
+        unstable.push_back(index);
+      }
+      else
+      {
+        output_index[index] = species_particle.size();
+        species_particle.push_back(index);
+
+        chosen_mass.push_back(particles->mass[index]);
+        chosen_mcid.push_back(particles->mc_id[index]);
+        chosen_charge.push_back(particles->charge[index]);
+
+        added_species++;
+      }
+    }
+  }
+
+  if(species_particle.size() > 65535)
+  {
+    printf("Hadron_Decayer error: compact sampled particles support at most 65535 chosen particles and decay products\n");
+    exit(-1);
+  }
+}
+
+
+void Hadron_Decayer::decay(const Decay_Particle & parent, default_random_engine & generator, vector<Decay_Particle> & products) const
+{
+  // decay the parent at its decay vertex and append the products (lab frame)
+  int ipart = parent.ipart;
+  double M = particles->mass[ipart];
+
+  // decay channel
+  double r = decay_canonical(generator);
+
+  int ichannel = channel_start[ipart];
+  while(ichannel < channel_start[ipart + 1] - 1 && r > channel_probability[ichannel]) ichannel++;
+
+  // decay vertex (exponential proper lifetime)
+  double width = particles->width[ipart];
+  double proper_time = 0.0;
+
+  if(width > 0.0) proper_time = - hbarC / width * log(1.0  -  decay_canonical(generator));
+
+  Decay_Particle vertex = parent;
+
+  vertex.t += proper_time * parent.E / M;
+  vertex.x += proper_time * parent.px / M;
+  vertex.y += proper_time * parent.py / M;
+  vertex.z += proper_time * parent.pz / M;
+
+  // product momenta in the parent rest frame
+  int first_product = product_start[ichannel];
+  int decay_products = product_start[ichannel + 1] - first_product;
+
+  double m[3];
+  double p[3][4];
+
+  for(int k = 0; k < decay_products; k++) m[k] = particles->mass[product[first_product + k]];
+
+  if(decay_products == 2)
+  {
+    double q = two_body_momentum(M, m[0], m[1]);
+
+    isotropic_momentum(q, m[0], generator, p[0]);
+
+    p[1][0] = sqrt(q * q  +  m[1] * m[1]);
+    for(int i = 1; i < 4; i++) p[1][i] = - p[0][i];
+  }
+  else
+  {
+    // uniform Dalitz distribution: invariant mass m12 of products (1,2) weighted by q(M -> m12 + m3) * q(m12 -> m1 + m2)
+    double m12_min = m[0] + m[1];
+    double m12_max = M - m[2];
+    double weight_max = two_body_momentum(M, m12_min, m[2]) * two_body_momentum(m12_max, m[0], m[1]);
+
+    double m12, weight;
+
+    do
+    {
+      m12 = m12_min  +  (m12_max - m12_min) * decay_canonical(generator);
+      weight = two_body_momentum(M, m12, m[2]) * two_body_momentum(m12, m[0], m[1]);
+    }
+    while(weight_max * decay_canonical(generator) > weight);
+
+    // M -> (12) + 3
+    double q = two_body_momentum(M, m12, m[2]);
+    double P12[4];
+
+    isotropic_momentum(q, m12, generator, P12);
+
+    p[2][0] = sqrt(q * q  +  m[2] * m[2]);
+    for(int i = 1; i < 4; i++) p[2][i] = - P12[i];
+
+    // (12) -> 1 + 2 in the rest frame of (12)
+    double q12 = two_body_momentum(m12, m[0], m[1]);
+
+    isotropic_momentum(q12, m[0], generator, p[0]);
+
+    p[1][0] = sqrt(q12 * q12  +  m[1] * m[1]);
+    for(int i = 1; i < 4; i++) p[1][i] = - p[0][i];
+
+    boost_from_rest_frame(p[0], P12, m12);
+    boost_from_rest_frame(p[1], P12, m12);
+  }
+
+  double Pmu[4] = {parent.E, parent.px, parent.py, parent.pz};
+
+  for(int k = 0; k < decay_products; k++)
+  {
+    boost_from_rest_frame(p[k], Pmu, M);
+
+    Decay_Particle daughter = vertex;
+
+    daughter.ipart = product[first_product + k];
+    daughter.E = p[k][0];
+    daughter.px = p[k][1];
+    daughter.py = p[k][2];
+    daughter.pz = p[k][3];
+
+    products.push_back(daughter);
+  }
+}
+
+
+void Hadron_Decayer::decay_event(vector<Compact_Particle> & event, long event_index, const vector<double> & chosen_mass) const
+{
+  // random number stream of the event (independent of the thread and the other events)
+  seed_seq event_seed = {(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)event_index, (uint32_t)((uint64_t)event_index >> 32), (uint32_t)50000};
+  default_random_engine generator(event_seed);
+
+  vector<Compact_Particle> decayed;
+  vector<Decay_Particle> cascade;
+
+  decayed.reserve(event.size());
+
+  for(const Compact_Particle & particle : event)
+  {
+    int ipart = species_particle[particle.chosen_index];
+
+    if(output_index[ipart] != -1)
+    {
+      decayed.push_back(particle);
+      continue;
+    }
+
+    double mass = chosen_mass[particle.chosen_index];
+
+    cascade.push_back({ipart, particle.t(), particle.x, particle.y, particle.z(), particle.E(mass), particle.px, particle.py, particle.pz});
+
+    while(!cascade.empty())
+    {
+      Decay_Particle parent = cascade.back();
+      cascade.pop_back();
+
+      if(output_index[parent.ipart] == -1)
+      {
+        decay(parent, generator, cascade);
+        continue;
+      }
+
+      // stable descendant
+      Compact_Particle daughter;
+
+      daughter.chosen_index = output_index[parent.ipart];
+      daughter.tau = sqrt(fabs(parent.t * parent.t  -  parent.z * parent.z));
+      daughter.x = parent.x;
+      daughter.y = parent.y;
+      daughter.eta = 0.5 * log((parent.t + parent.z) / (parent.t - parent.z));
+      daughter.px = parent.px;
+      daughter.py = parent.py;
+      daughter.pz = parent.pz;
+
+      decayed.push_back(daughter);
+    }
+  }
+
+  event.swap(decayed);
+}
@@ -0,0 +1,59 @@
+
+#ifndef HADRONDECAYS_H
+#define HADRONDECAYS_H
+
+#include <vector>
+#include <random>
+#include <stdint.h>
+#include "ParticleTable.h"
+#include "SampledParticle.h"
+
+using namespace std;
+
+
+// Monte Carlo strong decays of the sampled hadrons (decay_sampled_hadrons = 1)
+//
+// unstable hadrons are replaced by their stable descendants: a decay channel is chosen from the PDG branching ratios
+// (2 and 3-body channels that are open at the pole masses, renormalized), the products get isotropic 2-body or
+// uniform Dalitz 3-body momenta in the parent rest frame and are created at the decay vertex (exponential proper
+// lifetime hbarC / width). products that decay again are processed until only stable hadrons are left
+//
+// decay products that aren't chosen particles are appended to the chosen mass / mcid / charge tables, so the
+// compact sampled particles can refer to them (chosen index >= number of chosen particles)
+
+typedef struct
+{
+  int ipart;                                // PDG index
+  double t, x, y, z;                        // position (fm)
+  double E, px, py, pz;                     // momentum (GeV)
+} Decay_Particle;
+
+
+class Hadron_Decayer
+{
+  private:
+    const Particle_Table * particles;
+
+    vector<int> output_index;               // compact chosen index of each PDG particle in the decayed lists (-1 = decays)
+    vector<int> species_particle;           // PDG index of each compact chosen index
+    vector<int> channel_start;              // open decay channels of each PDG particle [size + 1]
+    vector<double> channel_probability;     // cumulative branching ratio (renormalized over the open channels)
+    vector<int> product_start;              // products of each open channel [channels + 1]
+    vector<int> product;                    // PDG index of the decay products
+
+    uint64_t seed;                          // sampler seed (each event gets its own random number stream)
+
+    void decay(const Decay_Particle & parent, default_random_engine & generator, vector<Decay_Particle> & products) const;
+
+  public:
+    int unstable_species;                   // species that decay
+    int added_species;                      // decay products appended to the chosen particle tables
+    int closed_channels;                    // > 3-body channels, missing products or closed at the pole masses
+
+    Hadron_Decayer(const Particle_Table * particles_in, const int * chosen_particles_sampling_table, int number_of_chosen_particles, vector<double> & chosen_mass, vector<int> & chosen_mcid, vector<int> & chosen_charge, uint64_t seed_in);
+
+    // replace the unstable hadrons of an event by their stable decay products (reproducible for a given event index)
+    void decay_event(vector<Compact_Particle> & event, long event_index, const vector<double> & chosen_mass) const;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <cmath>
 #include <iomanip>
 #include <vector>
+#include <complex>
 #include <stdio.h>
 #include <random>
 #include <algorithm>
@@ -90,9 +91,47 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
     }
   }
 
+  // df coefficients of all cells (batch interpolation)
+  Deltaf_Coefficient_Columns df_columns;
+
+  double * muB_df = (INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF) ? muB_fo : NULL;
+  double * bulkPi_df = INCLUDE_BULK_DELTAF ? bulkPi_fo : NULL;
+
+  // only the cells with u.dsigma > 0 (the others are skipped by the kernel)
+  vector<char> emitting(FO_length);
+
+  for(long icell = 0; icell < FO_length; icell++)
+  {
+    double tau2 = tau_fo[icell] * tau_fo[icell];
+    double ux = ux_fo[icell];
+    double uy = uy_fo[icell];
+    double un = un_fo[icell];
+    double utperp = sqrt(1.0  +  ux * ux  +  uy * uy);
+    double ut = sqrt(utperp * utperp  +  tau2 * un * un);
+
+    emitting[icell] = (ut * dat_fo[icell]  +  ux * dax_fo[icell]  +  uy * day_fo[icell]  +  un * dan_fo[icell] > 0.0);
+  }
+
+  df_data->evaluate_df_coefficients(FO_length, T_fo, muB_df, E_fo, P_fo, bulkPi_df, emitting.data(), df_columns);
+
   //declare a huge array of size CORES * npart * pT_tab_length * phi_tab_length * y_tab_length to hold spectra for each chunk
   long npart = (long)number_of_chosen_particles;
-  double *dN_pTdpTdphidy_all = (double*)calloc(CORES * npart * pT_tab_length * phi_tab_length * y_tab_length, sizeof(double));
+  double *dN_pTdpTdphidy_all = NULL;
+
+  // or CORES * npart * pT_tab_length * y_tab_length * (2.K_MAX + 1) to hold the phip Fourier harmonics (spectra_harmonics = 1)
+  const int harmonics = 2 * K_MAX + 1;
+  vector<double> phip_harmonics;
+  double *harmonics_all = NULL;
+
+  if(SPECTRA_HARMONICS)
+  {
+    set_phip_harmonic_weights(phip_harmonics);
+    harmonics_all = (double*)calloc(CORES * harmonics * npart * pT_tab_length * y_tab_length, sizeof(double));
+  }
+  else
+  {
+    dN_pTdpTdphidy_all = (double*)calloc(CORES * npart * pT_tab_length * phi_tab_length * y_tab_length, sizeof(double));
+  }
 
   // subdivide bite size chunks of freezeout surface across cores
   #pragma omp parallel for
@@ -106,6 +145,20 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
 
       long icell_glb = n  +  icell * CORES;
 
+      if(polzn_sweep != NULL)   // spin polarization in the same surface sweep (mode = 5)
+      {
+        add_spin_polzn_cell(n, icell_glb, Mass, Sign, tau_fo, eta_fo, ux_fo, uy_fo, un_fo, dat_fo, dax_fo, day_fo, dan_fo);
+      }
+
+      double x_pos = 0.0;                     // transverse position (femtoscopy moments)
+      double y_pos = 0.0;
+
+      if(femto_sweep != NULL)
+      {
+        x_pos = femto_sweep->x[icell_glb];
+        y_pos = femto_sweep->y[icell_glb];
+      }
+
       double tau = tau_fo[icell_glb];         // longitudinal proper time
       double tau2 = tau * tau;
       if(DIMENSION == 3)
@@ -194,7 +247,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
 
 
       // set df coefficients
-      deltaf_coefficients df = df_data->evaluate_df_coefficients(T, muB, E, P, bulkPi);
+      deltaf_coefficients df = df_columns.get(icell_glb);
 
       double c0 = df.c0;             // 14 moment coefficients
       double c1 = df.c1;
@@ -290,6 +343,9 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
             double Vx_px = Vx * px;
             double Vy_py = Vy * py;
 
+            double x_out = x_pos * cosphiValues[iphip]  +  y_pos * sinphiValues[iphip];    // (out, side) position
+            double x_side = y_pos * cosphiValues[iphip]  -  x_pos * sinphiValues[iphip];
+
             for(long iy = 0; iy < y_tab_length; iy++)
             {
               long iS3D = iy + iS2D;
@@ -297,6 +353,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
               double y = yValues[iy];
 
               double eta_integral = 0.0;
+              double eta_moments[5] = {0.0, 0.0, 0.0, 0.0, 0.0};   // eta integrals of the (t, z, t^2, z^2, t.z) moments
 
               // sum over eta
               for(long ieta = 0; ieta < eta_tab_length; ieta++)
@@ -358,11 +415,40 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
 
                 double f = feq * (1.0 + df);
 
-                eta_integral += eta_weight * pdotdsigma * f;
+                double weight = eta_weight * pdotdsigma * f;
+
+                eta_integral += weight;
+
+                if(femto_sweep != NULL)
+                {
+                  double t = tau * coshyeta;            // LCMS time and longitudinal position
+                  double z = - tau * sinhyeta;
+
+                  eta_moments[0] += weight * t;
+                  eta_moments[1] += weight * z;
+                  eta_moments[2] += weight * t * t;
+                  eta_moments[3] += weight * z * z;
+                  eta_moments[4] += weight * t * z;
+                }
 
               } // ieta
 
-              dN_pTdpTdphidy_all[n  +  CORES * iS3D] += (prefactor * degeneracy * eta_integral);
+              if(harmonics_all != NULL)
+              {
+                double * Vn = harmonics_all  +  harmonics * (iy  +  y_tab_length * (ipT  +  pT_tab_length * (ipart  +  npart * n)));
+                const double * phip_weights = phip_harmonics.data()  +  harmonics * iphip;
+
+                for(int ih = 0; ih < harmonics; ih++) Vn[ih] += phip_weights[ih] * (prefactor * degeneracy * eta_integral);
+              }
+              else
+              {
+                dN_pTdpTdphidy_all[n  +  CORES * iS3D] += (prefactor * degeneracy * eta_integral);
+              }
+
+              if(femto_sweep != NULL)
+              {
+                add_femtoscopy_moments(n, iS3D, prefactor * degeneracy, eta_integral, x_out, x_side, eta_moments);
+              }
 
             } // rapidity points (iy)
 
@@ -380,35 +466,43 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
 
 
   // now perform the reduction over cores
-  #pragma omp parallel for collapse(4)
-  for(long ipart = 0; ipart < npart; ipart++)
+  if(harmonics_all != NULL)
   {
-    for(long ipT = 0; ipT < pT_tab_length; ipT++)
+    reduce_spectra_harmonics(harmonics_all);
+    free(harmonics_all);
+  }
+  else
+  {
+    #pragma omp parallel for collapse(4)
+    for(long ipart = 0; ipart < npart; ipart++)
     {
-      for(long iphip = 0; iphip < phi_tab_length; iphip++)
+      for(long ipT = 0; ipT < pT_tab_length; ipT++)
       {
-        for(long iy = 0; iy < y_tab_length; iy++)
+        for(long iphip = 0; iphip < phi_tab_length; iphip++)
         {
-          long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
+          for(long iy = 0; iy < y_tab_length; iy++)
+          {
+            long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
 
-          double dN_pTdpTdphidy_tmp = 0.0; // reduction variable
+            double dN_pTdpTdphidy_tmp = 0.0; // reduction variable
 
-          #pragma omp simd reduction(+:dN_pTdpTdphidy_tmp)
-          for(long n = 0; n < CORES; n++)
-          {
-            dN_pTdpTdphidy_tmp += dN_pTdpTdphidy_all[n  +  CORES * iS3D];
+            #pragma omp simd reduction(+:dN_pTdpTdphidy_tmp)
+            for(long n = 0; n < CORES; n++)
+            {
+              dN_pTdpTdphidy_tmp += dN_pTdpTdphidy_all[n  +  CORES * iS3D];
 
-          } // sum over the cores
+            } // sum over the cores
 
-          dN_pTdpTdphidy[iS3D] = dN_pTdpTdphidy_tmp;
+            dN_pTdpTdphidy[iS3D] = dN_pTdpTdphidy_tmp;
 
-        } // rapidity points (iy)
+          } // rapidity points (iy)
 
-      } // azimuthal angle points (iphip)
+        } // azimuthal angle points (iphip)
 
-    } // transverse momentum points (ipT)
+      } // transverse momentum points (ipT)
 
-  } // particle species (ipart)
+    } // particle species (ipart)
+  }
 
   // free memory
   free(dN_pTdpTdphidy_all);
@@ -485,14 +579,32 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
   const int pbar_pts = laguerre->points;
 
   double * pbar_root1 = laguerre->root[1];
-  double * pbar_root2 = laguerre->root[2];
 
   double * pbar_weight1 = laguerre->weight[1];
-  double * pbar_weight2 = laguerre->weight[2];
+
+  // weighted roots of the feq moments in the feqmod renormalization (df_mode = 3), computed once instead of per cell and hadron
+  const int renorm_moments = neq_moment | J10_moment | J20_moment;
+  vector<double> renorm_weight_exp(3 * pbar_pts);
+  GaussThermal_weight_exp(renorm_moments, laguerre->root, laguerre->weight, pbar_pts, renorm_weight_exp.data());
 
   //declare a huge array of size CORES * npart * pT_tab_length * phi_tab_length * y_tab_length to hold spectra for each chunk
   long npart = (long)number_of_chosen_particles;
-  double *dN_pTdpTdphidy_all = (double*)calloc(CORES * npart * pT_tab_length * phi_tab_length * y_tab_length, sizeof(double));
+  double *dN_pTdpTdphidy_all = NULL;
+
+  // or CORES * npart * pT_tab_length * y_tab_length * (2.K_MAX + 1) to hold the phip Fourier harmonics (spectra_harmonics = 1)
+  const int harmonics = 2 * K_MAX + 1;
+  vector<double> phip_harmonics;
+  double *harmonics_all = NULL;
+
+  if(SPECTRA_HARMONICS)
+  {
+    set_phip_harmonic_weights(phip_harmonics);
+    harmonics_all = (double*)calloc(CORES * harmonics * npart * pT_tab_length * y_tab_length, sizeof(double));
+  }
+  else
+  {
+    dN_pTdpTdphidy_all = (double*)calloc(CORES * npart * pT_tab_length * phi_tab_length * y_tab_length, sizeof(double));
+  }
 
 
   // subdivide bite size chunks of freezeout surface across cores
@@ -513,6 +625,20 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
 
       long icell_glb = n  +  icell * CORES;
 
+      if(polzn_sweep != NULL)   // spin polarization in the same surface sweep (mode = 5)
+      {
+        add_spin_polzn_cell(n, icell_glb, Mass, Sign, tau_fo, eta_fo, ux_fo, uy_fo, un_fo, dat_fo, dax_fo, day_fo, dan_fo);
+      }
+
+      double x_pos = 0.0;                     // transverse position (femtoscopy moments)
+      double y_pos = 0.0;
+
+      if(femto_sweep != NULL)
+      {
+        x_pos = femto_sweep->x[icell_glb];
+        y_pos = femto_sweep->y[icell_glb];
+      }
+
       double tau = tau_fo[icell_glb];     // longitudinal proper time
       double tau2 = tau * tau;
       if(DIMENSION == 3)
@@ -797,11 +923,13 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
             double mbar = mass / T;
             double mbar_mod = mass / T_mod;
 
-            double neq = neq_fact * degeneracy * GaussThermal(neq_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
+            Thermal_Moments thermal = GaussThermal_moments_weighted(renorm_moments, laguerre->root, renorm_weight_exp.data(), pbar_pts, mbar, alphaB, baryon, sign);
+
+            double neq = neq_fact * degeneracy * thermal.neq;
 
-            double N10 = baryon * N10_fact * degeneracy * GaussThermal(J10_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
+            double N10 = baryon * N10_fact * degeneracy * thermal.J10;
 
-            double J20 = J20_fact * degeneracy * GaussThermal(J20_int, pbar_root2, pbar_weight2, pbar_pts, mbar, alphaB, baryon, sign);
+            double J20 = J20_fact * degeneracy * thermal.J20;
 
             double n_linear = neq  +  dn_fact * (neq  +  N10 * G  +  J20 * F / T / T);
 
@@ -846,6 +974,9 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
             double px = pT * cosphiValues[iphip]; // p^x
             double py = pT * sinphiValues[iphip]; // p^y
 
+            double x_out = x_pos * cosphiValues[iphip]  +  y_pos * sinphiValues[iphip];    // (out, side) position
+            double x_side = y_pos * cosphiValues[iphip]  -  x_pos * sinphiValues[iphip];
+
             for(long iy = 0; iy < y_tab_length; iy++)
             {
               long iS3D = iy + iS2D;
@@ -853,6 +984,7 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
               double y = yValues[iy];
 
               double eta_integral = 0.0;  // Cooper Frye integral over eta
+              double eta_moments[5] = {0.0, 0.0, 0.0, 0.0, 0.0};   // eta integrals of the (t, z, t^2, z^2, t.z) moments
 
               // integrate over eta
               for(long ieta = 0; ieta < eta_tab_length; ieta++)
@@ -981,9 +1113,37 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
 
                 eta_integral += (pdotdsigma * f); // add contribution to integral
 
+                if(femto_sweep != NULL)
+                {
+                  double weight = pdotdsigma * f;
+                  double t = tau * cosh(eta - y);       // LCMS time and longitudinal position
+                  double z = tau * sinh(eta - y);
+
+                  eta_moments[0] += weight * t;
+                  eta_moments[1] += weight * z;
+                  eta_moments[2] += weight * t * t;
+                  eta_moments[3] += weight * z * z;
+                  eta_moments[4] += weight * t * z;
+                }
+
               } // eta points (ieta)
 
-              dN_pTdpTdphidy_all[n  +  CORES * iS3D] += (prefactor * degeneracy * eta_integral);
+              if(harmonics_all != NULL)
+              {
+                double * Vn = harmonics_all  +  harmonics * (iy  +  y_tab_length * (ipT  +  pT_tab_length * (ipart  +  npart * n)));
+                const double * phip_weights = phip_harmonics.data()  +  harmonics * iphip;
+
+                for(int ih = 0; ih < harmonics; ih++) Vn[ih] += phip_weights[ih] * (prefactor * degeneracy * eta_integral);
+              }
+              else
+              {
+                dN_pTdpTdphidy_all[n  +  CORES * iS3D] += (prefactor * degeneracy * eta_integral);
+              }
+
+              if(femto_sweep != NULL)
+              {
+                add_femtoscopy_moments(n, iS3D, prefactor * degeneracy, eta_integral, x_out, x_side, eta_moments);
+              }
 
             } // rapidity points (iy)
 
@@ -1005,35 +1165,43 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_feqmod(double *Mass, double
 
 
   // now perform the reduction over cores
-  #pragma omp parallel for collapse(4)
-  for(long ipart = 0; ipart < npart; ipart++)
+  if(harmonics_all != NULL)
   {
-    for(long ipT = 0; ipT < pT_tab_length; ipT++)
+    reduce_spectra_harmonics(harmonics_all);
+    free(harmonics_all);
+  }
+  else
+  {
+    #pragma omp parallel for collapse(4)
+    for(long ipart = 0; ipart < npart; ipart++)
     {
-      for(long iphip = 0; iphip < phi_tab_length; iphip++)
+      for(long ipT = 0; ipT < pT_tab_length; ipT++)
       {
-        for(long iy = 0; iy < y_tab_length; iy++)
+        for(long iphip = 0; iphip < phi_tab_length; iphip++)
         {
-          long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
+          for(long iy = 0; iy < y_tab_length; iy++)
+          {
+            long iS3D = iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart));
 
-          double dN_pTdpTdphidy_tmp = 0.0; // reduction variable
+            double dN_pTdpTdphidy_tmp = 0.0; // reduction variable
 
-          #pragma omp simd reduction(+:dN_pTdpTdphidy_tmp)
-          for(long n = 0; n < CORES; n++)
-          {
-            dN_pTdpTdphidy_tmp += dN_pTdpTdphidy_all[n  +  CORES * iS3D];
+            #pragma omp simd reduction(+:dN_pTdpTdphidy_tmp)
+            for(long n = 0; n < CORES; n++)
+            {
+              dN_pTdpTdphidy_tmp += dN_pTdpTdphidy_all[n  +  CORES * iS3D];
 
-          } // sum over the cores
+            } // sum over the cores
 
-          dN_pTdpTdphidy[iS3D] = dN_pTdpTdphidy_tmp;
+            dN_pTdpTdphidy[iS3D] = dN_pTdpTdphidy_tmp;
 
-        } // rapidity points (iy)
+          } // rapidity points (iy)
 
-      } // azimuthal angle points (iphip)
+        } // azimuthal angle points (iphip)
 
-    } // transverse momentum points (ipT)
+      } // transverse momentum points (ipT)
 
-  } // particle species (ipart)
+    } // particle species (ipart)
+  }
 
 
   printf("\nfeqmod breaks down for %ld / %ld cells until t = %.3f fm/c\n", breakdown, FO_length, tau_breakdown);
@@ -1683,4 +1851,201 @@ void EmissionFunctionArray::calculate_dN_pTdpTdphidy_famod(double *Mass, double
 
 
 
+void EmissionFunctionArray::set_phip_harmonic_weights(vector<double> & phip_harmonics)
+{
+  // phip quadrature weights times (1, cos(k.phip), sin(k.phip)) for k = 1, ..., K_MAX [ih + (2.K_MAX + 1) * iphip]
+  // (Chebyshev recurrence from cos(phip) and sin(phip))
+  const int harmonics = 2 * K_MAX + 1;
+
+  phip_harmonics.assign(harmonics * phi_tab_length, 0.0);
+
+  for(long iphip = 0; iphip < phi_tab_length; iphip++)
+  {
+    double phip = phi_tab->get(1, iphip + 1);
+    double phip_weight = phi_tab->get(2, iphip + 1);
+
+    double cos1 = cos(phip);
+    double sin1 = sin(phip);
+
+    double cosk_prev = 1.0;     // cos((k-1).phip), sin((k-1).phip)
+    double sink_prev = 0.0;
+    double cosk = cos1;         // cos(k.phip), sin(k.phip)
+    double sink = sin1;
+
+    double * weights = phip_harmonics.data()  +  harmonics * iphip;
+
+    weights[0] = phip_weight;
+
+    for(int k = 1; k <= K_MAX; k++)
+    {
+      weights[2*k - 1] = phip_weight * cosk;
+      weights[2*k] = phip_weight * sink;
+
+      double cosk_next = 2.0 * cos1 * cosk  -  cosk_prev;
+      double sink_next = 2.0 * cos1 * sink  -  sink_prev;
+
+      cosk_prev = cosk;
+      sink_prev = sink;
+      cosk = cosk_next;
+      sink = sink_next;
+    }
+  }
+}
+
+
+void EmissionFunctionArray::reduce_spectra_harmonics(const double * harmonics_all)
+{
+  // sum the per-core harmonics [ih + (2.K_MAX + 1) * (iy + y_tab_length * (ipT + pT_tab_length * (ipart + npart * n)))]
+  long length = (2 * K_MAX + 1) * number_of_chosen_particles * pT_tab_length * y_tab_length;
+
+  #pragma omp parallel for
+  for(long i = 0; i < length; i++)
+  {
+    double dN_harmonics_tmp = 0.0;
+
+    for(long n = 0; n < CORES; n++)
+    {
+      dN_harmonics_tmp += harmonics_all[i  +  length * n];
+    }
+
+    dN_harmonics[i] = dN_harmonics_tmp;
+  }
+}
+
+
+
+void EmissionFunctionArray::set_momentum_grid()
+{
+  pT_values.resize(pT_tab_length);
+  pT_weights.resize(pT_tab_length);
+  phip_values.resize(phi_tab_length);
+  phip_weights.resize(phi_tab_length);
+  y_values.assign(y_tab_length, 0.0);     // y = 0 for 2+1d
+
+  for(long ipT = 0; ipT < pT_tab_length; ipT++)
+  {
+    pT_values[ipT] = pT_tab->get(1, ipT + 1);
+    pT_weights[ipT] = pT_tab->get(2, ipT + 1);
+  }
+  for(long iphip = 0; iphip < phi_tab_length; iphip++)
+  {
+    phip_values[iphip] = phi_tab->get(1, iphip + 1);
+    phip_weights[iphip] = phi_tab->get(2, iphip + 1);
+  }
+  if(DIMENSION == 3)
+  {
+    for(long iy = 0; iy < y_tab_length; iy++) y_values[iy] = y_tab->get(1, iy + 1);
+  }
+}
+
+
+void EmissionFunctionArray::reduce_continuous_spectra()
+{
+  // project the continuous spectra of each species onto dN_2pipTdpTdy, dN_dphidy, dN_dy and vn in a single pass
+  // over its (y, phip, pT) grid (parallel over species). with spectra_harmonics = 1 the projections come from the
+  // phip harmonics (no dN_dphidy)
+  set_momentum_grid();
+
+  const int harmonics = 2 * K_MAX + 1;
+  const complex<double> I(0.0, 1.0);
+
+  // cos and sin(k.phip) of the phip grid [k - 1 + K_MAX * iphip]
+  vector<double> cos_kphip(K_MAX * phi_tab_length);
+  vector<double> sin_kphip(K_MAX * phi_tab_length);
+
+  for(long iphip = 0; iphip < phi_tab_length; iphip++)
+  {
+    for(int k = 0; k < K_MAX; k++)
+    {
+      cos_kphip[k  +  K_MAX * iphip] = cos(((double)k + 1.0) * phip_values[iphip]);
+      sin_kphip[k  +  K_MAX * iphip] = sin(((double)k + 1.0) * phip_values[iphip]);
+    }
+  }
+
+  long npart = number_of_chosen_particles;
+
+  continuous_observables.resize(npart);
+
+  #pragma omp parallel for schedule(dynamic)
+  for(long ipart = 0; ipart < npart; ipart++)
+  {
+    Continuous_Observables & observables = continuous_observables[ipart];
+
+    observables.dN_2pipTdpTdy.assign(pT_tab_length * y_tab_length, 0.0);
+    observables.dN_dphidy.assign(SPECTRA_HARMONICS ? 0 : phi_tab_length * y_tab_length, 0.0);
+    observables.dN_dy.assign(y_tab_length, 0.0);
+    observables.vn.assign(K_MAX * pT_tab_length * y_tab_length, 0.0);
+
+    vector<double> Vn_real(K_MAX * pT_tab_length);      // vn numerators and denominator of each pT
+    vector<double> Vn_imag(K_MAX * pT_tab_length);
+    vector<double> vn_denominator(pT_tab_length);
+
+    for(long iy = 0; iy < y_tab_length; iy++)
+    {
+      double dN_dy = 0.0;
+
+      if(SPECTRA_HARMONICS)
+      {
+        for(long ipT = 0; ipT < pT_tab_length; ipT++)
+        {
+          const double * Vn = dN_harmonics  +  harmonics * (iy  +  y_tab_length * (ipT  +  pT_tab_length * ipart));
+
+          vn_denominator[ipT] = Vn[0];
+          observables.dN_2pipTdpTdy[ipT  +  pT_tab_length * iy] = Vn[0] / two_pi;
+
+          for(int k = 0; k < K_MAX; k++)
+          {
+            Vn_real[k  +  K_MAX * ipT] = Vn[2*k + 1];
+            Vn_imag[k  +  K_MAX * ipT] = Vn[2*k + 2];
+          }
+
+          dN_dy += pT_weights[ipT] * Vn[0];
+        }
+      }
+      else
+      {
+        fill(Vn_real.begin(), Vn_real.end(), 0.0);
+        fill(Vn_imag.begin(), Vn_imag.end(), 0.0);
+        fill(vn_denominator.begin(), vn_denominator.end(), 0.0);
+
+        for(long iphip = 0; iphip < phi_tab_length; iphip++)
+        {
+          double phip_weight = phip_weights[iphip];
+          double dN_dphidy = 0.0;
 
+          for(long ipT = 0; ipT < pT_tab_length; ipT++)
+          {
+            double dN = dN_pTdpTdphidy[iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * ipart))];
+
+            dN_dphidy += pT_weights[ipT] * dN;
+            dN_dy += phip_weight * pT_weights[ipT] * dN;
+
+            for(int k = 0; k < K_MAX; k++)
+            {
+              Vn_real[k  +  K_MAX * ipT] += cos_kphip[k  +  K_MAX * iphip] * phip_weight * dN;
+              Vn_imag[k  +  K_MAX * ipT] += sin_kphip[k  +  K_MAX * iphip] * phip_weight * dN;
+            }
+            vn_denominator[ipT] += phip_weight * dN;
+            observables.dN_2pipTdpTdy[ipT  +  pT_tab_length * iy] += phip_weight * dN / two_pi;
+          }
+
+          observables.dN_dphidy[iphip  +  phi_tab_length * iy] = dN_dphidy;
+        }
+      }
+
+      for(long ipT = 0; ipT < pT_tab_length; ipT++)
+      {
+        for(int k = 0; k < K_MAX; k++)
+        {
+          double vn = abs(Vn_real[k  +  K_MAX * ipT]  +  I * Vn_imag[k  +  K_MAX * ipT]) / vn_denominator[ipT];
+
+          if(vn_denominator[ipT] < 1.e-15) vn = 0.0;
+
+          observables.vn[k  +  K_MAX * (ipT  +  pT_tab_length * iy)] = vn;
+        }
+      }
+
+      observables.dN_dy[iy] = dN_dy;
+    }
+  }
+}
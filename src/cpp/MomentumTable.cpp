@@ -0,0 +1,222 @@
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "MomentumTable.h"
+
+using namespace std;
+
+
+Momentum_Table::Momentum_Table(int npart_in, double * Mass, double * Sign, double T_min_in, double T_max_in, int T_bins_in, int points_in)
+{
+  npart = npart_in;
+  T_bins = T_bins_in;
+  points = points_in;
+
+  if(T_bins < 2 || points < 2)
+  {
+    printf("Momentum_Table error: need momentum_table_T_bins >= 2 and momentum_table_points >= 2\n");
+    exit(-1);
+  }
+
+  T_min = T_min_in;
+  T_max = T_max_in;
+  dT = (T_max - T_min) / ((double)T_bins - 1.0);
+  du = 1.0 / (double)points;
+
+  if(dT <= 0.0)
+  {
+    printf("Momentum_Table error: T_max = %lf must be greater than T_min = %lf\n", T_max, T_min);
+    exit(-1);
+  }
+
+  mass = (double *)calloc(npart, sizeof(double));
+  sign = (double *)calloc(npart, sizeof(double));
+
+  for(int ipart = 0; ipart < npart; ipart++)
+  {
+    mass[ipart] = Mass[ipart];
+    sign[ipart] = Sign[ipart];
+  }
+
+  pbar_table = (double *)calloc((long)npart * T_bins * points, sizeof(double));
+}
+
+
+Momentum_Table::~Momentum_Table()
+{
+  free(mass);
+  free(sign);
+  free(pbar_table);
+}
+
+
+void Momentum_Table::compute_inverse_cdf(double mbar, double sign, double * pbar_quantile)
+{
+  // cumulative distribution of pbar^2 / (exp(Ebar) + sign) on a fine grid
+  // cut off where the kinetic energy (Ebar - mbar) = 50 (tail ~ e^-50)
+  const long fine_pts = 16 * (long)points;
+  const double pbar_max = sqrt((mbar + 50.0) * (mbar + 50.0)  -  mbar * mbar);
+  const double dpbar = pbar_max / (double)fine_pts;
+
+  double * cdf = (double *)calloc(fine_pts + 1, sizeof(double));
+
+  double f_prev = 0.0;                        // integrand at pbar = 0
+
+  for(long k = 1; k <= fine_pts; k++)
+  {
+    double pbar = k * dpbar;
+    double Ebar = sqrt(pbar * pbar  +  mbar * mbar);
+    double f = pbar * pbar / (exp(Ebar) + sign);
+
+    cdf[k] = cdf[k - 1]  +  0.5 * dpbar * (f_prev + f);   // trapezoid rule
+    f_prev = f;
+  }
+
+  double norm = cdf[fine_pts];
+
+  // invert the cdf at the quantile nodes u = iu * du
+  long k = 0;
+
+  for(int iu = 0; iu < points; iu++)
+  {
+    double target = iu * du * norm;
+
+    while(k < fine_pts - 1 && cdf[k + 1] < target) k++;
+
+    double dcdf = cdf[k + 1] - cdf[k];
+    double x = (dcdf > 0.0) ? (target - cdf[k]) / dcdf : 0.0;
+
+    pbar_quantile[iu] = (k + x) * dpbar;
+  }
+
+  free(cdf);
+}
+
+
+void Momentum_Table::build_table()
+{
+  printf("Building momentum sampling tables for %d particles and %d temperatures in [%lf, %lf] GeV...\n", npart, T_bins, T_min, T_max);
+
+  #pragma omp parallel for collapse(2)
+  for(int ipart = 0; ipart < npart; ipart++)
+  {
+    for(int iT = 0; iT < T_bins; iT++)
+    {
+      double T = T_min  +  iT * dT;
+      double mbar = mass[ipart] / T;
+
+      compute_inverse_cdf(mbar, sign[ipart], pbar_table + (long)points * (iT + T_bins * ipart));
+    }
+  }
+}
+
+
+bool Momentum_Table::read_table_from_file(string filename)
+{
+  FILE * table_file = fopen(filename.c_str(), "rb");
+
+  if(table_file == NULL) return false;
+
+  int header[3];
+  double T_range[2];
+
+  bool match = (fread(header, sizeof(int), 3, table_file) == 3) && (fread(T_range, sizeof(double), 2, table_file) == 2);
+
+  match = match && (header[0] == npart) && (header[1] == T_bins) && (header[2] == points);
+  match = match && (T_range[0] == T_min) && (T_range[1] == T_max);
+
+  // check the table was made for the same particles
+  for(int ipart = 0; ipart < npart && match; ipart++)
+  {
+    double mass_sign[2];
+
+    match = (fread(mass_sign, sizeof(double), 2, table_file) == 2) && (mass_sign[0] == mass[ipart]) && (mass_sign[1] == sign[ipart]);
+  }
+
+  long table_length = (long)npart * T_bins * points;
+
+  match = match && ((long)fread(pbar_table, sizeof(double), table_length, table_file) == table_length);
+
+  fclose(table_file);
+
+  if(match) printf("Read momentum sampling tables from %s\n", filename.c_str());
+  else printf("Momentum sampling tables in %s are out of date\n", filename.c_str());
+
+  return match;
+}
+
+
+void Momentum_Table::write_table_to_file(string filename)
+{
+  FILE * table_file = fopen(filename.c_str(), "wb");
+
+  if(table_file == NULL)
+  {
+    printf("Momentum_Table warning: could not write %s\n", filename.c_str());
+    return;
+  }
+
+  int header[3] = {npart, T_bins, points};
+  double T_range[2] = {T_min, T_max};
+
+  fwrite(header, sizeof(int), 3, table_file);
+  fwrite(T_range, sizeof(double), 2, table_file);
+
+  for(int ipart = 0; ipart < npart; ipart++)
+  {
+    double mass_sign[2] = {mass[ipart], sign[ipart]};
+    fwrite(mass_sign, sizeof(double), 2, table_file);
+  }
+
+  fwrite(pbar_table, sizeof(double), (long)npart * T_bins * points, table_file);
+
+  fclose(table_file);
+}
+
+
+bool Momentum_Table::temperature_in_range(double T)
+{
+  return (T >= T_min && T <= T_max);
+}
+
+
+double Momentum_Table::sample_pbar(int ipart, double T, double u)
+{
+  // bilinear interpolation of the quantiles pbar(u) in (u, T)
+  double s = (T - T_min) / dT;
+  int iT = max(0, min(T_bins - 2, (int)floor(s)));
+  double wT = s - (double)iT;
+
+  double x = u / du;
+  int iu = (int)floor(x);
+  double wu = x - (double)iu;
+
+  double pbar[2];
+
+  for(int i = 0; i < 2; i++)
+  {
+    const double * quantile = pbar_table + (long)points * (iT + i + T_bins * ipart);
+
+    if(iu < points - 1)
+    {
+      pbar[i] = (1.0 - wu) * quantile[iu]  +  wu * quantile[iu + 1];
+    }
+    else
+    {
+      // last quantile bin: exponential tail with the local decay rate of pbar^2.exp(-Ebar)
+      double pbar_last = quantile[points - 1];
+      double mbar = mass[ipart] / (T_min  +  (iT + i) * dT);
+      double Ebar_last = sqrt(pbar_last * pbar_last  +  mbar * mbar);
+      double rate = max(0.1, pbar_last / Ebar_last  -  2.0 / pbar_last);
+
+      pbar[i] = pbar_last  +  log(du / (1.0 - u)) / rate;
+    }
+  }
+
+  return (1.0 - wT) * pbar[0]  +  wT * pbar[1];
+}
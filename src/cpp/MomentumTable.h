@@ -0,0 +1,47 @@
+
+#ifndef MOMENTUMTABLE_H
+#define MOMENTUMTABLE_H
+
+#include <string>
+
+using namespace std;
+
+
+// tabulated inverse cumulative distributions of the LRF momentum magnitude
+// pbar = |p| / T sampled from pbar^2 / (exp(Ebar) + sign) for each (species, T node)
+// replaces the rejection loop in sample_momentum when chem = 0 and T is in the table range
+
+class Momentum_Table
+{
+  private:
+    int npart;              // number of chosen particles
+    int T_bins;             // number of temperature nodes
+    int points;             // number of quantile nodes u = [0, 1)
+
+    double T_min;           // temperature range of table (GeV)
+    double T_max;
+    double dT;
+    double du;
+
+    double * mass;          // species mass and quantum statistics sign
+    double * sign;
+
+    double * pbar_table;    // quantiles pbar(u) in flat storage [iu + points * (iT + T_bins * ipart)]
+
+    void compute_inverse_cdf(double mbar, double sign, double * pbar_quantile);
+
+  public:
+    Momentum_Table(int npart_in, double * Mass, double * Sign, double T_min_in, double T_max_in, int T_bins_in, int points_in);
+    ~Momentum_Table();
+
+    void build_table();                                 // tabulate all (species, T node) in parallel
+
+    bool read_table_from_file(string filename);         // load cached table (false if missing or stale)
+    void write_table_to_file(string filename);
+
+    bool temperature_in_range(double T);
+
+    double sample_pbar(int ipart, double T, double u);  // interpolated quantile for uniform u in [0,1)
+};
+
+#endif
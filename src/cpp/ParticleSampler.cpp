@@ -18,6 +18,8 @@
 #include "Arsenal.h"
 #include "Macros.h"
 #include "GaussThermal.h"
+#include "MomentumTable.h"
+#include "ThermalDensityTable.h"
 
 using namespace std;
 
@@ -161,8 +163,9 @@ double fast_max_particle_number(double equilibrium_density, double bulk_density,
 }
 
 
-double max_particle_number(double mbar, double degeneracy, double sign, double baryon, double T, double alphaB, double bulkPi, deltaf_coefficients df, bool feqmod_breaks_down, Gauss_Laguerre * laguerre, int df_mode, int include_baryon, double neq_fact, double J20_fact)
+double max_particle_number(double degeneracy, double baryon, double T, double bulkPi, deltaf_coefficients df, bool feqmod_breaks_down, int df_mode, int include_baryon, double neq_fact, double J20_fact, Thermal_Moments thermal)
 {
+  // thermal = (neq, J10, J20) integrals at (T, alphaB) (at alphaB = 0 for df_mode = 4 if feqmod does not break down)
   double particle_density = 0.0;
 
   switch(df_mode)
@@ -172,11 +175,7 @@ double max_particle_number(double mbar, double degeneracy, double sign, double b
     {
       linear_df:
 
-      const int laguerre_pts = laguerre->points;
-      double * pbar_root1 = laguerre->root[1];
-      double * pbar_weight1 = laguerre->weight[1];
-
-      double equilibrium_density = neq_fact * degeneracy * GaussThermal(neq_int, pbar_root1, pbar_weight1, laguerre_pts, mbar, alphaB, baryon, sign);
+      double equilibrium_density = neq_fact * degeneracy * thermal.neq;
 
       particle_density = 2.0 * equilibrium_density;
 
@@ -191,19 +190,13 @@ double max_particle_number(double mbar, double degeneracy, double sign, double b
       double betabulk = df.betabulk;
 
       // compute the linearized density
-      const int laguerre_pts = laguerre->points;
-      double * pbar_root1 = laguerre->root[1];
-      double * pbar_root2 = laguerre->root[2];
-      double * pbar_weight1 = laguerre->weight[1];
-      double * pbar_weight2 = laguerre->weight[2];
-
-      double equilibrium_density = neq_fact * degeneracy * GaussThermal(neq_int, pbar_root1, pbar_weight1, laguerre_pts, mbar, alphaB, baryon, sign);
+      double equilibrium_density = neq_fact * degeneracy * thermal.neq;
       double J10 = 0.0;
       if(include_baryon)
       {
-        J10 = neq_fact * degeneracy * GaussThermal(J10_int, pbar_root1, pbar_weight1, laguerre_pts, mbar, alphaB, baryon, sign);
+        J10 = neq_fact * degeneracy * thermal.J10;
       }
-      double J20 = J20_fact * degeneracy * GaussThermal(J20_int, pbar_root2, pbar_weight2, laguerre_pts, mbar, alphaB, baryon, sign);
+      double J20 = J20_fact * degeneracy * thermal.J20;
       double bulk_density = (equilibrium_density + (baryon * J10 * G) + (J20 * F / T / T)) / betabulk;
 
       particle_density = equilibrium_density  +  bulkPi * bulk_density;
@@ -216,11 +209,7 @@ double max_particle_number(double mbar, double degeneracy, double sign, double b
 
       double z = df.z;
 
-      const int laguerre_pts = laguerre->points;
-      double * pbar_root1 = laguerre->root[1];
-      double * pbar_weight1 = laguerre->weight[1];
-
-      double equilibrium_density = neq_fact * degeneracy * GaussThermal(neq_int, pbar_root1, pbar_weight1, laguerre_pts, mbar, 0.0, 0.0, sign);
+      double equilibrium_density = neq_fact * degeneracy * thermal.neq;
 
       particle_density = z * equilibrium_density;
 
@@ -404,6 +393,41 @@ LRF_Momentum sample_momentum(default_random_engine& generator, long * acceptance
 
 }
 
+LRF_Momentum sample_momentum_tabulated(default_random_engine& generator, long * acceptances, long * samples, Momentum_Table * momentum_table, int ipart, double mass, double sign, double T, double chem)
+{
+  // sample the local rest frame momentum by interpolating the tabulated inverse cdf of pbar
+  // (no rejection); fall back to sample_momentum if no table, chem != 0 or T outside the table
+
+  if(momentum_table == NULL || chem != 0.0 || !momentum_table->temperature_in_range(T))
+  {
+    return sample_momentum(generator, acceptances, samples, mass, sign, T, chem);
+  }
+
+  *samples = (*samples) + 1;
+  *acceptances = (*acceptances) + 1;
+
+  double mbar = mass / T;
+
+  double pbar = momentum_table->sample_pbar(ipart, T, canonical(generator));
+  double Ebar = sqrt(pbar * pbar  +  mbar * mbar);
+
+  double phi = two_pi * canonical(generator);
+  double costheta = 2.0 * canonical(generator) - 1.0;
+  double sintheta = sqrt(1.0  -  costheta * costheta);
+
+  double p = pbar * T;
+
+  LRF_Momentum pLRF;
+
+  pLRF.E = Ebar * T;
+  pLRF.px = p * sintheta * cos(phi);
+  pLRF.py = p * sintheta * sin(phi);
+  pLRF.pz = p * costheta;
+  pLRF.feq = 1.0 / (exp(Ebar) + sign);
+
+  return pLRF;
+}
+
 LRF_Momentum rescale_momentum(LRF_Momentum pLRF_mod, double mass_squared, double baryon, double pixx, double pixy, double pixz, double piyy, double piyz, double pizz, double Vx, double Vy, double Vz, double shear_mod, double isotropic_scale, double diff_mod, double baryon_enthalpy_ratio)
 {
     double E = pLRF_mod.E;
@@ -444,16 +468,232 @@ LRF_Momentum rescale_momentum_famod(LRF_Momentum pLRF_mod, double mass_squared,
 }
 
 
-double EmissionFunctionArray::calculate_total_yield(double * Equilibrium_Density, double * Bulk_Density, double * Diffusion_Density, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Deltaf_Data * df_data, Gauss_Laguerre * laguerre)
+void EmissionFunctionArray::set_sampler_seed()
+{
+  // seed the sampler's random number engines (once for all event batches)
+  unsigned seed;
+  if (SAMPLER_SEED < 0) seed = chrono::system_clock::now().time_since_epoch().count();
+  else seed = SAMPLER_SEED;
+
+  sampler_seed_value = seed;
+
+  generator_poisson.seed(seed);
+  generator_type.seed(seed + 10000);
+  generator_momentum.seed(seed + 20000);
+  //generator_keep.seed(seed + 30000);
+  generator_rapidity.seed(seed + 40000);
+}
+
+
+void EmissionFunctionArray::build_momentum_table(double *Mass, double *Sign, double *T_fo)
+{
+  // tabulated inverse cdfs of the LRF momentum (replaces rejection sampling for chem = 0)
+  double T_min = T_fo[0];
+  double T_max = T_fo[0];
+
+  for(long icell = 1; icell < FO_length; icell++)
+  {
+    T_min = min(T_min, T_fo[icell]);
+    T_max = max(T_max, T_fo[icell]);
+  }
+
+  if(T_max - T_min < 1.e-3)           // pad narrow (or single) temperature ranges
+  {
+    T_min -= 5.e-4;
+    T_max += 5.e-4;
+  }
+
+  if(momentum_table != NULL) delete momentum_table;
+
+  momentum_table = new Momentum_Table(number_of_chosen_particles, Mass, Sign, T_min, T_max, MOMENTUM_TABLE_T_BINS, MOMENTUM_TABLE_POINTS);
+
+  string momentum_table_file = "tables/thermodynamic/momentum_sampling_table.dat";
+
+  if(!CACHE_MOMENTUM_TABLE || !momentum_table->read_table_from_file(momentum_table_file))
+  {
+    momentum_table->build_table();
+
+    if(CACHE_MOMENTUM_TABLE) momentum_table->write_table_to_file(momentum_table_file);
+  }
+}
+
+
+void EmissionFunctionArray::decay_sampled_hadrons()
+{
+  // each event has its own random number stream (reproducible from the sampler seed for any thread count)
+  #pragma omp parallel for schedule(dynamic)
+  for(long ievent = 0; ievent < (long)particle_event_list.size(); ievent++)
+  {
+    hadron_decayer->decay_event(particle_event_list[ievent], event_offset + ievent, chosen_mass);
+
+    if(event_observables != NULL)
+    {
+      // event observables of the decayed final state (the sampler skips them when the hadrons are decayed)
+      for(const Compact_Particle & particle : particle_event_list[ievent])
+      {
+        double E = particle.E(chosen_mass[particle.chosen_index]);
+        double rapidity = 0.5 * log((E + particle.pz) / (E - particle.pz));
+
+        event_observables->add_particle(ievent, particle.chosen_index, E, particle.px, particle.py, particle.pz, rapidity);
+      }
+    }
+  }
+}
+
+
+void EmissionFunctionArray::build_density_table(double *Mass, double *Sign, double *Baryon, double *T_fo, double *muB_fo, Gauss_Laguerre * laguerre)
+{
+  // tabulated thermal integrals of the sampler's max particle numbers (replaces the per-cell quadratures for fast = 0)
+  double T_min = T_fo[0];
+  double T_max = T_fo[0];
+  double alphaB_min = 0.0;            // always include alphaB = 0 (df_mode = 4, pi0 breakdown check)
+  double alphaB_max = 0.0;
+
+  bool baryon_cells = (INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF);
+
+  for(long icell = 0; icell < FO_length; icell++)
+  {
+    T_min = min(T_min, T_fo[icell]);
+    T_max = max(T_max, T_fo[icell]);
+
+    if(baryon_cells)
+    {
+      double alphaB = muB_fo[icell] / T_fo[icell];
+
+      alphaB_min = min(alphaB_min, alphaB);
+      alphaB_max = max(alphaB_max, alphaB);
+    }
+  }
+
+  if(T_max - T_min < 1.e-3)           // pad narrow (or single) temperature ranges
+  {
+    T_min -= 5.e-4;
+    T_max += 5.e-4;
+  }
+
+  int alphaB_bins = 1;
+
+  if(baryon_cells && alphaB_max > alphaB_min) alphaB_bins = max(2, DENSITY_TABLE_ALPHAB_BINS);
+
+  if(density_table != NULL) delete density_table;
+
+  density_table = new Thermal_Density_Table(number_of_chosen_particles, Mass, Sign, Baryon, MASS_PION0, T_min, T_max, DENSITY_TABLE_T_BINS, alphaB_min, alphaB_max, alphaB_bins);
+
+  density_table->build_table(laguerre);
+}
+
+
+double EmissionFunctionArray::max_particle_numbers(double * dn_list, double *Mass, double *Sign, double *Degeneracy, double *Baryon, double *Equilibrium_Density, double *Bulk_Density, double T, double alphaB, double bulkPi, deltaf_coefficients df, bool feqmod_breaks_down, Gauss_Laguerre * laguerre)
+  {
+    // mean number of each species emitted from a unit volume (weights of the sampler's particle type distribution)
+    // returns the total dn_tot (before multiplying by the volume)
+
+    int npart = number_of_chosen_particles;
+
+    double dn_tot = 0.0;
+
+    if(FAST)
+    {
+      for(int ipart = 0; ipart < npart; ipart++)
+      {
+        double equilibrium_density = Equilibrium_Density[ipart];
+        double bulk_density = Bulk_Density[ipart];
+
+        dn_list[ipart] = fast_max_particle_number(equilibrium_density, bulk_density, bulkPi, df.z, feqmod_breaks_down, DF_MODE);
+        dn_tot += dn_list[ipart];
+      }
+    }
+    else
+    {
+      double neq_fact = T * T * T / two_pi2_hbarC3;
+      double J20_fact = T * neq_fact;
+
+      // df_mode = 4 uses the alphaB = 0 density (unless feqmod breaks down)
+      double alphaB_thermal = (DF_MODE == 4 && !feqmod_breaks_down) ? 0.0 : alphaB;
+
+      int moments = neq_moment;
+      if(DF_MODE == 3 && !feqmod_breaks_down) moments |= (J10_moment | J20_moment);
+
+      std::vector<Thermal_Moments> thermal(npart);
+
+      if(density_table != NULL && density_table->in_range(T, alphaB_thermal))
+      {
+        for(int ipart = 0; ipart < npart; ipart++)
+        {
+          density_table->thermal_integrals(ipart, T, alphaB_thermal, &thermal[ipart].neq, &thermal[ipart].J10, &thermal[ipart].J20);
+        }
+      }
+      else
+      {
+        // one fused quadrature pass per species
+        GaussThermal_moments_batch(moments, laguerre->root, laguerre->weight, laguerre->points, npart, Mass, T, alphaB_thermal, Baryon, Sign, thermal.data());
+      }
+
+      for(int ipart = 0; ipart < npart; ipart++)
+      {
+        dn_list[ipart] = max_particle_number(Degeneracy[ipart], Baryon[ipart], T, bulkPi, df, feqmod_breaks_down, DF_MODE, INCLUDE_BARYON, neq_fact, J20_fact, thermal[ipart]);
+        dn_tot += dn_list[ipart];
+      }
+    }
+
+    return dn_tot;
+  }
+
+
+double EmissionFunctionArray::calculate_total_yield(double *Mass, double *Sign, double *Degeneracy, double *Baryon, double * Equilibrium_Density, double * Bulk_Density, double * Diffusion_Density, double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *ux_fo, double *uy_fo, double *un_fo, double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo, double *pixx_fo, double *pixy_fo, double *pixn_fo, double *piyy_fo, double *piyn_fo, double *bulkPi_fo, double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Deltaf_Data * df_data, Gauss_Laguerre * laguerre)
   {
     // estimate the total mean particle yield from the freezeout surface
     // to determine the number of events you want to sample
 
+    // for df_mode = (1,2,3,4) this pass also stores the sampler's per-cell quantities
+    // (dn_tot, ds_max, feqmod breakdown and, if they fit in species_weight_cache, the species weights dn_list)
+    // so sample_dN_pTdpTdphidy does not recompute them for every batch of events
+
     int npart = number_of_chosen_particles;
 
     double Ntot = 0;                      // total particle yield
 
-    //#pragma omp parallel for reduction(+:Ntot)
+    double y_max = 0.5;                   // effective volume extension by 2.y_max (as in the sampler)
+    if(DIMENSION == 2) y_max = Y_CUT;
+
+    bool cache_cells = (DF_MODE != 5);
+    double species_weights_MB = (double)FO_length * (double)npart * sizeof(double) / (1024.0 * 1024.0);
+    bool cache_species = cache_cells && SPECIES_WEIGHT_CACHE > 0.0 && species_weights_MB <= SPECIES_WEIGHT_CACHE;
+
+    sampler_cells_cached = cache_cells;
+    sampler_species_cached = cache_species;
+
+    cell_dn_tot.assign(cache_cells ? FO_length : 0, 0.0);
+    cell_ds_max.assign(cache_cells ? FO_length : 0, 0.0);
+    cell_feqmod_breaks_down.assign(cache_cells ? FO_length : 0, 0);
+    cell_dn_list.assign(cache_species ? FO_length * npart : 0, 0.0);
+
+    if(cache_species)
+    {
+      printf("Caching species weights of %ld cells x %d particles (%.3g MB)\n", FO_length, npart, species_weights_MB);
+    }
+    else if(cache_cells && SPECIES_WEIGHT_CACHE > 0.0)
+    {
+      printf("Species weights of %ld cells x %d particles (%.3g MB) exceed species_weight_cache = %.3g MB (recomputed while sampling)\n", FO_length, npart, species_weights_MB, SPECIES_WEIGHT_CACHE);
+    }
+
+    // average temperature and df coefficients (for fast mode)
+    Plasma QGP;
+    QGP.load_thermodynamic_averages();
+    const double Tavg = QGP.temperature;
+    const double muBavg = QGP.baryon_chemical_potential;
+
+    double F_avg = 0.0;
+    double betabulk_avg = 0.0;
+
+    if(FAST && DF_MODE == 3)
+    {
+      deltaf_coefficients df_avg = df_data->evaluate_df_coefficients(Tavg, muBavg, 0.0, 0.0, 0.0);
+      F_avg = df_avg.F;
+      betabulk_avg = df_avg.betabulk;
+    }
+
+    #pragma omp parallel for reduction(+:Ntot) schedule(dynamic, 64)
     for(long icell = 0; icell < FO_length; icell++)
     {
       double tau = tau_fo[icell];         // longitudinal proper time
@@ -579,6 +819,8 @@ double EmissionFunctionArray::calculate_total_yield(double * Equilibrium_Density
       Surface_Element_Vector dsigma(dat, dax, day, dan);
       dsigma.boost_dsigma_to_lrf(basis_vectors, ut, ux, uy, un);
 
+      dsigma.compute_dsigma_magnitude();
+
       double ds_time = dsigma.dsigmat_LRF;
       double ds_space = dsigma.dsigma_space;
 
@@ -612,7 +854,7 @@ double EmissionFunctionArray::calculate_total_yield(double * Equilibrium_Density
       double detA = compute_detA(pimunu, shear_mod, bulk_mod);
 
       // determine if feqmod breaks down
-      bool feqmod_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, DETA_MIN, z, laguerre, DF_MODE, 0, T, F, betabulk);
+      bool feqmod_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, DETA_MIN, z, laguerre, DF_MODE, 0, T, F, betabulk, density_table);
 
       // sum over hadrons
       for(int ipart = 0; ipart < npart; ipart++)
@@ -623,6 +865,34 @@ double EmissionFunctionArray::calculate_total_yield(double * Equilibrium_Density
 
         Ntot += estimate_mean_particle_number(equilibrium_density, bulk_density, diffusion_density, ds_time, ds_space, bulkPi, Vdsigma, z, delta_z, feqmod_breaks_down, DF_MODE);
       }
+
+      if(!cache_cells) continue;
+
+      // sampler's breakdown check uses the average temperature in fast mode
+      bool sampler_breaks_down = feqmod_breaks_down;
+
+      if(FAST) sampler_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, DETA_MIN, z, laguerre, DF_MODE, FAST, Tavg, F_avg, betabulk_avg);
+
+      std::vector<double> dn_list_cell;
+      double * dn_list = NULL;
+
+      if(cache_species)
+      {
+        dn_list = cell_dn_list.data()  +  npart * icell;
+      }
+      else
+      {
+        dn_list_cell.resize(npart);
+        dn_list = dn_list_cell.data();
+      }
+
+      double dn_tot = max_particle_numbers(dn_list, Mass, Sign, Degeneracy, Baryon, Equilibrium_Density, Bulk_Density, T, alphaB, bulkPi, df, sampler_breaks_down, laguerre);
+
+      if(dn_tot <= 0.0) continue;
+
+      cell_dn_tot[icell] = dn_tot * (2.0 * y_max * dsigma.dsigma_magnitude);   // multiply by the volume
+      cell_ds_max[icell] = dsigma.dsigma_magnitude;
+      cell_feqmod_breaks_down[icell] = sampler_breaks_down;
     } // freezeout cells (icell)
 
     if(DIMENSION == 2)
@@ -642,17 +912,6 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
     double y_max = 0.5;                 // effective volume extension by 2.y_max
     if(DIMENSION == 2) y_max = Y_CUT;   // default value is 2.y_max = 1 (for 3+1d)
 
-    // set seed
-    unsigned seed;
-    if (SAMPLER_SEED < 0) seed = chrono::system_clock::now().time_since_epoch().count();
-    else seed = SAMPLER_SEED;
-
-    default_random_engine generator_poisson(seed);
-    default_random_engine generator_type(seed + 10000);
-    default_random_engine generator_momentum(seed + 20000);
-    //default_random_engine generator_keep(seed + 30000);
-    default_random_engine generator_rapidity(seed + 40000);
-
     // get average temperature (for fast mode)
     Plasma QGP;
     QGP.load_thermodynamic_averages();
@@ -702,6 +961,8 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
 
       if(udsigma <= 0.0) continue;        // skip over cells with u.dsigma < 0
 
+      if(sampler_cells_cached && cell_dn_tot[icell] <= 0.0) continue;   // no hadrons (from the yield pass)
+
       double ut2 = ut * ut;               // useful expressions
       double ux2 = ux * ux;
       double uy2 = uy * uy;
@@ -815,14 +1076,12 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
       // dsigma / eta_weight class
       Surface_Element_Vector dsigma(dat, dax, day, dan);
       dsigma.boost_dsigma_to_lrf(basis_vectors, ut, ux, uy, un);
-      dsigma.compute_dsigma_magnitude();
 
       // LRF components
       double dst = dsigma.dsigmat_LRF;
       double dsx = dsigma.dsigmax_LRF;
       double dsy = dsigma.dsigmay_LRF;
       double dsz = dsigma.dsigmaz_LRF;
-      double ds_max = dsigma.dsigma_magnitude;
 
       // shear stress class
       Shear_Stress pimunu(pitt, pitx, pity, pitn, pixx, pixy, pixn, piyy, piyn, pinn);
@@ -868,61 +1127,64 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
       }
       double isotropic_scale = 1.0 + bulk_mod;
 
-      double detA = compute_detA(pimunu, shear_mod, bulk_mod);
-
-      // determine if feqmod breaks down
-      bool feqmod_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, DETA_MIN, z, laguerre, DF_MODE, FAST, Tavg, F_avg, betabulk_avg);
-
-      // discrete number fraction of each species
-      std::vector<double> dn_list;
-      dn_list.resize(npart);
+      bool feqmod_breaks_down;
+      double ds_max;
 
       // total mean number of hadrons emitted from freezeout
       // cell of max volume (volume also scaled by 2.y_max)
       double dn_tot = 0.0;
 
-      if(FAST)
+      // discrete number fraction of each species
+      std::vector<double> dn_list_cell;
+      const double * dn_list;
+
+      if(sampler_cells_cached)
       {
-        for(int ipart = 0; ipart < npart; ipart++)
-        {
-          double equilibrium_density = Equilibrium_Density[ipart];
-          double bulk_density = Bulk_Density[ipart];
+        // stored by the yield pass (calculate_total_yield)
+        feqmod_breaks_down = cell_feqmod_breaks_down[icell];
+        ds_max = cell_ds_max[icell];
+        dn_tot = cell_dn_tot[icell];
+      }
+      else
+      {
+        double detA = compute_detA(pimunu, shear_mod, bulk_mod);
 
-          dn_list[ipart] = fast_max_particle_number(equilibrium_density, bulk_density, bulkPi, z, feqmod_breaks_down, DF_MODE);
-          dn_tot += dn_list[ipart];
-        }
+        // determine if feqmod breaks down
+        feqmod_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, DETA_MIN, z, laguerre, DF_MODE, FAST, Tavg, F_avg, betabulk_avg, density_table);
+
+        dsigma.compute_dsigma_magnitude();
+        ds_max = dsigma.dsigma_magnitude;
+      }
+
+      if(sampler_species_cached)
+      {
+        dn_list = cell_dn_list.data()  +  npart * icell;
       }
       else
       {
-        double neq_fact = T * T * T / two_pi2_hbarC3;
-        double J20_fact = T * neq_fact;
+        dn_list_cell.resize(npart);
 
-        for(int ipart = 0; ipart < npart; ipart++)
+        double dn = max_particle_numbers(dn_list_cell.data(), Mass, Sign, Degeneracy, Baryon, Equilibrium_Density, Bulk_Density, T, alphaB, bulkPi, df, feqmod_breaks_down, laguerre);
+
+        if(!sampler_cells_cached)
         {
-          double mass = Mass[ipart];
-          double mbar = mass / T;
-          double degeneracy = Degeneracy[ipart];
-          double sign = Sign[ipart];
-          double baryon = Baryon[ipart];
-
-          dn_list[ipart] = max_particle_number(mbar, degeneracy, sign, baryon, T, alphaB, bulkPi, df, feqmod_breaks_down, laguerre, DF_MODE, INCLUDE_BARYON, neq_fact, J20_fact);
-          dn_tot += dn_list[ipart];
-        }
-      }
+          if(dn <= 0.0) continue;
 
-      if(dn_tot <= 0.0) continue;
+          dn_tot = dn * (2.0 * y_max * ds_max);         // multiply by the volume
+        }
 
-      dn_tot *= (2.0 * y_max * ds_max);                      // multiply by the volume
+        dn_list = dn_list_cell.data();
+      }
 
 
       // construct discrete probability distribution for particle types (weight[ipart] ~ dn_list[ipart] / dn_tot)
-      std::discrete_distribution<int> particle_type(dn_list.begin(), dn_list.end());
+      std::discrete_distribution<int> particle_type(dn_list, dn_list + npart);
 
       // construct poisson probability distribution for number of hadrons
       std::poisson_distribution<int> poisson_hadrons(dn_tot);
 
       // sample events for each FO cell
-      for(long ievent = 0; ievent < Nevents; ievent++)
+      for(long ievent = 0; ievent < Nevents_batch; ievent++)
       {
         int N_hadrons = poisson_hadrons(generator_poisson);   // sample total number of hadrons in FO cell
 
@@ -936,7 +1198,6 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
           double baryon = Baryon[chosen_index];               // baryon number
           double chem = baryon * alphaB;
           double chem_mod = baryon * alphaB_mod;
-          int mcid = MCID[chosen_index];                      // mc_id
 
           LRF_Momentum pLRF;                                  // local rest frame momentum
           double w_visc = 1.0;                                // viscous weight
@@ -948,7 +1209,7 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
           {
             case 1: // 14 moment
             {
-              pLRF = sample_momentum(generator_momentum, &acceptances, &samples, mass, sign, T, chem);
+              pLRF = sample_momentum_tabulated(generator_momentum, &acceptances, &samples, momentum_table, chosen_index, mass, sign, T, chem);
 
               double E = pLRF.E;
               double px = pLRF.px;
@@ -975,7 +1236,7 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
             {
               chapman_enskog:
 
-              pLRF = sample_momentum(generator_momentum, &acceptances, &samples, mass, sign, T, chem);
+              pLRF = sample_momentum_tabulated(generator_momentum, &acceptances, &samples, momentum_table, chosen_index, mass, sign, T, chem);
 
               double E = pLRF.E;
               double px = pLRF.px;
@@ -1002,7 +1263,7 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
             {
               if(feqmod_breaks_down) goto chapman_enskog;
 
-              pLRF = sample_momentum(generator_momentum, &acceptances, &samples, mass, sign, T_mod, chem_mod);
+              pLRF = sample_momentum_tabulated(generator_momentum, &acceptances, &samples, momentum_table, chosen_index, mass, sign, T_mod, chem_mod);
               pLRF = rescale_momentum(pLRF, mass_squared, baryon, pixx_LRF, pixy_LRF, pixz_LRF, piyy_LRF, piyz_LRF, pizz_LRF, Vx_LRF, Vy_LRF, Vz_LRF, shear_mod, isotropic_scale, diff_mod, baryon_enthalpy_ratio);
 
               double E = pLRF.E;
@@ -1015,7 +1276,7 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
             }
             case 4: // Modified (Jonah)
             {
-              pLRF = sample_momentum(generator_momentum, &acceptances, &samples, mass, sign, T, 0.0);
+              pLRF = sample_momentum_tabulated(generator_momentum, &acceptances, &samples, momentum_table, chosen_index, mass, sign, T, 0.0);
 
               if(!feqmod_breaks_down)
               {
@@ -1063,14 +1324,12 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
             pLab.boost_pLRF_to_lab_frame(basis_vectors, ut, ux, uy, un);
 
             // new sampled particle info
-            Sampled_Particle new_particle;
+            Compact_Particle new_particle;
 
             new_particle.chosen_index = chosen_index;
-            new_particle.mcID = mcid;
             new_particle.tau = tau;
             new_particle.x = x;
             new_particle.y = y;
-            new_particle.mass = mass;
             new_particle.px = pLab.px;
             new_particle.py = pLab.py;
 
@@ -1104,9 +1363,6 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
             }
 
             new_particle.eta = eta;
-            new_particle.t = tau * cosheta;
-            new_particle.z = tau * sinheta;
-            new_particle.E = E;
             new_particle.pz = pz;
 
             if(TEST_SAMPLER)
@@ -1121,10 +1377,17 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy(double *Mass, double *Sign, do
             }
             else
             {
-              //CAREFUL push_back is not a thread-safe operation
-              //how should we modify for GPU version?
-              #pragma omp critical
-              particle_event_list[ievent].push_back(new_particle);
+              if(event_observables != NULL && hadron_decayer == NULL)
+              {
+                event_observables->add_particle(ievent, chosen_index, E, pLab.px, pLab.py, pz, rapidity);
+              }
+              if(EVENT_OBSERVABLES != 2 || hadron_decayer != NULL)
+              {
+                //CAREFUL push_back is not a thread-safe operation
+                //how should we modify for GPU version?
+                #pragma omp critical
+                particle_event_list[ievent].push_back(new_particle);
+              }
             }
           } // add sampled particle to event list
         } // sampled hadrons (n)
@@ -1146,22 +1409,6 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy_famod(double *Mass, double *Si
     y_max = Y_CUT;                    // volume extension factor = 2.y_cut for 2+1d surface
   }
 
-  unsigned seed;                      // set the seed
-
-  if(SAMPLER_SEED < 0)
-  {
-    seed = chrono::system_clock::now().time_since_epoch().count();
-  }
-  else
-  {
-    seed = SAMPLER_SEED;
-  }
-
-  default_random_engine generator_poisson(seed);            // initialize random number engines for each distribution
-  default_random_engine generator_type(seed + 10000);
-  default_random_engine generator_momentum(seed + 20000);
-  default_random_engine generator_rapidity(seed + 40000);
-
   double detB_min = DETA_MIN;         // default value for minimum detB = detC . detA
 
   double lambda_prev;                 // for tracking reconstruction of anisotropic variables
@@ -1514,7 +1761,7 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy_famod(double *Mass, double *Si
 
 
     // sample events for each freezeout cell
-    for(long ievent = 0; ievent < Nevents; ievent++)
+    for(long ievent = 0; ievent < Nevents_batch; ievent++)
     {
       int N_hadrons = poisson_hadrons(generator_poisson);   // sample total number of hadrons in FO cell
 
@@ -1529,7 +1776,6 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy_famod(double *Mass, double *Si
         double baryon = Baryon[chosen_index];               // baryon number
         double chem = baryon * upsilonB;                    // chemical potential term
 
-        int mcid = MCID[chosen_index];                      // mc_id
 
 
         // sample LRF momentum and transform
@@ -1553,14 +1799,12 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy_famod(double *Mass, double *Si
           Lab_Momentum pLab(pLRF);
           pLab.boost_pLRF_to_lab_frame(basis_vectors, ut, ux, uy, un);  // get the lab frame momentum
 
-          Sampled_Particle new_particle;
+          Compact_Particle new_particle;
 
           new_particle.chosen_index = chosen_index;                     // set sampled particle info
-          new_particle.mcID = mcid;
           new_particle.tau = tau;
           new_particle.x = x;
           new_particle.y = y;
-          new_particle.mass = mass;
           new_particle.px = pLab.px;
           new_particle.py = pLab.py;
 
@@ -1594,9 +1838,6 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy_famod(double *Mass, double *Si
           }
 
           new_particle.eta = eta;
-          new_particle.t = tau * cosheta;
-          new_particle.z = tau * sinheta;
-          new_particle.E = E;
           new_particle.pz = pz;
 
           if(TEST_SAMPLER)
@@ -1610,10 +1851,17 @@ void EmissionFunctionArray::sample_dN_pTdpTdphidy_famod(double *Mass, double *Si
           }
           else
           {
-            //CAREFUL push_back is not a thread-safe operation
-            //how should we modify for GPU version?
-            #pragma omp critical
-            particle_event_list[ievent].push_back(new_particle);        // append sampled particle to event list
+            if(event_observables != NULL && hadron_decayer == NULL)
+            {
+              event_observables->add_particle(ievent, chosen_index, E, pLab.px, pLab.py, pz, rapidity);   // update event observables
+            }
+            if(EVENT_OBSERVABLES != 2 || hadron_decayer != NULL)
+            {
+              //CAREFUL push_back is not a thread-safe operation
+              //how should we modify for GPU version?
+              #pragma omp critical
+              particle_event_list[ievent].push_back(new_particle);      // append sampled particle to event list
+            }
           }
         } // keep sampled particle
       } // hadrons (n)
@@ -0,0 +1,331 @@
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ParticleStore.h"
+#include "Arsenal.h"
+
+using namespace std;
+
+
+const char store_magic[8] = {'i', 'S', '3', 'D', 'p', 'a', 'r', 't'};
+const char index_magic[8] = {'i', 'S', '3', 'D', 'i', 'n', 'd', 'x'};
+const int store_values = 9;                 // t, x, y, z, E, px, py, pz, m
+const long store_header_size = 16;
+
+
+inline void pack_value(char * record, int precision, double value)
+{
+  if(precision == 4)
+  {
+    float value_float = (float)value;
+    memcpy(record, &value_float, 4);
+  }
+  else
+  {
+    memcpy(record, &value, 8);
+  }
+}
+
+
+inline double unpack_value(const char * record, int precision)
+{
+  if(precision == 4)
+  {
+    float value_float;
+    memcpy(&value_float, record, 4);
+    return (double)value_float;
+  }
+
+  double value;
+  memcpy(&value, record, 8);
+  return value;
+}
+
+
+
+Particle_Store_Writer::Particle_Store_Writer(string filename_in, int precision_in)
+{
+  precision = precision_in;
+
+  if(precision != 4 && precision != 8)
+  {
+    printf("Particle_Store_Writer error: precision = %d must be 4 (float32) or 8 (float64)\n", precision);
+    exit(-1);
+  }
+
+  record_size = 4 + store_values * precision;
+
+  // write to a unique temporary file and rename it when the index is written
+  // (a full disk or an interrupted run doesn't leave a truncated store)
+  filename = filename_in;
+  store_file = open_temporary_file(filename, tmp_filename);
+
+  if(store_file == NULL)
+  {
+    printf("Particle_Store_Writer error: could not open a temporary file for %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  int32_t header[2] = {particle_store_version, precision};
+
+  written = (fwrite(store_magic, 1, 8, store_file) == 8);
+  written = written && (fwrite(header, sizeof(int32_t), 2, store_file) == 2);
+
+  position = store_header_size;
+  event_offset.push_back(position);
+}
+
+
+Particle_Store_Writer::~Particle_Store_Writer()
+{
+  close();
+}
+
+
+void Particle_Store_Writer::write_event(const vector<Compact_Particle> & event, const double * mass, const int * mcid)
+{
+  long particles = event.size();
+
+  buffer.resize(particles * record_size);
+
+  for(long ipart = 0; ipart < particles; ipart++)
+  {
+    const Compact_Particle & particle = event[ipart];
+    double m = mass[particle.chosen_index];
+
+    char * record = buffer.data() + ipart * record_size;
+
+    int32_t pdg = mcid[particle.chosen_index];
+    memcpy(record, &pdg, 4);
+
+    double values[store_values] = {particle.t(), particle.x, particle.y, particle.z(), particle.E(m), particle.px, particle.py, particle.pz, m};
+
+    for(int i = 0; i < store_values; i++)
+    {
+      pack_value(record + 4 + i * precision, precision, values[i]);
+    }
+  }
+
+  written = written && (fwrite(buffer.data(), 1, buffer.size(), store_file) == buffer.size());
+
+  position += buffer.size();
+  event_offset.push_back(position);
+}
+
+
+void Particle_Store_Writer::close()
+{
+  if(store_file == NULL) return;
+
+  uint64_t Nevents = event_offset.size() - 1;
+
+  written = written && (fwrite(event_offset.data(), sizeof(uint64_t), event_offset.size(), store_file) == event_offset.size());
+  written = written && (fwrite(&Nevents, sizeof(uint64_t), 1, store_file) == 1);
+  written = written && (fwrite(index_magic, 1, 8, store_file) == 8);
+
+  bool installed = install_temporary_file(store_file, tmp_filename, filename, written);
+  store_file = NULL;
+
+  if(!installed)
+  {
+    printf("Particle_Store_Writer error: could not write %s\n", filename.c_str());
+    exit(-1);
+  }
+}
+
+
+
+Particle_Store_Reader::Particle_Store_Reader(string filename)
+{
+  store_file = fopen(filename.c_str(), "rb");
+
+  if(store_file == NULL)
+  {
+    printf("Particle_Store_Reader error: could not open %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  char magic[8];
+  int32_t header[2];
+
+  if(fread(magic, 1, 8, store_file) != 8 || memcmp(magic, store_magic, 8) != 0 || fread(header, sizeof(int32_t), 2, store_file) != 2)
+  {
+    printf("Particle_Store_Reader error: %s is not an iS3D particle store\n", filename.c_str());
+    exit(-1);
+  }
+
+  if(header[0] != particle_store_version)
+  {
+    printf("Particle_Store_Reader error: %s has version %d (expected %d)\n", filename.c_str(), header[0], particle_store_version);
+    exit(-1);
+  }
+
+  precision = header[1];
+
+  if(precision != 4 && precision != 8)
+  {
+    printf("Particle_Store_Reader error: %s has precision %d (must be 4 or 8)\n", filename.c_str(), precision);
+    exit(-1);
+  }
+
+  record_size = 4 + store_values * precision;
+
+  fseek(store_file, 0, SEEK_END);
+  uint64_t file_size = ftell(store_file);
+
+  // read the event index at the end of the file
+  uint64_t Nevents;
+
+  if(file_size < (uint64_t)store_header_size + 16 + sizeof(uint64_t) || fseek(store_file, -16, SEEK_END) != 0
+    || fread(&Nevents, sizeof(uint64_t), 1, store_file) != 1 || fread(magic, 1, 8, store_file) != 8 || memcmp(magic, index_magic, 8) != 0)
+  {
+    printf("Particle_Store_Reader error: %s has no event index (file incomplete?)\n", filename.c_str());
+    exit(-1);
+  }
+
+  // the index (Nevents + 1 offsets) must fit between the header and the trailer
+  uint64_t max_events = (file_size - store_header_size - 16) / sizeof(uint64_t) - 1;
+
+  if(Nevents > max_events)
+  {
+    printf("Particle_Store_Reader error: %s claims %lu events, more than the file can index\n", filename.c_str(), (unsigned long)Nevents);
+    exit(-1);
+  }
+
+  uint64_t records_end = file_size - 16 - (Nevents + 1) * sizeof(uint64_t);
+
+  event_offset.resize(Nevents + 1);
+
+  fseek(store_file, records_end, SEEK_SET);
+
+  if(fread(event_offset.data(), sizeof(uint64_t), Nevents + 1, store_file) != Nevents + 1)
+  {
+    printf("Particle_Store_Reader error: could not read event index of %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  // events are back to back whole records from the end of the header to the start of the index
+  bool valid = (event_offset[0] == (uint64_t)store_header_size) && (event_offset[Nevents] == records_end);
+
+  for(uint64_t ievent = 0; valid && ievent < Nevents; ievent++)
+  {
+    valid = (event_offset[ievent] <= event_offset[ievent + 1]) && ((event_offset[ievent + 1] - event_offset[ievent]) % record_size == 0);
+  }
+
+  if(!valid)
+  {
+    printf("Particle_Store_Reader error: %s has an inconsistent event index\n", filename.c_str());
+    exit(-1);
+  }
+}
+
+
+Particle_Store_Reader::~Particle_Store_Reader()
+{
+  fclose(store_file);
+}
+
+
+long Particle_Store_Reader::number_of_events()
+{
+  return event_offset.size() - 1;
+}
+
+
+long Particle_Store_Reader::number_of_particles(long ievent)
+{
+  return (event_offset[ievent + 1] - event_offset[ievent]) / record_size;
+}
+
+
+void Particle_Store_Reader::read_event(long ievent, vector<Sampled_Particle> & event)
+{
+  if(ievent < 0 || ievent >= number_of_events())
+  {
+    printf("Particle_Store_Reader error: event %ld out of range\n", ievent);
+    exit(-1);
+  }
+
+  long particles = number_of_particles(ievent);
+
+  vector<char> buffer(particles * record_size);
+
+  fseek(store_file, event_offset[ievent], SEEK_SET);
+
+  if((long)fread(buffer.data(), 1, buffer.size(), store_file) != (long)buffer.size())
+  {
+    printf("Particle_Store_Reader error: could not read event %ld\n", ievent);
+    exit(-1);
+  }
+
+  event.resize(particles);
+
+  for(long ipart = 0; ipart < particles; ipart++)
+  {
+    const char * record = buffer.data() + ipart * record_size;
+
+    int32_t pdg;
+    memcpy(&pdg, record, 4);
+
+    double values[store_values];
+
+    for(int i = 0; i < store_values; i++)
+    {
+      values[i] = unpack_value(record + 4 + i * precision, precision);
+    }
+
+    Sampled_Particle & particle = event[ipart];
+
+    particle.mcID = pdg;
+    particle.t = values[0];
+    particle.x = values[1];
+    particle.y = values[2];
+    particle.z = values[3];
+    particle.E = values[4];
+    particle.px = values[5];
+    particle.py = values[6];
+    particle.pz = values[7];
+    particle.mass = values[8];
+
+    particle.tau = sqrt(fabs(particle.t * particle.t  -  particle.z * particle.z));
+    particle.eta = atanh(particle.z / particle.t);
+  }
+}
+
+
+
+void convert_particle_store_to_OSC(string store_filename, string output_directory)
+{
+  Particle_Store_Reader store(store_filename);
+
+  vector<Sampled_Particle> event;
+
+  for(long ievent = 0; ievent < store.number_of_events(); ievent++)
+  {
+    store.read_event(ievent, event);
+
+    char filename[255] = "";
+    sprintf(filename, "%s/particle_list_osc_%ld.dat", output_directory.c_str(), ievent + 1);
+
+    ofstream spectraFile(filename, ios_base::out);
+
+    spectraFile << "n pid px py pz E m x y z t" << "\n";
+
+    for(long ipart = 0; ipart < (long)event.size(); ipart++)
+    {
+      Sampled_Particle & particle = event[ipart];
+
+      spectraFile << ipart << " " << particle.mcID << " " << scientific <<  setw(5) << setprecision(8) << particle.px << " " << particle.py << " " << particle.pz << " " << particle.E << " " << particle.mass << " " << particle.x << " " << particle.y << " " << particle.z << " " << particle.t << "\n";
+    }
+
+    spectraFile.close();
+  }
+}
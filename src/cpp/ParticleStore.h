@@ -0,0 +1,69 @@
+
+#ifndef PARTICLESTORE_H
+#define PARTICLESTORE_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include "SampledParticle.h"
+
+using namespace std;
+
+
+// binary particle store (one file per run)
+//
+//   header:   char magic[8] = "iS3Dpart", int32 version, int32 precision (4 = float32, 8 = float64)
+//   records:  int32 pdg, (t, x, y, z, E, px, py, pz, m) in float32 or float64 (little endian)
+//   trailer:  uint64 event_offset[Nevents + 1] (byte offset of each event's first record, last = end of records)
+//             uint64 Nevents, char magic[8] = "iS3Dindx"
+//
+// events are stored back to back, so event i has (event_offset[i+1] - event_offset[i]) / record_size particles
+
+const int particle_store_version = 1;
+
+class Particle_Store_Writer
+{
+  private:
+    FILE * store_file;
+    string filename;
+    string tmp_filename;                    // events are written to a temporary file, renamed by close()
+    bool written;                           // every fwrite so far succeeded
+    int precision;                          // bytes per floating point value (4 or 8)
+    long record_size;
+    uint64_t position;                      // current byte offset in file
+    vector<uint64_t> event_offset;
+    vector<char> buffer;                    // packed records of one event
+
+  public:
+    Particle_Store_Writer(string filename_in, int precision_in);
+    ~Particle_Store_Writer();
+
+    void write_event(const vector<Compact_Particle> & event, const double * mass, const int * mcid);
+    void close();                           // write the event index and install the file (called by destructor if needed)
+};
+
+
+class Particle_Store_Reader
+{
+  private:
+    FILE * store_file;
+    int precision;
+    long record_size;
+    vector<uint64_t> event_offset;
+
+  public:
+    Particle_Store_Reader(string filename);
+    ~Particle_Store_Reader();
+
+    long number_of_events();
+    long number_of_particles(long ievent);
+
+    void read_event(long ievent, vector<Sampled_Particle> & event);   // random access to any event
+};
+
+
+// convert a binary particle store to the OSCAR text files written by write_particle_list_OSC
+void convert_particle_store_to_OSC(string store_filename, string output_directory);
+
+#endif
@@ -0,0 +1,80 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ParticleTable.h"
+
+using namespace std;
+
+
+Particle_Table::Particle_Table()
+{
+  size = 0;
+  decay_channel_start.assign(1, 0);
+  decay_product_start.assign(1, 0);
+}
+
+
+int Particle_Table::add_particle(long mc_id_in, string name_in, double mass_in, double width_in, int gspin_in, int baryon_in, int strange_in, int charm_in, int bottom_in, int gisospin_in, int charge_in, int sign_in)
+{
+  mass.push_back(mass_in);
+  sign.push_back((double)sign_in);
+  degeneracy.push_back((double)gspin_in);
+  baryon.push_back((double)baryon_in);
+
+  mc_id.push_back(mc_id_in);
+  name.push_back(name_in);
+  width.push_back(width_in);
+  strange.push_back(strange_in);
+  charm.push_back(charm_in);
+  bottom.push_back(bottom_in);
+  gisospin.push_back(gisospin_in);
+  charge.push_back(charge_in);
+  stable.push_back(1);
+
+  equilibrium_density.push_back(0.0);
+  bulk_density.push_back(0.0);
+  diff_density.push_back(0.0);
+
+  decay_channel_start.push_back(decay_channel_start.back());
+
+  return size++;
+}
+
+
+void Particle_Table::add_decay_channel(int Npart, double branchratio, const long * products, int Nproducts)
+{
+  if(size == 0)
+  {
+    printf("Particle_Table error: decay channel added before any particle\n");
+    exit(-1);
+  }
+
+  decay_Npart.push_back(Npart);
+  decay_branchratio.push_back(branchratio);
+
+  for(int j = 0; j < Nproducts; j++)
+  {
+    decay_product.push_back(products[j]);
+  }
+
+  decay_product_start.push_back(decay_product.size());
+  decay_channel_start.back()++;
+}
+
+
+int Particle_Table::decay_channels(int ipart) const
+{
+  return decay_channel_start[ipart + 1] - decay_channel_start[ipart];
+}
+
+
+int Particle_Table::find(long mc_id_in) const
+{
+  for(int ipart = 0; ipart < size; ipart++)
+  {
+    if(mc_id[ipart] == mc_id_in) return ipart;
+  }
+
+  return -1;
+}
@@ -0,0 +1,66 @@
+
+#ifndef PARTICLETABLE_H
+#define PARTICLETABLE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// hadron resonance list read from the PDG file (structure of arrays, grows as particles are added)
+//
+// the hot columns (mass, sign, degeneracy, baryon) are contiguous doubles for the HRG loops / thermal integrals
+// the decay channels are a separate variable-length table:
+//
+//   channels of particle i          decay_channel_start[i] <= ichannel < decay_channel_start[i + 1]
+//   products of channel ichannel    decay_product_start[ichannel] <= j < decay_product_start[ichannel + 1]
+
+class Particle_Table
+{
+  public:
+    int size;                               // number of particles (antiparticles are separate entries)
+
+    // hot columns
+    vector<double> mass;                    // GeV
+    vector<double> sign;                    // quantum statistics sign (BE, FD) = (-1, 1)
+    vector<double> degeneracy;              // spin degeneracy
+    vector<double> baryon;                  // baryon number
+
+    // cold columns
+    vector<long> mc_id;                     // Monte Carlo number according to PDG
+    vector<string> name;
+    vector<double> width;                   // GeV
+    vector<int> strange;
+    vector<int> charm;
+    vector<int> bottom;
+    vector<int> gisospin;                   // isospin degeneracy
+    vector<int> charge;
+    vector<int> stable;                     // 1 if the particle doesn't decay strongly
+
+    // particle number / cell volume for the sampler (Deltaf_Data::compute_particle_densities)
+    vector<double> equilibrium_density;     // equilibrium density  (thermal number / u.dsigma)
+    vector<double> bulk_density;            // bulk correction      (bulk number / u.dsigma / bulkPi)
+    vector<double> diff_density;            // diffusion correction (diffusion number / V.dsigma)
+
+    // decay table
+    vector<int> decay_channel_start;        // [size + 1]
+    vector<int> decay_Npart;                // number of decay products of each channel (as listed in the PDG file)
+    vector<double> decay_branchratio;
+    vector<int> decay_product_start;        // [channels + 1]
+    vector<long> decay_product;             // mc_id of the decay products
+
+    Particle_Table();
+
+    // append a particle (returns its index); decay channels added next belong to it
+    int add_particle(long mc_id_in, string name_in, double mass_in, double width_in, int gspin_in, int baryon_in, int strange_in, int charm_in, int bottom_in, int gisospin_in, int charge_in, int sign_in);
+
+    // append a decay channel of the last particle
+    void add_decay_channel(int Npart, double branchratio, const long * products, int Nproducts);
+
+    int decay_channels(int ipart) const;
+
+    int find(long mc_id_in) const;          // index of the particle (-1 if it's not in the table)
+};
+
+#endif
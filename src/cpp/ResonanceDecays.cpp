@@ -0,0 +1,830 @@
+
+#include <iostream>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include <ctime>
+
+#ifdef OPENMP
+  #include <omp.h>
+#endif
+
+#include "iS3D.h"
+#include "readindata.h"
+#include "EmissionFunction.h"
+#include "Arsenal.h"
+#include "DecayResponse.h"
+
+using namespace std;
+
+
+// Smooth resonance decay feed-down of the continuous spectra (revived from jail/emissionfunction_resonance_decays.cpp)
+//
+// the parents' spectra are integrated over the decay kinematics (Sollfrank, Koch, Heinz) and added to their daughters' spectra:
+// - top down approach: loop over the chosen parents from heaviest to lightest, so feed-down from heavier resonances
+//   is included before a parent decays
+// - 2 and 3-body channels (channels with more products are skipped), grouped by daughter type
+// - linear interpolation of log(dN_pTdpTdphidy) of the parent, exponential MT tail beyond the last positive point
+// - each (decay group, daughter momentum) pair is independent: OpenMP across both (deterministic sum into the spectra)
+//
+// do_resonance_decays = 2: the same integrals with linear interpolation of dN (tail exp(-MT / decay_response_tail_T))
+// are linear in the parent spectra, so they're precomputed once per (PDG list, chosen particles, momentum grid) as sparse
+// response matrices (cached in tables/momentum/decay_response_<key>.bin) and the feed-down is a sequence of sparse matrix-vector products
+
+const int decay_gauss_pts = 12;       // Gauss-Legendre points for the (s, v, zeta) integrals
+
+const double decay_legendre_root[decay_gauss_pts] = {-0.98156063424672, -0.90411725637048, -0.76990267419431, -0.58731795428662, -0.3678314989982, -0.12523340851147,
+0.12523340851147, 0.36783149899818, 0.58731795428662, 0.76990267419431, 0.90411725637048, 0.98156063424672};
+
+const double decay_legendre_weight[decay_gauss_pts] = {0.04717533638651, 0.1069393259953, 0.16007832854335, 0.20316742672307, 0.23349253653836, 0.2491470458134,
+0.2491470458134, 0.23349253653836, 0.20316742672307, 0.1600783285433, 0.10693932599532, 0.04717533638651};
+
+const double log_dN_floor = -700.0;   // log of the parent spectrum where it's not positive (or not tabulated)
+const double pT_min_decay = 1.e-4;    // azimuthal solutions are degenerate at pT = 0 (use the smooth limit)
+
+const string decay_response_prefix = "tables/momentum/decay_response_";     // + key in hex + .bin
+const char decay_response_version[] = "decay response v1";
+
+
+double calculate_Q_factor(double mass_parent, double mass_1, double mass_2, double mass_3)
+{
+  // normalization of the 3-body phase space (uniform Dalitz distribution)
+  double a = (mass_parent + mass_1) * (mass_parent + mass_1);
+  double b = (mass_parent - mass_1) * (mass_parent - mass_1);     // s+
+  double c = (mass_2 + mass_3) * (mass_2 + mass_3);               // s-
+  double d = (mass_2 - mass_3) * (mass_2 - mass_3);
+
+  // 24 gauss-legendre points for accurate Q-factor calculation
+  const int x_pts = 24;
+  double x_root[x_pts] = {-0.99518721999702,-0.97472855597131,-0.93827455200273,-0.8864155270044,-0.8200019859739,-0.74012419157855,-0.64809365193698,-0.54542147138884,-0.43379350762605,-0.31504267969616,-0.19111886747362,-0.064056892862606,0.06405689286261,0.19111886747362,0.31504267969616,0.43379350762605,0.54542147138884,0.64809365193698,0.74012419157855,0.8200019859739,0.8864155270044,0.93827455200273,0.97472855597131,0.99518721999702};
+
+  double x_weight[x_pts] = {0.01234122979999,0.02853138862893,0.0442774388174,0.059298584915437,0.0733464814111,0.08619016153195,0.0976186521041,0.107444270116,0.11550566805373,0.1216704729278,0.12583745634683,0.1279381953468,0.1279381953468,0.1258374563468,0.1216704729278,0.1155056680537,0.107444270116,0.09761865210411,0.08619016153195,0.07334648141108,0.05929858491544,0.04427743881742,0.02853138862893,0.01234122979999};
+
+  double Q = 0.0;
+
+  for(int i = 0; i < x_pts; i++)
+  {
+    // s = s- + (s+ - s-)(1 + x)/2, where x = [-1,1]
+    double s = c  +  (b - c) * (1.0 + x_root[i]) / 2.0;
+
+    Q += x_weight[i] * (b - c) * sqrt(fabs((a - s) * (b - s) * (s - c) * (s - d))) / (2.0 * s);
+  }
+
+  return Q;
+}
+
+
+void EmissionFunctionArray::set_parent_log_spectrum(int parent_chosen_index, double mass_parent)
+{
+  // log of the parent spectrum, stored in columns of MT at fixed (phip, y):
+  // logdN_PTdPTdPhidY[ipT + pT_tab_length * (iphip + phi_tab_length * iy)]
+  set_parent_MT_grid(mass_parent);
+
+  for(int iy = 0; iy < y_tab_length; iy++)
+  {
+    for(int iphip = 0; iphip < phi_tab_length; iphip++)
+    {
+      long icolumn = iphip  +  phi_tab_length * iy;
+      double * logdN = logdN_PTdPTdPhidY  +  pT_tab_length * icolumn;
+
+      // interpolate up to the last positive point (df corrections can make the high pT spectra negative)
+      int points = 0;
+
+      for(int ipT = 0; ipT < pT_tab_length; ipT++)
+      {
+        double dN = dN_pTdpTdphidy[iy  +  y_tab_length * (iphip  +  phi_tab_length * (ipT  +  pT_tab_length * parent_chosen_index))];
+
+        if(!(dN > 0.0) || !std::isfinite(dN)) break;
+
+        logdN[ipT] = log(dN);
+        points++;
+      }
+      for(int ipT = points; ipT < pT_tab_length; ipT++)
+      {
+        logdN[ipT] = log_dN_floor;
+      }
+
+      MT_fit_parameters fit = {log_dN_floor, 0.0, points};
+
+      if(points >= 2)
+      {
+        // least squares fit of log(dN) = constant + slope * MT in the relativistic region (last two points if too few)
+        double MT_relativistic = sqrt(2.73) * mass_parent;
+
+        int first = points - 2;
+        while(first > 0 && MT_parent[first - 1] > MT_relativistic) first--;
+
+        double n = 0.0, Sx = 0.0, Sy = 0.0, Sxx = 0.0, Sxy = 0.0;
+
+        for(int ipT = first; ipT < points; ipT++)
+        {
+          double x = MT_parent[ipT];
+          double y = logdN[ipT];
+
+          n += 1.0;
+          Sx += x;
+          Sy += y;
+          Sxx += x * x;
+          Sxy += x * y;
+        }
+
+        double slope = (n * Sxy  -  Sx * Sy) / (n * Sxx  -  Sx * Sx);
+
+        if(!(slope < 0.0)) slope = 0.0;
+
+        // anchor the tail at the last positive point (continuous at MT_switch)
+        fit.slope = slope;
+        fit.constant = logdN[points - 1]  -  slope * MT_parent[points - 1];
+      }
+
+      MT_fit_parent[icolumn] = fit;
+    }
+  }
+}
+
+
+double EmissionFunctionArray::log_dN_column(long icolumn, double MT, int iMTR)
+{
+  // log(dN/dYMTdMTdPhi) of the parent (phip, y) column at MT (iMTR = first MT grid point above MT)
+  const MT_fit_parameters & fit = MT_fit_parent[icolumn];
+
+  if(fit.points < 2) return log_dN_floor;
+
+  if(MT >= MT_parent[fit.points - 1]) return fit.constant  +  fit.slope * MT;
+
+  int iR = min(iMTR, fit.points - 1);
+  int iL = iR - 1;
+
+  const double * logdN = logdN_PTdPTdPhidY  +  pT_tab_length * icolumn;
+
+  double MTL = MT_parent[iL];
+  double MTR = MT_parent[iR];
+
+  return (logdN[iL] * (MTR - MT)  +  logdN[iR] * (MT - MTL)) / (MTR - MTL);
+}
+
+
+bool EmissionFunctionArray::decay_y_bracket(double Y, int & iYL, int & iYR, double & wYL, double & wYR)
+{
+  // rapidity interpolation points (boost invariant if there's one rapidity point, false if the parent spectrum is cut off in Y)
+  iYL = 0;
+  iYR = 0;
+  wYL = 1.0;
+  wYR = 0.0;
+
+  if(y_tab_length == 1) return true;
+
+  if(Y < y_values[0] || Y > y_values[y_tab_length - 1]) return false;
+
+  iYR = upper_bound(y_values.begin() + 1, y_values.end() - 1, Y) - y_values.begin();
+  iYL = iYR - 1;
+
+  wYR = (Y - y_values[iYL]) / (y_values[iYR] - y_values[iYL]);
+  wYL = 1.0 - wYR;
+
+  return true;
+}
+
+
+void EmissionFunctionArray::decay_phip_bracket(double Phip, int & iPhipL, int & iPhipR, double & wPhipL, double & wPhipR)
+{
+  // periodic interpolation points in phip
+  iPhipL = 0;
+  iPhipR = 0;
+  wPhipL = 1.0;
+  wPhipR = 0.0;
+
+  if(phi_tab_length == 1) return;
+
+  double phi = Phip  -  two_pi * floor(Phip / two_pi);   // [0, 2pi)
+
+  int iR = upper_bound(phip_values.begin(), phip_values.end(), phi) - phip_values.begin();
+
+  double PhipL, PhipR;
+
+  if(iR == 0)
+  {
+    iPhipL = phi_tab_length - 1;
+    iPhipR = 0;
+    PhipL = phip_values[iPhipL] - two_pi;   // small negative angle
+    PhipR = phip_values[iPhipR];
+  }
+  else if(iR == phi_tab_length)
+  {
+    iPhipL = phi_tab_length - 1;
+    iPhipR = 0;
+    PhipL = phip_values[iPhipL];
+    PhipR = phip_values[iPhipR] + two_pi;
+  }
+  else
+  {
+    iPhipL = iR - 1;
+    iPhipR = iR;
+    PhipL = phip_values[iPhipL];
+    PhipR = phip_values[iPhipR];
+  }
+
+  wPhipR = (phi - PhipL) / (PhipR - PhipL);
+  wPhipL = 1.0 - wPhipR;
+}
+
+
+double EmissionFunctionArray::dN_dYMTdMTdPhi_parent(double MT, double Phip1, double Phip2, double Y)
+{
+  // parent spectrum at (MT, Phip1, Y) + (MT, Phip2, Y): linear interpolation of the log in (MT, Phip, Y)
+  int iMTR = upper_bound(MT_parent.begin() + 1, MT_parent.end() - 1, MT) - MT_parent.begin();
+
+  int iYL, iYR;
+  double wYL, wYR;
+
+  if(!decay_y_bracket(Y, iYL, iYR, wYL, wYR)) return 0.0;
+
+  double Phip[2] = {Phip1, Phip2};
+  double dN = 0.0;
+
+  for(int k = 0; k < 2; k++)
+  {
+    int iPhipL, iPhipR;
+    double wPhipL, wPhipR;
+
+    decay_phip_bracket(Phip[k], iPhipL, iPhipR, wPhipL, wPhipR);
+
+    double logdN = wYL * (wPhipL * log_dN_column(iPhipL + phi_tab_length * iYL, MT, iMTR)  +  wPhipR * log_dN_column(iPhipR + phi_tab_length * iYL, MT, iMTR));
+
+    if(wYR != 0.0)
+    {
+      logdN += wYR * (wPhipL * log_dN_column(iPhipL + phi_tab_length * iYR, MT, iMTR)  +  wPhipR * log_dN_column(iPhipR + phi_tab_length * iYR, MT, iMTR));
+    }
+
+    dN += exp(logdN);
+  }
+
+  return dN;
+}
+
+
+void EmissionFunctionArray::add_parent_response(Decay_Response_Row * row, double MT, double Phip1, double Phip2, double Y, double weight)
+{
+  // weight * dN_dYMTdMTdPhi_parent(MT, Phip1, Phip2, Y) as weights of the parent grid points (linear interpolation of dN)
+  // parent point index: iy + y_tab_length * (iphip + phi_tab_length * ipT)
+  int iYL, iYR;
+  double wYL, wYR;
+
+  if(!decay_y_bracket(Y, iYL, iYR, wYL, wYR)) return;
+
+  int iMTL, iMTR;
+  double wMTL, wMTR;
+
+  if(MT >= MT_parent[pT_tab_length - 1])
+  {
+    // exponential tail of the last pT point
+    iMTL = pT_tab_length - 1;
+    iMTR = iMTL;
+    wMTL = exp(-(MT - MT_parent[iMTL]) / DECAY_RESPONSE_TAIL_T);
+    wMTR = 0.0;
+  }
+  else
+  {
+    iMTR = upper_bound(MT_parent.begin() + 1, MT_parent.end() - 1, MT) - MT_parent.begin();
+    iMTL = iMTR - 1;
+    wMTR = max(0.0, (MT - MT_parent[iMTL]) / (MT_parent[iMTR] - MT_parent[iMTL]));
+    wMTL = 1.0 - wMTR;
+  }
+
+  int iMT[2] = {iMTL, iMTR};
+  double wMT[2] = {wMTL, wMTR};
+  int iY[2] = {iYL, iYR};
+  double wY[2] = {wYL, wYR};
+
+  double Phip[2] = {Phip1, Phip2};
+
+  for(int k = 0; k < 2; k++)
+  {
+    int iPhip[2];
+    double wPhip[2];
+
+    decay_phip_bracket(Phip[k], iPhip[0], iPhip[1], wPhip[0], wPhip[1]);
+
+    for(int a = 0; a < 2; a++)
+    {
+      if(wMT[a] == 0.0) continue;
+
+      for(int b = 0; b < 2; b++)
+      {
+        if(wPhip[b] == 0.0) continue;
+
+        for(int c = 0; c < 2; c++)
+        {
+          if(wY[c] == 0.0) continue;
+
+          row->add(iY[c]  +  y_tab_length * (iPhip[b]  +  phi_tab_length * iMT[a]), weight * wMT[a] * wPhip[b] * wY[c]);
+        }
+      }
+    }
+  }
+}
+
+
+double EmissionFunctionArray::two_body_integral(double mass_parent, double mass, double Estar, double pstar, double pT, double phip, double y, double weight, Decay_Response_Row * row)
+{
+  // integral over the parent rapidity Y = y + v.DeltaY and transverse mass MT = MTbar + DeltaMT.cos(zeta)
+  // of a daughter with momentum (pT, phip, y) and energy, momentum (Estar, pstar) in the parent rest frame
+  // (if row != NULL, weight * integrand weights are added to the response row instead)
+  pT = max(pT, pT_min_decay);
+
+  double parent_mass2 = mass_parent * mass_parent;
+  double pole_mass2 = parent_mass * parent_mass;
+
+  double pT2 = pT * pT;
+  double mT = sqrt(pT2  +  mass * mass);
+
+  double Estar_M = Estar * mass_parent;
+  double Estar2_plus_pT2 = Estar * Estar  +  pT2;
+
+  double DeltaY = log((pstar + sqrt(Estar2_plus_pT2)) / mT);    // parent rapidity interval
+
+  double v_integral = 0.0;
+
+  for(int iv = 0; iv < decay_gauss_pts; iv++)
+  {
+    double v = decay_legendre_root[iv];
+    double Y = y  +  v * DeltaY;
+
+    if(y_tab_length > 1 && (Y < y_values[0] || Y > y_values[y_tab_length - 1])) continue;
+
+    double mT_coshvDeltaY = mT * cosh(v * DeltaY);
+    double mT2_coshvDeltaY2_minus_pT2 = mT_coshvDeltaY * mT_coshvDeltaY  -  pT2;
+
+    double MTbar = Estar_M * mT_coshvDeltaY / mT2_coshvDeltaY2_minus_pT2;
+    double DeltaMT = mass_parent * pT * sqrt(fabs(Estar2_plus_pT2  -  mT_coshvDeltaY * mT_coshvDeltaY)) / mT2_coshvDeltaY2_minus_pT2;
+
+    double v_weight = decay_legendre_weight[iv] * DeltaY / sqrt(fabs(mT2_coshvDeltaY2_minus_pT2));
+    double zeta_integral = 0.0;
+
+    for(int izeta = 0; izeta < decay_gauss_pts; izeta++)
+    {
+      // zeta = (1 + x)pi/2, x = [-1,1] (factor of pi/2 in the prefactor)
+      double coszeta = cos(M_PI * (1.0 + decay_legendre_root[izeta]) / 2.0);
+
+      double MT = MTbar  +  DeltaMT * coszeta;                  // parent MT
+      double PT2 = fabs(MT * MT  -  parent_mass2);
+      double PT = sqrt(PT2);
+
+      double cosPhip_tilde = 1.0;
+      if(PT > 0.0) cosPhip_tilde = max(-1.0, min(1.0, (MT * mT_coshvDeltaY  -  Estar_M) / (pT * PT)));
+
+      double Phip_tilde = acos(cosPhip_tilde);
+
+      // two solutions for the parent azimuthal angle (parent spectrum at its pole mass)
+      double MT_pole = sqrt(PT2  +  pole_mass2);
+
+      if(row != NULL)
+      {
+        add_parent_response(row, MT_pole, phip + Phip_tilde, phip - Phip_tilde, Y, weight * v_weight * decay_legendre_weight[izeta] * MT);
+        continue;
+      }
+
+      zeta_integral += decay_legendre_weight[izeta] * MT * dN_dYMTdMTdPhi_parent(MT_pole, phip + Phip_tilde, phip - Phip_tilde, Y);
+    }
+
+    v_integral += v_weight * zeta_integral;
+  }
+
+  return v_integral;
+}
+
+
+double EmissionFunctionArray::decay_feed_down(const Decay_Group & group, double pT, double phip, double y, Decay_Response_Row * row)
+{
+  // contribution of the decay group to the daughter spectrum dN/pTdpTdphidy (or its response row)
+  double M = group.mass_parent;
+  double M2 = M * M;
+  double m = group.mass;
+  double m2 = m * m;
+
+  if(group.bodies == 2)
+  {
+    double mass_secondary = group.mass_2;
+
+    double Estar = (M2  +  m2  -  mass_secondary * mass_secondary) / (2.0 * M);
+    double pstar = sqrt(fabs(Estar * Estar  -  m2));
+
+    double prefactor = group.multiplicity * M * group.branch_ratio / (8.0 * pstar);
+
+    return prefactor * two_body_integral(M, m, Estar, pstar, pT, phip, y, prefactor, row);
+  }
+
+  // 3-body decay: integrate over the invariant mass squared s of the other two products
+  double s_plus = (M - m) * (M - m);
+  double s_minus = (group.mass_2 + group.mass_3) * (group.mass_2 + group.mass_3);
+  double d = (group.mass_2 - group.mass_3) * (group.mass_2 - group.mass_3);
+
+  double prefactor = group.multiplicity * M2 * (s_plus - s_minus) * group.branch_ratio / (8.0 * group.Q);
+
+  double s_integral = 0.0;
+
+  for(int is = 0; is < decay_gauss_pts; is++)
+  {
+    double s = s_minus  +  (s_plus - s_minus) * (1.0 + decay_legendre_root[is]) / 2.0;
+
+    double Estar = (M2  +  m2  -  s) / (2.0 * M);
+    double pstar = sqrt(fabs(Estar * Estar  -  m2));
+
+    double s_weight = decay_legendre_weight[is] * sqrt(fabs((s - s_minus) * (s - d))) / s;
+
+    s_integral += s_weight * two_body_integral(M, m, Estar, pstar, pT, phip, y, prefactor * s_weight, row);
+  }
+
+  return prefactor * s_integral;
+}
+
+
+void EmissionFunctionArray::set_parent_MT_grid(double mass_parent)
+{
+  parent_mass = mass_parent;
+
+  for(int ipT = 0; ipT < pT_tab_length; ipT++)
+  {
+    MT_parent[ipT] = sqrt(pT_values[ipT] * pT_values[ipT]  +  mass_parent * mass_parent);
+  }
+}
+
+
+void EmissionFunctionArray::setup_resonance_decays(vector<int> & chosen_index, vector<int> & parents)
+{
+  // momentum grid, chosen index of each particle in the PDG list (-1 if not chosen or lighter than lightest_particle)
+  // and the unstable chosen parents from heaviest to lightest
+  if(pT_tab_length < 2)
+  {
+    printf("do_resonance_decays error: need at least 2 pT points\n");
+    exit(-1);
+  }
+
+  int lightest_index = particles->find(LIGHTEST_PARTICLE);
+
+  if(lightest_index == -1)
+  {
+    printf("do_resonance_decays error: lightest_particle = %d is not in the PDG list\n", LIGHTEST_PARTICLE);
+    exit(-1);
+  }
+
+  double mass_lightest = particles->mass[lightest_index];
+
+  set_momentum_grid();    // momentum grid of the continuous spectra
+
+  MT_parent.resize(pT_tab_length);
+  MT_fit_parent.resize(phi_tab_length * y_tab_length);
+
+  chosen_index.assign(Nparticles, -1);
+
+  for(int ichosen = 0; ichosen < number_of_chosen_particles; ichosen++)
+  {
+    int ipart = chosen_particles_sampling_table[ichosen];
+
+    if(particles->mass[ipart] >= mass_lightest) chosen_index[ipart] = ichosen;
+  }
+
+  parents.clear();
+
+  for(int ichosen = 0; ichosen < number_of_chosen_particles; ichosen++)
+  {
+    int ipart = chosen_particles_sampling_table[ichosen];
+
+    if(!particles->stable[ipart] && chosen_index[ipart] != -1) parents.push_back(ichosen);
+  }
+
+  stable_sort(parents.begin(), parents.end(), [&](int a, int b)
+  {
+    return particles->mass[chosen_particles_sampling_table[a]] > particles->mass[chosen_particles_sampling_table[b]];
+  });
+}
+
+
+vector<Decay_Group> EmissionFunctionArray::resonance_decay_groups(int parent_chosen_index, const vector<int> & chosen_index, long & decay_channels, long & skipped_channels)
+{
+  // group the chosen daughters of each decay channel of the parent by type
+  int parent = chosen_particles_sampling_table[parent_chosen_index];
+  double mass_parent = particles->mass[parent];
+
+  vector<Decay_Group> groups;
+
+  for(int ichannel = particles->decay_channel_start[parent]; ichannel < particles->decay_channel_start[parent + 1]; ichannel++)
+  {
+    int first_product = particles->decay_product_start[ichannel];
+    int decay_products = particles->decay_product_start[ichannel + 1] - first_product;
+
+    if(decay_products < 2) continue;                  // stable "channel"
+
+    vector<int> products;
+
+    for(int k = 0; k < decay_products; k++)
+    {
+      int index = particles->find(particles->decay_product[first_product + k]);
+
+      if(index == -1) break;
+
+      products.push_back(index);
+    }
+
+    if(decay_products > 3 || (int)products.size() != decay_products)
+    {
+      skipped_channels++;                             // 4-body decays or decay products missing from the PDG list
+      continue;
+    }
+
+    double masses[3] = {0.0, 0.0, 0.0};
+    for(int k = 0; k < decay_products; k++) masses[k] = particles->mass[products[k]];
+
+    double M = mass_parent;
+
+    if(decay_products == 2)
+    {
+      // adjust the masses to satisfy energy conservation
+      double width_parent = particles->width[parent];
+      double width_1 = particles->width[products[0]];
+      double width_2 = particles->width[products[1]];
+
+      bool below_threshold = false;
+
+      while(masses[0] + masses[1] >= M)
+      {
+        if(width_parent + width_1 + width_2 <= 0.0)
+        {
+          below_threshold = true;
+          break;
+        }
+
+        M += 0.25 * width_parent;
+        masses[0] -= 0.5 * width_1;
+        masses[1] -= 0.5 * width_2;
+
+        if(masses[0] < 0.0 || masses[1] < 0.0)
+        {
+          below_threshold = true;
+          break;
+        }
+      }
+
+      if(below_threshold)
+      {
+        skipped_channels++;
+        continue;
+      }
+    }
+    else if(masses[0] + masses[1] + masses[2] >= M)
+    {
+      skipped_channels++;
+      continue;
+    }
+
+    decay_channels++;
+
+    for(int k = 0; k < decay_products; k++)
+    {
+      int daughter = chosen_index[products[k]];
+
+      if(daughter == -1 || products[k] == parent) continue;
+
+      // count identical daughters once (first occurrence)
+      bool counted = false;
+      for(int j = 0; j < k; j++) if(products[j] == products[k]) counted = true;
+      if(counted) continue;
+
+      Decay_Group group;
+
+      group.daughter = daughter;
+      group.bodies = decay_products;
+      group.multiplicity = 0.0;
+      group.branch_ratio = particles->decay_branchratio[ichannel];
+      group.mass_parent = M;
+      group.mass = masses[k];
+      group.mass_2 = 0.0;
+      group.mass_3 = 0.0;
+      group.Q = 0.0;
+
+      // remaining decay products (remove one daughter)
+      vector<double> others;
+      bool removed = false;
+
+      for(int j = 0; j < decay_products; j++)
+      {
+        if(products[j] == products[k])
+        {
+          group.multiplicity += 1.0;
+
+          if(!removed)
+          {
+            removed = true;
+            continue;
+          }
+        }
+        others.push_back(masses[j]);
+      }
+
+      group.mass_2 = others[0];
+
+      if(decay_products == 3)
+      {
+        group.mass_3 = others[1];
+        group.Q = calculate_Q_factor(M, group.mass, group.mass_2, group.mass_3);
+      }
+
+      groups.push_back(group);
+    }
+  }
+
+  return groups;
+}
+
+
+uint64_t EmissionFunctionArray::decay_response_key()
+{
+  // everything the response matrices depend on: PDG decay table, chosen particles, momentum grid and settings
+  uint64_t key = fnv1a_hash(decay_response_version, sizeof(decay_response_version), fnv1a_offset);
+
+  key = fnv1a_hash(particles->mc_id.data(), particles->size * sizeof(long), key);
+  key = fnv1a_hash(particles->mass.data(), particles->size * sizeof(double), key);
+  key = fnv1a_hash(particles->width.data(), particles->size * sizeof(double), key);
+  key = fnv1a_hash(particles->stable.data(), particles->size * sizeof(int), key);
+  key = fnv1a_hash(particles->decay_channel_start.data(), particles->decay_channel_start.size() * sizeof(int), key);
+  key = fnv1a_hash(particles->decay_branchratio.data(), particles->decay_branchratio.size() * sizeof(double), key);
+  key = fnv1a_hash(particles->decay_product_start.data(), particles->decay_product_start.size() * sizeof(int), key);
+  key = fnv1a_hash(particles->decay_product.data(), particles->decay_product.size() * sizeof(long), key);
+
+  key = fnv1a_hash(chosen_particles_sampling_table, number_of_chosen_particles * sizeof(int), key);
+
+  key = fnv1a_hash(pT_values.data(), pT_values.size() * sizeof(double), key);
+  key = fnv1a_hash(phip_values.data(), phip_values.size() * sizeof(double), key);
+  key = fnv1a_hash(y_values.data(), y_values.size() * sizeof(double), key);
+
+  int settings[2] = {DIMENSION, LIGHTEST_PARTICLE};
+
+  key = fnv1a_hash(settings, sizeof(settings), key);
+  key = fnv1a_hash(&DECAY_RESPONSE_TAIL_T, sizeof(double), key);
+
+  return key;
+}
+
+
+void EmissionFunctionArray::build_decay_response(const vector<int> & chosen_index, const vector<int> & parents, long & decay_channels, long & skipped_channels)
+{
+  // response matrix of each (parent, chosen daughter) pair: all decay groups of the pair summed into the same rows
+  int momentum_points = pT_tab_length * phi_tab_length * y_tab_length;
+
+  for(int parent_chosen_index : parents)
+  {
+    vector<Decay_Group> groups = resonance_decay_groups(parent_chosen_index, chosen_index, decay_channels, skipped_channels);
+
+    if(groups.size() == 0) continue;
+
+    set_parent_MT_grid(particles->mass[chosen_particles_sampling_table[parent_chosen_index]]);
+
+    // daughters in order of first appearance
+    vector<int> daughters;
+
+    for(const Decay_Group & group : groups)
+    {
+      if(find(daughters.begin(), daughters.end(), group.daughter) == daughters.end()) daughters.push_back(group.daughter);
+    }
+
+    for(int daughter : daughters)
+    {
+      vector<vector<int>> columns(momentum_points);
+      vector<vector<double>> values(momentum_points);
+
+      #pragma omp parallel
+      {
+        Decay_Response_Row row(momentum_points);    // thread's row accumulator
+
+        #pragma omp for schedule(dynamic)
+        for(int ipoint = 0; ipoint < momentum_points; ipoint++)
+        {
+          // ipoint = iy + y_tab_length * (iphip + phi_tab_length * ipT)
+          int iy = ipoint % y_tab_length;
+          int iphip = (ipoint / y_tab_length) % phi_tab_length;
+          int ipT = ipoint / (y_tab_length * phi_tab_length);
+
+          for(const Decay_Group & group : groups)
+          {
+            if(group.daughter == daughter) decay_feed_down(group, pT_values[ipT], phip_values[iphip], y_values[iy], &row);
+          }
+
+          row.extract(columns[ipoint], values[ipoint]);
+        }
+      }
+
+      decay_response->add_pair(parent_chosen_index, daughter);
+
+      for(int ipoint = 0; ipoint < momentum_points; ipoint++)
+      {
+        decay_response->add_row(columns[ipoint], values[ipoint]);
+      }
+    }
+  }
+}
+
+
+void EmissionFunctionArray::do_resonance_decays()
+{
+  printf("\nComputing resonance decay feed-down...\n\n");
+
+#ifdef OPENMP
+  double t1 = omp_get_wtime();
+#else
+  clock_t start = clock();
+#endif
+
+  vector<int> chosen_index;
+  vector<int> parents;
+
+  setup_resonance_decays(chosen_index, parents);
+
+  long momentum_points = pT_tab_length * phi_tab_length * y_tab_length;
+
+  long decay_channels = 0;
+  long skipped_channels = 0;
+
+  if(DO_RESONANCE_DECAYS == 2)
+  {
+    // precomputed response matrices (built once per PDG list, chosen particles and momentum grid)
+    if(decay_response == NULL)
+    {
+      uint64_t key = decay_response_key();
+
+      // one cache file per key, so runs with different PDG lists / chosen particles / grids don't overwrite each other
+      char key_hex[17];
+      snprintf(key_hex, sizeof(key_hex), "%016llx", (unsigned long long)key);
+
+      string decay_response_file = decay_response_prefix + key_hex + ".bin";
+
+      decay_response = new Decay_Response(key, momentum_points);
+
+      if(!decay_response->read_from_file(decay_response_file))
+      {
+        printf("Building decay response matrices...\n");
+
+        build_decay_response(chosen_index, parents, decay_channels, skipped_channels);
+
+        printf("Resonance decays: %d parents, %ld decay channels (%ld channels with > 3 or missing products / below threshold skipped)\n", (int)parents.size(), decay_channels, skipped_channels);
+
+        decay_response->write_to_file(decay_response_file);
+      }
+    }
+
+    decay_response->apply(dN_pTdpTdphidy);
+
+    printf("Decay response matrices: %d (parent, daughter) pairs, %ld nonzero weights\n", decay_response->pairs(), decay_response->nonzeros());
+  }
+  else
+  {
+    for(int parent_chosen_index : parents)
+    {
+      vector<Decay_Group> groups = resonance_decay_groups(parent_chosen_index, chosen_index, decay_channels, skipped_channels);
+
+      if(groups.size() == 0) continue;
+
+      set_parent_log_spectrum(parent_chosen_index, particles->mass[chosen_particles_sampling_table[parent_chosen_index]]);
+
+      int number_of_groups = groups.size();
+
+      vector<double> feed_down(number_of_groups * momentum_points, 0.0);
+
+      #pragma omp parallel for collapse(2) schedule(dynamic)
+      for(int igroup = 0; igroup < number_of_groups; igroup++)
+      {
+        for(long ipoint = 0; ipoint < momentum_points; ipoint++)
+        {
+          // ipoint = iy + y_tab_length * (iphip + phi_tab_length * ipT)
+          long iy = ipoint % y_tab_length;
+          long iphip = (ipoint / y_tab_length) % phi_tab_length;
+          long ipT = ipoint / (y_tab_length * phi_tab_length);
+
+          feed_down[ipoint  +  momentum_points * igroup] = decay_feed_down(groups[igroup], pT_values[ipT], phip_values[iphip], y_values[iy]);
+        }
+      }
+
+      // add the feed-down to the daughters' spectra
+      for(int igroup = 0; igroup < number_of_groups; igroup++)
+      {
+        double * dN_daughter = dN_pTdpTdphidy  +  momentum_points * groups[igroup].daughter;
+
+        for(long ipoint = 0; ipoint < momentum_points; ipoint++)
+        {
+          dN_daughter[ipoint] += feed_down[ipoint  +  momentum_points * igroup];
+        }
+      }
+    }
+
+    printf("Resonance decays: %d parents, %ld decay channels (%ld channels with > 3 or missing products / below threshold skipped)\n", (int)parents.size(), decay_channels, skipped_channels);
+  }
+
+#ifdef OPENMP
+  double t2 = omp_get_wtime();
+  cout << "Resonance decays took " << (t2 - t1) << " seconds\n" << endl;
+#else
+  double duration = (clock() - start) / (double)CLOCKS_PER_SEC;
+  cout << "Resonance decays took " << duration << " seconds\n" << endl;
+#endif
+}
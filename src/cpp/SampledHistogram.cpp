@@ -0,0 +1,115 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SampledHistogram.h"
+
+using namespace std;
+
+
+Histogram_Axis::Histogram_Axis(int bins_in, double min_in, double max_in)
+{
+  bins = bins_in;
+  min = min_in;
+  max = max_in;
+
+  if(bins < 1 || max <= min)
+  {
+    printf("Histogram_Axis error: need bins = %d >= 1 and max = %lf > min = %lf\n", bins, max, min);
+    exit(-1);
+  }
+
+  width = (max - min) / (double)bins;
+}
+
+
+double Histogram_Axis::midpoint(int ibin) const
+{
+  return min  +  width * ((double)ibin + 0.5);
+}
+
+
+
+Sampled_Histogram::Sampled_Histogram(int npart_in)
+{
+  npart = npart_in;
+
+  // one copy per OpenMP thread (fill is called from the parallel loops whether or not OPENMP is set in Macros.h)
+  threads = 1;
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+
+  length = 0;
+  counts = NULL;
+  merged = false;
+}
+
+
+Sampled_Histogram::~Sampled_Histogram()
+{
+  free(counts);
+}
+
+
+int Sampled_Histogram::add_observable(Histogram_Axis axis_in, int components_in)
+{
+  if(counts != NULL)
+  {
+    printf("Sampled_Histogram error: observables must be added before allocate()\n");
+    exit(-1);
+  }
+
+  axis.push_back(axis_in);
+  components.push_back(components_in);
+  offset.push_back(length);
+
+  length += (long)components_in * axis_in.bins * npart;
+
+  return axis.size() - 1;
+}
+
+
+void Sampled_Histogram::allocate()
+{
+  counts = (double *)calloc(length * threads, sizeof(double));
+
+  if(counts == NULL)
+  {
+    printf("Sampled_Histogram error: could not allocate %ld histogram bins\n", length * threads);
+    exit(-1);
+  }
+}
+
+
+void Sampled_Histogram::merge()
+{
+  if(merged) return;
+
+  for(int thread = 1; thread < threads; thread++)
+  {
+    const double * counts_thread = counts  +  length * thread;
+
+    #pragma omp parallel for
+    for(long i = 0; i < length; i++)
+    {
+      counts[i] += counts_thread[i];
+    }
+  }
+
+  merged = true;
+}
+
+
+const Histogram_Axis & Sampled_Histogram::get_axis(int id)
+{
+  return axis[id];
+}
+
+
+double Sampled_Histogram::get(int id, int ipart, int ibin, int icomp)
+{
+  merge();
+
+  return counts[offset[id]  +  icomp  +  (long)components[id] * (ibin  +  (long)axis[id].bins * ipart)];
+}
@@ -0,0 +1,98 @@
+
+#ifndef SAMPLEDHISTOGRAM_H
+#define SAMPLEDHISTOGRAM_H
+
+#include <vector>
+#include <cmath>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+using namespace std;
+
+
+// uniform bins of a sampled observable x in [min, max)
+class Histogram_Axis
+{
+  public:
+    int bins;
+    double min;
+    double max;
+    double width;
+
+    Histogram_Axis(int bins_in = 1, double min_in = 0.0, double max_in = 1.0);
+
+    inline int bin(double x) const          // bin index (-1 if x is outside the range)
+    {
+      double s = (x - min) / width;
+      if(!(s >= 0.0) || s >= (double)bins) return -1;
+      return (int)s;
+    }
+
+    double midpoint(int ibin) const;
+};
+
+
+// histograms of sampled particles for all chosen species (for sampler tests)
+//
+// every observable is a set of (components) accumulators per bin and species,
+// all observables share one contiguous allocation that is repeated for each thread:
+//
+//   counts[offset[id]  +  icomp  +  components[id] * (ibin  +  bins[id] * ipart)  +  length * thread]
+//
+// fill() only touches the calling thread's copy, merge() sums the copies into thread 0
+
+class Sampled_Histogram
+{
+  private:
+    int npart;                              // number of chosen particles
+    int threads;                            // number of per-thread copies (OpenMP threads)
+
+    vector<Histogram_Axis> axis;            // binning of each observable
+    vector<int> components;                 // accumulators per bin (e.g. count, cos(n.phi), sin(n.phi))
+    vector<long> offset;                    // start of each observable in a thread copy
+
+    long length;                            // size of one thread copy
+    double * counts;
+
+    bool merged;
+
+    inline int thread_index()               // copies are sized by omp_get_max_threads()
+    {
+    #ifdef _OPENMP
+      return omp_get_thread_num();
+    #else
+      return 0;
+    #endif
+    }
+
+  public:
+    Sampled_Histogram(int npart_in);
+    ~Sampled_Histogram();
+
+    int add_observable(Histogram_Axis axis_in, int components_in = 1);   // returns id (call before allocate)
+    void allocate();
+
+    // accumulators of the bin containing x for the calling thread (NULL if x is outside the range)
+    inline double * bin_accumulators(int id, int ipart, double x)
+    {
+      int ibin = axis[id].bin(x);
+      if(ibin < 0) return NULL;
+
+      return counts  +  length * thread_index()  +  offset[id]  +  (long)components[id] * (ibin  +  (long)axis[id].bins * ipart);
+    }
+
+    inline void fill(int id, int ipart, double x, double weight = 1.0)
+    {
+      double * accumulator = bin_accumulators(id, ipart, x);
+      if(accumulator != NULL) accumulator[0] += weight;
+    }
+
+    void merge();                           // sum the thread copies (once, after sampling)
+
+    const Histogram_Axis & get_axis(int id);
+    double get(int id, int ipart, int ibin, int icomp = 0);   // merged value
+};
+
+#endif
@@ -1,6 +1,12 @@
 #ifndef PARTICLE_H
 #define PARTICLE_H
 
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cmath>
+#include <stdint.h>
+
 // class particle
 // {
 // public:
@@ -53,4 +59,96 @@ public:
   double pz = 0;
 };
 
+
+class Compact_Particle
+{
+  // compact record of a sampled particle held in the sampler's event lists (32 vs 96 bytes)
+  // mass and mcID follow from chosen_index, (t,z) from (tau,eta) and E from the mass and 3-momentum
+
+public:
+
+  uint16_t chosen_index = 0;  // chosen particle index
+
+  float tau = 0;              // spacetime position of sampled particle
+  float x = 0;
+  float y = 0;
+  float eta = 0;
+
+  float px = 0;               // cartesian momentum
+  float py = 0;
+  float pz = 0;
+
+  double t() const {return (double)tau * cosh((double)eta);}
+  double z() const {return (double)tau * sinh((double)eta);}
+  double E(double mass) const {return sqrt(mass * mass  +  (double)px * px  +  (double)py * py  +  (double)pz * pz);}
+
+  Sampled_Particle expand(double mass, int mcID) const
+  {
+    Sampled_Particle particle;
+
+    particle.chosen_index = chosen_index;
+    particle.mcID = mcID;
+    particle.mass = mass;
+    particle.tau = tau;
+    particle.x = x;
+    particle.y = y;
+    particle.eta = eta;
+    particle.t = t();
+    particle.z = z();
+    particle.E = E(mass);
+    particle.px = px;
+    particle.py = py;
+    particle.pz = pz;
+
+    return particle;
+  }
+};
+
+
+class Chosen_Species_Table
+{
+  // mass and mcID of the chosen particles (indexed by Compact_Particle::chosen_index)
+
+public:
+
+  std::vector<double> mass;
+  std::vector<int> mcID;
+};
+
+
+class Compact_Event_List
+{
+  // sampled events held as compact records; an event is only expanded to Sampled_Particle
+  // when it is accessed (the species table is shared, so the list outlives the sampler)
+
+public:
+
+  std::vector< std::vector<Compact_Particle> > events;
+  std::shared_ptr<const Chosen_Species_Table> species;
+
+  long size() const {return events.size();}
+
+  std::vector<Sampled_Particle> event(long ievent) const
+  {
+    std::vector<Sampled_Particle> particles;
+    particles.reserve(events[ievent].size());
+
+    for(const Compact_Particle & particle : events[ievent])
+    {
+      particles.push_back(particle.expand(species->mass[particle.chosen_index], species->mcID[particle.chosen_index]));
+    }
+    return particles;
+  }
+
+  void clear()
+  {
+    std::vector< std::vector<Compact_Particle> >().swap(events);
+    species.reset();
+  }
+};
+
+
+// called with (event index, sampled particle list) for each completed event
+typedef std::function<void(long, std::vector<Sampled_Particle> &&)> Particle_Event_Callback;
+
 #endif
\ No newline at end of file
@@ -28,6 +28,76 @@
 using namespace std;
 
 
+void EmissionFunctionArray::write_dN_dX_toFile(int *MCID, const double * dN_dX_all)
+{
+  // reduce the per-core (tau,r,phi) histograms of calculate_dN_dX(_feqmod) and write them to file
+  // layout: dN_dX_all[ibin  +  dX_bins * (ipart  +  npart * n)], ibin = [tau bins | r bins | phi bins]
+
+  const long taubins = TAU_BINS;
+  const long rbins = R_BINS;
+  const long phibins = PHIP_BINS;
+  const long dX_bins = taubins  +  rbins  +  phibins;
+  const long npart = number_of_chosen_particles;
+
+  vector<double> dN_dX(dX_bins);
+
+  for(long ipart = 0; ipart < npart; ipart++)
+  {
+    // sum over the cores
+    for(long ibin = 0; ibin < dX_bins; ibin++)
+    {
+      double dN_dX_tmp = 0.0;
+
+      for(long n = 0; n < CORES; n++)
+      {
+        dN_dX_tmp += dN_dX_all[ibin  +  dX_bins * (ipart  +  npart * n)];
+      }
+
+      dN_dX[ibin] = dN_dX_tmp;
+    }
+
+    char file_time[255] = "";
+    char file_radial[255] = "";
+    char file_azimuthal[255] = "";
+
+    sprintf(file_time, "results/continuous/dN_taudtaudy_%d.dat", MCID[ipart]);
+    sprintf(file_radial, "results/continuous/dN_2pirdrdy_%d.dat", MCID[ipart]);
+    sprintf(file_azimuthal, "results/continuous/dN_dphidy_%d.dat", MCID[ipart]);
+
+    ofstream time_distribution(file_time, ios_base::out);
+    ofstream radial_distribution(file_radial, ios_base::out);
+    ofstream azimuthal_distribution(file_azimuthal, ios_base::out);
+
+    // normalize by the binwidths
+    for(long ir = 0; ir < rbins; ir++)
+    {
+      double r_mid = R_MIN  +  R_WIDTH * ((double)ir + 0.5);
+
+      radial_distribution << setprecision(6) << scientific << r_mid << "\t" << dN_dX[taubins + ir] / (two_pi * r_mid * R_WIDTH)  << "\n";
+    }
+
+    for(long itau = 0; itau < taubins; itau++)
+    {
+      double tau_mid = TAU_MIN  +  TAU_WIDTH * ((double)itau + 0.5);
+
+      time_distribution << setprecision(6) << scientific << tau_mid << "\t" << dN_dX[itau] / (tau_mid * TAU_WIDTH) << "\n";
+    }
+
+    for(long iphi = 0; iphi < phibins; iphi++)
+    {
+      double phi_mid = PHIP_WIDTH * ((double)iphi + 0.5);
+
+      azimuthal_distribution << setprecision(6) << scientific << phi_mid << "\t" << dN_dX[taubins + rbins + iphi] / PHIP_WIDTH << "\n";
+    }
+
+    time_distribution.close();
+    radial_distribution.close();
+    azimuthal_distribution.close();
+
+  } // hadron species (ipart)
+}
+
+
 void EmissionFunctionArray::calculate_dN_dX(int *MCID, double *Mass, double *Sign, double *Degeneracy, double *Baryon,
 double *T_fo, double *P_fo, double *E_fo, double *tau_fo, double *x_fo, double *y_fo, double *eta_fo, double *ux_fo, double *uy_fo, double *un_fo,
 double *dat_fo, double *dax_fo, double *day_fo, double *dan_fo,
@@ -40,6 +110,9 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
   // only have boost invariance in mind right now so
   // deta = dy and only need to integrate over (pT,phi)
 
+  // one sweep over the freezeout surface: each cell's dN/dy of every species
+  // is binned into the (tau,r,phi) histograms of its core (and the emission histograms, if any)
+
   double prefactor = pow(2.0 * M_PI * hbarC, -3);   // prefactor of CFF
 
   long FO_chunk = FO_length / CORES;
@@ -93,7 +166,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
   }
   else if(DIMENSION == 3)
   {
-    etaValues[0] = 0.0;       // below, will load eta_fo
+    etaValues[0] = 0.0;       // shifted by eta_fo below
     etaWeights[0] = 1.0; // 1.0 for 3+1d
     for(long iy = 0; iy < y_tab_length; iy++)
     {
@@ -101,215 +174,209 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
     }
   }
 
-  // (tau,r,phi) grid (bin midpoints)
+  // (tau,r,phi) histograms of all species on each core
   const long taubins = TAU_BINS;
   const long rbins = R_BINS;
   const long phibins = PHIP_BINS;
+  const long dX_bins = taubins  +  rbins  +  phibins;
 
-  double tau_midpoint[taubins];
-  double r_midpoint[rbins];
-  double phi_midpoint[phibins];
-  for(long itau = 0; itau < taubins; itau++)  tau_midpoint[itau] = TAU_MIN + TAU_WIDTH * ((double)itau + 0.5);
-  for(long ir = 0; ir < rbins; ir++) r_midpoint[ir] = R_MIN + R_WIDTH * ((double)ir + 0.5);
-  for(long iphi = 0; iphi < phibins; iphi++) phi_midpoint[iphi] = PHIP_WIDTH * ((double)iphi + 0.5);
+  const long npart = number_of_chosen_particles;
 
+  double *dN_dX_all = (double*)calloc(CORES * npart * dX_bins, sizeof(double));
 
-  const int npart = number_of_chosen_particles;
+  // df coefficients of all cells (batch interpolation)
+  Deltaf_Coefficient_Columns df_columns;
 
-  double dN_taudtaudy[taubins];
-  double dN_twopirdrdy[rbins];
-  double dN_dphidy[phibins];
+  double * muB_df = (INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF) ? muB_fo : NULL;
+  double * bulkPi_df = INCLUDE_BULK_DELTAF ? bulkPi_fo : NULL;
 
-  double *dN_taudtaudy_all =  (double*)calloc(CORES * taubins, sizeof(double));
-  double *dN_twopirdrdy_all = (double*)calloc(CORES * rbins, sizeof(double));
-  double *dN_dphidy_all =  (double*)calloc(CORES * phibins, sizeof(double));
-  //double * dN_dy = (double*)calloc(npart, sizeof(double));
-  //double ** dN_dydeta = (double**)calloc(npart, sizeof(double*));
-  //for(int i = 0; i < npart; i++) dN_dydeta[i] = (double*)calloc(eta_pts, sizeof(double));
+  // only the cells with u.dsigma > 0 (the others are skipped by the kernel)
+  vector<char> emitting(FO_length);
 
-  // calculate the spacetime distributions for each particle species
-  for(int ipart = 0; ipart < npart; ipart++)
+  for(long icell = 0; icell < FO_length; icell++)
   {
-    printf("Starting spacetime distribution %d\n", MCID[ipart]);
+    double tau2 = tau_fo[icell] * tau_fo[icell];
+    double ux = ux_fo[icell];
+    double uy = uy_fo[icell];
+    double un = un_fo[icell];
+    double ut = sqrt(1.0  +  ux * ux  +  uy * uy  +  tau2 * un * un);
 
-    char file_time[255] = "";
-    char file_radial[255] = "";
-    char file_azimuthal[255] = "";
+    emitting[icell] = (ut * dat_fo[icell]  +  ux * dax_fo[icell]  +  uy * day_fo[icell]  +  un * dan_fo[icell] > 0.0);
+  }
 
-    sprintf(file_time, "results/continuous/dN_taudtaudy_%d.dat", MCID[ipart]);
-    sprintf(file_radial, "results/continuous/dN_2pirdrdy_%d.dat", MCID[ipart]);
-    sprintf(file_azimuthal, "results/continuous/dN_dphidy_%d.dat", MCID[ipart]);
+  df_data->evaluate_df_coefficients(FO_length, T_fo, muB_df, E_fo, P_fo, bulkPi_df, emitting.data(), df_columns);
 
-    ofstream time_distribution(file_time, ios_base::app);
-    ofstream radial_distribution(file_radial, ios_base::app);
-    ofstream azimuthal_distribution(file_azimuthal, ios_base::app);
+  #pragma omp parallel for
+  for(long n = 0; n < CORES; n++)
+  {
+    // dN/dy of the cell at each (pT, eta) point (for the emission histograms binned in pT or etas)
+    double *node_weights = NULL;
+    if(emission_histograms != NULL && emission_histograms->uses_nodes()) node_weights = (double*)calloc(pT_tab_length * eta_tab_length, sizeof(double));
 
-    // rapidity distribution
-    //char file_rapidity[255] = "";
-    //sprintf(file_rapidity, "results/continuous/dN_dydeta_%d_%dpt.dat", MCID[ipart], eta_tab_length);
-    //ofstream rapidity_distribution(file_rapidity, ios_base::out);
+    long endFO = FO_chunk;
 
-    // set particle properties
-    double mass = Mass[ipart];              // mass (GeV)
-    double mass2 = mass * mass;
-    double sign = Sign[ipart];              // quantum statistics sign
-    double degeneracy = Degeneracy[ipart];  // spin degeneracy
-    double baryon = Baryon[ipart];          // baryon number
+    for(long icell = 0; icell < endFO; icell++)  // cell index inside each chunk
+    {
+      if((icell == endFO - 1) && (remainder != 0) && (n > remainder - 1)) continue;
 
-    // reset spacetime distributions to zero
-    for(long itau = 0; itau < taubins; itau++) dN_taudtaudy[itau] = 0.0;
-    for(long ir = 0; ir < rbins; ir++) dN_twopirdrdy[ir] = 0.0;
-    for(long iphi = 0; iphi < phibins; iphi++) dN_dphidy[iphi] = 0.0;
+      long icell_glb = n  +  icell * CORES;
 
+      double tau = tau_fo[icell_glb];         // longitudinal proper time
+      double x_pos = x_fo[icell_glb];         // x position
+      double y_pos = y_fo[icell_glb];         // y position
 
-    // reset spacetime distributions of chunks to zero
-    memset(dN_taudtaudy_all, 0.0, CORES * taubins);
-    memset(dN_twopirdrdy_all, 0.0, CORES * rbins);
-    memset(dN_dphidy_all, 0.0, CORES * phibins);
+      // determine which spacetime bins the freezeout cell lies in
+      double r = sqrt(x_pos * x_pos  +  y_pos * y_pos);
+      double phi = atan2(y_pos, x_pos);
+      if(phi < 0.0) phi += two_pi;
 
-    #pragma omp parallel for
-    for(long n = 0; n < CORES; n++)
-    {
-      long endFO = FO_chunk;
+      long itau = (long)floor((tau - TAU_MIN) / TAU_WIDTH);
+      long ir = (long)floor((r - R_MIN) / R_WIDTH);
+      long iphi = (long)floor(phi / PHIP_WIDTH);
 
-      for(long icell = 0; icell < endFO; icell++)  // cell index inside each chunk
-      {
-	      if((icell == endFO - 1) && (remainder != 0) && (n > remainder - 1)) continue;
+      bool tau_bin = (itau >= 0 && itau < taubins);
+      bool r_bin = (ir >= 0 && ir < rbins);
+      bool phi_bin = (iphi >= 0 && iphi < phibins);
 
-	      long icell_glb = n  +  icell * CORES;
+      double eta_shift = (DIMENSION == 3) ? eta_fo[icell_glb] : 0.0;  // spacetime rapidity from surface file (3+1d)
 
-        double tau = tau_fo[icell_glb];         // longitudinal proper time
-        double x_pos = x_fo[icell_glb];         // x position
-        double y_pos = y_fo[icell_glb];         // y position
+      bool histogram_cell = (emission_histograms != NULL) && emission_histograms->set_cell(n, tau, r, phi, eta_shift);
 
-        double tau2 = tau * tau;
-        if(DIMENSION == 3)
-        {
-          etaValues[0] = eta_fo[icell_glb];     // spacetime rapidity from surface file
-        }
+      if(!tau_bin && !r_bin && !phi_bin && !histogram_cell) continue;    // cell is outside the histograms
 
-        double dat = dat_fo[icell_glb];         // covariant normal surface vector
-        double dax = dax_fo[icell_glb];
-        double day = day_fo[icell_glb];
-        double dan = dan_fo[icell_glb];         // dan should be 0 for 2+1d
-
-        double ux = ux_fo[icell_glb];           // contravariant fluid velocity
-        double uy = uy_fo[icell_glb];           // enforce normalization
-        double un = un_fo[icell_glb];
-        double ut = sqrt(1.0  +  ux * ux  +  uy * uy  +  tau2 * un * un);
-
-         // skip cells with u.dsigma < 0
-        if(ut * dat  +  ux * dax  +  uy * day  +  un * dan <= 0.0) continue;
-
-        double ux2 = ux * ux;                   // useful expressions
-        double uy2 = uy * uy;
-        double ut2 = ut * ut;
-        double utperp = sqrt(1.0  +  ux * ux  +  uy * uy);
-
-        double T = T_fo[icell_glb];             // temperature (GeV)
-        double P = P_fo[icell_glb];             // equilibrium pressure (GeV/fm^3)
-        double E = E_fo[icell_glb];             // energy density (GeV/fm^3)
-
-        double pitt = 0.0;                      // contravariant shear stress tensor pi^munu (GeV/fm^3)
-        double pitx = 0.0;                      // enforce orthogonality pi.u = 0
-        double pity = 0.0;                      // and tracelessness Tr(pi) = 0
-        double pitn = 0.0;
-        double pixx = 0.0;
-        double pixy = 0.0;
-        double pixn = 0.0;
-        double piyy = 0.0;
-        double piyn = 0.0;
-        double pinn = 0.0;
-
-        if(INCLUDE_SHEAR_DELTAF)
-        {
-          pixx = pixx_fo[icell_glb];
-          pixy = pixy_fo[icell_glb];
-          pixn = pixn_fo[icell_glb];
-          piyy = piyy_fo[icell_glb];
-          piyn = piyn_fo[icell_glb];
-          pinn = (pixx * (ux2 - ut2)  +  piyy * (uy2 - ut2)  +  2.0 * (pixy * ux * uy  +  tau2 * un * (pixn * ux  +  piyn * uy))) / (tau2 * utperp * utperp);
-          pitn = (pixn * ux  +  piyn * uy  +  tau2 * pinn * un) / ut;
-          pity = (pixy * ux  +  piyy * uy  +  tau2 * piyn * un) / ut;
-          pitx = (pixx * ux  +  pixy * uy  +  tau2 * pixn * un) / ut;
-          pitt = (pitx * ux  +  pity * uy  +  tau2 * pitn * un) / ut;
-        }
+      double tau2 = tau * tau;
 
-        double bulkPi = 0.0;                    // bulk pressure (GeV/fm^3)
+      double dat = dat_fo[icell_glb];         // covariant normal surface vector
+      double dax = dax_fo[icell_glb];
+      double day = day_fo[icell_glb];
+      double dan = dan_fo[icell_glb];         // dan should be 0 for 2+1d
 
-        if(INCLUDE_BULK_DELTAF) bulkPi = bulkPi_fo[icell_glb];
+      double ux = ux_fo[icell_glb];           // contravariant fluid velocity
+      double uy = uy_fo[icell_glb];           // enforce normalization
+      double un = un_fo[icell_glb];
+      double ut = sqrt(1.0  +  ux * ux  +  uy * uy  +  tau2 * un * un);
 
-        double muB = 0.0;                       // baryon chemical potential (GeV)
-        double alphaB = 0.0;                    // muB / T
-        double nB = 0.0;                        // net baryon density (fm^-3)
-        double Vt = 0.0;                        // contravariant net baryon diffusion V^mu (fm^-3)
-        double Vx = 0.0;                        // enforce orthogonality V.u = 0
-        double Vy = 0.0;
-        double Vn = 0.0;
-        double baryon_enthalpy_ratio = 0.0;     // nB / (E + P)
+       // skip cells with u.dsigma < 0
+      if(ut * dat  +  ux * dax  +  uy * day  +  un * dan <= 0.0) continue;
 
-        if(INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF)
-        {
-          muB = muB_fo[icell_glb];
-          nB = nB_fo[icell_glb];
-          Vx = Vx_fo[icell_glb];
-          Vy = Vy_fo[icell_glb];
-          Vn = Vn_fo[icell_glb];
-          Vt = (Vx * ux  +  Vy * uy  +  tau2 * Vn * un) / ut;
-
-          alphaB = muB / T;
-          baryon_enthalpy_ratio = nB / (E + P);
-        }
+      double ux2 = ux * ux;                   // useful expressions
+      double uy2 = uy * uy;
+      double ut2 = ut * ut;
+      double utperp = sqrt(1.0  +  ux * ux  +  uy * uy);
 
-        double chem = baryon * alphaB;          // chemical potential term in feq
+      double T = T_fo[icell_glb];             // temperature (GeV)
+      double P = P_fo[icell_glb];             // equilibrium pressure (GeV/fm^3)
+      double E = E_fo[icell_glb];             // energy density (GeV/fm^3)
+
+      double pitt = 0.0;                      // contravariant shear stress tensor pi^munu (GeV/fm^3)
+      double pitx = 0.0;                      // enforce orthogonality pi.u = 0
+      double pity = 0.0;                      // and tracelessness Tr(pi) = 0
+      double pitn = 0.0;
+      double pixx = 0.0;
+      double pixy = 0.0;
+      double pixn = 0.0;
+      double piyy = 0.0;
+      double piyn = 0.0;
+      double pinn = 0.0;
+
+      if(INCLUDE_SHEAR_DELTAF)
+      {
+        pixx = pixx_fo[icell_glb];
+        pixy = pixy_fo[icell_glb];
+        pixn = pixn_fo[icell_glb];
+        piyy = piyy_fo[icell_glb];
+        piyn = piyn_fo[icell_glb];
+        pinn = (pixx * (ux2 - ut2)  +  piyy * (uy2 - ut2)  +  2.0 * (pixy * ux * uy  +  tau2 * un * (pixn * ux  +  piyn * uy))) / (tau2 * utperp * utperp);
+        pitn = (pixn * ux  +  piyn * uy  +  tau2 * pinn * un) / ut;
+        pity = (pixy * ux  +  piyy * uy  +  tau2 * piyn * un) / ut;
+        pitx = (pixx * ux  +  pixy * uy  +  tau2 * pixn * un) / ut;
+        pitt = (pitx * ux  +  pity * uy  +  tau2 * pitn * un) / ut;
+      }
+
+      double bulkPi = 0.0;                    // bulk pressure (GeV/fm^3)
+
+      if(INCLUDE_BULK_DELTAF) bulkPi = bulkPi_fo[icell_glb];
+
+      double muB = 0.0;                       // baryon chemical potential (GeV)
+      double alphaB = 0.0;                    // muB / T
+      double nB = 0.0;                        // net baryon density (fm^-3)
+      double Vt = 0.0;                        // contravariant net baryon diffusion V^mu (fm^-3)
+      double Vx = 0.0;                        // enforce orthogonality V.u = 0
+      double Vy = 0.0;
+      double Vn = 0.0;
+      double baryon_enthalpy_ratio = 0.0;     // nB / (E + P)
+
+      if(INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF)
+      {
+        muB = muB_fo[icell_glb];
+        nB = nB_fo[icell_glb];
+        Vx = Vx_fo[icell_glb];
+        Vy = Vy_fo[icell_glb];
+        Vn = Vn_fo[icell_glb];
+        Vt = (Vx * ux  +  Vy * uy  +  tau2 * Vn * un) / ut;
+
+        alphaB = muB / T;
+        baryon_enthalpy_ratio = nB / (E + P);
+      }
 
-        // set df coefficients
-        deltaf_coefficients df = df_data->evaluate_df_coefficients(T, muB, E, P, bulkPi);
+      // set df coefficients
+      deltaf_coefficients df = df_columns.get(icell_glb);
 
-        double c0 = df.c0;             // 14 moment coefficients
-        double c1 = df.c1;
-        double c2 = df.c2;
-        double c3 = df.c3;
-        double c4 = df.c4;
+      double c0 = df.c0;             // 14 moment coefficients
+      double c1 = df.c1;
+      double c2 = df.c2;
+      double c3 = df.c3;
+      double c4 = df.c4;
 
-        double F = df.F;               // Chapman Enskog
-        double G = df.G;
-        double betabulk = df.betabulk;
-        double betaV = df.betaV;
-        double betapi = df.betapi;
+      double F = df.F;               // Chapman Enskog
+      double G = df.G;
+      double betabulk = df.betabulk;
+      double betaV = df.betaV;
+      double betapi = df.betapi;
 
-        // evaluate shear and bulk coefficients
-        double shear_coeff = 0.0;
-        double bulk0_coeff = 0.0;
-        double bulk1_coeff = 0.0;
-        double bulk2_coeff = 0.0;
+      // evaluate shear and bulk coefficients
+      double shear_coeff = 0.0;
+      double bulk0_coeff = 0.0;
+      double bulk1_coeff = 0.0;
+      double bulk2_coeff = 0.0;
 
-        switch(DF_MODE)
+      switch(DF_MODE)
+      {
+        case 1: // 14 moment
         {
-          case 1: // 14 moment
-          {
-            shear_coeff = 0.5 / (T * T * (E + P));
-            bulk0_coeff = c0 - c2;
-            bulk1_coeff = c1;
-            bulk2_coeff = 4.0 * c2  -  c0;
-            break;
-          }
-          case 2: // Chapman enskog
-          {
-            shear_coeff = 0.5 / (betapi * T);
-            bulk0_coeff = F / (T * T * betabulk);
-            bulk1_coeff = G / betabulk;
-            bulk2_coeff = 1.0 / (3.0 * T * betabulk);
-            break;
-          }
-          default:
-          {
-            printf("Error: set df_mode = (1,2) in parameters.dat\n"); exit(-1);
-          }
+          shear_coeff = 0.5 / (T * T * (E + P));
+          bulk0_coeff = c0 - c2;
+          bulk1_coeff = c1;
+          bulk2_coeff = 4.0 * c2  -  c0;
+          break;
         }
+        case 2: // Chapman enskog
+        {
+          shear_coeff = 0.5 / (betapi * T);
+          bulk0_coeff = F / (T * T * betabulk);
+          bulk1_coeff = G / betabulk;
+          bulk2_coeff = 1.0 / (3.0 * T * betabulk);
+          break;
+        }
+        default:
+        {
+          printf("Error: set df_mode = (1,2) in parameters.dat\n"); exit(-1);
+        }
+      }
+
+      // now loop over all particle species
+      for(long ipart = 0; ipart < npart; ipart++)
+      {
+        double mass = Mass[ipart];              // mass (GeV)
+        double mass2 = mass * mass;
+        double sign = Sign[ipart];              // quantum statistics sign
+        double degeneracy = Degeneracy[ipart];  // spin degeneracy
+        double baryon = Baryon[ipart];          // baryon number
+        double chem = baryon * alphaB;          // chemical potential term in feq
 
+        if(node_weights != NULL) memset(node_weights, 0, pT_tab_length * eta_tab_length * sizeof(double));
 
-        // compute the dNdy of each freezeout cell (integrating over pT,phi)
+        // compute the dNdy of the freezeout cell (integrating over pT,phi)
         double dN_dy_cell = 0.0;
 
         for(long ipT = 0; ipT < pT_tab_length; ipT++)
@@ -336,7 +403,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
               // sum over eta
               for(long ieta = 0; ieta < eta_tab_length; ieta++)
               {
-                double eta = etaValues[ieta];
+                double eta = etaValues[ieta]  +  eta_shift;
                 double eta_weight = etaWeights[ieta];
 
                 double pt = mT * cosh(y - eta);           // p^\tau (GeV)
@@ -394,8 +461,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
 
                 eta_integral += (pdotdsigma * f);
 
-                //dN_dydeta[ipart][ieta] += (pT_weight * phi_weight * prefactor * degeneracy * pdotdsigma * f / eta_weight);
-
+                if(node_weights != NULL) node_weights[ieta  +  eta_tab_length * ipT] += (pT_weight * phi_weight * prefactor * degeneracy * pdotdsigma * f);
 
               } // eta points (ieta)
 
@@ -407,113 +473,27 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Delt
 
         } // transverse momentum points (ipT)
 
-        //dN_dy[ipart] += dN_dy_cell;
-
-
-        // now determine which spacetime bin the freezeout cell lies
-        double r = sqrt(x_pos * x_pos  +  y_pos * y_pos);
-        double phi = atan2(y_pos, x_pos);
-        if(phi < 0.0) phi += two_pi;
-
-        // bin index
-        long itau = (int)floor((tau - TAU_MIN) / TAU_WIDTH);
-        long ir = (int)floor((r - R_MIN) / R_WIDTH);
-        long iphi = (int)floor(phi / PHIP_WIDTH);
-
         // add dNdy to the corresponding bin(s)
-        if(itau >= 0 && itau < taubins)
-        {
-          long itau_all = itau  +  n * taubins;
-          dN_taudtaudy_all[itau_all] += dN_dy_cell;
-        }
-
-        if(ir >= 0 && ir < rbins)
-        {
-          long ir_all = ir  +  n * rbins;
-          dN_twopirdrdy_all[ir_all] += dN_dy_cell;
-        }
-
-        if(iphi >= 0 && iphi < phibins)
-        {
-          long iphi_all = iphi  +  n * phibins;
-          dN_dphidy_all[iphi_all] += dN_dy_cell;
-        }
-
+        double *dN_dX_cell = dN_dX_all  +  dX_bins * (ipart  +  npart * n);
 
-      } // freezeout cells (icell)
+        if(tau_bin) dN_dX_cell[itau] += dN_dy_cell;
+        if(r_bin) dN_dX_cell[taubins + ir] += dN_dy_cell;
+        if(phi_bin) dN_dX_cell[taubins + rbins + iphi] += dN_dy_cell;
 
-    } // chunks or cores (n)
+        if(histogram_cell) emission_histograms->fill_cell(n, ipart, dN_dy_cell, node_weights);
 
+      } // hadron species (ipart)
 
-    // write spacetime distributions to file (normalize by the binwidths)
-    for(long ir = 0; ir < rbins; ir++)
-    {
-      // sum over the cores
-      for(long n = 0; n < CORES; n++)
-      {
-        long ir_all = ir  +  n * rbins;
-        dN_twopirdrdy[ir] += dN_twopirdrdy_all[ir_all];
-      }
+    } // freezeout cells (icell)
 
-      double r_mid = r_midpoint[ir];
+    free(node_weights);
 
-      radial_distribution << setprecision(6) << scientific << r_mid << "\t" << dN_twopirdrdy[ir] / (two_pi * r_mid * R_WIDTH)  << "\n";
-    }
+  } // chunks or cores (n)
 
-    for(long itau = 0; itau < taubins; itau++)
-    {
-      // sum over the cores
-      for(long n = 0; n < CORES; n++)
-      {
-        long itau_all = itau  +  n * taubins;
-        dN_taudtaudy[itau] += dN_taudtaudy_all[itau_all];
-
-      } // sum over the cores
-
-      double tau_mid = tau_midpoint[itau];
-
-      time_distribution << setprecision(6) << scientific << tau_mid << "\t" << dN_taudtaudy[itau] / (tau_mid * TAU_WIDTH) << "\n";
-    }
-
-    for(long iphi = 0; iphi < phibins; iphi++)
-    {
-      // sum over the cores
-      for(long n = 0; n < CORES; n++)
-      {
-        long iphi_all = iphi  +  n * phibins;
-        dN_dphidy[iphi] += dN_dphidy_all[iphi_all];
-      }
-
-      double phi_mid = phi_midpoint[iphi];
-
-      azimuthal_distribution << setprecision(6) << scientific << phi_mid << "\t" << dN_dphidy[iphi] / PHIP_WIDTH << "\n";
-    }
-
-    // close files
-    time_distribution.close();
-    radial_distribution.close();
-    azimuthal_distribution.close();
-
-    // write rapidity distribution to file
-    // for(int ieta = 0; ieta < eta_pts; ieta++)
-    // {
-    //   rapidity_distribution << setprecision(6) << scientific << etaValues[ieta] << "\t" << dN_dydeta[ipart][ieta] << "\n";
-    // }
-    // rapidity_distribution.close();
-
-  } // hadron species (ipart)
-
-  // for(int i = 0; i < npart; i++)
-  // {
-  //   printf("dN_dy = %lf\n", dN_dy[i]);
-  // }
-
-  //free_2D(dN_dydeta, npart);
-  //free(dN_dy);
-  free(dN_taudtaudy_all);
-  free(dN_twopirdrdy_all);
-  free(dN_dphidy_all);
+  // write spacetime distributions to file
+  write_dN_dX_toFile(MCID, dN_dX_all);
 
+  free(dN_dX_all);
 }
 
 
@@ -531,6 +511,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
 
   // you compute the spatial distributions by setting up a spacetime
   // grid and binning the freezeout cell's mean particle number
+  // (the cell's momentum transformation is set up once for all species)
 
   double prefactor = pow(2.0 * M_PI * hbarC, -3);   // prefactor of CFF
   long FO_chunk = FO_length / CORES;
@@ -543,7 +524,6 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
   if(remainder != 0) FO_chunk++;
 
   double detA_min = DETA_MIN;   // default value for minimum detA
-  int breakdown = 0;            // # times feqmod breaks down
 
   // phi arrays
   double cosphiValues[phi_tab_length];
@@ -587,7 +567,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
   }
   else if(DIMENSION == 3)
   {
-    etaValues[0] = 0.0;       // below, will load eta_fo
+    etaValues[0] = 0.0;       // shifted by eta_fo below
     etaWeights[0] = 1.0; // 1.0 for 3+1d
     for(int iy = 0; iy < y_tab_length; iy++)
     {
@@ -595,336 +575,300 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
     }
   }
 
-  // (tau,r,phi) grid (bin midpoints)
+  // (tau,r,phi) histograms of all species on each core
   const long taubins = TAU_BINS;
   const long rbins = R_BINS;
   const long phibins = PHIP_BINS;
+  const long dX_bins = taubins  +  rbins  +  phibins;
 
-  double tau_midpoint[taubins];
-  double r_midpoint[rbins];
-  double phi_midpoint[phibins];
-  for(long itau = 0; itau < taubins; itau++)  tau_midpoint[itau] = TAU_MIN + TAU_WIDTH * ((double)itau + 0.5);
-  for(long ir = 0; ir < rbins; ir++) r_midpoint[ir] = R_MIN + R_WIDTH * ((double)ir + 0.5);
-  for(long iphi = 0; iphi < phibins; iphi++) phi_midpoint[iphi] = PHIP_WIDTH * ((double)iphi + 0.5);
-
-  const int npart = number_of_chosen_particles;
-
-  double dN_taudtaudy[taubins];
-  double dN_twopirdrdy[rbins];
-  double dN_dphidy[phibins];
+  const long npart = number_of_chosen_particles;
 
-  double *dN_taudtaudy_all =  (double*)calloc(CORES * taubins, sizeof(double));
-  double *dN_twopirdrdy_all = (double*)calloc(CORES * rbins, sizeof(double));
-  double *dN_dphidy_all =  (double*)calloc(CORES * phibins, sizeof(double));
+  double *dN_dX_all = (double*)calloc(CORES * npart * dX_bins, sizeof(double));
 
 
   /// gauss laguerre roots
   const int pbar_pts = laguerre->points;
 
   double * pbar_root1 = laguerre->root[1];
-  double * pbar_root2 = laguerre->root[2];
 
   double * pbar_weight1 = laguerre->weight[1];
-  double * pbar_weight2 = laguerre->weight[2];
 
-  // double * dN_dy = (double*)calloc(npart, sizeof(double));
-  // double ** dN_dydeta = (double**)calloc(npart, sizeof(double*));
-  // for(int i = 0; i < npart; i++) dN_dydeta[i] = (double*)calloc(eta_tab_length, sizeof(double));
+  // weighted roots of the feq moments in the feqmod renormalization (df_mode = 3), computed once instead of per cell and hadron
+  const int renorm_moments = neq_moment | J10_moment | J20_moment;
+  vector<double> renorm_weight_exp(3 * pbar_pts);
+  GaussThermal_weight_exp(renorm_moments, laguerre->root, laguerre->weight, pbar_pts, renorm_weight_exp.data());
 
-  // calculate the spacetime distributions for each particle species
-  for(int ipart = 0; ipart < npart; ipart++)
+
+  #pragma omp parallel for
+  for(long n = 0; n < CORES; n++)
   {
-    // make the files
-     printf("Starting spacetime distribution %d\n", MCID[ipart]);
+    double ** A_copy = (double**)calloc(3, sizeof(double*));
+    for(int i = 0; i < 3; i++) A_copy[i] = (double*)calloc(3, sizeof(double));
 
-    char file_time[255] = "";
-    char file_radial[255] = "";
-    char file_azimuthal[255] = "";
+    double ** A_inv = (double**)calloc(3, sizeof(double*));
+    for(int i = 0; i < 3; i++) A_inv[i] = (double*)calloc(3, sizeof(double));
 
-    sprintf(file_time, "results/continuous/dN_taudtaudy_%d.dat", MCID[ipart]);
-    sprintf(file_radial, "results/continuous/dN_2pirdrdy_%d.dat", MCID[ipart]);
-    sprintf(file_azimuthal, "results/continuous/dN_dphidy_%d.dat", MCID[ipart]);
+    // dN/dy of the cell at each (pT, eta) point (for the emission histograms binned in pT or etas)
+    double *node_weights = NULL;
+    if(emission_histograms != NULL && emission_histograms->uses_nodes()) node_weights = (double*)calloc(pT_tab_length * eta_tab_length, sizeof(double));
 
-    ofstream time_distribution(file_time, ios_base::app);
-    ofstream radial_distribution(file_radial, ios_base::app);
-    ofstream azimuthal_distribution(file_azimuthal, ios_base::app);
+    long endFO = FO_chunk;
 
-    // rapidity distribution
-    //char file_rapidity[255] = "";
-    //sprintf(file_rapidity, "results/continuous/dN_dydeta_%d_%dpt.dat", MCID[ipart], eta_tab_length);
-    //ofstream rapidity_distribution(file_rapidity, ios_base::out);
+    for(long icell = 0; icell < endFO; icell++)
+    {
+      if((icell == endFO - 1) && (remainder != 0) && (n > remainder - 1)) continue;
 
-    // set particle properties
-    double mass = Mass[ipart];              // mass (GeV)
-    double mass2 = mass * mass;
-    double sign = Sign[ipart];              // quantum statistics sign
-    double degeneracy = Degeneracy[ipart];  // spin degeneracy
-    double baryon = Baryon[ipart];          // baryon number
+      long icell_glb = n  +  icell * CORES;   // global cell index
 
-    // reset spacetime distributions to zero
-    for(long itau = 0; itau < taubins; itau++) dN_taudtaudy[itau] = 0.0;
-    for(long ir = 0; ir < rbins; ir++) dN_twopirdrdy[ir] = 0.0;
-    for(long iphi = 0; iphi < phibins; iphi++) dN_dphidy[iphi] = 0.0;
+      double tau = tau_fo[icell_glb];         // longitudinal proper time
+      double x_pos = x_fo[icell_glb];         // x position
+      double y_pos = y_fo[icell_glb];         // y position
 
+      // determine which spacetime bins the freezeout cell lies in
+      double r = sqrt(x_pos * x_pos  +  y_pos * y_pos);
+      double phi = atan2(y_pos, x_pos);
+      if(phi < 0.0) phi += two_pi;
 
-    // reset spacetime distributions of chunks to zero
-    memset(dN_taudtaudy_all, 0.0, CORES * taubins);
-    memset(dN_twopirdrdy_all, 0.0, CORES * rbins);
-    memset(dN_dphidy_all, 0.0, CORES * phibins);
+      long itau = (long)floor((tau - TAU_MIN) / TAU_WIDTH);
+      long ir = (long)floor((r - R_MIN) / R_WIDTH);
+      long iphi = (long)floor(phi / PHIP_WIDTH);
 
+      bool tau_bin = (itau >= 0 && itau < taubins);
+      bool r_bin = (ir >= 0 && ir < rbins);
+      bool phi_bin = (iphi >= 0 && iphi < phibins);
 
-    #pragma omp parallel for
-    for(long n = 0; n < CORES; n++)
-    {
-      double ** A_copy = (double**)calloc(3, sizeof(double*));
-      for(int i = 0; i < 3; i++) A_copy[i] = (double*)calloc(3, sizeof(double));
+      double eta_shift = (DIMENSION == 3) ? eta_fo[icell_glb] : 0.0;  // spacetime rapidity from surface file (3+1d)
 
-      double ** A_inv = (double**)calloc(3, sizeof(double*));
-      for(int i = 0; i < 3; i++) A_inv[i] = (double*)calloc(3, sizeof(double));
+      bool histogram_cell = (emission_histograms != NULL) && emission_histograms->set_cell(n, tau, r, phi, eta_shift);
 
-      long endFO = FO_chunk;
+      if(!tau_bin && !r_bin && !phi_bin && !histogram_cell) continue;    // cell is outside the histograms
 
-      for(long icell = 0; icell < endFO; icell++)
-      {
-        if((icell == endFO - 1) && (remainder != 0) && (n > remainder - 1)) continue;
+      double tau2 = tau * tau;
 
-        long icell_glb = n  +  icell * CORES;   // global cell index
+      double dat = dat_fo[icell_glb];         // covariant normal surface vector
+      double dax = dax_fo[icell_glb];
+      double day = day_fo[icell_glb];
+      double dan = dan_fo[icell_glb];         // dan should be 0 for 2+1d
 
-        double tau = tau_fo[icell_glb];         // longitudinal proper time
-        double x_pos = x_fo[icell_glb];         // x position
-        double y_pos = y_fo[icell_glb];         // y position
+      double ux = ux_fo[icell_glb];           // contravariant fluid velocity
+      double uy = uy_fo[icell_glb];           // enforce normalization
+      double un = un_fo[icell_glb];
+      double ut = sqrt(1.0  +  ux * ux  +  uy * uy  +  tau2 * un * un);
 
-        double tau2 = tau * tau;
-        if(DIMENSION == 3)
-        {
-          etaValues[0] = eta_fo[icell_glb];     // spacetime rapidity from surface file
-        }
+      double udsigma = ut * dat  +  ux * dax  +  uy * day  +  un * dan;  // u.dsigma / eta_weight
 
-        double dat = dat_fo[icell_glb];         // covariant normal surface vector
-        double dax = dax_fo[icell_glb];
-        double day = day_fo[icell_glb];
-        double dan = dan_fo[icell_glb];         // dan should be 0 for 2+1d
-
-        double ux = ux_fo[icell_glb];           // contravariant fluid velocity
-        double uy = uy_fo[icell_glb];           // enforce normalization
-        double un = un_fo[icell_glb];
-        double ut = sqrt(1.0  +  ux * ux  +  uy * uy  +  tau2 * un * un);
-
-        double udsigma = ut * dat  +  ux * dax  +  uy * day  +  un * dan;  // u.dsigma / eta_weight
-
-        if(udsigma <= 0.0) continue;            // skip cells with u.dsigma < 0
-
-        double ux2 = ux * ux;                   // useful expressions
-        double uy2 = uy * uy;
-        double ut2 = ut * ut;
-        double uperp = sqrt(ux * ux  +  uy * uy);
-        double utperp = sqrt(1.0  +  ux * ux  +  uy * uy);
-
-        double T = T_fo[icell_glb];             // temperature (GeV)
-        double P = P_fo[icell_glb];             // equilibrium pressure (GeV/fm^3)
-        double E = E_fo[icell_glb];             // energy density (GeV/fm^3)
-
-        double pitt = 0.0;                      // contravariant shear stress tensor pi^munu (GeV/fm^3)
-        double pitx = 0.0;                      // enforce orthogonality pi.u = 0
-        double pity = 0.0;                      // and tracelessness Tr(pi) = 0
-        double pitn = 0.0;
-        double pixx = 0.0;
-        double pixy = 0.0;
-        double pixn = 0.0;
-        double piyy = 0.0;
-        double piyn = 0.0;
-        double pinn = 0.0;
-
-        if(INCLUDE_SHEAR_DELTAF)
-        {
-          pixx = pixx_fo[icell_glb];
-          pixy = pixy_fo[icell_glb];
-          pixn = pixn_fo[icell_glb];
-          piyy = piyy_fo[icell_glb];
-          piyn = piyn_fo[icell_glb];
-          pinn = (pixx * (ux2 - ut2)  +  piyy * (uy2 - ut2)  +  2.0 * (pixy * ux * uy  +  tau2 * un * (pixn * ux  +  piyn * uy))) / (tau2 * utperp * utperp);
-          pitn = (pixn * ux  +  piyn * uy  +  tau2 * pinn * un) / ut;
-          pity = (pixy * ux  +  piyy * uy  +  tau2 * piyn * un) / ut;
-          pitx = (pixx * ux  +  pixy * uy  +  tau2 * pixn * un) / ut;
-          pitt = (pitx * ux  +  pity * uy  +  tau2 * pitn * un) / ut;
-        }
+      if(udsigma <= 0.0) continue;            // skip cells with u.dsigma < 0
 
-        double bulkPi = 0.0;                    // bulk pressure (GeV/fm^3)
+      double ux2 = ux * ux;                   // useful expressions
+      double uy2 = uy * uy;
+      double ut2 = ut * ut;
+      double uperp = sqrt(ux * ux  +  uy * uy);
+      double utperp = sqrt(1.0  +  ux * ux  +  uy * uy);
 
-        if(INCLUDE_BULK_DELTAF) bulkPi = bulkPi_fo[icell_glb];
+      double T = T_fo[icell_glb];             // temperature (GeV)
+      double P = P_fo[icell_glb];             // equilibrium pressure (GeV/fm^3)
+      double E = E_fo[icell_glb];             // energy density (GeV/fm^3)
 
-        double muB = 0.0;                       // baryon chemical potential (GeV)
-        double alphaB = 0.0;                    // muB / T
-        double nB = 0.0;                        // net baryon density (fm^-3)
-        double Vt = 0.0;                        // contravariant net baryon diffusion V^mu (fm^-3)
-        double Vx = 0.0;                        // enforce orthogonality V.u = 0
-        double Vy = 0.0;
-        double Vn = 0.0;
-        double baryon_enthalpy_ratio = 0.0;     // nB / (E + P)
+      double pitt = 0.0;                      // contravariant shear stress tensor pi^munu (GeV/fm^3)
+      double pitx = 0.0;                      // enforce orthogonality pi.u = 0
+      double pity = 0.0;                      // and tracelessness Tr(pi) = 0
+      double pitn = 0.0;
+      double pixx = 0.0;
+      double pixy = 0.0;
+      double pixn = 0.0;
+      double piyy = 0.0;
+      double piyn = 0.0;
+      double pinn = 0.0;
 
-        if(INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF)
-        {
-          muB = muB_fo[icell_glb];
-          nB = nB_fo[icell_glb];
-          Vx = Vx_fo[icell_glb];
-          Vy = Vy_fo[icell_glb];
-          Vn = Vn_fo[icell_glb];
-          Vt = (Vx * ux  +  Vy * uy  +  tau2 * Vn * un) / ut;
-
-          alphaB = muB / T;
-          baryon_enthalpy_ratio = nB / (E + P);
-        }
+      if(INCLUDE_SHEAR_DELTAF)
+      {
+        pixx = pixx_fo[icell_glb];
+        pixy = pixy_fo[icell_glb];
+        pixn = pixn_fo[icell_glb];
+        piyy = piyy_fo[icell_glb];
+        piyn = piyn_fo[icell_glb];
+        pinn = (pixx * (ux2 - ut2)  +  piyy * (uy2 - ut2)  +  2.0 * (pixy * ux * uy  +  tau2 * un * (pixn * ux  +  piyn * uy))) / (tau2 * utperp * utperp);
+        pitn = (pixn * ux  +  piyn * uy  +  tau2 * pinn * un) / ut;
+        pity = (pixy * ux  +  piyy * uy  +  tau2 * piyn * un) / ut;
+        pitx = (pixx * ux  +  pixy * uy  +  tau2 * pixn * un) / ut;
+        pitt = (pitx * ux  +  pity * uy  +  tau2 * pitn * un) / ut;
+      }
 
-        // regulate bulk pressure if goes out of bounds given
-        // by Jonah's feqmod to avoid gsl interpolation errors
-        if(DF_MODE == 4)
-        {
-          double bulkPi_over_Peq_max = df_data->bulkPi_over_Peq_max;
+      double bulkPi = 0.0;                    // bulk pressure (GeV/fm^3)
 
-          if(bulkPi <= - P) bulkPi = - (1.0 - 1.e-5) * P;
-          else if(bulkPi / P >= bulkPi_over_Peq_max) bulkPi = P * (bulkPi_over_Peq_max - 1.e-5);
-        }
+      if(INCLUDE_BULK_DELTAF) bulkPi = bulkPi_fo[icell_glb];
 
-        // set df coefficients
-        deltaf_coefficients df = df_data->evaluate_df_coefficients(T, muB, E, P, bulkPi);
-
-        // modified coefficients (Mike / Jonah)
-        double F = df.F;
-        double G = df.G;
-        double betabulk = df.betabulk;
-        double betaV = df.betaV;
-        double betapi = df.betapi;
-        double lambda = df.lambda;
-        double z = df.z;
-        double delta_lambda = df.delta_lambda;
-        double delta_z = df.delta_z;
-
-        // milne basis class
-        Milne_Basis basis_vectors(ut, ux, uy, un, uperp, utperp, tau);
-        basis_vectors.test_orthonormality(tau2);
-
-        double Xt = basis_vectors.Xt;   double Yx = basis_vectors.Yx;
-        double Xx = basis_vectors.Xx;   double Yy = basis_vectors.Yy;
-        double Xy = basis_vectors.Xy;   double Zt = basis_vectors.Zt;
-        double Xn = basis_vectors.Xn;   double Zn = basis_vectors.Zn;
-
-        // shear stress class
-        Shear_Stress pimunu(pitt, pitx, pity, pitn, pixx, pixy, pixn, piyy, piyn, pinn);
-        pimunu.test_pimunu_orthogonality_and_tracelessness(ut, ux, uy, un, tau2);
-        pimunu.boost_pimunu_to_lrf(basis_vectors, tau2);
-
-        // baryon diffusion class
-        Baryon_Diffusion Vmu(Vt, Vx, Vy, Vn);
-        Vmu.test_Vmu_orthogonality(ut, ux, uy, un, tau2);
-        Vmu.boost_Vmu_to_lrf(basis_vectors, tau2);
-
-
-        // modified temperature / chemical potential
-        double T_mod = T;
-        double alphaB_mod = alphaB;
-
-        if(DF_MODE == 3)
-        {
-          T_mod = T  +  bulkPi * F / betabulk;
-          alphaB_mod = alphaB  +  bulkPi * G / betabulk;
-        }
+      double muB = 0.0;                       // baryon chemical potential (GeV)
+      double alphaB = 0.0;                    // muB / T
+      double nB = 0.0;                        // net baryon density (fm^-3)
+      double Vt = 0.0;                        // contravariant net baryon diffusion V^mu (fm^-3)
+      double Vx = 0.0;                        // enforce orthogonality V.u = 0
+      double Vy = 0.0;
+      double Vn = 0.0;
+      double baryon_enthalpy_ratio = 0.0;     // nB / (E + P)
 
-        double chem = baryon * alphaB;          // chemical potential term in feq
-        double chem_mod = baryon * alphaB_mod;  // chemical potential term in feqmod
+      if(INCLUDE_BARYON && INCLUDE_BARYONDIFF_DELTAF)
+      {
+        muB = muB_fo[icell_glb];
+        nB = nB_fo[icell_glb];
+        Vx = Vx_fo[icell_glb];
+        Vy = Vy_fo[icell_glb];
+        Vn = Vn_fo[icell_glb];
+        Vt = (Vx * ux  +  Vy * uy  +  tau2 * Vn * un) / ut;
+
+        alphaB = muB / T;
+        baryon_enthalpy_ratio = nB / (E + P);
+      }
 
-        // linearized Chapman Enskog df coefficients (for Mike only)
-        double shear_coeff = 0.5 / (betapi * T);      // Jonah linear df also shares shear coeff
-        double bulk0_coeff = F / (T * T * betabulk);
-        double bulk1_coeff = G / betabulk;
-        double bulk2_coeff = 1.0 / (3.0 * T * betabulk);
-
-        // pimunu and Vmu LRF components
-        double pixx_LRF = pimunu.pixx_LRF;
-        double pixy_LRF = pimunu.pixy_LRF;
-        double pixz_LRF = pimunu.pixz_LRF;
-        double piyy_LRF = pimunu.piyy_LRF;
-        double piyz_LRF = pimunu.piyz_LRF;
-        double pizz_LRF = pimunu.pizz_LRF;
-
-        double Vx_LRF = Vmu.Vx_LRF;
-        double Vy_LRF = Vmu.Vy_LRF;
-        double Vz_LRF = Vmu.Vz_LRF;
-
-        // local momentum transformation matrix Mij = Aij
-        // Aij = ideal + shear + bulk is symmetric
-        // Mij is not symmetric if include baryon diffusion (leave for future work)
-
-        // modified coefficients in Aij
-        double shear_mod = 0.5 / betapi;
-        double bulk_mod = bulkPi / (3.0 * betabulk);
-
-        if(DF_MODE == 4) bulk_mod = lambda;
-
-        // Aij elements
-        double Axx = 1.0  +  pixx_LRF * shear_mod  +  bulk_mod;
-        double Axy = pixy_LRF * shear_mod;
-        double Axz = pixz_LRF * shear_mod;
-        double Ayy = 1.0  +  piyy_LRF * shear_mod  +  bulk_mod;
-        double Ayz = piyz_LRF * shear_mod;
-        double Azz = 1.0  +  pizz_LRF * shear_mod  +  bulk_mod;
-
-        double detA = Axx * (Ayy * Azz  -  Ayz * Ayz)  -  Axy * (Axy * Azz  -  Ayz * Axz)  +  Axz * (Axy * Ayz  -  Ayy * Axz);
-        double detA_bulk_two_thirds = pow(1.0 + bulk_mod, 2);
-
-        // determine if feqmod breaks down
-        bool feqmod_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, detA_min, z, laguerre, DF_MODE, 0, T, F, betabulk);
-
-        // set Aij matrix
-        double A[] = {Axx, Axy, Axz,
-                      Axy, Ayy, Ayz,
-                      Axz, Ayz, Azz};           // gsl matrix format
-
-        A_copy[0][0] = Axx;  A_copy[0][1] = Axy;  A_copy[0][2] = Axz;
-        A_copy[1][0] = Axy;  A_copy[1][1] = Ayy;  A_copy[1][2] = Ayz;
-        A_copy[2][0] = Axz;  A_copy[2][1] = Ayz;  A_copy[2][2] = Azz;
-
-        // compute Aij^-1 using LUP decomposition
-        int s;
-        gsl_matrix_view LU = gsl_matrix_view_array(A, 3, 3);
-        gsl_permutation * p = gsl_permutation_calloc(3);
-        gsl_linalg_LU_decomp(&LU.matrix, p, &s);
-
-        gsl_matrix * A_inverse = gsl_matrix_alloc(3, 3);
-        gsl_linalg_LU_invert(&LU.matrix, p, A_inverse);
-
-        for(int i = 0; i < 3; i++)
-        {
-          for(int j = 0; j < 3; j++)
-          {
-            A_inv[i][j] = gsl_matrix_get(A_inverse, i, j);
-          }
-        }
+      // regulate bulk pressure if goes out of bounds given
+      // by Jonah's feqmod to avoid gsl interpolation errors
+      if(DF_MODE == 4)
+      {
+        double bulkPi_over_Peq_max = df_data->bulkPi_over_Peq_max;
 
+        if(bulkPi <= - P) bulkPi = - (1.0 - 1.e-5) * P;
+        else if(bulkPi / P >= bulkPi_over_Peq_max) bulkPi = P * (bulkPi_over_Peq_max - 1.e-5);
+      }
 
-        // prefactors for equilibrium, linear bulk correction and modified densities (Mike's feqmod)
-        double neq_fact = T * T * T / two_pi2_hbarC3;
-        double dn_fact = bulkPi / betabulk;
-        double J20_fact = T * neq_fact;
-        double N10_fact = neq_fact;
-        double nmod_fact = T_mod * T_mod * T_mod / two_pi2_hbarC3;
-
-        // if(feqmod_breaks_down)
-        // {
-        //   #pragma omp critical
-        //   {
-        //     breakdown++;
-        //     cout << setw(5) << setprecision(4) << "feqmod breaks down for " << breakdown << " / " << FO_length << " cells  (cell = " << icell << ", tau = " << tau << " fm/c, " << ", detA = " << detA << ", detA_min = " << detA_min << ")" << endl;
-        //   }
-        // }
-
-        // rescale eta by detA if modified momentum space elements are shrunk
-        // for integrating modified distribution with narrow (y-eta) distributions
-        // note: this only works for boost invariant surfaces, where dsigma is always orthogonal to eta direction (dan = 0)
-        double eta_scale = 1.0;
-        if(detA > detA_min && DIMENSION == 2)
+      // set df coefficients
+      deltaf_coefficients df = df_data->evaluate_df_coefficients(T, muB, E, P, bulkPi);
+
+      // modified coefficients (Mike / Jonah)
+      double F = df.F;
+      double G = df.G;
+      double betabulk = df.betabulk;
+      double betaV = df.betaV;
+      double betapi = df.betapi;
+      double lambda = df.lambda;
+      double z = df.z;
+      double delta_lambda = df.delta_lambda;
+      double delta_z = df.delta_z;
+
+      // milne basis class
+      Milne_Basis basis_vectors(ut, ux, uy, un, uperp, utperp, tau);
+      basis_vectors.test_orthonormality(tau2);
+
+      double Xt = basis_vectors.Xt;   double Yx = basis_vectors.Yx;
+      double Xx = basis_vectors.Xx;   double Yy = basis_vectors.Yy;
+      double Xy = basis_vectors.Xy;   double Zt = basis_vectors.Zt;
+      double Xn = basis_vectors.Xn;   double Zn = basis_vectors.Zn;
+
+      // shear stress class
+      Shear_Stress pimunu(pitt, pitx, pity, pitn, pixx, pixy, pixn, piyy, piyn, pinn);
+      pimunu.test_pimunu_orthogonality_and_tracelessness(ut, ux, uy, un, tau2);
+      pimunu.boost_pimunu_to_lrf(basis_vectors, tau2);
+
+      // baryon diffusion class
+      Baryon_Diffusion Vmu(Vt, Vx, Vy, Vn);
+      Vmu.test_Vmu_orthogonality(ut, ux, uy, un, tau2);
+      Vmu.boost_Vmu_to_lrf(basis_vectors, tau2);
+
+
+      // modified temperature / chemical potential
+      double T_mod = T;
+      double alphaB_mod = alphaB;
+
+      if(DF_MODE == 3)
+      {
+        T_mod = T  +  bulkPi * F / betabulk;
+        alphaB_mod = alphaB  +  bulkPi * G / betabulk;
+      }
+
+      // linearized Chapman Enskog df coefficients (for Mike only)
+      double shear_coeff = 0.5 / (betapi * T);      // Jonah linear df also shares shear coeff
+      double bulk0_coeff = F / (T * T * betabulk);
+      double bulk1_coeff = G / betabulk;
+      double bulk2_coeff = 1.0 / (3.0 * T * betabulk);
+
+      // pimunu and Vmu LRF components
+      double pixx_LRF = pimunu.pixx_LRF;
+      double pixy_LRF = pimunu.pixy_LRF;
+      double pixz_LRF = pimunu.pixz_LRF;
+      double piyy_LRF = pimunu.piyy_LRF;
+      double piyz_LRF = pimunu.piyz_LRF;
+      double pizz_LRF = pimunu.pizz_LRF;
+
+      // local momentum transformation matrix Mij = Aij
+      // Aij = ideal + shear + bulk is symmetric
+      // Mij is not symmetric if include baryon diffusion (leave for future work)
+
+      // modified coefficients in Aij
+      double shear_mod = 0.5 / betapi;
+      double bulk_mod = bulkPi / (3.0 * betabulk);
+
+      if(DF_MODE == 4) bulk_mod = lambda;
+
+      // Aij elements
+      double Axx = 1.0  +  pixx_LRF * shear_mod  +  bulk_mod;
+      double Axy = pixy_LRF * shear_mod;
+      double Axz = pixz_LRF * shear_mod;
+      double Ayy = 1.0  +  piyy_LRF * shear_mod  +  bulk_mod;
+      double Ayz = piyz_LRF * shear_mod;
+      double Azz = 1.0  +  pizz_LRF * shear_mod  +  bulk_mod;
+
+      double detA = Axx * (Ayy * Azz  -  Ayz * Ayz)  -  Axy * (Axy * Azz  -  Ayz * Axz)  +  Axz * (Axy * Ayz  -  Ayy * Axz);
+      double detA_bulk_two_thirds = pow(1.0 + bulk_mod, 2);
+
+      // determine if feqmod breaks down
+      bool feqmod_breaks_down = does_feqmod_breakdown(MASS_PION0, T, F, bulkPi, betabulk, detA, detA_min, z, laguerre, DF_MODE, 0, T, F, betabulk);
+
+      // set Aij matrix
+      double A[] = {Axx, Axy, Axz,
+                    Axy, Ayy, Ayz,
+                    Axz, Ayz, Azz};           // gsl matrix format
+
+      A_copy[0][0] = Axx;  A_copy[0][1] = Axy;  A_copy[0][2] = Axz;
+      A_copy[1][0] = Axy;  A_copy[1][1] = Ayy;  A_copy[1][2] = Ayz;
+      A_copy[2][0] = Axz;  A_copy[2][1] = Ayz;  A_copy[2][2] = Azz;
+
+      // compute Aij^-1 using LUP decomposition
+      int s;
+      gsl_matrix_view LU = gsl_matrix_view_array(A, 3, 3);
+      gsl_permutation * p = gsl_permutation_calloc(3);
+      gsl_linalg_LU_decomp(&LU.matrix, p, &s);
+
+      gsl_matrix * A_inverse = gsl_matrix_alloc(3, 3);
+      gsl_linalg_LU_invert(&LU.matrix, p, A_inverse);
+
+      for(int i = 0; i < 3; i++)
+      {
+        for(int j = 0; j < 3; j++)
         {
-          eta_scale = detA / detA_bulk_two_thirds;
+          A_inv[i][j] = gsl_matrix_get(A_inverse, i, j);
         }
+      }
+
+      gsl_matrix_free(A_inverse);
+      gsl_permutation_free(p);
+
+
+      // prefactors for equilibrium, linear bulk correction and modified densities (Mike's feqmod)
+      double neq_fact = T * T * T / two_pi2_hbarC3;
+      double dn_fact = bulkPi / betabulk;
+      double J20_fact = T * neq_fact;
+      double N10_fact = neq_fact;
+      double nmod_fact = T_mod * T_mod * T_mod / two_pi2_hbarC3;
+
+      // rescale eta by detA if modified momentum space elements are shrunk
+      // for integrating modified distribution with narrow (y-eta) distributions
+      // note: this only works for boost invariant surfaces, where dsigma is always orthogonal to eta direction (dan = 0)
+      double eta_scale = 1.0;
+      if(detA > detA_min && DIMENSION == 2)
+      {
+        eta_scale = detA / detA_bulk_two_thirds;
+      }
+
+      // now loop over all particle species
+      for(long ipart = 0; ipart < npart; ipart++)
+      {
+        double mass = Mass[ipart];              // mass (GeV)
+        double mass2 = mass * mass;
+        double sign = Sign[ipart];              // quantum statistics sign
+        double degeneracy = Degeneracy[ipart];  // spin degeneracy
+        double baryon = Baryon[ipart];          // baryon number
+
+        double chem = baryon * alphaB;          // chemical potential term in feq
+        double chem_mod = baryon * alphaB_mod;  // chemical potential term in feqmod
 
         // compute the modified renormalization factor
         double renorm = 1.0;
@@ -936,11 +880,13 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
             double mbar = mass / T;
             double mbar_mod = mass / T_mod;
 
-            double neq = neq_fact * degeneracy * GaussThermal(neq_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
+            Thermal_Moments thermal = GaussThermal_moments_weighted(renorm_moments, laguerre->root, renorm_weight_exp.data(), pbar_pts, mbar, alphaB, baryon, sign);
+
+            double neq = neq_fact * degeneracy * thermal.neq;
 
-            double N10 = baryon * N10_fact * degeneracy * GaussThermal(J10_int, pbar_root1, pbar_weight1, pbar_pts, mbar, alphaB, baryon, sign);
+            double N10 = baryon * N10_fact * degeneracy * thermal.J10;
 
-            double J20 = J20_fact * degeneracy * GaussThermal(J20_int, pbar_root2, pbar_weight2, pbar_pts, mbar, alphaB, baryon, sign);
+            double J20 = J20_fact * degeneracy * thermal.J20;
 
             double n_linear = neq  +  dn_fact * (neq  +  N10 * G  +  J20 * F / T / T);
 
@@ -969,7 +915,9 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
           continue;
         }
 
-        // compute the dNdy of each freezeout cell (integrating over pT,phi,y)
+        if(node_weights != NULL) memset(node_weights, 0, pT_tab_length * eta_tab_length * sizeof(double));
+
+        // compute the dNdy of the freezeout cell (integrating over pT,phi,y)
         double dN_dy_cell = 0.0;
 
         for(int ipT = 0; ipT < pT_tab_length; ipT++)
@@ -996,7 +944,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
               // sum over eta
               for(int ieta = 0; ieta < eta_tab_length; ieta++)
               {
-                double eta = etaValues[ieta];
+                double eta = etaValues[ieta]  +  eta_shift;
                 double eta_weight = etaWeights[ieta];
 
                 bool feqmod_breaks_down_narrow = false;
@@ -1118,7 +1066,7 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
 
                 eta_integral += (pdotdsigma * f);
 
-                //dN_dydeta[ipart][ieta] += (pT_weight * phi_weight * prefactor * degeneracy * pdotdsigma * f / eta_weight);
+                if(node_weights != NULL) node_weights[ieta  +  eta_tab_length * ipT] += (pT_weight * phi_weight * prefactor * degeneracy * pdotdsigma * f);
 
               } // eta points (ieta)
 
@@ -1130,121 +1078,27 @@ double *muB_fo, double *nB_fo, double *Vx_fo, double *Vy_fo, double *Vn_fo, Gaus
 
         } // transverse momentum points (ipT)
 
-        //dN_dy[ipart] += dN_dy_cell;
-
-        gsl_matrix_free(A_inverse);
-        gsl_permutation_free(p);
-
-
-        // now determine which spacetime bin the freezeout cell lies
-        double r = sqrt(x_pos * x_pos  +  y_pos * y_pos);
-        double phi = atan2(y_pos, x_pos);
-        if(phi < 0.0) phi += two_pi;
-
-        // bin index
-        long itau = (int)floor((tau - TAU_MIN) / TAU_WIDTH);
-        long ir = (int)floor((r - R_MIN) / R_WIDTH);
-        long iphi = (int)floor(phi / PHIP_WIDTH);
-
         // add dNdy to the corresponding bin(s)
-        if(itau >= 0 && itau < taubins)
-        {
-          long itau_all = itau  +  n * taubins;
-          dN_taudtaudy_all[itau_all] += dN_dy_cell;
-        }
-
-        if(ir >= 0 && ir < rbins)
-        {
-          long ir_all = ir  +  n * rbins;
-          dN_twopirdrdy_all[ir_all] += dN_dy_cell;
-        }
-
-        if(iphi >= 0 && iphi < phibins)
-        {
-          long iphi_all = iphi  +  n * phibins;
-          dN_dphidy_all[iphi_all] += dN_dy_cell;
-        }
-
-
-      } // freezeout cells (icell)
-
-
-      free_2D(A_copy, 3);
-      free_2D(A_inv, 3);
-
-    } // chunks or cores (n)
-
-
-    // write spacetime distributions to file (normalize by the binwidths)
-    for(long ir = 0; ir < rbins; ir++)
-    {
-      for(long n = 0; n < CORES; n++)
-      {
-        long ir_all = ir  +  n * rbins;
-        dN_twopirdrdy[ir] += dN_twopirdrdy_all[ir_all];
-      } // sum over the cores
-
-      double r_mid = r_midpoint[ir];
-
-      radial_distribution << setprecision(6) << scientific << r_mid << "\t" << dN_twopirdrdy[ir] / (two_pi * r_mid * R_WIDTH)  << "\n";
-    }
-
-    for(long itau = 0; itau < taubins; itau++)
-    {
-      for(long n = 0; n < CORES; n++)
-      {
-        long itau_all = itau  +  n * taubins;
-        dN_taudtaudy[itau] += dN_taudtaudy_all[itau_all];
-
-      } // sum over the cores
-
-      double tau_mid = tau_midpoint[itau];
-
-      time_distribution << setprecision(6) << scientific << tau_mid << "\t" << dN_taudtaudy[itau] / (tau_mid * TAU_WIDTH) << "\n";
-    }
+        double *dN_dX_cell = dN_dX_all  +  dX_bins * (ipart  +  npart * n);
 
-    for(long iphi = 0; iphi < phibins; iphi++)
-    {
-      for(long n = 0; n < CORES; n++)
-      {
-        long iphi_all = iphi  +  n * phibins;
-        dN_dphidy[iphi] += dN_dphidy_all[iphi_all];
-      } // sum over the cores
+        if(tau_bin) dN_dX_cell[itau] += dN_dy_cell;
+        if(r_bin) dN_dX_cell[taubins + ir] += dN_dy_cell;
+        if(phi_bin) dN_dX_cell[taubins + rbins + iphi] += dN_dy_cell;
 
-      double phi_mid = phi_midpoint[iphi];
+        if(histogram_cell) emission_histograms->fill_cell(n, ipart, dN_dy_cell, node_weights);
 
-      azimuthal_distribution << setprecision(6) << scientific << phi_mid << "\t" << dN_dphidy[iphi] / PHIP_WIDTH << "\n";
-    }
+      } // hadron species (ipart)
 
-    // close files
-    time_distribution.close();
-    radial_distribution.close();
-    azimuthal_distribution.close();
+    } // freezeout cells (icell)
 
+    free_2D(A_copy, 3);
+    free_2D(A_inv, 3);
+    free(node_weights);
 
-    // write rapidity distribution to file
-    // for(int ieta = 0; ieta < eta_tab_length; ieta++)
-    // {
-    //   rapidity_distribution << setprecision(6) << scientific << etaValues[ieta] << "\t" << dN_dydeta[ipart][ieta] << "\n";
-    // }
-    // rapidity_distribution.close();
-
-  } // hadron species (ipart)
+  } // chunks or cores (n)
 
+  // write spacetime distributions to file
+  write_dN_dX_toFile(MCID, dN_dX_all);
 
-  // free memory
-  free(dN_taudtaudy_all);
-  free(dN_twopirdrdy_all);
-  free(dN_dphidy_all);
-
-  // for(int i = 0; i < npart; i++)
-  // {
-  //   printf("dN_dy = %lf\n", dN_dy[i]);
-  // }
-  // free_2D(dN_dydeta, npart);
-  // free(dN_dy);
+  free(dN_dX_all);
 }
-
-
-
-
@@ -0,0 +1,426 @@
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SpectraStore.h"
+#include "Arsenal.h"
+
+using namespace std;
+
+
+const char spectra_magic[8] = {'i', 'S', '3', 'D', 's', 'p', 'e', 'c'};
+const long spectra_header_size = 24;
+const int name_length = 32;
+const int units_length = 16;
+const int axes_length = 32;
+const int max_rank = 4;
+const long directory_entry_size = name_length + units_length + axes_length + 8 + 8 * max_rank + 8;
+
+
+long Spectra_Store_Array::size() const
+{
+  long values = 1;
+
+  for(int i = 0; i < (int)shape.size(); i++) values *= shape[i];
+
+  return values;
+}
+
+
+static void pack_string(char * entry, const string & value, int length)
+{
+  memset(entry, 0, length);
+  memcpy(entry, value.c_str(), min((int)value.size(), length - 1));    // null terminated
+}
+
+
+static string unpack_string(const char * entry, int length)
+{
+  return string(entry, strnlen(entry, length));
+}
+
+
+static int axes_rank(const string & axes)
+{
+  // number of comma separated axis names
+  return 1 + count(axes.begin(), axes.end(), ',');
+}
+
+
+
+Spectra_Store_Writer::Spectra_Store_Writer(string filename_in, int dimension_in, const int * mcid_in, int species)
+{
+  filename = filename_in;
+  dimension = dimension_in;
+  mcid.assign(mcid_in, mcid_in + species);
+}
+
+
+void Spectra_Store_Writer::add(string name, string units, string axes, const vector<int64_t> & shape, const double * values)
+{
+  if(name.size() >= (size_t)name_length || units.size() >= (size_t)units_length || axes.size() >= (size_t)axes_length || shape.empty() || shape.size() > (size_t)max_rank || axes_rank(axes) != (int)shape.size())
+  {
+    printf("Spectra_Store_Writer error: array %s (units %s, axes %s) does not fit the directory entry\n", name.c_str(), units.c_str(), axes.c_str());
+    exit(-1);
+  }
+
+  Spectra_Store_Array array;
+  array.name = name;
+  array.units = units;
+  array.axes = axes;
+  array.shape = shape;
+  array.offset = 0;
+
+  arrays.push_back(array);
+  data.push_back(values);
+}
+
+
+void Spectra_Store_Writer::write()
+{
+  // write to a unique temporary file and rename it (a full disk or an interrupted run doesn't leave a truncated file)
+  string tmp_filename;
+
+  FILE * store_file = open_temporary_file(filename, tmp_filename);
+
+  if(store_file == NULL)
+  {
+    printf("Spectra_Store_Writer error: could not open a temporary file for %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  // the data follows the header, species ids and directory back to back
+  uint64_t offset = spectra_header_size  +  4 * mcid.size()  +  directory_entry_size * arrays.size();
+
+  for(int i = 0; i < (int)arrays.size(); i++)
+  {
+    arrays[i].offset = offset;
+    offset += 8 * arrays[i].size();
+  }
+
+  int32_t header[4] = {spectra_store_version, dimension, (int32_t)mcid.size(), (int32_t)arrays.size()};
+
+  bool written = (fwrite(spectra_magic, 1, 8, store_file) == 8);
+  written = written && (fwrite(header, sizeof(int32_t), 4, store_file) == 4);
+  written = written && (fwrite(mcid.data(), sizeof(int32_t), mcid.size(), store_file) == mcid.size());
+
+  vector<char> entry(directory_entry_size);
+
+  for(int i = 0; i < (int)arrays.size(); i++)
+  {
+    const Spectra_Store_Array & array = arrays[i];
+
+    char * position = entry.data();
+
+    pack_string(position, array.name, name_length);
+    position += name_length;
+    pack_string(position, array.units, units_length);
+    position += units_length;
+    pack_string(position, array.axes, axes_length);
+    position += axes_length;
+
+    int32_t rank[2] = {(int32_t)array.shape.size(), 0};
+    memcpy(position, rank, 8);
+    position += 8;
+
+    for(int j = 0; j < max_rank; j++)
+    {
+      int64_t extent = (j < (int)array.shape.size()) ? array.shape[j] : 1;
+      memcpy(position, &extent, 8);
+      position += 8;
+    }
+
+    memcpy(position, &array.offset, 8);
+
+    written = written && (fwrite(entry.data(), 1, directory_entry_size, store_file) == (size_t)directory_entry_size);
+  }
+
+  for(int i = 0; i < (int)arrays.size(); i++)
+  {
+    written = written && ((long)fwrite(data[i], sizeof(double), arrays[i].size(), store_file) == arrays[i].size());
+  }
+
+  if(!install_temporary_file(store_file, tmp_filename, filename, written))
+  {
+    printf("Spectra_Store_Writer error: could not write %s\n", filename.c_str());
+    exit(-1);
+  }
+}
+
+
+
+Spectra_Store_Reader::Spectra_Store_Reader(string filename)
+{
+  store_file = fopen(filename.c_str(), "rb");
+
+  if(store_file == NULL)
+  {
+    printf("Spectra_Store_Reader error: could not open %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  char magic[8];
+  int32_t header[4];
+
+  if(fread(magic, 1, 8, store_file) != 8 || memcmp(magic, spectra_magic, 8) != 0 || fread(header, sizeof(int32_t), 4, store_file) != 4)
+  {
+    printf("Spectra_Store_Reader error: %s is not an iS3D spectra file\n", filename.c_str());
+    exit(-1);
+  }
+
+  version = header[0];
+  dimension = header[1];
+
+  if(version != spectra_store_version || header[2] < 0 || header[3] < 0)
+  {
+    printf("Spectra_Store_Reader error: %s has version %d (this reader supports version %d)\n", filename.c_str(), version, spectra_store_version);
+    exit(-1);
+  }
+
+  fseek(store_file, 0, SEEK_END);
+  uint64_t file_size = ftell(store_file);
+  fseek(store_file, spectra_header_size, SEEK_SET);
+
+  uint64_t data_start = spectra_header_size  +  4 * (uint64_t)header[2]  +  directory_entry_size * (uint64_t)header[3];
+
+  if(data_start > file_size)
+  {
+    printf("Spectra_Store_Reader error: the directory of %s is truncated\n", filename.c_str());
+    exit(-1);
+  }
+
+  vector<int32_t> mcid_in(header[2]);
+  vector<char> entries(directory_entry_size * header[3]);
+
+  if(fread(mcid_in.data(), sizeof(int32_t), header[2], store_file) != (size_t)header[2] || fread(entries.data(), 1, entries.size(), store_file) != entries.size())
+  {
+    printf("Spectra_Store_Reader error: could not read the directory of %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  mcid.assign(mcid_in.begin(), mcid_in.end());
+
+  for(int i = 0; i < header[3]; i++)
+  {
+    const char * position = entries.data()  +  directory_entry_size * i;
+
+    Spectra_Store_Array array;
+
+    array.name = unpack_string(position, name_length);
+    position += name_length;
+    array.units = unpack_string(position, units_length);
+    position += units_length;
+    array.axes = unpack_string(position, axes_length);
+    position += axes_length;
+
+    int32_t rank[2];
+    memcpy(rank, position, 8);
+    position += 8;
+
+    bool valid = (rank[0] >= 1 && rank[0] <= max_rank && rank[0] == axes_rank(array.axes));
+
+    for(int j = 0; j < max_rank; j++)
+    {
+      int64_t extent;
+      memcpy(&extent, position, 8);
+      position += 8;
+
+      if(j < rank[0]) array.shape.push_back(extent);
+
+      if(extent < 1 || (j >= rank[0] && extent != 1)) valid = false;      // padded extents are 1
+    }
+
+    memcpy(&array.offset, position, 8);
+
+    // the data must lie between the directory and the end of the file (checked without overflowing the size)
+    valid = valid && (array.offset >= data_start) && (array.offset <= file_size);
+
+    uint64_t values_left = valid ? (file_size - array.offset) / 8 : 0;
+
+    for(int j = 0; valid && j < rank[0]; j++)
+    {
+      valid = ((uint64_t)array.shape[j] <= values_left);
+      if(valid) values_left /= array.shape[j];
+    }
+
+    if(!valid)
+    {
+      printf("Spectra_Store_Reader error: invalid directory entry %s (axes %s) in %s\n", array.name.c_str(), array.axes.c_str(), filename.c_str());
+      exit(-1);
+    }
+
+    arrays.push_back(array);
+  }
+}
+
+
+Spectra_Store_Reader::~Spectra_Store_Reader()
+{
+  fclose(store_file);
+}
+
+
+const vector<Spectra_Store_Array> & Spectra_Store_Reader::directory() const
+{
+  return arrays;
+}
+
+
+bool Spectra_Store_Reader::has(string name) const
+{
+  for(int i = 0; i < (int)arrays.size(); i++)
+  {
+    if(arrays[i].name == name) return true;
+  }
+
+  return false;
+}
+
+
+void Spectra_Store_Reader::read(string name, vector<double> & values, vector<int64_t> & shape)
+{
+  for(int i = 0; i < (int)arrays.size(); i++)
+  {
+    const Spectra_Store_Array & array = arrays[i];
+
+    if(array.name != name) continue;
+
+    values.resize(array.size());
+    shape = array.shape;
+
+    fseek(store_file, array.offset, SEEK_SET);
+
+    if((long)fread(values.data(), sizeof(double), values.size(), store_file) != (long)values.size())
+    {
+      printf("Spectra_Store_Reader error: could not read array %s\n", name.c_str());
+      exit(-1);
+    }
+    return;
+  }
+
+  printf("Spectra_Store_Reader error: no array %s in the spectra file\n", name.c_str());
+  exit(-1);
+}
+
+
+
+void convert_spectra_store_to_text(string store_filename, string output_directory)
+{
+  Spectra_Store_Reader store(store_filename);
+
+  vector<int64_t> shape;
+  vector<double> pT, phip, y;
+
+  store.read("pT", pT, shape);
+  store.read("phip", phip, shape);
+  store.read("y", y, shape);
+
+  long pT_points = pT.size();
+  long phip_points = phip.size();
+  long y_points = y.size();
+  long species = store.mcid.size();
+
+  char filename[255] = "";
+
+  if(store.has("dN_pTdpTdphidy"))
+  {
+    vector<double> dN_pTdpTdphidy;
+    store.read("dN_pTdpTdphidy", dN_pTdpTdphidy, shape);
+
+    for(long ipart = 0; ipart < species; ipart++)
+    {
+      sprintf(filename, "%s/dN_pTdpTdphidy_%d.dat", output_directory.c_str(), store.mcid[ipart]);
+      ofstream spectra(filename, ios_base::out);
+
+      spectra << "y" << "\t" << "phip" << "\t" << "pT" << "\t" << "dN_pTdpTdphidy" << "\n";
+
+      for(long iy = 0; iy < y_points; iy++)
+      {
+        for(long iphip = 0; iphip < phip_points; iphip++)
+        {
+          for(long ipT = 0; ipT < pT_points; ipT++)
+          {
+            long iS3D = iy  +  y_points * (iphip  +  phip_points * (ipT  +  pT_points * ipart));
+
+            spectra << scientific <<  setw(5) << setprecision(8) << y[iy] << "\t" << phip[iphip] << "\t" << pT[ipT] << "\t" << dN_pTdpTdphidy[iS3D] << "\n";
+          }
+          spectra << "\n";
+        }
+      }
+      spectra.close();
+    }
+  }
+
+  if(store.has("dN_dphidy"))
+  {
+    vector<double> dN_dphidy;
+    store.read("dN_dphidy", dN_dphidy, shape);
+
+    for(long ipart = 0; ipart < species; ipart++)
+    {
+      sprintf(filename, "%s/dN_dphidy_%d.dat", output_directory.c_str(), store.mcid[ipart]);
+      ofstream spectra(filename, ios_base::out);
+
+      for(long iy = 0; iy < y_points; iy++)
+      {
+        for(long iphip = 0; iphip < phip_points; iphip++)
+        {
+          spectra << scientific <<  setw(5) << setprecision(8) << y[iy] << "\t" << phip[iphip] << "\t" << dN_dphidy[iphip  +  phip_points * (iy  +  y_points * ipart)] << "\n";
+        }
+        if(iy < y_points - 1) spectra << "\n";
+      }
+      spectra.close();
+    }
+  }
+
+  vector<double> dN_2pipTdpTdy, dN_dy, vn;
+  store.read("dN_2pipTdpTdy", dN_2pipTdpTdy, shape);
+  store.read("dN_dy", dN_dy, shape);
+  store.read("vn", vn, shape);
+
+  long harmonics = shape.back();
+
+  for(long ipart = 0; ipart < species; ipart++)
+  {
+    sprintf(filename, "%s/dN_2pipTdpTdy_%d.dat", output_directory.c_str(), store.mcid[ipart]);
+    ofstream pT_spectra(filename, ios_base::out);
+
+    sprintf(filename, "%s/dN_dy_%d.dat", output_directory.c_str(), store.mcid[ipart]);
+    ofstream y_spectra(filename, ios_base::out);
+
+    sprintf(filename, "%s/vn_%d.dat", output_directory.c_str(), store.mcid[ipart]);
+    ofstream vn_File(filename, ios_base::out);
+
+    for(long iy = 0; iy < y_points; iy++)
+    {
+      for(long ipT = 0; ipT < pT_points; ipT++)
+      {
+        long iS2D = ipT  +  pT_points * (iy  +  y_points * ipart);
+
+        pT_spectra << scientific <<  setw(5) << setprecision(8) << y[iy] << "\t" << pT[ipT] << "\t" << dN_2pipTdpTdy[iS2D] << "\n";
+
+        vn_File << scientific <<  setw(5) << setprecision(8) << y[iy] << "\t" << pT[ipT];
+
+        for(long k = 0; k < harmonics; k++) vn_File << "\t" << vn[k  +  harmonics * iS2D];
+
+        vn_File << "\n";
+      }
+
+      if(iy < y_points - 1) pT_spectra << "\n";
+      vn_File << "\n";
+
+      y_spectra << setw(5) << setprecision(8) << y[iy] << "\t" << dN_dy[iy  +  y_points * ipart] << endl;
+    }
+
+    pT_spectra.close();
+    y_spectra.close();
+    vn_File.close();
+  }
+}
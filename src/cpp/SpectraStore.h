@@ -0,0 +1,82 @@
+
+#ifndef SPECTRASTORE_H
+#define SPECTRASTORE_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+using namespace std;
+
+
+// binary continuous spectra (one self-describing file per run, spectra_output_format = 1)
+//
+//   header:     char magic[8] = "iS3Dspec", int32 version, int32 dimension, int32 species, int32 arrays
+//               int32 mcid[species]
+//   directory:  char name[32], char units[16], char axes[32], int32 rank, int32 (unused), int64 shape[4] (unused = 1),
+//               uint64 offset   (per array; rank = number of comma separated axes)
+//   data:       float64 arrays at their byte offsets (little endian, last axis fastest)
+//
+// the momentum grid is stored as arrays too (pT, pT_weight, phip, phip_weight, y). the observables are
+// dN_pTdpTdphidy (species, pT, phip, y), dN_2pipTdpTdy (species, y, pT), dN_dphidy (species, y, phip),
+// dN_dy (species, y) and vn (species, y, pT, n) with n = 1, ..., 7 (spectra_harmonics = 1 has no phip resolved arrays)
+
+const int spectra_store_version = 2;
+
+class Spectra_Store_Array
+{
+  public:
+    string name;
+    string units;
+    string axes;                            // comma separated axis names (slowest first)
+    vector<int64_t> shape;
+    uint64_t offset;                        // byte offset of the data in the file
+
+    long size() const;                      // number of values
+};
+
+
+class Spectra_Store_Writer
+{
+  private:
+    string filename;
+    int dimension;
+    vector<int32_t> mcid;
+
+    vector<Spectra_Store_Array> arrays;
+    vector<const double *> data;            // caller owned until write()
+
+  public:
+    Spectra_Store_Writer(string filename_in, int dimension_in, const int * mcid_in, int species);
+
+    void add(string name, string units, string axes, const vector<int64_t> & shape, const double * values);
+    void write();                           // via a temporary file (exits if the file can't be written)
+};
+
+
+class Spectra_Store_Reader
+{
+  private:
+    FILE * store_file;
+    vector<Spectra_Store_Array> arrays;
+
+  public:
+    int version;
+    int dimension;
+    vector<int> mcid;
+
+    Spectra_Store_Reader(string filename);  // exits if the file is not a valid spectra file of this version
+    ~Spectra_Store_Reader();
+
+    const vector<Spectra_Store_Array> & directory() const;
+    bool has(string name) const;
+
+    void read(string name, vector<double> & values, vector<int64_t> & shape);   // random access to any array
+};
+
+
+// convert a binary spectra file to the per-species text files written by the continuous spectra writers
+void convert_spectra_store_to_text(string store_filename, string output_directory);
+
+#endif
@@ -0,0 +1,202 @@
+
+#include <iostream>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "ThermalDensityTable.h"
+#include "GaussThermal.h"
+
+using namespace std;
+
+
+Thermal_Density_Table::Thermal_Density_Table(int npart, double * Mass, double * Sign, double * Baryon, double mass_pion0, double T_min_in, double T_max_in, int T_bins_in, double alphaB_min_in, double alphaB_max_in, int alphaB_bins_in)
+{
+  nspecies = npart + 1;
+  T_bins = T_bins_in;
+  alphaB_bins = alphaB_bins_in;
+
+  if(T_bins < 4 || alphaB_bins < 1)
+  {
+    printf("Thermal_Density_Table error: need density_table_T_bins >= 4 and density_table_alphaB_bins >= 1\n");
+    exit(-1);
+  }
+
+  T_min = T_min_in;
+  T_max = T_max_in;
+  dT = (T_max - T_min) / ((double)T_bins - 1.0);
+
+  if(dT <= 0.0)
+  {
+    printf("Thermal_Density_Table error: T_max = %lf must be greater than T_min = %lf\n", T_max, T_min);
+    exit(-1);
+  }
+
+  alphaB_min = alphaB_min_in;
+  alphaB_max = alphaB_max_in;
+  dalphaB = 0.0;
+
+  if(alphaB_bins > 1) dalphaB = (alphaB_max - alphaB_min) / ((double)alphaB_bins - 1.0);
+  else alphaB_max = alphaB_min;
+
+  mass = (double *)calloc(nspecies, sizeof(double));
+  sign = (double *)calloc(nspecies, sizeof(double));
+  baryon = (double *)calloc(nspecies, sizeof(double));
+
+  for(int ipart = 0; ipart < npart; ipart++)
+  {
+    mass[ipart] = Mass[ipart];
+    sign[ipart] = Sign[ipart];
+    baryon[ipart] = Baryon[ipart];
+  }
+
+  mass[npart] = mass_pion0;       // pi0
+  sign[npart] = -1.0;
+  baryon[npart] = 0.0;
+
+  log_moment_table = (double *)calloc((long)thermal_moments * T_bins * alphaB_bins * nspecies, sizeof(double));
+}
+
+
+Thermal_Density_Table::~Thermal_Density_Table()
+{
+  free(mass);
+  free(sign);
+  free(baryon);
+  free(log_moment_table);
+}
+
+
+void Thermal_Density_Table::build_table(Gauss_Laguerre * laguerre)
+{
+  printf("Building thermal density tables for %d particles, %d temperatures in [%lf, %lf] GeV and %d alphaB in [%lf, %lf]...\n", nspecies - 1, T_bins, T_min, T_max, alphaB_bins, alphaB_min, alphaB_max);
+
+  #pragma omp parallel for collapse(2)
+  for(int ialphaB = 0; ialphaB < alphaB_bins; ialphaB++)
+  {
+    for(int iT = 0; iT < T_bins; iT++)
+    {
+      double T = T_min  +  iT * dT;
+      double alphaB = alphaB_min  +  ialphaB * dalphaB;
+
+      // fused quadratures of all species at (T, alphaB)
+      vector<Thermal_Moments> thermal(nspecies);
+
+      GaussThermal_moments_batch(neq_moment | J10_moment | J20_moment, laguerre->root, laguerre->weight, laguerre->points, nspecies, mass, T, alphaB, baryon, sign, thermal.data());
+
+      for(int ispecies = 0; ispecies < nspecies; ispecies++)
+      {
+        double * log_moments = log_moment_table  +  thermal_moments * (iT  +  T_bins * (ialphaB  +  (long)alphaB_bins * ispecies));
+
+        log_moments[0] = log(thermal[ispecies].neq);
+        log_moments[1] = log(thermal[ispecies].J10);
+        log_moments[2] = log(thermal[ispecies].J20);
+      }
+    }
+  }
+}
+
+
+bool Thermal_Density_Table::in_range(double T, double alphaB)
+{
+  return (T >= T_min && T <= T_max && alphaB >= alphaB_min && alphaB <= alphaB_max);
+}
+
+
+int lagrange_stencil(double s, int nodes, double * weights, int * first)
+{
+  // weights of the (up to) 4 nearest nodes for the fractional grid index s, starting at node *first
+  // cubic Lagrange if nodes >= 4, linear if nodes = 2, 3 (returns the number of stencil nodes: 4, 2 or 1)
+  if(nodes >= 4)
+  {
+    int i = max(0, min(nodes - 4, (int)floor(s) - 1));
+    double x = s - (double)i;               // in [0, 3]
+
+    weights[0] = -(x - 1.0) * (x - 2.0) * (x - 3.0) / 6.0;
+    weights[1] = x * (x - 2.0) * (x - 3.0) / 2.0;
+    weights[2] = -x * (x - 1.0) * (x - 3.0) / 2.0;
+    weights[3] = x * (x - 1.0) * (x - 2.0) / 6.0;
+
+    *first = i;
+    return 4;
+  }
+  else if(nodes >= 2)
+  {
+    int i = max(0, min(nodes - 2, (int)floor(s)));
+    double x = s - (double)i;
+
+    weights[0] = 1.0 - x;
+    weights[1] = x;
+
+    *first = i;
+    return 2;
+  }
+
+  weights[0] = 1.0;
+
+  *first = 0;
+  return 1;
+}
+
+
+void Thermal_Density_Table::interpolate(int ispecies, double T, double alphaB, double * moments)
+{
+  double wT[4];
+  double walphaB[4];
+
+  int iT;
+  int ialphaB;
+
+  lagrange_stencil((T - T_min) / dT, T_bins, wT, &iT);       // T_bins >= 4 (cubic)
+
+  double s_alphaB = (alphaB_bins > 1) ? (alphaB - alphaB_min) / dalphaB : 0.0;
+
+  int alphaB_pts = lagrange_stencil(s_alphaB, alphaB_bins, walphaB, &ialphaB);   // only the nodes of the stencil are read
+
+  double log_moments[thermal_moments] = {0.0, 0.0, 0.0};
+
+  for(int ia = 0; ia < alphaB_pts; ia++)
+  {
+    const double * table = log_moment_table  +  thermal_moments * (iT  +  T_bins * (ialphaB + ia  +  (long)alphaB_bins * ispecies));
+
+    for(int k = 0; k < 4; k++)
+    {
+      double w = walphaB[ia] * wT[k];
+
+      for(int m = 0; m < thermal_moments; m++)
+      {
+        log_moments[m] += w * table[m  +  thermal_moments * k];
+      }
+    }
+  }
+
+  for(int m = 0; m < thermal_moments; m++)
+  {
+    moments[m] = exp(log_moments[m]);
+  }
+}
+
+
+void Thermal_Density_Table::thermal_integrals(int ipart, double T, double alphaB, double * neq, double * J10, double * J20)
+{
+  double moments[thermal_moments];
+
+  interpolate(ipart, T, alphaB, moments);
+
+  *neq = moments[0];
+  *J10 = moments[1];
+  *J20 = moments[2];
+}
+
+
+void Thermal_Density_Table::pion0_integrals(double T, double * neq, double * J20)
+{
+  double moments[thermal_moments];
+
+  interpolate(nspecies - 1, T, alphaB_min, moments);
+
+  *neq = moments[0];
+  *J20 = moments[2];
+}
@@ -0,0 +1,53 @@
+
+#ifndef THERMALDENSITYTABLE_H
+#define THERMALDENSITYTABLE_H
+
+#include "readindata.h"
+
+using namespace std;
+
+
+// tabulated Gauss-Laguerre thermal integrals (neq, J10, J20) of each species over (T, alphaB)
+// replaces the per-cell quadratures of max_particle_number and does_feqmod_breakdown (fast = 0)
+//
+// stores log of the integrals on a uniform grid spanning the freezeout surface:
+// cubic interpolation in T and alphaB (linear if alphaB_bins < 4; log of the integrals ~ baryon.alphaB)
+
+const int thermal_moments = 3;        // neq, J10, J20
+
+class Thermal_Density_Table
+{
+  private:
+    int nspecies;                     // chosen particles + pi0 (last entry, for the feqmod breakdown check)
+    int T_bins;                       // number of temperature nodes (>= 4)
+    int alphaB_bins;                  // number of alphaB nodes (1 if alphaB = 0 everywhere)
+
+    double T_min;                     // range of table
+    double T_max;
+    double dT;
+    double alphaB_min;
+    double alphaB_max;
+    double dalphaB;
+
+    double * mass;                    // species mass, quantum statistics sign and baryon number
+    double * sign;
+    double * baryon;
+
+    double * log_moment_table;        // [imoment + 3 * (iT + T_bins * (ialphaB + alphaB_bins * ispecies))]
+
+    void interpolate(int ispecies, double T, double alphaB, double * moments);
+
+  public:
+    Thermal_Density_Table(int npart, double * Mass, double * Sign, double * Baryon, double mass_pion0, double T_min_in, double T_max_in, int T_bins_in, double alphaB_min_in, double alphaB_max_in, int alphaB_bins_in);
+    ~Thermal_Density_Table();
+
+    void build_table(Gauss_Laguerre * laguerre);          // tabulate all (species, T, alphaB) in parallel
+
+    bool in_range(double T, double alphaB);
+
+    // same values as GaussThermal(neq_int / J10_int / J20_int, ..., mbar = m / T, alphaB, baryon, sign) with 1st / 2nd order roots
+    void thermal_integrals(int ipart, double T, double alphaB, double * neq, double * J10, double * J20);
+    void pion0_integrals(double T, double * neq, double * J20);
+};
+
+#endif
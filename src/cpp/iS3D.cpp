@@ -16,6 +16,7 @@
 #include "Arsenal.h"
 #include "ParameterReader.h"
 #include "DeltafData.h"
+#include "CooperFrye.h"
 
 
 IS3D::IS3D()
@@ -26,7 +27,31 @@ IS3D::IS3D()
 
 IS3D::~IS3D()
 {
+  if(cooper_frye_ != NULL) delete cooper_frye_;
+}
+
 
+void IS3D::set_particle_event_callback(Particle_Event_Callback callback)
+{
+  particle_event_callback_ = callback;
+}
+
+
+void IS3D::set_compact_particle_storage(bool compact)
+{
+  compact_particle_storage_ = compact;
+}
+
+
+void IS3D::evaluate_cooper_frye(const std::vector<Cooper_Frye_Point> & points, std::vector<double> & E_dN_d3p)
+{
+  if(cooper_frye_ == NULL)
+  {
+    printf("IS3D::evaluate_cooper_frye error: set cooper_frye_api = 1 and run the particlization first\n");
+    exit(-1);
+  }
+
+  cooper_frye_->evaluate(points, E_dN_d3p);
 }
 
 
@@ -224,9 +249,9 @@ void IS3D::run_particlization(int fo_from_file)
 
 
   printf("\n\nReading in particle info from ");
-  particle_info *particle_data = new particle_info[Maxparticle];  // particle info pointer
+  Particle_Table particle_data;                                   // particle info table
   PDG_Data pdg(paraRdr);                                          // PDG class
-  int Nparticle = pdg.read_resonances(particle_data);             // get number of resonances in PDG file
+  pdg.read_resonances(particle_data);                             // read the resonances of the PDG file
 
 
   printf("\n\nReading in chosen particles table from PDG/chosen_particles.dat... (please check if 1 blank line eof)\n\n");
@@ -237,15 +262,17 @@ void IS3D::run_particlization(int fo_from_file)
 
 
   Deltaf_Data *df_data = new Deltaf_Data(paraRdr);               // df data pointer
-  df_data->load_df_coefficient_data();                            // read in df coefficient tables
+  df_data->load_df_coefficient_data(particle_data);               // map the df coefficient bundle, read in the tables or generate them
 
   if(!include_baryon)
   {
     df_data->construct_cubic_splines();                           // prepare cubic spline interpolation (muB = 0)
-    df_data->compute_jonah_coefficients(particle_data, Nparticle);// compute PTB exclusive coefficients (muB = 0)
+    df_data->compute_jonah_coefficients(particle_data);           // compute PTB exclusive coefficients (muB = 0)
   }
 
-  df_data->compute_particle_densities(particle_data, Nparticle);  // compute resonances' particle density (T = T_avg, muB = muB_avg)
+  df_data->write_df_coefficient_bundle();                         // cache the df coefficients (if the bundle is missing or stale)
+
+  df_data->compute_particle_densities(particle_data);             // compute resonances' particle density (T = T_avg, muB = muB_avg)
   df_data->test_df_coefficients(-0.1);                            // test df coefficients for bulk pressure Pi = -Peq/10
 
 
@@ -259,25 +286,49 @@ void IS3D::run_particlization(int fo_from_file)
 
 
   // emission function class (continuous or sampled particle spectra)
-  EmissionFunctionArray efa(paraRdr, &chosen_particles, &pT_tab, &phi_tab, &y_tab, &eta_tab, particle_data, Nparticle, surf_ptr, FO_length, df_data);
+  EmissionFunctionArray efa(paraRdr, &chosen_particles, &pT_tab, &phi_tab, &y_tab, &eta_tab, &particle_data, surf_ptr, FO_length, df_data);
+
+  if(particle_event_callback_) efa.set_particle_event_callback(particle_event_callback_);
 
-  std::vector<std::vector<Sampled_Particle>> particle_event_list_in;    // sampled particle lists (JETSCAPE)
+  Compact_Event_List particle_event_list_in;                            // sampled particle lists (JETSCAPE)
   efa.calculate_spectra(particle_event_list_in);                        // compute particle spectra from Cooper-Frye formula
 
 
+  if(paraRdr->getVal("cooper_frye_api"))
+  {
+    printf("\nPreprocessing the freezeout surface for on-demand Cooper-Frye spectra...\n");
+
+    if(cooper_frye_ != NULL) delete cooper_frye_;
+    cooper_frye_ = new Cooper_Frye_Evaluator(paraRdr, surf_ptr, FO_length, df_data, &particle_data, &eta_tab);
+  }
+
+
   int operation = paraRdr->getVal("operation");
 
   if(operation == 2)
   {
-    printf("\nCopying final particle list to memory (JETSCAPE)\n");
+    printf("\nMoving final particle list to memory (JETSCAPE)\n");
     printf("Event particle list contains %ld events\n", particle_event_list_in.size());
 
-    final_particles_ = particle_event_list_in;                    // store particlization events in memory to pass to afterburner module in JETSCAPE
+    if(compact_particle_storage_)
+    {
+      final_compact_particles_ = std::move(particle_event_list_in); // keep the compact records (expanded per event on access)
+    }
+    else
+    {
+      final_particles_.clear();                                     // store particlization events in memory to pass to afterburner module in JETSCAPE
+      final_particles_.reserve(particle_event_list_in.size());
+
+      for(long ievent = 0; ievent < particle_event_list_in.size(); ievent++)
+      {
+        final_particles_.push_back(particle_event_list_in.event(ievent));
+        std::vector<Compact_Particle>().swap(particle_event_list_in.events[ievent]);  // release each compact event once expanded
+      }
+    }
   }
 
   delete paraRdr;                                                 // delete pointers
   delete [] surf_ptr;
-  delete [] particle_data;
   delete df_data;
 }
 
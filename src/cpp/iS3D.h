@@ -17,10 +17,15 @@ const double two_pi2_hbarC3 = 2.0 * pow(M_PI, 2) * pow(hbarC, 3);
 const double four_pi2_hbarC3 = 4.0 * pow(M_PI, 2) * pow(hbarC, 3);
 
 
-//TO DO remove these hardcoded entries and declare a std::vector<particle_info> which can be appended
-const int Maxparticle = 600; //size of array for storage of the particles
-const int Maxdecaychannel = 50;
-const int Maxdecaypart = 5;
+// momentum point of an on-demand Cooper-Frye evaluation (IS3D::evaluate_cooper_frye)
+typedef struct
+{
+  long mcid;                  // PDG MC ID of the species
+  double px, py, pz;          // lab frame momentum (GeV), on shell
+} Cooper_Frye_Point;
+
+class Cooper_Frye_Evaluator;
+
 
 class IS3D {
 private:
@@ -65,6 +70,25 @@ public:
   // vector to store final particle lists from oversampled events
   std::vector<std::vector<Sampled_Particle>> final_particles_;
 
+  // final particle lists kept as compact records instead (if set_compact_particle_storage(true) was called;
+  // final_particles_ then stays empty and final_compact_particles_.event(i) expands event i)
+  Compact_Event_List final_compact_particles_;
+  bool compact_particle_storage_ = false;
+
+  void set_compact_particle_storage(bool compact);
+
+  // optional callback that receives each sampled event as soon as it is complete
+  // (if set, events are not stored in final_particles_)
+  Particle_Event_Callback particle_event_callback_;
+
+  void set_particle_event_callback(Particle_Event_Callback callback);
+
+  // preprocessed surface kept after run_particlization (cooper_frye_api = 1)
+  Cooper_Frye_Evaluator * cooper_frye_ = NULL;
+
+  // Cooper-Frye spectra E.dN/d^3p (GeV^-2) at a batch of momentum points (requires cooper_frye_api = 1)
+  void evaluate_cooper_frye(const std::vector<Cooper_Frye_Point> & points, std::vector<double> & E_dN_d3p);
+
 
 
   //this calls the particlization routine
@@ -6,6 +6,8 @@
 #include<cmath>
 #include<iomanip>
 #include<stdlib.h>
+#include<vector>
+#include<algorithm>
 
 #include "iS3D.h"
 #include "Macros.h"
@@ -790,6 +792,7 @@ read_mcid::read_mcid(long int mcid_in)
   get_gspin();
   get_baryon();
   get_sign();
+  get_charge();
   does_particle_have_distinct_antiparticle();
 }
 
@@ -936,6 +939,48 @@ void read_mcid::get_sign()
   }
 }
 
+void read_mcid::get_charge()
+{
+  // get the electric charge of the particle from its quark content
+  // (up-type quarks u,c,t have even fields and charge 2/3, down-type d,s,b have odd fields and charge -1/3)
+  if(is_deuteron)
+  {
+    charge = 1;
+    return;
+  }
+  else if(is_hadron)
+  {
+    int q1 = (nq1 % 2 == 0) ? 2 : -1;   // 3 x quark charges
+    int q2 = (nq2 % 2 == 0) ? 2 : -1;
+    int q3 = (nq3 % 2 == 0) ? 2 : -1;
+
+    if(is_baryon)
+    {
+      charge = (q1 + q2 + q3) / 3;
+      return;
+    }
+    else if(nq2 == nq3)
+    {
+      charge = 0;         // quarkonium
+      return;
+    }
+
+    // meson: the heavier quark is a quark if it is up-type, the lighter one is then an antiquark
+    int q_heavy = (nq2 > nq3) ? q2 : q3;
+    int q_light = (nq2 > nq3) ? q3 : q2;
+
+    if(q_heavy == 2) charge = (q_heavy - q_light) / 3;
+    else charge = (q_light - q_heavy) / 3;
+    return;
+  }
+  else
+  {
+    printf("Error: particle is not a deuteron or hadron\n");
+    charge = 0;
+    return;
+  }
+}
+
 void read_mcid::does_particle_have_distinct_antiparticle()
 {
   // check if the particle has distinct antiparticle
@@ -970,132 +1015,138 @@ PDG_Data::~PDG_Data()
 }
 
 
-int PDG_Data::read_resonances_conventional(particle_info * particle, string pdg_filename)
+int PDG_Data::read_resonances_conventional(Particle_Table & particle, string pdg_filename)
 {
   double eps = 1.e-15;
-  int Nparticle = 0;
 
   ifstream resofile(pdg_filename);
-  int local_i = 0;
+
+  long mc_id;
+  string name;
+  double mass, width;
+  int gspin, baryon, strange, charm, bottom, gisospin, charge, decays;
+
   int dummy_int;
+  int Npart;
+  double branchratio;
+  long products[5];
 
-  while(!resofile.eof())
+  vector<int> channel_Npart;
+  vector<double> channel_branchratio;
+  vector<long> channel_products;          // [5 * channel + k]
+
+  while(resofile >> mc_id)
   {
-    resofile >> particle[local_i].mc_id;
-    resofile >> particle[local_i].name;
-    resofile >> particle[local_i].mass;
-    resofile >> particle[local_i].width;
-    resofile >> particle[local_i].gspin;	      //spin degeneracy
-    resofile >> particle[local_i].baryon;
-    resofile >> particle[local_i].strange;
-    resofile >> particle[local_i].charm;
-    resofile >> particle[local_i].bottom;
-    resofile >> particle[local_i].gisospin;     //isospin degeneracy
-    resofile >> particle[local_i].charge;
-    resofile >> particle[local_i].decays;
-
-    for(int j = 0; j < particle[local_i].decays; j++)
+    resofile >> name;
+    resofile >> mass;
+    resofile >> width;
+    resofile >> gspin;	      //spin degeneracy
+    resofile >> baryon;
+    resofile >> strange;
+    resofile >> charm;
+    resofile >> bottom;
+    resofile >> gisospin;     //isospin degeneracy
+    resofile >> charge;
+    resofile >> decays;
+
+    channel_Npart.clear();
+    channel_branchratio.clear();
+    channel_products.clear();
+
+    for(int j = 0; j < decays; j++)
     {
       resofile >> dummy_int;
-      resofile >> particle[local_i].decays_Npart[j];
-      resofile >> particle[local_i].decays_branchratio[j];
-      resofile >> particle[local_i].decays_part[j][0];
-      resofile >> particle[local_i].decays_part[j][1];
-      resofile >> particle[local_i].decays_part[j][2];
-      resofile >> particle[local_i].decays_part[j][3];
-      resofile >> particle[local_i].decays_part[j][4];
+      resofile >> Npart;
+      resofile >> branchratio;
+
+      channel_Npart.push_back(Npart);
+      channel_branchratio.push_back(branchratio);
+
+      for(int k = 0; k < 5; k++)
+      {
+        resofile >> products[k];
+        channel_products.push_back(products[k]);
+      }
+    }
+
+    int sign = (baryon % 2 == 0) ? -1 : 1;
+
+    int ipart = particle.add_particle(mc_id, name, mass, width, gspin, baryon, strange, charm, bottom, gisospin, charge, sign);
+
+    for(int j = 0; j < decays; j++)
+    {
+      particle.add_decay_channel(channel_Npart[j], channel_branchratio[j], &channel_products[5 * j], min(abs(channel_Npart[j]), 5));
     }
 
     //decide whether particle is stable under strong interactions
-    if (particle[local_i].decays_Npart[0] == 1) particle[local_i].stable = 1;
-    else particle[local_i].stable = 0;
+    particle.stable[ipart] = (decays == 0 || channel_Npart[0] == 1) ? 1 : 0;
 
     //add anti-particle entry
-    if (particle[local_i].baryon > 0) // changed on Feb. 2019
+    if (baryon > 0) // changed on Feb. 2019
     {
-      local_i++;
-      particle[local_i].mc_id = -particle[local_i-1].mc_id;
-
       ostringstream antiname;
-      antiname << "Anti-baryon-" << particle[local_i-1].name;
-
-      particle[local_i].name = antiname.str();
-      particle[local_i].mass = particle[local_i-1].mass;
-      particle[local_i].width = particle[local_i-1].width;
-      particle[local_i].gspin = particle[local_i-1].gspin;
-      particle[local_i].baryon = -particle[local_i-1].baryon;
-      particle[local_i].strange = -particle[local_i-1].strange;
-      particle[local_i].charm = -particle[local_i-1].charm;
-      particle[local_i].bottom = -particle[local_i-1].bottom;
-      particle[local_i].gisospin = particle[local_i-1].gisospin;
-      particle[local_i].charge = -particle[local_i-1].charge;
-      particle[local_i].decays = particle[local_i-1].decays;
-      particle[local_i].stable = particle[local_i-1].stable;
-
-      for (int j = 0; j < particle[local_i].decays; j++)
-      {
-        particle[local_i].decays_Npart[j]=particle[local_i-1].decays_Npart[j];
-        particle[local_i].decays_branchratio[j]=particle[local_i-1].decays_branchratio[j];
+      antiname << "Anti-baryon-" << name;
 
-        for (int k=0; k< Maxdecaypart; k++)
+      int ianti = particle.add_particle(-mc_id, antiname.str(), mass, width, gspin, -baryon, -strange, -charm, -bottom, gisospin, -charge, sign);
+
+      particle.stable[ianti] = particle.stable[ipart];
+
+      for (int j = 0; j < decays; j++)
+      {
+        for (int k = 0; k < 5; k++)
         {
-          if(particle[local_i-1].decays_part[j][k] == 0) particle[local_i].decays_part[j][k] = (particle[local_i-1].decays_part[j][k]);
+          long product = channel_products[5 * j + k];
+
+          if(product == 0) products[k] = 0;
           else
           {
-            int idx;
             // find the index for decay particle
-            for(idx = 0; idx < local_i; idx++)
-            if (particle[idx].mc_id == particle[local_i-1].decays_part[j][k]) break;
-            if(idx == local_i && particle[local_i-1].stable == 0 && particle[local_i-1].decays_branchratio[j] > eps)
+            int idx = particle.find(product);
+
+            if(idx == -1 && particle.stable[ipart] == 0 && channel_branchratio[j] > eps)
             {
               cout << "Error: can not find decay particle index for anti-baryon!" << endl;
-              cout << "particle mc_id : " << particle[local_i-1].decays_part[j][k] << endl;
+              cout << "particle mc_id : " << product << endl;
               exit(1);
             }
-            if (particle[idx].baryon == 0 && particle[idx].charge == 0 && particle[idx].strange == 0) particle[local_i].decays_part[j][k] = (particle[local_i-1].decays_part[j][k]);
-            else particle[local_i].decays_part[j][k] = (- particle[local_i-1].decays_part[j][k]);
+            if (idx != -1 && particle.baryon[idx] == 0 && particle.charge[idx] == 0 && particle.strange[idx] == 0) products[k] = product;
+            else products[k] = - product;
           }
         }
+
+        particle.add_decay_channel(channel_Npart[j], channel_branchratio[j], products, min(abs(channel_Npart[j]), 5));
       }
     }
-    local_i++;	// Add one to the counting variable "i" for the meson/baryon
   }
   resofile.close();
-  Nparticle = local_i - 1; //take account the final fake one
-  for (int i = 0; i < Nparticle; i++)
-  {
-    //if (particle[i].baryon == 0) particle[i].sign = -1; // this made deuteron a fermion
-    if (particle[i].baryon % 2 == 0) particle[i].sign = -1;
-    else particle[i].sign = 1;
-  }
+
+  int Nparticle = particle.size;
 
   // count the number of mesons, baryons and antibaryons
   int meson = 0;
-  int baryon = 0;
-  int antibaryon = 0;
+  int baryon_count = 0;
+  int antibaryon_count = 0;
 
   for(int i = 0; i < Nparticle; i++)
   {
-    if(particle[i].baryon == 0) meson++;
-    else if(particle[i].baryon > 0) baryon++;
-    else if(particle[i].baryon < 0) antibaryon++;
+    if(particle.baryon[i] == 0) meson++;
+    else if(particle.baryon[i] > 0) baryon_count++;
+    else if(particle.baryon[i] < 0) antibaryon_count++;
   }
-  if(baryon != antibaryon) printf("Error: (anti)baryons not paired correctly\n");
+  if(baryon_count != antibaryon_count) printf("Error: (anti)baryons not paired correctly\n");
 
   printf("\nNumber of resonances = %d\n\n\t", Nparticle);
   printf("%d mesons\n\t", meson);
-  printf("%d baryons\n\t", baryon);
-  printf("%d antibaryons\n\n", antibaryon);
+  printf("%d baryons\n\t", baryon_count);
+  printf("%d antibaryons\n\n", antibaryon_count);
 
-  particle_info last_particle = particle[Nparticle - 1];
-
-  printf("Last particle has mcid = %ld, %s, m = %lf GeV (please check this) \n\n", last_particle.mc_id, last_particle.name.c_str(), last_particle.mass);
+  printf("Last particle has mcid = %ld, %s, m = %lf GeV (please check this) \n\n", particle.mc_id[Nparticle - 1], particle.name[Nparticle - 1].c_str(), particle.mass[Nparticle - 1]);
 
   return Nparticle;
 }
 
 
-int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_filename)
+int PDG_Data::read_resonances_smash_box(Particle_Table & particle, string pdg_filename)
 {
   //******************************|
   //******************************|
@@ -1116,8 +1167,6 @@ int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_fil
 
   ifstream pdg_smash_box(pdg_filename);
 
-  int i = 0;  // particle index
-
   while(getline(pdg_smash_box, line))
   {
       istringstream current_line(line);
@@ -1139,15 +1188,8 @@ int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_fil
           // get remaining particle info from the mcid
           read_mcid mcid_info(mc_id[k]);
 
-          particle[i].name = name;
-          particle[i].mass = mass;
-          particle[i].width = width;
-          particle[i].mc_id = mc_id[k];
-          particle[i].gspin = mcid_info.gspin;
-          particle[i].baryon = mcid_info.baryon;
-          particle[i].sign = mcid_info.sign;
-
-          i++;
+          // (strangeness, charm, bottom and isospin degeneracy aren't used)
+          particle.add_particle(mc_id[k], name, mass, width, mcid_info.gspin, mcid_info.baryon, 0, 0, 0, 0, mcid_info.charge, mcid_info.sign);
 
           if(mcid_info.has_antiparticle)
           {
@@ -1155,16 +1197,7 @@ int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_fil
             ostringstream antiname;
               antiname << "Anti-" << name;
 
-            particle[i].name = antiname.str();
-            particle[i].mass = mass;
-            particle[i].width = width;
-            particle[i].mc_id = -mc_id[k];
-            particle[i].gspin = mcid_info.gspin;
-            particle[i].baryon = -mcid_info.baryon;
-            particle[i].sign = mcid_info.sign;
-
-            i++;
-
+            particle.add_particle(-mc_id[k], antiname.str(), mass, width, mcid_info.gspin, -mcid_info.baryon, 0, 0, 0, 0, -mcid_info.charge, mcid_info.sign);
           } // add antiparticle
 
         } // check if mc_id if nonzero
@@ -1174,19 +1207,13 @@ int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_fil
 
       } // mcid index
 
-      if(i > (Maxparticle -1))
-      {
-        printf("\nError: number of particles in file exceeds Maxparticle = %d. Exiting...\n\n", Maxparticle);
-        exit(-1);
-      }
-
   } // scanning file
 
   pdg_smash_box.close();
 
   free(mc_id);
 
-  int Nparticle = i;  // total number of resonances
+  int Nparticle = particle.size;  // total number of resonances
 
   // count the number of mesons, baryons and antibaryons
   int meson = 0;
@@ -1195,9 +1222,9 @@ int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_fil
 
   for(int i = 0; i < Nparticle; i++)
   {
-    if(particle[i].baryon == 0) meson++;
-    else if(particle[i].baryon > 0) baryon++;
-    else if(particle[i].baryon < 0) antibaryon++;
+    if(particle.baryon[i] == 0) meson++;
+    else if(particle.baryon[i] > 0) baryon++;
+    else if(particle.baryon[i] < 0) antibaryon++;
   }
   if(baryon != antibaryon) printf("Error: (anti)baryons not paired correctly\n");
 
@@ -1206,15 +1233,13 @@ int PDG_Data::read_resonances_smash_box(particle_info * particle, string pdg_fil
   printf("%d baryons\n\t", baryon);
   printf("%d antibaryons\n\n", antibaryon);
 
-  particle_info last_particle = particle[Nparticle - 1];
-
-  printf("Last particle is mcid = %ld, %s, m = %lf GeV (please check this) \n\n", last_particle.mc_id, last_particle.name.c_str(), last_particle.mass);
+  printf("Last particle is mcid = %ld, %s, m = %lf GeV (please check this) \n\n", particle.mc_id[Nparticle - 1], particle.name[Nparticle - 1].c_str(), particle.mass[Nparticle - 1]);
 
   return Nparticle;
 }
 
 
-int PDG_Data::read_resonances(particle_info * particle)
+int PDG_Data::read_resonances(Particle_Table & particle)
 {
   int Nparticle;
 
@@ -3,6 +3,7 @@
 
 #include "iS3D.h"
 #include "ParameterReader.h"
+#include "ParticleTable.h"
 #include <fstream>
 
 using namespace std;
@@ -49,33 +50,6 @@ class Plasma
     void load_thermodynamic_averages();
 };
 
-typedef struct
-{
-  long int mc_id; // Monte Carlo number according PDG
-  string name;
-  double mass;
-  double width;
-  int gspin; // spin degeneracy
-  int baryon;
-  int strange;
-  int charm;
-  int bottom;
-  int gisospin; // isospin degeneracy
-  int charge;
-  int decays; // amount of decays listed for this resonance
-  int stable; // defines whether this particle is considered as stable
-  int decays_Npart[Maxdecaychannel];
-  double decays_branchratio[Maxdecaychannel];
-  int decays_part[Maxdecaychannel][Maxdecaypart];
-  int sign; //Bose-Einstein or Dirac-Fermi statistics
-
-  // ~ particle number / cell volume (for sampler routine)
-  double equilibrium_density; // equilibrium density  (thermal number / u.dsigma)
-  double bulk_density;        // bulk correction      (bulk number / u.dsigma / bulkPi)
-  double diff_density;        // diffusion correction (diffusion number / V.dsigma)
-
-} particle_info;
-
 typedef struct
 {
    double tau, x, y, eta;                 // contravariant spacetime position x^\mu
@@ -140,6 +114,7 @@ class read_mcid
     int spin;               // spin x 2
     int gspin;              // spin degeneracy
     int sign;               // quantum statistics sign (BE, FD) = (-1, 1)
+    int charge;             // electric charge
 
     uint32_t nJ  : 4;       // spin quantum number nJ = 2J + 1
     uint32_t nq3 : 4;       // third quark field
@@ -162,6 +137,7 @@ class read_mcid
     void get_spin();                                  // get the spin x 2
     void get_gspin();                                 // get the spin degeneracy
     void get_sign();                                  // get the quantum statistics sign
+    void get_charge();                                // get the electric charge
     void does_particle_have_distinct_antiparticle();  // determine if there's a distinct antiparticle
 
 };
@@ -202,9 +178,9 @@ class PDG_Data
     PDG_Data(ParameterReader * paraRdr_in);
     ~PDG_Data();
 
-    int read_resonances_conventional(particle_info * particle, string pdg_filename);
-    int read_resonances_smash_box(particle_info * particle, string pdg_filename);
-    int read_resonances(particle_info * particle);
+    int read_resonances_conventional(Particle_Table & particle, string pdg_filename);
+    int read_resonances_smash_box(Particle_Table & particle, string pdg_filename);
+    int read_resonances(Particle_Table & particle);     // appends the resonances (and antiparticles) to the table
 };
 
 #endif